@@ -0,0 +1,170 @@
+#include "alloc_trace.h"
+
+#if ALLOC_TRACE_ENABLED
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_memory_utils.h"
+#include "esp_system.h"
+
+#define TASK_NAME_SIZE 16                 // configMAX_TASK_NAME_LEN
+
+typedef struct {
+    void *ptr;                            // Block returned to the caller
+    uint32_t size;                        // Requested size
+    bool freed;                           // Freed since
+    char task[TASK_NAME_SIZE];            // Allocating task, "-" before the scheduler
+    void *callers[ALLOC_TRACE_DEPTH];     // Return addresses, innermost first
+} alloc_record_t;
+
+static const char *TAG = "alloc_trace";                    // Logging tag
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the records
+static volatile bool armed;                                // Allocations are recorded
+static bool steady;                                        // Allocations are violations
+static alloc_record_t records[ALLOC_TRACE_RECORDS];        // Ring of the last allocations
+static uint32_t alloc_count;                               // Allocations since armed, next = alloc_count % size
+static uint32_t free_count;                                // Frees since armed
+static uint32_t violation_count;                           // Allocations in steady state
+
+/**
+ * @brief Collects the return addresses of the current call chain
+ * @details Needs the frame pointers of CONFIG_ESP_SYSTEM_USE_FRAME_POINTER:
+ * below the frame address of a function lie its return address and the frame
+ * address of its caller. Without them only the direct caller is known.
+ */
+static void IRAM_ATTR get_callers(void **callers) {
+    memset(callers, 0, ALLOC_TRACE_DEPTH * sizeof(void *));
+#if CONFIG_ESP_SYSTEM_USE_FRAME_POINTER
+    void **fp = __builtin_frame_address(0);
+    for (int i = 0; i < ALLOC_TRACE_DEPTH; i++) {
+        if (!esp_stack_ptr_is_sane((uint32_t)fp)) break;
+        void *ra = fp[-1];
+        if (!esp_ptr_executable(ra)) break;
+        callers[i] = ra;
+        fp = fp[-2];
+    }
+#else
+    callers[0] = __builtin_return_address(0);
+#endif
+}
+
+/**
+ * @brief Heap hook, called by the heap after every allocation
+ * @details Runs with the heap in use: must not allocate, block or log through
+ * the regular logger.
+ */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+    if (!armed || !ptr) return;
+
+    portENTER_CRITICAL_SAFE(&trace_lock);
+    alloc_record_t *record = &records[alloc_count % ALLOC_TRACE_RECORDS];
+    record->ptr = ptr;
+    record->size = size;
+    record->freed = false;
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    strncpy(record->task, task ? pcTaskGetName(task) : "-", TASK_NAME_SIZE - 1);
+    record->task[TASK_NAME_SIZE - 1] = '\0';
+    get_callers(record->callers);
+    alloc_count++;
+    bool warn = steady && violation_count++ < ALLOC_TRACE_WARNINGS;
+
+    // The record can be reused by another task once the lock is released
+    char task_name[TASK_NAME_SIZE];
+    void *caller = record->callers[0];
+    if (warn) memcpy(task_name, record->task, TASK_NAME_SIZE);
+    portEXIT_CRITICAL_SAFE(&trace_lock);
+
+    if (warn) {
+        ESP_DRAM_LOGW(TAG, "Steady-state allocation of %u bytes in %s from %p",
+                      (unsigned)size, task_name, caller);
+    }
+}
+
+/**
+ * @brief Heap hook, called by the heap before every free
+ */
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr) {
+    if (!armed || !ptr) return;
+
+    portENTER_CRITICAL_SAFE(&trace_lock);
+    free_count++;
+    for (int i = 0; i < ALLOC_TRACE_RECORDS; i++) {
+        if (records[i].ptr == ptr && !records[i].freed) {
+            records[i].freed = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&trace_lock);
+}
+
+/**
+ * @brief Clears the records and starts recording allocations
+ * @param steady_state Steady state, the firmware should not allocate anymore
+ */
+void alloc_trace_arm(bool steady_state) {
+    portENTER_CRITICAL(&trace_lock);
+    memset(records, 0, sizeof(records));
+    alloc_count = 0;
+    free_count = 0;
+    violation_count = 0;
+    steady = steady_state;
+    armed = true;
+    portEXIT_CRITICAL(&trace_lock);
+    ESP_LOGI(TAG, "Recording allocations%s", steady_state ? ", steady state" : "");
+}
+
+/**
+ * @brief Stops recording, the records are kept for alloc_trace_dump()
+ */
+void alloc_trace_disarm(void) {
+    armed = false;
+}
+
+/**
+ * @brief Allocations seen in steady state since alloc_trace_arm()
+ */
+uint32_t alloc_trace_violations(void) {
+    return violation_count;
+}
+
+/**
+ * @brief Writes the records as text
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void alloc_trace_dump(alloc_trace_write_fn write, void *arg) {
+    char line[160];
+    int len;
+
+    // Sending allocates, those blocks must not overwrite the records being sent
+    bool was_armed = armed;
+    armed = false;
+
+    len = snprintf(line, sizeof(line), "# alloc armed=%d steady=%d allocs=%" PRIu32 " frees=%" PRIu32
+                   " violations=%" PRIu32 " free_heap=%" PRIu32 "\n", was_armed, steady, alloc_count,
+                   free_count, violation_count, esp_get_free_heap_size());
+    write(line, len, arg);
+
+    // Oldest first
+    uint32_t count = alloc_count < ALLOC_TRACE_RECORDS ? alloc_count : ALLOC_TRACE_RECORDS;
+    for (uint32_t n = alloc_count - count; n < alloc_count; n++) {
+        const alloc_record_t *record = &records[n % ALLOC_TRACE_RECORDS];
+        len = snprintf(line, sizeof(line), "%08" PRIx32 " %" PRIu32 " %d %s", (uint32_t)record->ptr,
+                       record->size, record->freed, record->task);
+        for (int i = 0; i < ALLOC_TRACE_DEPTH && record->callers[i]; i++) {
+            len += snprintf(line + len, sizeof(line) - len, " %08" PRIx32, (uint32_t)record->callers[i]);
+        }
+        line[len++] = '\n';
+        write(line, len, arg);
+    }
+
+    armed = was_armed;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+// Built only with the heap hooks, see sdkconfig.alloc_trace
+#ifdef CONFIG_HEAP_USE_HOOKS
+#define ALLOC_TRACE_ENABLED 1
+#else
+#define ALLOC_TRACE_ENABLED 0
+#endif
+
+#define ALLOC_TRACE_RECORDS    64          // Allocations kept, the oldest are overwritten
+#define ALLOC_TRACE_DEPTH      6           // Return addresses kept per allocation
+#define ALLOC_TRACE_WARNINGS   8           // Steady-state violations logged, the rest are counted
+
+/**
+ * @brief Receives the dump one line at a time
+ */
+typedef void (*alloc_trace_write_fn)(const char *line, size_t len, void *arg);
+
+#if ALLOC_TRACE_ENABLED
+
+/**
+ * @brief Clears the records and starts recording allocations
+ * @details Every allocation keeps its address, size, task and
+ * ALLOC_TRACE_DEPTH return addresses, walked through the frame pointers.
+ * A free of a recorded block marks it freed. In steady state every allocation
+ * is a violation: the first ALLOC_TRACE_WARNINGS are logged.
+ * @param steady Steady state, the firmware should not allocate anymore
+ */
+void alloc_trace_arm(bool steady);
+
+/**
+ * @brief Stops recording, the records are kept for alloc_trace_dump()
+ */
+void alloc_trace_disarm(void);
+
+/**
+ * @brief Allocations seen in steady state since alloc_trace_arm()
+ */
+uint32_t alloc_trace_violations(void);
+
+/**
+ * @brief Writes the records as text
+ * @details Recording pauses during the dump. Format, one record per line:
+ *   # alloc armed=<0|1> steady=<0|1> allocs=<n> frees=<n> violations=<n> free_heap=<n>
+ *   <address hex> <size> <freed 0|1> <task> <return address hex>...
+ * tools/heap_check.py symbolizes it and compares the call sites to a baseline.
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void alloc_trace_dump(alloc_trace_write_fn write, void *arg);
+
+#else
+
+static inline void alloc_trace_arm(bool steady) {}
+static inline void alloc_trace_disarm(void) {}
+static inline uint32_t alloc_trace_violations(void) { return 0; }
+static inline void alloc_trace_dump(alloc_trace_write_fn write, void *arg) {}
+
+#endif
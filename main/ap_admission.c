@@ -0,0 +1,203 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "ap_admission.h"
+
+/**
+ * @brief State of one associated station
+ */
+typedef struct {
+    bool used;                            // Slot in use
+    uint8_t mac[6];                       // Station MAC
+    uint32_t ip;                          // DHCP lease, 0 until assigned
+    int64_t lease_ms;                     // Time the lease was handed out
+    int64_t last_activity_ms;             // Association, lease or traffic
+    bool finished;                        // Provisioning completed
+    int64_t finished_ms;                  // Time provisioning completed
+} ap_station_t;
+
+static ap_station_t stations[AP_MAX_STATIONS];
+static portMUX_TYPE stations_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Finds a station by MAC, caller holds the lock
+ */
+static ap_station_t *find_by_mac(const uint8_t mac[6]) {
+    for (int i = 0; i < AP_MAX_STATIONS; i++) {
+        if (stations[i].used && memcmp(stations[i].mac, mac, 6) == 0) return &stations[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds a station by leased IP, caller holds the lock
+ */
+static ap_station_t *find_by_ip(uint32_t ip) {
+    for (int i = 0; i < AP_MAX_STATIONS; i++) {
+        if (stations[i].used && stations[i].ip == ip) return &stations[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Picks the station that is most useless right now, caller holds the lock
+ * @param need_slot true if the AP is full and idle stations may go early
+ */
+static ap_station_t *pick_victim(int64_t now_ms, bool need_slot) {
+    ap_station_t *victim = NULL;
+
+    for (int i = 0; i < AP_MAX_STATIONS; i++) {
+        ap_station_t *sta = &stations[i];
+        if (!sta->used) continue;
+
+        // Finished stations go first, the one that finished earliest
+        if (sta->finished && (need_slot || now_ms - sta->finished_ms >= AP_FINISHED_LINGER_MS)) {
+            if (!victim || !victim->finished || sta->finished_ms < victim->finished_ms) victim = sta;
+            continue;
+        }
+        if (victim && victim->finished) continue;
+
+        // Then the station idle for the longest time
+        int64_t idle_ms = now_ms - sta->last_activity_ms;
+        int64_t limit_ms = need_slot ? AP_IDLE_TIMEOUT_MS : AP_IDLE_HARD_TIMEOUT_MS;
+        if (idle_ms >= limit_ms && (!victim || sta->last_activity_ms < victim->last_activity_ms)) {
+            victim = sta;
+        }
+    }
+    return victim;
+}
+
+/**
+ * @brief Clears the station table
+ */
+void ap_admission_init(void) {
+    portENTER_CRITICAL(&stations_lock);
+    memset(stations, 0, sizeof(stations));
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+/**
+ * @brief Admission control for a newly associated station
+ * @param mac Station MAC
+ * @param now_ms Current time in milliseconds
+ * @param evict_mac Station to deauthenticate when AP_ADMIT_AFTER_EVICT is returned
+ * @return Admission decision
+ */
+ap_admission_decision_t ap_admission_on_connect(const uint8_t mac[6], int64_t now_ms, uint8_t evict_mac[6]) {
+    ap_admission_decision_t decision = AP_ADMIT;
+    ap_station_t *slot = NULL;
+
+    portENTER_CRITICAL(&stations_lock);
+    slot = find_by_mac(mac);
+    for (int i = 0; !slot && i < AP_MAX_STATIONS; i++) {
+        if (!stations[i].used) slot = &stations[i];
+    }
+
+    // Full: make room by evicting an idle or finished station, if there is one
+    if (!slot) {
+        slot = pick_victim(now_ms, true);
+        if (slot) {
+            memcpy(evict_mac, slot->mac, 6);
+            decision = AP_ADMIT_AFTER_EVICT;
+        } else {
+            decision = AP_REJECT;
+        }
+    }
+
+    if (slot) {
+        memset(slot, 0, sizeof(*slot));
+        slot->used = true;
+        memcpy(slot->mac, mac, 6);
+        slot->last_activity_ms = now_ms;
+    }
+    portEXIT_CRITICAL(&stations_lock);
+
+    return decision;
+}
+
+/**
+ * @brief Removes a station that left or was deauthenticated
+ */
+void ap_admission_on_disconnect(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&stations_lock);
+    ap_station_t *sta = find_by_mac(mac);
+    if (sta) sta->used = false;
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+/**
+ * @brief Records the DHCP lease handed out to a station
+ */
+void ap_admission_on_lease(const uint8_t mac[6], uint32_t ip, int64_t now_ms) {
+    portENTER_CRITICAL(&stations_lock);
+    ap_station_t *sta = find_by_mac(mac);
+    if (sta) {
+        sta->ip = ip;
+        sta->lease_ms = now_ms;
+        sta->last_activity_ms = now_ms;
+    }
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+/**
+ * @brief Records frames received from a station
+ */
+void ap_admission_note_station(const uint8_t mac[6], int64_t now_ms) {
+    portENTER_CRITICAL(&stations_lock);
+    ap_station_t *sta = find_by_mac(mac);
+    if (sta) sta->last_activity_ms = now_ms;
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+/**
+ * @brief Records traffic from a station
+ */
+void ap_admission_note_activity(uint32_t ip, int64_t now_ms) {
+    portENTER_CRITICAL(&stations_lock);
+    ap_station_t *sta = find_by_ip(ip);
+    if (sta) sta->last_activity_ms = now_ms;
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+/**
+ * @brief Marks the provisioning session of a station as finished
+ */
+void ap_admission_mark_finished(uint32_t ip, int64_t now_ms) {
+    portENTER_CRITICAL(&stations_lock);
+    ap_station_t *sta = find_by_ip(ip);
+    if (sta && !sta->finished) {
+        sta->finished = true;
+        sta->finished_ms = now_ms;
+    }
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+/**
+ * @brief Picks the next station to evict
+ * @param now_ms Current time in milliseconds
+ * @param mac_out MAC of the station to deauthenticate
+ * @return true if a station should be evicted
+ */
+bool ap_admission_next_eviction(int64_t now_ms, uint8_t mac_out[6]) {
+    portENTER_CRITICAL(&stations_lock);
+    // A full table lets idle stations go early so the next technician can join
+    bool need_slot = ap_admission_station_count() >= AP_MAX_STATIONS;
+    ap_station_t *victim = pick_victim(now_ms, need_slot);
+    if (victim) {
+        memcpy(mac_out, victim->mac, 6);
+        victim->used = false;
+    }
+    portEXIT_CRITICAL(&stations_lock);
+
+    return victim != NULL;
+}
+
+/**
+ * @brief Number of stations in the table
+ */
+int ap_admission_station_count(void) {
+    int count = 0;
+    for (int i = 0; i < AP_MAX_STATIONS; i++) {
+        if (stations[i].used) count++;
+    }
+    return count;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Soft-AP station management
+#define AP_MAX_STATIONS        4          // Stations served at the same time
+#define AP_IDLE_TIMEOUT_MS     60000      // Idle stations are evicted when a slot is needed
+#define AP_IDLE_HARD_TIMEOUT_MS 300000    // Idle stations are always evicted after this
+#define AP_FINISHED_LINGER_MS  10000      // Time a finished station may stay to read the result
+
+/**
+ * @brief Decision taken for a newly associated station
+ */
+typedef enum {
+    AP_ADMIT,                             // Slot available
+    AP_ADMIT_AFTER_EVICT,                 // Slot freed by evicting the returned station
+    AP_REJECT,                            // All slots busy with active stations
+} ap_admission_decision_t;
+
+/**
+ * @brief Clears the station table
+ */
+void ap_admission_init(void);
+
+/**
+ * @brief Admission control for a newly associated station
+ * @param mac Station MAC
+ * @param now_ms Current time in milliseconds
+ * @param evict_mac Station to deauthenticate when AP_ADMIT_AFTER_EVICT is returned
+ * @return Admission decision
+ */
+ap_admission_decision_t ap_admission_on_connect(const uint8_t mac[6], int64_t now_ms, uint8_t evict_mac[6]);
+
+/**
+ * @brief Removes a station that left or was deauthenticated
+ */
+void ap_admission_on_disconnect(const uint8_t mac[6]);
+
+/**
+ * @brief Records the DHCP lease handed out to a station
+ * @param mac Station MAC
+ * @param ip Assigned IPv4 address (network byte order)
+ * @param now_ms Current time in milliseconds
+ */
+void ap_admission_on_lease(const uint8_t mac[6], uint32_t ip, int64_t now_ms);
+
+/**
+ * @brief Records frames received from a station
+ * @details Counts any unicast traffic, so a station waiting in the accept
+ * backlog of the server or still before its lease is not idle.
+ * @param mac Station MAC
+ * @param now_ms Current time in milliseconds
+ */
+void ap_admission_note_station(const uint8_t mac[6], int64_t now_ms);
+
+/**
+ * @brief Records traffic from a station
+ * @param ip Source IPv4 address (network byte order)
+ * @param now_ms Current time in milliseconds
+ */
+void ap_admission_note_activity(uint32_t ip, int64_t now_ms);
+
+/**
+ * @brief Marks the provisioning session of a station as finished
+ * @param ip Source IPv4 address (network byte order)
+ * @param now_ms Current time in milliseconds
+ */
+void ap_admission_mark_finished(uint32_t ip, int64_t now_ms);
+
+/**
+ * @brief Picks the next station to evict
+ * @details Finished stations are evicted after AP_FINISHED_LINGER_MS. Idle
+ * stations are evicted after AP_IDLE_TIMEOUT_MS when the AP is full, and after
+ * AP_IDLE_HARD_TIMEOUT_MS in any case.
+ * @param now_ms Current time in milliseconds
+ * @param mac_out MAC of the station to deauthenticate
+ * @return true if a station should be evicted
+ */
+bool ap_admission_next_eviction(int64_t now_ms, uint8_t mac_out[6]);
+
+/**
+ * @brief Number of stations in the table
+ */
+int ap_admission_station_count(void);
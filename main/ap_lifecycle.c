@@ -0,0 +1,86 @@
+#include <string.h>
+#include "ap_lifecycle.h"
+
+#define HOUR_MS       (60 * 60 * 1000)
+#define TU_US         1024                // One time unit in microseconds
+
+/**
+ * @brief Starts a provisioning window in the active state
+ */
+void ap_lifecycle_init(ap_lifecycle_t *lc, const ap_lifecycle_policy_t *policy, int64_t now_ms) {
+    memset(lc, 0, sizeof(*lc));
+    lc->policy = *policy;
+    ap_lifecycle_wake(lc, now_ms);
+}
+
+/**
+ * @brief External wake trigger (button, command): reopens the window as active
+ */
+void ap_lifecycle_wake(ap_lifecycle_t *lc, int64_t now_ms) {
+    lc->state = AP_STATE_ACTIVE;
+    lc->window_start_ms = now_ms;
+    lc->last_station_ms = now_ms;
+}
+
+/**
+ * @brief Evaluates the policy
+ * @param lc State machine
+ * @param stations Number of associated stations
+ * @param now_ms Current time in milliseconds
+ * @return State after the evaluation
+ */
+ap_state_t ap_lifecycle_update(ap_lifecycle_t *lc, int stations, int64_t now_ms) {
+    const ap_lifecycle_policy_t *policy = &lc->policy;
+
+    if (lc->state == AP_STATE_OFF) {
+        if (policy->wake_interval_ms && now_ms - lc->off_since_ms >= policy->wake_interval_ms) {
+            ap_lifecycle_wake(lc, now_ms);
+        }
+        return lc->state;
+    }
+
+    // Never pull the AP from under a station
+    if (stations > 0) {
+        lc->last_station_ms = now_ms;
+        return lc->state;
+    }
+
+    if (policy->window_ms && now_ms - lc->window_start_ms >= policy->window_ms) {
+        lc->state = AP_STATE_OFF;
+        lc->off_since_ms = now_ms;
+    } else if (now_ms - lc->last_station_ms >= policy->idle_after_ms) {
+        lc->state = AP_STATE_IDLE;
+    }
+    return lc->state;
+}
+
+/**
+ * @brief Estimates the radio cost of a policy over the first hour without visitors
+ * @param policy Policy to evaluate
+ * @param beacon_airtime_us Airtime of one beacon frame
+ * @param out Estimate output
+ */
+void ap_lifecycle_estimate_hour(const ap_lifecycle_policy_t *policy, uint32_t beacon_airtime_us,
+                                ap_lifecycle_estimate_t *out) {
+    uint64_t active_ms = 0, idle_ms = 0;
+    uint64_t t = 0;
+
+    // Walk through windows and off periods until the hour is over
+    while (t < HOUR_MS) {
+        uint64_t window = policy->window_ms ? policy->window_ms : HOUR_MS;
+        if (window > HOUR_MS - t) window = HOUR_MS - t;
+
+        uint64_t active = policy->idle_after_ms < window ? policy->idle_after_ms : window;
+        active_ms += active;
+        idle_ms += window - active;
+        t += window;
+
+        if (!policy->window_ms || !policy->wake_interval_ms) break;
+        t += policy->wake_interval_ms;
+    }
+
+    out->radio_on_ms = (uint32_t)(active_ms + idle_ms);
+    uint64_t beacons = active_ms * 1000 / ((uint64_t)policy->active_beacon_tu * TU_US) +
+                       idle_ms * 1000 / ((uint64_t)policy->idle_beacon_tu * TU_US);
+    out->beacon_airtime_ms = (uint32_t)(beacons * beacon_airtime_us / 1000);
+}
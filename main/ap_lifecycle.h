@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Lifecycle state of the provisioning soft-AP
+ */
+typedef enum {
+    AP_STATE_ACTIVE = 0,                  // Normal beaconing, someone is or was just around
+    AP_STATE_IDLE,                        // Nobody around: long beacon interval and DTIM
+    AP_STATE_OFF,                         // Provisioning window closed, AP stopped
+} ap_state_t;
+
+/**
+ * @brief Lifecycle policy
+ */
+typedef struct {
+    uint32_t window_ms;                   // AP lifetime after a (re)start, 0 = unlimited
+    uint32_t idle_after_ms;               // Time without stations before going idle
+    uint32_t wake_interval_ms;            // Reopen the window this long after closing it, 0 = never
+    uint16_t active_beacon_tu;            // Beacon interval while active (1 TU = 1024 us)
+    uint16_t idle_beacon_tu;              // Beacon interval while idle
+    uint8_t active_dtim;                  // DTIM period while active
+    uint8_t idle_dtim;                    // DTIM period while idle
+} ap_lifecycle_policy_t;
+
+// Default: 10 minute window, idle after 2 minutes, reopen every 30 minutes
+#define AP_LIFECYCLE_DEFAULT_POLICY() { \
+    .window_ms = 10 * 60 * 1000,        \
+    .idle_after_ms = 2 * 60 * 1000,     \
+    .wake_interval_ms = 30 * 60 * 1000, \
+    .active_beacon_tu = 100,            \
+    .idle_beacon_tu = 1000,             \
+    .active_dtim = 1,                   \
+    .idle_dtim = 3,                     \
+}
+
+/**
+ * @brief Lifecycle state machine
+ */
+typedef struct {
+    ap_lifecycle_policy_t policy;
+    ap_state_t state;
+    int64_t window_start_ms;              // Start of the current provisioning window
+    int64_t last_station_ms;              // Last time a station was associated
+    int64_t off_since_ms;                 // Time the AP was switched off
+} ap_lifecycle_t;
+
+/**
+ * @brief Estimated radio cost of a policy for one hour without visitors
+ */
+typedef struct {
+    uint32_t radio_on_ms;                 // Time the AP keeps the radio on
+    uint32_t beacon_airtime_ms;           // Time spent transmitting beacons
+} ap_lifecycle_estimate_t;
+
+/**
+ * @brief Starts a provisioning window in the active state
+ */
+void ap_lifecycle_init(ap_lifecycle_t *lc, const ap_lifecycle_policy_t *policy, int64_t now_ms);
+
+/**
+ * @brief Evaluates the policy
+ * @details Stations keep the current state (changing the beacon interval
+ * restarts the AP and would drop them). Without stations the AP goes idle after
+ * idle_after_ms and off when the window closes, and comes back after
+ * wake_interval_ms.
+ * @param lc State machine
+ * @param stations Number of associated stations
+ * @param now_ms Current time in milliseconds
+ * @return State after the evaluation
+ */
+ap_state_t ap_lifecycle_update(ap_lifecycle_t *lc, int stations, int64_t now_ms);
+
+/**
+ * @brief External wake trigger (button, command): reopens the window as active
+ */
+void ap_lifecycle_wake(ap_lifecycle_t *lc, int64_t now_ms);
+
+/**
+ * @brief Estimates the radio cost of a policy over the first hour without visitors
+ * @details The soft-AP does not sleep, so the radio is on for the whole time the
+ * AP exists; the beacon interval only changes the transmit airtime.
+ * @param policy Policy to evaluate
+ * @param beacon_airtime_us Airtime of one beacon frame
+ * @param out Estimate output
+ */
+void ap_lifecycle_estimate_hour(const ap_lifecycle_policy_t *policy, uint32_t beacon_airtime_us,
+                                ap_lifecycle_estimate_t *out);
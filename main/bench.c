@@ -0,0 +1,72 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "bench.h"
+
+typedef struct {
+    const char *metric;
+    int64_t value;
+} bench_metric_t;
+
+static const char *TAG = "BENCH";                          // Logging tag, parsed by the host tools
+static bench_metric_t metrics[BENCH_MAX_METRICS];
+static int metric_count;
+static portMUX_TYPE bench_lock = portMUX_INITIALIZER_UNLOCKED; // Protects metrics
+
+/**
+ * @brief Finds a metric, adding it on first use
+ * @return The metric, NULL if the table is full
+ */
+static bench_metric_t *find(const char *metric) {
+    for (int i = 0; i < metric_count; i++) {
+        if (strcmp(metrics[i].metric, metric) == 0) return &metrics[i];
+    }
+    if (metric_count == BENCH_MAX_METRICS) return NULL;
+    metrics[metric_count] = (bench_metric_t){ .metric = metric };
+    return &metrics[metric_count++];
+}
+
+/**
+ * @brief Sets a metric and logs it as a BENCH line
+ * @param metric Name, must stay valid (string literal)
+ * @param value New value
+ */
+void bench_set(const char *metric, int64_t value) {
+    portENTER_CRITICAL(&bench_lock);
+    bench_metric_t *entry = find(metric);
+    if (entry) entry->value = value;
+    portEXIT_CRITICAL(&bench_lock);
+    ESP_LOGI(TAG, "{\"metric\":\"%s\",\"value\":%" PRId64 "}", metric, value);
+}
+
+/**
+ * @brief Adds to a counter metric, without logging
+ * @param metric Name, must stay valid (string literal)
+ * @param delta Added to the value
+ */
+void bench_add(const char *metric, int64_t delta) {
+    portENTER_CRITICAL(&bench_lock);
+    bench_metric_t *entry = find(metric);
+    if (entry) entry->value += delta;
+    portEXIT_CRITICAL(&bench_lock);
+}
+
+/**
+ * @brief Writes all metrics, one JSON object per line
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void bench_dump(bench_write_fn write, void *arg) {
+    char line[96];
+
+    for (int i = 0; i < metric_count; i++) {
+        portENTER_CRITICAL(&bench_lock);
+        bench_metric_t entry = metrics[i];
+        portEXIT_CRITICAL(&bench_lock);
+        int len = snprintf(line, sizeof(line), "{\"metric\":\"%s\",\"value\":%" PRId64 "}\n",
+                           entry.metric, entry.value);
+        write(line, len, arg);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_MAX_METRICS 16              // Distinct metrics kept, later ones are ignored
+
+/**
+ * @brief Receives the dump one line at a time
+ */
+typedef void (*bench_write_fn)(const char *line, size_t len, void *arg);
+
+/**
+ * @brief Sets a metric and logs it as a BENCH line
+ * @details The log message is JSON, so a serial log can be collected by
+ * tools/bench_run.py as well:
+ *   I (412) BENCH: {"metric":"boot.server_ms","value":412}
+ * @param metric Name, must stay valid (string literal)
+ * @param value New value
+ */
+void bench_set(const char *metric, int64_t value);
+
+/**
+ * @brief Adds to a counter metric, without logging
+ * @param metric Name, must stay valid (string literal)
+ * @param delta Added to the value
+ */
+void bench_add(const char *metric, int64_t delta);
+
+/**
+ * @brief Writes all metrics, one JSON object per line
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void bench_dump(bench_write_fn write, void *arg);
@@ -0,0 +1,66 @@
+#include <string.h>
+#include "boot_guard.h"
+
+/**
+ * @brief Counts the end of the previous boot and decides how this one proceeds
+ * @param guard Boot history
+ * @param config Tuning
+ * @param reset Why the previous boot ended
+ * @return Mode of this boot
+ */
+boot_mode_t boot_guard_on_boot(boot_guard_t *guard, const boot_guard_config_t *config, boot_reset_t reset) {
+    bool retry = guard->retry;
+
+    if (guard->magic != BOOT_GUARD_MAGIC || reset == BOOT_RESET_POWER_ON) {
+        memset(guard, 0, sizeof(*guard));
+        guard->magic = BOOT_GUARD_MAGIC;
+    } else if (guard->booting && (reset == BOOT_RESET_CRASH || guard->failed)) {
+        if (guard->early_crashes < UINT8_MAX) guard->early_crashes++;
+    }
+    guard->booting = true;
+    guard->failed = false;
+    guard->retry = false;
+    guard->retrying = false;
+
+    if (guard->early_crashes >= config->crash_limit) guard->safe_mode = true;
+    if (guard->safe_mode && retry) {
+        // The previous boot was stable in safe mode, the network may be fine again
+        guard->retrying = true;
+        return BOOT_NORMAL;
+    }
+    return guard->safe_mode ? BOOT_SAFE_MODE : BOOT_NORMAL;
+}
+
+/**
+ * @brief Marks the boot as good once it ran stable_ms, the crash count starts over
+ */
+void boot_guard_on_stable(boot_guard_t *guard) {
+    guard->booting = false;
+    guard->early_crashes = 0;
+    if (guard->retrying) {
+        guard->retrying = false;
+        guard->safe_mode = false;
+    }
+}
+
+/**
+ * @brief Makes the next boot retry the stored network
+ */
+void boot_guard_on_retry(boot_guard_t *guard) {
+    guard->retry = true;
+}
+
+/**
+ * @brief Marks the boot as failed before it restarts the chip itself
+ */
+void boot_guard_on_failure(boot_guard_t *guard) {
+    guard->failed = true;
+}
+
+/**
+ * @brief Leaves safe mode, e.g. once new credentials were saved
+ */
+void boot_guard_clear(boot_guard_t *guard) {
+    guard->safe_mode = false;
+    guard->early_crashes = 0;
+}
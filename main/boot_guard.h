@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Boot loop detection tuning
+ */
+typedef struct {
+    uint8_t crash_limit;                  // Early crashes in a row that start safe mode
+    uint32_t stable_ms;                   // Uptime after which a boot counts as good
+    uint32_t retry_ms;                    // Safe mode uptime after which the stored network is tried again
+} boot_guard_config_t;
+
+// Default: safe mode on the third crash within a minute of boot, stored network tried again every 10 min
+#define BOOT_GUARD_DEFAULT_CONFIG() { \
+    .crash_limit = 3,                 \
+    .stable_ms = 60000,               \
+    .retry_ms = 600000,               \
+}
+
+/**
+ * @brief Why the previous boot ended, reduced from esp_reset_reason()
+ */
+typedef enum {
+    BOOT_RESET_POWER_ON,                  // Power-on: RTC memory is undefined, starts over
+    BOOT_RESET_CRASH,                     // Panic or watchdog
+    BOOT_RESET_SOFTWARE,                  // esp_restart()
+    BOOT_RESET_OTHER,                     // Reset pin, brownout, deep sleep, unknown
+} boot_reset_t;
+
+/**
+ * @brief How this boot should proceed
+ */
+typedef enum {
+    BOOT_NORMAL,                          // Connect to the stored network, also to retry it from safe mode
+    BOOT_SAFE_MODE,                       // Skip it, start the provisioning AP and server at once
+} boot_mode_t;
+
+/**
+ * @brief Boot history, kept in RTC memory across resets
+ * @details Pure logic without driver calls, shared by the firmware and the
+ * host simulator (tools/boot_guard_sim.c).
+ */
+typedef struct {
+    uint32_t magic;                       // BOOT_GUARD_MAGIC once initialized
+    uint8_t early_crashes;                // Boots in a row that ended before stable_ms
+    bool booting;                         // This boot has not reached stable_ms yet
+    bool failed;                          // This boot gave up on its own (boot_guard_on_failure())
+    bool safe_mode;                       // Safe mode until new credentials are saved or a retry is stable
+    bool retry;                           // The next boot retries the stored network (boot_guard_on_retry())
+    bool retrying;                        // This boot retries it, safe mode ends once it is stable
+} boot_guard_t;
+
+#define BOOT_GUARD_MAGIC 0x42475244       // Random RTC memory at power-on is not taken as history
+
+/**
+ * @brief Counts the end of the previous boot and decides how this one proceeds
+ * @details A previous boot that crashed, or gave up, before reaching
+ * stable_ms counts as an early crash. After crash_limit of them in a row the
+ * unit stays in safe mode, as the stored network is the likely cause. Safe
+ * mode ends when new credentials are saved, when power is cycled, or when a
+ * retry of the stored network (boot_guard_on_retry()) reaches stable_ms. A
+ * retry that crashes early goes straight back to safe mode. Restarts asked
+ * for by a client are not counted.
+ * @param guard Boot history
+ * @param config Tuning
+ * @param reset Why the previous boot ended
+ * @return Mode of this boot
+ */
+boot_mode_t boot_guard_on_boot(boot_guard_t *guard, const boot_guard_config_t *config, boot_reset_t reset);
+
+/**
+ * @brief Marks the boot as good once it ran stable_ms, the crash count starts over
+ * @details A retry of the stored network that gets here leaves safe mode.
+ */
+void boot_guard_on_stable(boot_guard_t *guard);
+
+/**
+ * @brief Makes the next boot retry the stored network
+ * @details Call in safe mode once the boot ran retry_ms, right before the
+ * restart. The restart itself is not counted as a crash.
+ */
+void boot_guard_on_retry(boot_guard_t *guard);
+
+/**
+ * @brief Marks the boot as failed before it restarts the chip itself
+ */
+void boot_guard_on_failure(boot_guard_t *guard);
+
+/**
+ * @brief Leaves safe mode, e.g. once new credentials were saved
+ */
+void boot_guard_clear(boot_guard_t *guard);
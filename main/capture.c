@@ -0,0 +1,103 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "capture.h"
+
+#define DUMP_LINE_BYTES 32                // Ring bytes per dump line
+
+static uint8_t ring[CAPTURE_RING_SIZE];                    // Records, may wrap around the end
+static uint32_t head;                                      // Bytes ever written, next write at head % size
+static uint32_t tail;                                      // Start of the oldest record kept
+static uint32_t dropped;                                   // Records dropped for room
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the ring
+
+/**
+ * @brief Copies bytes into the ring at a stream position
+ */
+static void ring_write(uint32_t pos, const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        ring[(pos + i) % CAPTURE_RING_SIZE] = bytes[i];
+    }
+}
+
+/**
+ * @brief Copies bytes out of the ring from a stream position
+ */
+static void ring_read(uint32_t pos, void *data, size_t len) {
+    uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        bytes[i] = ring[(pos + i) % CAPTURE_RING_SIZE];
+    }
+}
+
+/**
+ * @brief Appends a record stamped with the current time
+ * @param type Record type
+ * @param code Meaning depends on type
+ * @param payload Payload, may be NULL when len is 0
+ * @param len Payload bytes, truncated to CAPTURE_MAX_PAYLOAD
+ */
+void capture_record(capture_type_t type, uint16_t code, const void *payload, size_t len) {
+    if (len > CAPTURE_MAX_PAYLOAD) len = CAPTURE_MAX_PAYLOAD;
+    capture_record_t record = {
+        .t_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .code = code,
+        .type = type,
+        .len = len,
+    };
+
+    portENTER_CRITICAL(&ring_lock);
+    // Drop whole records from the old end until the new one fits
+    while (CAPTURE_RING_SIZE - (head - tail) < sizeof(record) + len) {
+        capture_record_t oldest;
+        ring_read(tail, &oldest, sizeof(oldest));
+        tail += sizeof(oldest) + oldest.len;
+        dropped++;
+    }
+    ring_write(head, &record, sizeof(record));
+    ring_write(head + sizeof(record), payload, len);
+    head += sizeof(record) + len;
+    portEXIT_CRITICAL(&ring_lock);
+}
+
+/**
+ * @brief Writes the ring as text, oldest record first
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void capture_dump(capture_write_fn write, void *arg) {
+    char line[96];
+    uint8_t chunk[DUMP_LINE_BYTES];
+    int len;
+
+    portENTER_CRITICAL(&ring_lock);
+    uint32_t start = tail, end = head, dropped_count = dropped;
+    portEXIT_CRITICAL(&ring_lock);
+
+    len = snprintf(line, sizeof(line), "# capture format=%d bytes=%" PRIu32 " dropped=%" PRIu32
+                   " now_ms=%" PRIu32 "\n", CAPTURE_FORMAT, end - start, dropped_count,
+                   (uint32_t)(esp_timer_get_time() / 1000));
+    write(line, len, arg);
+
+    for (uint32_t pos = start; pos < end; pos += DUMP_LINE_BYTES) {
+        uint32_t n = end - pos < DUMP_LINE_BYTES ? end - pos : DUMP_LINE_BYTES;
+        portENTER_CRITICAL(&ring_lock);
+        bool overrun = (int32_t)(pos - tail) < 0;
+        if (!overrun) ring_read(pos, chunk, n);
+        portEXIT_CRITICAL(&ring_lock);
+        if (overrun) {
+            write("# overrun\n", 10, arg);
+            return;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            snprintf(line + 2 * i, 3, "%02x", chunk[i]);
+        }
+        line[2 * n] = '\n';
+        write(line, 2 * n + 1, arg);
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAPTURE_RING_SIZE   8192          // Bytes of records kept, the oldest are dropped
+#define CAPTURE_MAX_PAYLOAD 128           // Longer payloads are truncated
+#define CAPTURE_FORMAT      1             // Layout of capture_record_t and the payloads
+
+/**
+ * @brief Record types
+ */
+typedef enum {
+    CAPTURE_MARK = 1,                     // code: CAPTURE_MARK_*
+    CAPTURE_EVENT,                        // code: CAPTURE_EVENT_CODE(), payload by event
+    CAPTURE_RX,                           // code: 1 if redacted, payload: received bytes
+    CAPTURE_NVS,                          // code: CAPTURE_NVS_*, payload: capture_nvs_t
+    CAPTURE_DECISION,                     // code: CAPTURE_DECISION_*, payload by decision
+} capture_type_t;
+
+// CAPTURE_MARK codes
+#define CAPTURE_MARK_BOOT       1         // app_main() started
+#define CAPTURE_MARK_CONNECT    2         // connect_wifi() started, policy and damping reset
+#define CAPTURE_MARK_SAFE_MODE  3         // Boot loop detected, the stored network is skipped
+
+// CAPTURE_EVENT codes: event base in the high byte, event id in the low byte
+#define CAPTURE_BASE_WIFI       1
+#define CAPTURE_BASE_IP         2
+#define CAPTURE_EVENT_CODE(base, id) ((uint16_t)(((base) << 8) | ((id) & 0xff)))
+
+// CAPTURE_NVS codes
+#define CAPTURE_NVS_OPEN        1
+#define CAPTURE_NVS_GET         2
+#define CAPTURE_NVS_SET         3
+#define CAPTURE_NVS_COMMIT      4
+
+// CAPTURE_DECISION codes
+#define CAPTURE_DECISION_RECONNECT 1      // payload: capture_reconnect_t
+#define CAPTURE_DECISION_PUBLISH   2      // payload: uint32_t reuse delay in ms
+
+/**
+ * @brief Record header, followed by len payload bytes, little-endian
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t t_ms;                        // Time since boot
+    uint16_t code;                        // Meaning depends on type
+    uint8_t type;                         // capture_type_t
+    uint8_t len;                          // Payload bytes
+} capture_record_t;
+
+/**
+ * @brief Payload of CAPTURE_NVS
+ */
+typedef struct __attribute__((packed)) {
+    int32_t err;                          // esp_err_t of the call
+    uint32_t duration_us;                 // Time spent in the call
+} capture_nvs_t;
+
+/**
+ * @brief Payload of CAPTURE_DECISION_RECONNECT
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t action;                       // conn_action_t
+    uint8_t suppressed;                   // Flap damping suppresses the link
+} capture_reconnect_t;
+
+/**
+ * @brief Payload of CAPTURE_EVENT for WIFI_EVENT_STA_DISCONNECTED
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t reason;                       // wifi_err_reason_t
+    int8_t rssi;                          // Signal of the AP in dBm
+} capture_disconnect_t;
+
+/**
+ * @brief Receives the dump one line at a time
+ */
+typedef void (*capture_write_fn)(const char *line, size_t len, void *arg);
+
+/**
+ * @brief Appends a record stamped with the current time
+ * @details Safe from any task. When the ring is full the oldest records are
+ * dropped whole.
+ * @param type Record type
+ * @param code Meaning depends on type
+ * @param payload Payload, may be NULL when len is 0
+ * @param len Payload bytes, truncated to CAPTURE_MAX_PAYLOAD
+ */
+void capture_record(capture_type_t type, uint16_t code, const void *payload, size_t len);
+
+/**
+ * @brief Writes the ring as text, oldest record first
+ * @details Format:
+ *   # capture format=<n> bytes=<n> dropped=<n> now_ms=<n>
+ *   <hex of up to 32 bytes of records>...
+ * Recording goes on during the dump. If the oldest unsent records get dropped
+ * meanwhile, the dump ends early with a "# overrun" line.
+ * tools/capture_decode.py turns it into a binary capture and a timeline,
+ * tools/capture_replay.c replays the capture.
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void capture_dump(capture_write_fn write, void *arg);
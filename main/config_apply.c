@@ -0,0 +1,160 @@
+#include <string.h>
+#include "esp_log.h"
+#include "config_apply.h"
+
+static const char *TAG = "config_apply";                   // Logging tag
+static device_config_t active_config;                      // Configuration in use
+static const config_apply_ops_t *apply_ops;               // Driver actions
+
+/**
+ * @brief Fills a configuration with the built-in defaults
+ * @param config Configuration to initialize
+ */
+void device_config_set_defaults(device_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    strncpy(config->hostname, DEFAULT_HOSTNAME, sizeof(config->hostname) - 1);
+    config->log_level = DEFAULT_LOG_LEVEL;
+    config->ap_channel = DEFAULT_AP_CHANNEL;
+    config->wifi_timeout_ms = DEFAULT_WIFI_TIMEOUT_MS;
+    config->scan_dwell_ms = DEFAULT_SCAN_DWELL_MS;
+    config->scan_home_ms = DEFAULT_SCAN_HOME_MS;
+    config->heartbeat_s = DEFAULT_HEARTBEAT_S;
+    strncpy(config->uplink_host, DEFAULT_UPLINK_HOST, sizeof(config->uplink_host) - 1);
+    config->uplink_port = DEFAULT_UPLINK_PORT;
+}
+
+/**
+ * @brief Sets the active configuration and the driver actions
+ * @param initial Configuration the device is currently running with
+ * @param ops Driver actions, must stay valid for the lifetime of the program
+ */
+void config_apply_init(const device_config_t *initial, const config_apply_ops_t *ops) {
+    active_config = *initial;
+    apply_ops = ops;
+}
+
+/**
+ * @brief Returns the configuration the device is currently running with
+ */
+const device_config_t *config_apply_active(void) {
+    return &active_config;
+}
+
+/**
+ * @brief Compares two configurations
+ * @return Mask of CONFIG_FIELD_* bits that differ
+ */
+uint32_t config_apply_diff(const device_config_t *current, const device_config_t *next) {
+    uint32_t fields = 0;
+
+    if (strncmp(current->ssid, next->ssid, sizeof(current->ssid)) != 0) {
+        fields |= CONFIG_FIELD_SSID;
+    }
+    if (strncmp(current->password, next->password, sizeof(current->password)) != 0) {
+        fields |= CONFIG_FIELD_PASSWORD;
+    }
+    if (strncmp(current->hostname, next->hostname, sizeof(current->hostname)) != 0) {
+        fields |= CONFIG_FIELD_HOSTNAME;
+    }
+    // The address only matters while static addressing is enabled
+    if (current->static_ip != next->static_ip ||
+        (next->static_ip &&
+         (current->ip_info.ip.addr != next->ip_info.ip.addr ||
+          current->ip_info.gw.addr != next->ip_info.gw.addr ||
+          current->ip_info.netmask.addr != next->ip_info.netmask.addr))) {
+        fields |= CONFIG_FIELD_STATIC_IP;
+    }
+    if (current->log_level != next->log_level) {
+        fields |= CONFIG_FIELD_LOG_LEVEL;
+    }
+    if (current->ap_channel != next->ap_channel) {
+        fields |= CONFIG_FIELD_AP_CHANNEL;
+    }
+    if (current->wifi_timeout_ms != next->wifi_timeout_ms) {
+        fields |= CONFIG_FIELD_TIMEOUT;
+    }
+    if (current->scan_dwell_ms != next->scan_dwell_ms || current->scan_home_ms != next->scan_home_ms) {
+        fields |= CONFIG_FIELD_SCAN;
+    }
+    if (current->relay != next->relay) {
+        fields |= CONFIG_FIELD_RELAY;
+    }
+    if (current->heartbeat_s != next->heartbeat_s) {
+        fields |= CONFIG_FIELD_HEARTBEAT;
+    }
+    if (strncmp(current->uplink_host, next->uplink_host, sizeof(current->uplink_host)) != 0 ||
+        current->uplink_port != next->uplink_port) {
+        fields |= CONFIG_FIELD_UPLINK;
+    }
+
+    return fields;
+}
+
+/**
+ * @brief Copies the given fields from one configuration to another
+ */
+static void copy_fields(device_config_t *dst, const device_config_t *src, uint32_t fields) {
+    if (fields & CONFIG_FIELD_SSID) memcpy(dst->ssid, src->ssid, sizeof(dst->ssid));
+    if (fields & CONFIG_FIELD_PASSWORD) memcpy(dst->password, src->password, sizeof(dst->password));
+    if (fields & CONFIG_FIELD_HOSTNAME) memcpy(dst->hostname, src->hostname, sizeof(dst->hostname));
+    if (fields & CONFIG_FIELD_STATIC_IP) {
+        dst->static_ip = src->static_ip;
+        dst->ip_info = src->ip_info;
+    }
+    if (fields & CONFIG_FIELD_LOG_LEVEL) dst->log_level = src->log_level;
+    if (fields & CONFIG_FIELD_AP_CHANNEL) dst->ap_channel = src->ap_channel;
+    if (fields & CONFIG_FIELD_TIMEOUT) dst->wifi_timeout_ms = src->wifi_timeout_ms;
+    if (fields & CONFIG_FIELD_SCAN) {
+        dst->scan_dwell_ms = src->scan_dwell_ms;
+        dst->scan_home_ms = src->scan_home_ms;
+    }
+    if (fields & CONFIG_FIELD_RELAY) dst->relay = src->relay;
+    if (fields & CONFIG_FIELD_HEARTBEAT) dst->heartbeat_s = src->heartbeat_s;
+    if (fields & CONFIG_FIELD_UPLINK) {
+        memcpy(dst->uplink_host, src->uplink_host, sizeof(dst->uplink_host));
+        dst->uplink_port = src->uplink_port;
+    }
+}
+
+/**
+ * @brief Applies a new configuration with the smallest possible action
+ * @details Live fields are applied in place, netif fields restart the DHCP
+ * client only and radio fields go through a full reconnect. On success the new
+ * configuration becomes the active one.
+ * @param next Configuration to apply
+ * @return ESP_OK if successful, the error of the failing action otherwise
+ */
+esp_err_t config_apply(const device_config_t *next) {
+    uint32_t fields = config_apply_diff(&active_config, next);
+    uint32_t live = fields & CONFIG_FIELDS_LIVE;
+    uint32_t netif = fields & CONFIG_FIELDS_NETIF;
+    uint32_t radio = fields & CONFIG_FIELDS_RADIO;
+    esp_err_t err;
+
+    if (fields == 0) {
+        ESP_LOGI(TAG, "Configuration unchanged, nothing to apply");
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Changed fields: 0x%02x (live 0x%02x, netif 0x%02x, radio 0x%02x)",
+             (unsigned)fields, (unsigned)live, (unsigned)netif, (unsigned)radio);
+
+    // Live fields first, they can not fail in a way that affects the others
+    if (live) {
+        err = apply_ops->apply_live(next, live);
+        if (err != ESP_OK) return err;
+        copy_fields(&active_config, next, live);
+    }
+
+    // A radio restart brings the netif up again, so it also takes the netif fields
+    if (radio) {
+        err = apply_ops->apply_radio(next, radio | netif);
+        if (err != ESP_OK) return err;
+        copy_fields(&active_config, next, radio | netif);
+    } else if (netif) {
+        err = apply_ops->apply_netif(next, netif);
+        if (err != ESP_OK) return err;
+        copy_fields(&active_config, next, netif);
+    }
+
+    return ESP_OK;
+}
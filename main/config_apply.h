@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_bit_defs.h"
+#include "esp_err.h"
+#include "device_config.h"
+
+// Bits identifying the configuration fields that differ between two configs
+#define CONFIG_FIELD_SSID        BIT0
+#define CONFIG_FIELD_PASSWORD    BIT1
+#define CONFIG_FIELD_HOSTNAME    BIT2
+#define CONFIG_FIELD_STATIC_IP   BIT3
+#define CONFIG_FIELD_LOG_LEVEL   BIT4
+#define CONFIG_FIELD_AP_CHANNEL  BIT5
+#define CONFIG_FIELD_TIMEOUT     BIT6
+#define CONFIG_FIELD_SCAN        BIT7
+#define CONFIG_FIELD_RELAY       BIT8
+#define CONFIG_FIELD_HEARTBEAT   BIT9
+#define CONFIG_FIELD_UPLINK      BIT10
+
+// Fields that can be applied without touching the network stack
+#define CONFIG_FIELDS_LIVE   (CONFIG_FIELD_LOG_LEVEL | CONFIG_FIELD_TIMEOUT | CONFIG_FIELD_SCAN | \
+                              CONFIG_FIELD_RELAY | CONFIG_FIELD_HEARTBEAT | CONFIG_FIELD_UPLINK)
+// Fields that need the STA netif (DHCP client) to be restarted
+#define CONFIG_FIELDS_NETIF  (CONFIG_FIELD_HOSTNAME | CONFIG_FIELD_STATIC_IP)
+// Fields that need the radio to be reconfigured
+#define CONFIG_FIELDS_RADIO  (CONFIG_FIELD_SSID | CONFIG_FIELD_PASSWORD | CONFIG_FIELD_AP_CHANNEL)
+
+/**
+ * @brief Actions used by the apply engine to reach the driver
+ * @details Each callback receives the new configuration and the changed fields
+ * of its class. apply_radio also receives the netif fields because a radio
+ * restart brings the netif up again anyway.
+ */
+typedef struct {
+    esp_err_t (*apply_live)(const device_config_t *config, uint32_t fields);
+    esp_err_t (*apply_netif)(const device_config_t *config, uint32_t fields);
+    esp_err_t (*apply_radio)(const device_config_t *config, uint32_t fields);
+} config_apply_ops_t;
+
+/**
+ * @brief Fills a configuration with the built-in defaults
+ * @param config Configuration to initialize
+ */
+void device_config_set_defaults(device_config_t *config);
+
+/**
+ * @brief Sets the active configuration and the driver actions
+ * @param initial Configuration the device is currently running with
+ * @param ops Driver actions, must stay valid for the lifetime of the program
+ */
+void config_apply_init(const device_config_t *initial, const config_apply_ops_t *ops);
+
+/**
+ * @brief Returns the configuration the device is currently running with
+ */
+const device_config_t *config_apply_active(void);
+
+/**
+ * @brief Compares two configurations
+ * @return Mask of CONFIG_FIELD_* bits that differ
+ */
+uint32_t config_apply_diff(const device_config_t *current, const device_config_t *next);
+
+/**
+ * @brief Applies a new configuration with the smallest possible action
+ * @details Live fields are applied in place, netif fields restart the DHCP
+ * client only and radio fields go through a full reconnect. On success the new
+ * configuration becomes the active one.
+ * @param next Configuration to apply
+ * @return ESP_OK if successful, the error of the failing action otherwise
+ */
+esp_err_t config_apply(const device_config_t *next);
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "config_apply.h"
+#include "config_ops.h"
+#include "uplink_queue.h"
+#include "wifi_netif.h"
+
+static const char *TAG = "config_ops";                     // Logging tag
+static config_ops_connect_t connect_sta;                   // connect_wifi() of main.c
+
+/**
+ * @brief Applies hostname and addressing settings to the STA interface
+ * @param config Configuration to apply
+ * @return ESP_OK if successful, the failing esp_netif error otherwise
+ */
+esp_err_t config_ops_configure_sta_netif(const device_config_t *config) {
+    esp_netif_t *sta_netif = wifi_netif_sta();
+
+    // The hostname is sent with the next DHCP request
+    esp_err_t err = esp_netif_set_hostname(sta_netif, config->hostname);
+    if (err != ESP_OK) return err;
+
+    if (config->static_ip) {
+        err = esp_netif_dhcpc_stop(sta_netif);
+        if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) return err;
+        return esp_netif_set_ip_info(sta_netif, &config->ip_info);
+    }
+
+    err = esp_netif_dhcpc_start(sta_netif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STARTED) return err;
+    return ESP_OK;
+}
+
+/**
+ * @brief Applies settings that take effect immediately
+ */
+static esp_err_t apply_live_config(const device_config_t *config, uint32_t fields) {
+    if (fields & CONFIG_FIELD_LOG_LEVEL) {
+        esp_log_level_set("*", config->log_level);
+    }
+    if (fields & CONFIG_FIELD_UPLINK) {
+        uplink_queue_config_t uplink_config = { .port = config->uplink_port };
+        snprintf(uplink_config.host, sizeof(uplink_config.host), "%s", config->uplink_host);
+        esp_err_t err = uplink_queue_set_sink(&uplink_config);
+        if (err != ESP_OK) return err;
+    }
+    // The connection timeout, scan budget and heartbeat interval are read from
+    // the active configuration on every use
+    return ESP_OK;
+}
+
+/**
+ * @brief Restarts the DHCP client of the STA interface without touching the radio
+ */
+static esp_err_t apply_netif_config(const device_config_t *config, uint32_t fields) {
+    esp_netif_t *sta_netif = wifi_netif_sta();
+
+    ESP_LOGI(TAG, "Restarting STA interface (hostname: %s, %s)",
+             config->hostname, config->static_ip ? "static IP" : "DHCP");
+    // The restarted DHCP client sends the new hostname, static addressing stops it anyway
+    if (!config->static_ip) {
+        esp_err_t err = esp_netif_dhcpc_stop(sta_netif);
+        if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) return err;
+    }
+    return config_ops_configure_sta_netif(config);
+}
+
+/**
+ * @brief Reconfigures the radio for changed credentials or AP channel
+ */
+static esp_err_t apply_radio_config(const device_config_t *config, uint32_t fields) {
+    esp_err_t err;
+
+    if (fields & CONFIG_FIELDS_NETIF) {
+        err = config_ops_configure_sta_netif(config);
+        if (err != ESP_OK) return err;
+    }
+
+    // A running soft-AP only needs its channel changed
+    if (fields & CONFIG_FIELD_AP_CHANNEL) {
+        wifi_mode_t mode;
+        if (esp_wifi_get_mode(&mode) == ESP_OK && (mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA)) {
+            wifi_config_t ap_config;
+            err = esp_wifi_get_config(WIFI_IF_AP, &ap_config);
+            if (err != ESP_OK) return err;
+            ap_config.ap.channel = config->ap_channel;
+            err = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+            if (err != ESP_OK) return err;
+        }
+    }
+
+    if (fields & (CONFIG_FIELD_SSID | CONFIG_FIELD_PASSWORD)) {
+        return connect_sta(config->ssid, config->password);
+    }
+    return ESP_OK;
+}
+
+// Driver actions used by the configuration apply engine
+static const config_apply_ops_t apply_ops = {
+    .apply_live = apply_live_config,
+    .apply_netif = apply_netif_config,
+    .apply_radio = apply_radio_config,
+};
+
+/**
+ * @brief Sets the active configuration and hands the driver actions to the apply engine
+ * @param initial Configuration the device is currently running with
+ * @param connect Reconnects the STA with new credentials
+ */
+void config_ops_init(const device_config_t *initial, config_ops_connect_t connect) {
+    connect_sta = connect;
+    config_apply_init(initial, &apply_ops);
+}
+
+/**
+ * @brief Applies a configuration pushed over multicast
+ * @param next Configuration to apply
+ * @return ESP_OK if successful, the error of the failing action otherwise
+ */
+esp_err_t config_ops_apply_pushed(const device_config_t *next) {
+    device_config_t previous = *config_apply_active();
+
+    esp_err_t err = config_apply(next);
+    if (err != ESP_OK && config_apply_diff(&previous, next) & (CONFIG_FIELD_SSID | CONFIG_FIELD_PASSWORD)) {
+        ESP_LOGW(TAG, "Pushed credentials failed, back to the previous network");
+        connect_sta(previous.ssid, previous.password);
+    }
+    return err;
+}
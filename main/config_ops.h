@@ -0,0 +1,36 @@
+#pragma once
+
+#include "esp_err.h"
+#include "device_config.h"
+
+/**
+ * @brief Connects the STA to a network and waits for its address
+ * @return ESP_OK once connected, an error otherwise (see connect_wifi() in main.c)
+ */
+typedef esp_err_t (*config_ops_connect_t)(const char *ssid, const char *password);
+
+/**
+ * @brief Sets the active configuration and hands the driver actions to the apply engine
+ * @details The actions reach the WiFi driver and esp_netif directly, except
+ * for credentials, which go through connect. Kept out of main.c so the host
+ * test (tools/config_apply_test.c) counts the driver calls of each change.
+ * @param initial Configuration the device is currently running with
+ * @param connect Reconnects the STA with new credentials
+ */
+void config_ops_init(const device_config_t *initial, config_ops_connect_t connect);
+
+/**
+ * @brief Applies hostname and addressing settings to the STA interface
+ * @param config Configuration to apply
+ * @return ESP_OK if successful, the failing esp_netif error otherwise
+ */
+esp_err_t config_ops_configure_sta_netif(const device_config_t *config);
+
+/**
+ * @brief Applies a configuration pushed over multicast
+ * @details Credentials that do not connect are rolled back, so the unit stays
+ * reachable for the next push.
+ * @param next Configuration to apply
+ * @return ESP_OK if successful, the error of the failing action otherwise
+ */
+esp_err_t config_ops_apply_pushed(const device_config_t *next);
@@ -0,0 +1,181 @@
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "lwip/sockets.h"
+#include "config_apply.h"
+#include "net_status.h"
+#include "bench.h"
+#include "config_push.h"
+
+#define CONFIG_PUSH_NAMESPACE "config_push" // NVS namespace
+#define VERSION_KEY        "version"      // Last applied version
+#define RECV_TIMEOUT_S     5              // Period of the address change check
+#define READY_WAIT_MS      60000          // Wait for the STA between checks
+
+// Fields a push may carry
+#define PUSH_FIELDS (CONFIG_FIELD_SSID | CONFIG_FIELD_PASSWORD | CONFIG_FIELD_LOG_LEVEL | CONFIG_FIELD_TIMEOUT)
+
+static const char *TAG = "config_push";                    // Logging tag
+static config_push_apply_t apply_action;                   // Apply action from the application
+static uint32_t applied_version = 0;                       // Last applied version
+
+/**
+ * @brief Saves the last applied version to NVS
+ */
+static void save_version(uint32_t version) {
+    nvs_handle_t handle;
+    if (nvs_open(CONFIG_PUSH_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return;
+    if (nvs_set_u32(handle, VERSION_KEY, version) == ESP_OK && nvs_commit(handle) == ESP_OK) {
+        bench_add("nvs.commits", 1);
+    }
+    nvs_close(handle);
+}
+
+/**
+ * @brief Checks and applies a received message
+ * @return Status for the ack, or -1 to drop the message without an ack
+ */
+static int handle_message(config_push_msg_t *msg, size_t len) {
+    if (len != sizeof(*msg) || ntohs(msg->magic) != CONFIG_PUSH_MAGIC || msg->format != CONFIG_PUSH_FORMAT) {
+        return -1;
+    }
+
+    // Only authenticated senders get an answer, the credentials are decrypted in place
+    int64_t start_us = esp_timer_get_time();
+    bool valid = site_auth_open(msg->nonce, msg, offsetof(config_push_msg_t, ssid), msg->ssid,
+                                sizeof(msg->ssid) + sizeof(msg->password), msg->tag);
+    ESP_LOGD(TAG, "Tag checked in %" PRId64 " us", esp_timer_get_time() - start_us);
+    if (!valid) {
+        ESP_LOGW(TAG, "Dropping push with a bad tag");
+        return -1;
+    }
+
+    uint32_t version = ntohl(msg->version);
+    uint16_t fields = ntohs(msg->fields);
+    if (version <= applied_version) return CONFIG_PUSH_CURRENT;
+    if ((fields & ~PUSH_FIELDS) || msg->ssid[sizeof(msg->ssid) - 1] ||
+        msg->password[sizeof(msg->password) - 1]) {
+        return CONFIG_PUSH_UNSUPPORTED;
+    }
+
+    device_config_t next = *config_apply_active();
+    if (fields & CONFIG_FIELD_SSID) memcpy(next.ssid, msg->ssid, sizeof(next.ssid));
+    if (fields & CONFIG_FIELD_PASSWORD) memcpy(next.password, msg->password, sizeof(next.password));
+    if (fields & CONFIG_FIELD_LOG_LEVEL) {
+        if (msg->log_level > ESP_LOG_VERBOSE) return CONFIG_PUSH_UNSUPPORTED;
+        next.log_level = (esp_log_level_t)msg->log_level;
+    }
+    if (fields & CONFIG_FIELD_TIMEOUT) next.wifi_timeout_ms = ntohl(msg->wifi_timeout_ms);
+
+    ESP_LOGI(TAG, "Applying configuration version %" PRIu32 " (fields 0x%04x)", version, fields);
+    if (apply_action(&next) != ESP_OK) return CONFIG_PUSH_FAILED;
+
+    applied_version = version;
+    save_version(version);
+    return CONFIG_PUSH_APPLIED;
+}
+
+/**
+ * @brief Opens the UDP socket and joins the group on the STA address
+ * @return Socket, -1 on failure
+ */
+static int open_group_socket(esp_ip4_addr_t sta_ip) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) return -1;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_PUSH_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    struct ip_mreq mreq = { .imr_interface.s_addr = sta_ip.addr };
+    inet_pton(AF_INET, CONFIG_PUSH_GROUP, &mreq.imr_multiaddr);
+    struct timeval timeout = { .tv_sec = RECV_TIMEOUT_S };
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0 ||
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        ESP_LOGE(TAG, "Failed to join %s: %d", CONFIG_PUSH_GROUP, errno);
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/**
+ * @brief Listener: joins the group while the STA is ready and answers pushes
+ */
+static void config_push_task(void *pvParameters) {
+    config_push_msg_t msg;
+    config_push_ack_t ack = { .magic = htons(CONFIG_PUSH_ACK_MAGIC) };
+    esp_read_mac(ack.sta_mac, ESP_MAC_WIFI_STA);
+
+    while (1) {
+        if (!net_status_wait_ready(READY_WAIT_MS)) continue;
+
+        net_status_t status;
+        net_status_get(&status);
+        int sock = open_group_socket(status.ip);
+        if (sock < 0) {
+            vTaskDelay(pdMS_TO_TICKS(RECV_TIMEOUT_S * 1000));
+            continue;
+        }
+        ESP_LOGI(TAG, "Listening on %s:%d", CONFIG_PUSH_GROUP, CONFIG_PUSH_PORT);
+
+        // Rejoin when the STA loses its address or gets another one
+        while (1) {
+            struct sockaddr_in source_addr;
+            socklen_t addr_len = sizeof(source_addr);
+            int len = recvfrom(sock, &msg, sizeof(msg), 0, (struct sockaddr *)&source_addr, &addr_len);
+
+            if (len > 0) {
+                int result = handle_message(&msg, len);
+                if (result >= 0) {
+                    vTaskDelay(pdMS_TO_TICKS(esp_random() % CONFIG_PUSH_ACK_JITTER_MS));
+                    ack.status = result;
+                    ack.version = msg.version;
+                    sendto(sock, &ack, sizeof(ack), 0, (struct sockaddr *)&source_addr, addr_len);
+                }
+            }
+
+            net_status_t now;
+            net_status_get(&now);
+            if (now.state != NET_STATE_READY || now.ip.addr != status.ip.addr) break;
+        }
+        close(sock);
+    }
+}
+
+/**
+ * @brief Loads the last applied version and starts the listener task
+ * @param apply Apply action, called from the listener task
+ * @return ESP_OK if successful, ESP_ERR_NO_MEM if the task can not be created
+ */
+esp_err_t config_push_init(config_push_apply_t apply) {
+    nvs_handle_t handle;
+    apply_action = apply;
+    if (nvs_open(CONFIG_PUSH_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u32(handle, VERSION_KEY, &applied_version);
+        nvs_close(handle);
+    }
+    ESP_LOGI(TAG, "Configuration version %" PRIu32, applied_version);
+
+    if (xTaskCreate(config_push_task, "config_push", 4096, NULL, 5, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Returns the last applied configuration version, 0 if none
+ */
+uint32_t config_push_version(void) {
+    return applied_version;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "device_config.h"
+#include "site_auth.h"
+
+// Multicast configuration push
+#define CONFIG_PUSH_GROUP       "239.255.67.80" // Multicast group joined on the STA interface
+#define CONFIG_PUSH_PORT        3334            // UDP port of the group
+#define CONFIG_PUSH_MAGIC       0x4350          // "CP"
+#define CONFIG_PUSH_ACK_MAGIC   0x4341          // "CA"
+#define CONFIG_PUSH_FORMAT      2               // Layout of config_push_msg_t
+#define CONFIG_PUSH_ACK_JITTER_MS 5000          // Acks are spread over this window
+
+/**
+ * @brief Encrypted configuration update, one UDP datagram
+ * @details Multi-byte fields are big-endian. Only the fields listed in
+ * `fields` are applied. The SSID and password are encrypted with AES-GCM
+ * under the site key (site_auth_seal()); the header before them is
+ * authenticated only.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;                       // CONFIG_PUSH_MAGIC
+    uint8_t format;                       // CONFIG_PUSH_FORMAT
+    uint8_t reserved;
+    uint32_t version;                     // Configuration version, must increase
+    uint16_t fields;                      // CONFIG_FIELD_* carried by the message
+    uint8_t log_level;
+    uint32_t wifi_timeout_ms;
+    uint8_t nonce[SITE_NONCE_SIZE];       // Random, picked by the sender
+    char ssid[WIFI_NAME_SIZE];            // NUL terminated, encrypted
+    char password[WIFI_PASS_SIZE];        // NUL terminated, encrypted
+    uint8_t tag[SITE_TAG_SIZE];           // AES-GCM tag
+} config_push_msg_t;
+
+/**
+ * @brief Outcome reported in an ack
+ */
+typedef enum {
+    CONFIG_PUSH_APPLIED = 0,              // Applied, version saved
+    CONFIG_PUSH_CURRENT,                  // This version or a newer one is already applied
+    CONFIG_PUSH_FAILED,                   // Apply failed, previous configuration kept
+    CONFIG_PUSH_UNSUPPORTED,              // Carries fields this unit can not take
+} config_push_status_t;
+
+/**
+ * @brief Ack unicast to the sender, one UDP datagram
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;                       // CONFIG_PUSH_ACK_MAGIC, big-endian
+    uint8_t status;                       // config_push_status_t
+    uint8_t reserved;
+    uint32_t version;                     // Version of the acked message, big-endian
+    uint8_t sta_mac[6];                   // Unit identity
+} config_push_ack_t;
+
+/**
+ * @brief Applies a verified configuration
+ * @param next Active configuration with the pushed fields replaced
+ * @return ESP_OK if applied
+ */
+typedef esp_err_t (*config_push_apply_t)(const device_config_t *next);
+
+/**
+ * @brief Loads the last applied version and starts the listener task
+ * @details The listener joins the group whenever the STA is ready. Messages
+ * with a bad tag are dropped silently; the others are answered with an ack
+ * after a random delay of up to CONFIG_PUSH_ACK_JITTER_MS, so a fleet does not
+ * answer all at once.
+ * @param apply Apply action, called from the listener task
+ * @return ESP_OK if successful, ESP_ERR_NO_MEM if the task can not be created
+ */
+esp_err_t config_push_init(config_push_apply_t apply);
+
+/**
+ * @brief Returns the last applied configuration version, 0 if none
+ */
+uint32_t config_push_version(void);
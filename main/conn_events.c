@@ -0,0 +1,81 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "bench.h"
+#include "event_stats.h"
+#include "conn_events.h"
+
+static esp_event_handler_t user_handler;                   // Connection logic
+static void *user_arg;
+static event_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED; // Protects stats
+
+/**
+ * @brief Default loop handler: runs the connection logic and measures its run time
+ */
+static void dispatch(void *arg, esp_event_base_t base, int32_t event_id, void *event_data) {
+    int64_t start_us = esp_timer_get_time();
+    user_handler(user_arg, base, event_id, event_data);
+    int64_t run_us = esp_timer_get_time() - start_us;
+
+    portENTER_CRITICAL(&stats_lock);
+    event_stats_on_dispatch(&stats, run_us > UINT32_MAX ? UINT32_MAX : (uint32_t)run_us);
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief Sets the connection logic that handles the WiFi and IP events
+ * @param handler Runs for every registered event
+ * @param arg Passed to handler
+ */
+void conn_events_init(esp_event_handler_t handler, void *arg) {
+    user_handler = handler;
+    user_arg = arg;
+}
+
+/**
+ * @brief Registers the connection logic for events of the default loop
+ * @param base Event base
+ * @param event_id Event ID, ESP_EVENT_ANY_ID for all of the base
+ * @return ESP_OK if successful, the failing esp_event error otherwise
+ */
+esp_err_t conn_events_register(esp_event_base_t base, int32_t event_id) {
+    return esp_event_handler_register(base, event_id, &dispatch, NULL);
+}
+
+/**
+ * @brief Reports the handler run time as bench metrics
+ */
+void conn_events_bench(void) {
+    portENTER_CRITICAL(&stats_lock);
+    event_stats_t snapshot = stats;
+    portEXIT_CRITICAL(&stats_lock);
+
+    bench_set("events.run_p99_us", event_stats_percentile_us(&snapshot, 99));
+    bench_set("events.run_max_us", snapshot.latency_max_us);
+}
+
+/**
+ * @brief Writes the handler statistics
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void conn_events_dump(conn_events_write_fn write, void *arg) {
+    char line[96];
+    int len;
+
+    portENTER_CRITICAL(&stats_lock);
+    event_stats_t snapshot = stats;
+    portEXIT_CRITICAL(&stats_lock);
+
+    len = snprintf(line, sizeof(line), "# events now_ms=%" PRId64 "\n", esp_timer_get_time() / 1000);
+    write(line, len, arg);
+    len = snprintf(line, sizeof(line), "handled=%" PRIu32 "\n", snapshot.dispatched);
+    write(line, len, arg);
+    uint64_t avg_us = snapshot.dispatched ? snapshot.latency_sum_us / snapshot.dispatched : 0;
+    len = snprintf(line, sizeof(line), "run_us avg=%" PRIu64 " p50=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32 "\n",
+                   avg_us, event_stats_percentile_us(&snapshot, 50), event_stats_percentile_us(&snapshot, 99),
+                   snapshot.latency_max_us);
+    write(line, len, arg);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+/**
+ * @brief Receives the dump one line at a time
+ */
+typedef void (*conn_events_write_fn)(const char *line, size_t len, void *arg);
+
+/**
+ * @brief Sets the connection logic that handles the WiFi and IP events
+ * @details The handler runs in the default event loop, where the WiFi driver
+ * and esp_netif post. A private loop behind a forwarder was tried: its first
+ * hop still waits behind the default loop, so it gained nothing once the NVS
+ * write left the handler, and it allocated every event. See
+ * tools/event_loop_stress.c. The handler is timed instead, so a slow
+ * connection logic shows up in the statistics.
+ * @param handler Runs for every registered event
+ * @param arg Passed to handler
+ */
+void conn_events_init(esp_event_handler_t handler, void *arg);
+
+/**
+ * @brief Registers the connection logic for events of the default loop
+ * @param base Event base
+ * @param event_id Event ID, ESP_EVENT_ANY_ID for all of the base
+ * @return ESP_OK if successful, the failing esp_event error otherwise
+ */
+esp_err_t conn_events_register(esp_event_base_t base, int32_t event_id);
+
+/**
+ * @brief Reports the handler run time as bench metrics
+ * @details Sets events.run_p99_us and events.run_max_us, see bench.h.
+ */
+void conn_events_bench(void);
+
+/**
+ * @brief Writes the handler statistics
+ * @details One header line, then the counters:
+ *   # events now_ms=812345
+ *   handled=42
+ *   run_us avg=180 p50=256 p99=1024 max=731
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void conn_events_dump(conn_events_write_fn write, void *arg);
@@ -0,0 +1,61 @@
+#include <string.h>
+#include "conn_policy.h"
+
+/**
+ * @brief Initializes the reconnection state
+ */
+void conn_policy_init(conn_policy_t *policy, const conn_policy_config_t *config) {
+    memset(policy, 0, sizeof(*policy));
+    policy->config = *config;
+}
+
+/**
+ * @brief Starts over, e.g. for a new connection or after a successful one
+ */
+void conn_policy_reset(conn_policy_t *policy) {
+    policy->retry_count = 0;
+}
+
+/**
+ * @brief Decides what to do after a STA disconnect
+ * @param policy Reconnection state
+ * @return Action to take
+ */
+conn_action_t conn_policy_on_disconnect(conn_policy_t *policy) {
+    if (policy->retry_count >= policy->config.max_retry) return CONN_GIVE_UP;
+    policy->retry_count++;
+    return CONN_RETRY;
+}
+
+/**
+ * @brief Decides what to do after a setup step failed
+ * @param policy Reconnection state
+ * @param step Step that failed
+ * @param random Random number for the jitter
+ * @param delay_ms Set to the wait before the retry if the action is CONN_RETRY
+ * @return Action to take
+ */
+conn_action_t conn_policy_on_step_error(conn_policy_t *policy, conn_step_t step, uint32_t random,
+                                        uint32_t *delay_ms) {
+    uint8_t failures = policy->step_failures[step];
+    if (failures >= policy->config.max_step_retry) {
+        policy->step_failures[step] = 0;  // The caller escalates, a later attempt starts over
+        return CONN_GIVE_UP;
+    }
+    policy->step_failures[step] = failures + 1;
+
+    uint32_t backoff = policy->config.step_backoff_ms;
+    for (uint8_t i = 0; i < failures && backoff < policy->config.step_backoff_max_ms; i++) {
+        backoff *= 2;
+    }
+    if (backoff > policy->config.step_backoff_max_ms) backoff = policy->config.step_backoff_max_ms;
+    *delay_ms = backoff / 2 + random % (backoff / 2 + 1);
+    return CONN_RETRY;
+}
+
+/**
+ * @brief Notes that a setup step succeeded, its next failure starts over
+ */
+void conn_policy_on_step_ok(conn_policy_t *policy, conn_step_t step) {
+    policy->step_failures[step] = 0;
+}
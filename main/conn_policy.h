@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Reconnection tuning
+ */
+typedef struct {
+    uint8_t max_retry;                    // Attempts after a disconnect before giving up
+    uint8_t max_step_retry;               // Retries of a failed setup step before giving up
+    uint16_t step_backoff_ms;             // Wait before the first step retry, doubled for each next one
+    uint16_t step_backoff_max_ms;         // Upper bound of the step backoff
+} conn_policy_config_t;
+
+// Default: 5 immediate attempts; 4 step retries, at most 1.5 s in total
+#define CONN_POLICY_DEFAULT_CONFIG() { \
+    .max_retry = 5,                    \
+    .max_step_retry = 4,               \
+    .step_backoff_ms = 100,            \
+    .step_backoff_max_ms = 1000,       \
+}
+
+/**
+ * @brief Setup steps that can fail with a transient driver or stack error
+ */
+typedef enum {
+    CONN_STEP_STA,                        // Mode, configuration and start of the STA
+    CONN_STEP_AP,                         // DHCP server, mode, configuration and start of the soft-AP
+    CONN_STEP_SERVER,                     // Socket, bind and listen of the TCP server
+    CONN_STEP_NVS,                        // Opening the NVS namespace at boot
+    CONN_STEP_COUNT,
+} conn_step_t;
+
+/**
+ * @brief Decision taken after a STA disconnect
+ */
+typedef enum {
+    CONN_RETRY,                           // Call esp_wifi_connect() again
+    CONN_GIVE_UP,                         // Attempts exhausted
+} conn_action_t;
+
+/**
+ * @brief Reconnection state of the STA
+ * @details Pure logic without driver calls, shared by the firmware, the host
+ * fleet simulator (tools/fleet_sim.c) and the capture replay
+ * (tools/capture_replay.c).
+ */
+typedef struct {
+    conn_policy_config_t config;
+    uint8_t retry_count;                  // Attempts since the last success
+    uint8_t step_failures[CONN_STEP_COUNT]; // Failures of each step since it last succeeded
+} conn_policy_t;
+
+/**
+ * @brief Initializes the reconnection state
+ */
+void conn_policy_init(conn_policy_t *policy, const conn_policy_config_t *config);
+
+/**
+ * @brief Starts over, e.g. for a new connection or after a successful one
+ */
+void conn_policy_reset(conn_policy_t *policy);
+
+/**
+ * @brief Decides what to do after a STA disconnect
+ * @param policy Reconnection state
+ * @return Action to take
+ */
+conn_action_t conn_policy_on_disconnect(conn_policy_t *policy);
+
+/**
+ * @brief Decides what to do after a setup step failed
+ * @details Retries are spaced by a jittered exponential backoff: the nth
+ * retry waits between half and all of step_backoff_ms * 2^(n-1), bounded by
+ * step_backoff_max_ms. The jitter keeps units that failed together from
+ * retrying together.
+ * @param policy Reconnection state
+ * @param step Step that failed
+ * @param random Random number for the jitter
+ * @param delay_ms Set to the wait before the retry if the action is CONN_RETRY
+ * @return CONN_RETRY, or CONN_GIVE_UP once max_step_retry retries failed
+ */
+conn_action_t conn_policy_on_step_error(conn_policy_t *policy, conn_step_t step, uint32_t random,
+                                        uint32_t *delay_ms);
+
+/**
+ * @brief Notes that a setup step succeeded, its next failure starts over
+ */
+void conn_policy_on_step_ok(conn_policy_t *policy, conn_step_t step);
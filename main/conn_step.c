@@ -0,0 +1,27 @@
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "conn_step.h"
+
+static const char *TAG = "conn_step";                      // Logging tag
+
+/**
+ * @brief Waits before a failed setup step is retried
+ * @param policy Reconnection state
+ * @param step Step that failed
+ * @return true to try the step again, false once the policy gives up
+ */
+bool conn_step_backoff(conn_policy_t *policy, conn_step_t step) {
+    static const char *const step_names[CONN_STEP_COUNT] = { "STA setup", "AP setup", "Server setup", "NVS open" };
+    uint32_t delay_ms;
+
+    if (conn_policy_on_step_error(policy, step, esp_random(), &delay_ms) == CONN_GIVE_UP) {
+        ESP_LOGE(TAG, "%s failed, giving up", step_names[step]);
+        return false;
+    }
+    ESP_LOGW(TAG, "%s failed, retrying in %" PRIu32 " ms", step_names[step], delay_ms);
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    return true;
+}
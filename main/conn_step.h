@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+#include "conn_policy.h"
+
+/**
+ * @brief Waits before a failed setup step is retried
+ * @details Asks the policy (conn_policy_on_step_error()) and sleeps the
+ * jittered backoff it returns. Callers loop on the step:
+ *   while (step() != ESP_OK) {
+ *       if (!conn_step_backoff(&policy, CONN_STEP_STA)) return err;
+ *   }
+ *   conn_policy_on_step_ok(&policy, CONN_STEP_STA);
+ * @param policy Reconnection state
+ * @param step Step that failed
+ * @return true to try the step again, false once the policy gives up
+ */
+bool conn_step_backoff(conn_policy_t *policy, conn_step_t step);
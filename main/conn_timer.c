@@ -0,0 +1,139 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "conn_timer.h"
+
+#define TICK_US ((int64_t)CONN_TIMER_TICK_MS * 1000)
+
+static const char *TAG = "conn_timer";                     // Logging tag
+static timer_wheel_t wheel;
+static esp_timer_handle_t wheel_timer;                     // Fires at the next tick with work
+static uint64_t armed_tick = UINT64_MAX;                   // Tick wheel_timer is armed for
+static SemaphoreHandle_t wheel_mutex;                      // Protects wheel and armed_tick
+
+/**
+ * @brief Current tick, rounded down
+ */
+static uint64_t current_tick(void) {
+    return esp_timer_get_time() / TICK_US;
+}
+
+/**
+ * @brief Tick at which a timeout ends, rounded up so that it never ends early
+ */
+static uint64_t deadline_tick(uint32_t timeout_ms) {
+    return (esp_timer_get_time() + (int64_t)timeout_ms * 1000 + TICK_US - 1) / TICK_US;
+}
+
+/**
+ * @brief Arms wheel_timer for the next tick with work, called with wheel_mutex held
+ * @param force Arm again even if the next tick did not move earlier
+ */
+static void rearm(bool force) {
+    uint64_t tick;
+    if (!timer_wheel_next(&wheel, &tick)) tick = UINT64_MAX;
+    if (!force && tick >= armed_tick) return;
+
+    esp_timer_stop(wheel_timer);
+    armed_tick = tick;
+    if (tick == UINT64_MAX) return;
+    int64_t delay_us = (int64_t)tick * TICK_US - esp_timer_get_time();
+    esp_timer_start_once(wheel_timer, delay_us > 0 ? delay_us : 0);
+}
+
+/**
+ * @brief Hands out the due timers and runs their callbacks outside the lock
+ */
+static void wheel_timer_callback(void *arg) {
+    timer_wheel_timer_t *timer;
+
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    armed_tick = UINT64_MAX;
+    while ((timer = timer_wheel_expire(&wheel, current_tick()))) {
+        timer_wheel_cb_t callback = timer->callback;
+        void *callback_arg = timer->arg;
+        xSemaphoreGive(wheel_mutex);
+        callback(callback_arg);
+        xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    }
+    rearm(true);
+    xSemaphoreGive(wheel_mutex);
+}
+
+/**
+ * @brief Schedules a timer and moves wheel_timer earlier if needed
+ */
+static void start(conn_timer_t *timer, uint64_t expires, uint32_t period) {
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    timer_wheel_add(&wheel, timer, expires, period);
+    rearm(false);
+    xSemaphoreGive(wheel_mutex);
+}
+
+/**
+ * @brief Creates the esp_timer that drives the timer wheel
+ * @return ESP_OK if successful, the failing esp_timer error otherwise
+ */
+esp_err_t conn_timer_init(void) {
+    const esp_timer_create_args_t wheel_timer_args = {
+        .callback = wheel_timer_callback,
+        .name = "conn_timer",
+    };
+
+    wheel_mutex = xSemaphoreCreateMutex();
+    if (!wheel_mutex) return ESP_ERR_NO_MEM;
+    timer_wheel_init(&wheel, current_tick());
+    esp_err_t err = esp_timer_create(&wheel_timer_args, &wheel_timer);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Failed to create the wheel timer: %s", esp_err_to_name(err));
+    return err;
+}
+
+/**
+ * @brief Initializes a timer, not running
+ * @param timer Timer, must stay valid (static)
+ * @param callback Called on expiry
+ * @param arg Passed to callback
+ */
+void conn_timer_setup(conn_timer_t *timer, timer_wheel_cb_t callback, void *arg) {
+    timer_wheel_timer_init(timer, callback, arg);
+}
+
+/**
+ * @brief Starts a one-shot timer, restarting it if it runs
+ * @param timer Timer
+ * @param timeout_ms Time until the callback, rounded up to CONN_TIMER_TICK_MS
+ */
+void conn_timer_start_once(conn_timer_t *timer, uint32_t timeout_ms) {
+    start(timer, deadline_tick(timeout_ms), 0);
+}
+
+/**
+ * @brief Starts a periodic timer, restarting it if it runs
+ * @param timer Timer
+ * @param period_ms Time between callbacks, rounded up to CONN_TIMER_TICK_MS
+ */
+void conn_timer_start_periodic(conn_timer_t *timer, uint32_t period_ms) {
+    uint32_t period = (period_ms + CONN_TIMER_TICK_MS - 1) / CONN_TIMER_TICK_MS;
+    start(timer, deadline_tick(period_ms), period ? period : 1);
+}
+
+/**
+ * @brief Stops a timer
+ * @details wheel_timer stays armed, a wakeup with nothing due only rearms it.
+ */
+void conn_timer_stop(conn_timer_t *timer) {
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    timer_wheel_cancel(&wheel, timer);
+    xSemaphoreGive(wheel_mutex);
+}
+
+/**
+ * @brief Tells if a timer runs
+ */
+bool conn_timer_is_active(conn_timer_t *timer) {
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    bool active = timer_wheel_pending(timer);
+    xSemaphoreGive(wheel_mutex);
+    return active;
+}
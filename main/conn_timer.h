@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "timer_wheel.h"
+
+#define CONN_TIMER_TICK_MS 10             // Resolution, timeouts are rounded up to it
+
+typedef timer_wheel_timer_t conn_timer_t;
+
+/**
+ * @brief Creates the esp_timer that drives the timer wheel
+ * @details All connectivity and session timeouts share one timer wheel
+ * (timer_wheel.h). A single one-shot esp_timer is armed for the next tick at
+ * which the wheel has work, so the timer task wakes once per tick that has
+ * due timers, not once per timer. Callbacks run in the esp_timer task, as
+ * with esp_timer, and must not block.
+ * @return ESP_OK if successful, the failing esp_timer error otherwise
+ */
+esp_err_t conn_timer_init(void);
+
+/**
+ * @brief Initializes a timer, not running
+ * @param timer Timer, must stay valid (static)
+ * @param callback Called on expiry
+ * @param arg Passed to callback
+ */
+void conn_timer_setup(conn_timer_t *timer, timer_wheel_cb_t callback, void *arg);
+
+/**
+ * @brief Starts a one-shot timer, restarting it if it runs
+ * @param timer Timer
+ * @param timeout_ms Time until the callback, rounded up to CONN_TIMER_TICK_MS
+ */
+void conn_timer_start_once(conn_timer_t *timer, uint32_t timeout_ms);
+
+/**
+ * @brief Starts a periodic timer, restarting it if it runs
+ * @param timer Timer
+ * @param period_ms Time between callbacks, rounded up to CONN_TIMER_TICK_MS
+ */
+void conn_timer_start_periodic(conn_timer_t *timer, uint32_t period_ms);
+
+/**
+ * @brief Stops a timer
+ * @details A callback that is already running is not waited for.
+ */
+void conn_timer_stop(conn_timer_t *timer);
+
+/**
+ * @brief Tells if a timer runs
+ */
+bool conn_timer_is_active(conn_timer_t *timer);
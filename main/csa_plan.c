@@ -0,0 +1,49 @@
+#include "csa_plan.h"
+
+#define TU_US 1024                        // One time unit in microseconds
+
+/**
+ * @brief Duration of a number of beacon intervals in milliseconds
+ */
+static uint32_t beacons_to_ms(uint32_t beacons, uint16_t beacon_tu) {
+    return (uint32_t)((uint64_t)beacons * beacon_tu * TU_US / 1000);
+}
+
+/**
+ * @brief Number of beacons the soft-AP should announce a channel switch for
+ * @param params Beacon configuration and targets
+ * @return CSA count in [1, 255]
+ */
+uint8_t csa_plan_count(const csa_plan_params_t *params) {
+    uint32_t dtim = params->dtim ? params->dtim : 1;
+    uint32_t count = params->min_heard * dtim;
+
+    // Too slow: announce for as many beacons as fit, but at least one DTIM period
+    if (beacons_to_ms(count, params->beacon_tu) > params->max_delay_ms) {
+        uint32_t beacon_ms = beacons_to_ms(1, params->beacon_tu);
+        count = beacon_ms ? params->max_delay_ms / beacon_ms : count;
+        if (count < dtim) count = dtim;
+    }
+
+    if (count < 1) count = 1;
+    if (count > 255) count = 255;
+    return (uint8_t)count;
+}
+
+/**
+ * @brief Plans the move of the soft-AP to the STA channel
+ * @param ap_channel Current soft-AP channel
+ * @param sta_channel Channel of the AP the STA associated with
+ * @param stations Number of clients associated to the soft-AP
+ * @param params Beacon configuration and targets
+ * @param out Plan output
+ */
+void csa_plan(uint8_t ap_channel, uint8_t sta_channel, int stations,
+              const csa_plan_params_t *params, csa_plan_t *out) {
+    out->switch_needed = ap_channel != sta_channel;
+    out->announce = out->switch_needed && stations > 0;
+
+    // Nobody to warn: switch on the next beacon
+    out->count = out->announce ? csa_plan_count(params) : 1;
+    out->delay_ms = out->switch_needed ? beacons_to_ms(out->count, params->beacon_tu) : 0;
+}
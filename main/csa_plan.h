@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Inputs of the Channel Switch Announcement planning
+ */
+typedef struct {
+    uint16_t beacon_tu;                   // Beacon interval of the soft-AP (1 TU = 1024 us)
+    uint8_t dtim;                         // DTIM period, power-saving clients only wake for DTIM beacons
+    uint8_t min_heard;                    // CSA beacons each client should be able to hear
+    uint32_t max_delay_ms;                // Longest acceptable delay before the switch
+} csa_plan_params_t;
+
+// Three announcements per client, at most two seconds before moving
+#define CSA_PLAN_DEFAULT_PARAMS(beacon, dtim_period) { \
+    .beacon_tu = (beacon),                              \
+    .dtim = (dtim_period),                              \
+    .min_heard = 3,                                     \
+    .max_delay_ms = 2000,                               \
+}
+
+/**
+ * @brief Planned channel switch
+ */
+typedef struct {
+    bool switch_needed;                   // AP and STA channels differ
+    bool announce;                        // Clients are associated and need the CSA
+    uint8_t count;                        // CSA count (beacons before the switch)
+    uint32_t delay_ms;                    // Time from the first CSA beacon to the switch
+} csa_plan_t;
+
+/**
+ * @brief Number of beacons the soft-AP should announce a channel switch for
+ * @details Enough beacons for every power-saving client to hear min_heard of
+ * them, shortened to max_delay_ms but never below one DTIM period.
+ * @param params Beacon configuration and targets
+ * @return CSA count in [1, 255]
+ */
+uint8_t csa_plan_count(const csa_plan_params_t *params);
+
+/**
+ * @brief Plans the move of the soft-AP to the STA channel
+ * @param ap_channel Current soft-AP channel
+ * @param sta_channel Channel of the AP the STA associated with
+ * @param stations Number of clients associated to the soft-AP
+ * @param params Beacon configuration and targets
+ * @param out Plan output
+ */
+void csa_plan(uint8_t ap_channel, uint8_t sta_channel, int stations,
+              const csa_plan_params_t *params, csa_plan_t *out);
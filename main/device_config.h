@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "esp_netif.h"
+
+// Size limits shared by the NVS table, the TCP protocol and the WiFi driver
+#define WIFI_NAME_SIZE  32                // Maximum size for SSID
+#define WIFI_PASS_SIZE  64                // Maximum size for password
+#define HOSTNAME_SIZE   32                // Maximum size for the STA hostname
+#define IP4_STR_SIZE    16                // Dotted IPv4 address with its terminator
+
+// Defaults used until the client sends something else
+#define DEFAULT_HOSTNAME        "esp32-c6"
+#define DEFAULT_LOG_LEVEL       ESP_LOG_INFO
+#define DEFAULT_AP_CHANNEL      1
+#define DEFAULT_WIFI_TIMEOUT_MS 30000     // WiFi connection timeout (30 seconds)
+#define DEFAULT_SCAN_DWELL_MS   40        // Off-channel time per scanned channel while serving AP clients
+#define DEFAULT_SCAN_HOME_MS    100       // AP channel time between scanned channels
+#define DEFAULT_HEARTBEAT_S     60        // Heartbeat interval while connected
+#define DEFAULT_UPLINK_HOST     "192.168.0.10" // TCP sink receiving the queued application data
+#define DEFAULT_UPLINK_PORT     5000      // Port of the TCP sink
+
+/**
+ * @brief Complete runtime configuration of the device
+ * @details Everything the provisioning protocol can change lives here so that
+ * a new configuration can be compared field by field with the active one.
+ */
+typedef struct {
+    char ssid[WIFI_NAME_SIZE];            // STA network name
+    char password[WIFI_PASS_SIZE];        // STA network password
+    char hostname[HOSTNAME_SIZE];         // Hostname announced over DHCP
+    bool static_ip;                       // Use ip_info instead of DHCP
+    esp_netif_ip_info_t ip_info;          // Static address, gateway and netmask
+    esp_log_level_t log_level;            // Global log level
+    uint8_t ap_channel;                   // Soft-AP channel
+    uint32_t wifi_timeout_ms;             // Timeout for a single connection attempt
+    uint16_t scan_dwell_ms;               // Scan budget while serving AP clients: time per channel
+    uint16_t scan_home_ms;                // and time back on the AP channel in between
+    bool relay;                           // Relay the credentials to neighbours once connected
+    uint16_t heartbeat_s;                 // Heartbeat interval, 0 = off
+    char uplink_host[IP4_STR_SIZE];       // Sink of the uplink queue
+    uint16_t uplink_port;
+} device_config_t;
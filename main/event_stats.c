@@ -0,0 +1,61 @@
+#include "event_stats.h"
+
+/**
+ * @brief Counts an event about to be queued
+ */
+void event_stats_on_post(event_stats_t *stats) {
+    stats->posted++;
+    stats->depth++;
+    if (stats->depth > stats->max_depth) stats->max_depth = stats->depth;
+}
+
+/**
+ * @brief Takes back an event counted by event_stats_on_post() that the full queue refused
+ */
+void event_stats_on_drop(event_stats_t *stats) {
+    stats->posted--;
+    stats->depth--;
+    stats->dropped++;
+}
+
+/**
+ * @brief Counts the dispatch of a queued event
+ * @param stats Statistics
+ * @param latency_us Time from the post to the dispatch
+ */
+void event_stats_on_dispatch(event_stats_t *stats, uint32_t latency_us) {
+    int bucket = 0;
+
+    if (stats->depth > 0) stats->depth--;
+    stats->dispatched++;
+    stats->latency_sum_us += latency_us;
+    if (latency_us > stats->latency_max_us) stats->latency_max_us = latency_us;
+
+    while (bucket < EVENT_STATS_BUCKETS - 1 && latency_us >= ((uint32_t)EVENT_STATS_BUCKET0_US << bucket)) {
+        bucket++;
+    }
+    stats->histogram[bucket]++;
+}
+
+/**
+ * @brief Estimates a dispatch latency percentile from the histogram
+ * @param stats Statistics
+ * @param percent Percentile, 1 to 100
+ * @return Upper bound of the bucket holding the percentile, capped at the
+ * worst latency seen; 0 before the first dispatch
+ */
+uint32_t event_stats_percentile_us(const event_stats_t *stats, uint32_t percent) {
+    if (stats->dispatched == 0) return 0;
+
+    // Rank of the percentile, rounded up
+    uint64_t rank = ((uint64_t)stats->dispatched * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < EVENT_STATS_BUCKETS - 1; i++) {
+        seen += stats->histogram[i];
+        if (seen >= rank) {
+            uint32_t bound = (uint32_t)EVENT_STATS_BUCKET0_US << i;
+            return bound < stats->latency_max_us ? bound : stats->latency_max_us;
+        }
+    }
+    return stats->latency_max_us;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#define EVENT_STATS_BUCKETS   16          // Latency histogram buckets
+#define EVENT_STATS_BUCKET0_US 32         // Bucket i holds latencies below 32 << i us, the last one the rest
+
+/**
+ * @brief Queue depth and dispatch latency of an event loop
+ * @details Pure logic without driver calls, shared by the firmware and the
+ * host stress test (tools/event_loop_stress.c). The caller serializes access.
+ * The firmware only dispatches, with the run time of the handler as the
+ * latency, see conn_events.c.
+ */
+typedef struct {
+    uint32_t posted;                      // Events queued
+    uint32_t dropped;                     // Events lost to a full queue
+    uint32_t dispatched;                  // Events handed to the handler
+    uint32_t depth;                       // Events queued and not dispatched yet
+    uint32_t max_depth;                   // Highest depth seen
+    uint64_t latency_sum_us;              // Post to dispatch, summed over dispatched events
+    uint32_t latency_max_us;              // Worst post to dispatch latency
+    uint32_t histogram[EVENT_STATS_BUCKETS];
+} event_stats_t;
+
+/**
+ * @brief Counts an event about to be queued
+ * @details Called before the post: a dispatching task of higher priority can
+ * run before the post returns.
+ */
+void event_stats_on_post(event_stats_t *stats);
+
+/**
+ * @brief Takes back an event counted by event_stats_on_post() that the full queue refused
+ */
+void event_stats_on_drop(event_stats_t *stats);
+
+/**
+ * @brief Counts the dispatch of a queued event
+ * @param stats Statistics
+ * @param latency_us Time from the post to the dispatch
+ */
+void event_stats_on_dispatch(event_stats_t *stats, uint32_t latency_us);
+
+/**
+ * @brief Estimates a dispatch latency percentile from the histogram
+ * @param stats Statistics
+ * @param percent Percentile, 1 to 100
+ * @return Upper bound of the bucket holding the percentile, capped at the
+ * worst latency seen; 0 before the first dispatch
+ */
+uint32_t event_stats_percentile_us(const event_stats_t *stats, uint32_t percent);
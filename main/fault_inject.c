@@ -0,0 +1,217 @@
+#include "fault_inject.h"
+
+#if FAULT_INJECT_ENABLED
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+
+#define FAULT_MAGIC 0x46415531            // Marks rules written by this firmware, RTC memory is random at power-on
+
+typedef struct {
+    bool armed;
+    fault_rule_t rule;                    // skip and count go down as calls pass and fail
+} fault_state_t;
+
+typedef struct {
+    uint32_t calls;
+    uint32_t injected;
+    int64_t last_ms;                      // Last failure, -1 if none
+} fault_stats_t;
+
+static const char *TAG = "fault_inject";                   // Logging tag
+static const char *const site_names[FAULT_SITE_COUNT] = {
+    "nvs_open", "nvs_get", "nvs_set", "nvs_commit", "bind", "listen", "accept", "recv", "send",
+    "wifi_mode", "wifi_start",
+};
+static portMUX_TYPE fault_lock = portMUX_INITIALIZER_UNLOCKED; // Protects states and stats
+static RTC_NOINIT_ATTR uint32_t magic;
+static RTC_NOINIT_ATTR fault_state_t states[FAULT_SITE_COUNT];
+static fault_stats_t stats[FAULT_SITE_COUNT];
+
+/**
+ * @brief Counts a call and decides whether it fails
+ * @return true if the call must fail
+ */
+static bool hit(fault_site_t site) {
+    bool fail = false;
+
+    portENTER_CRITICAL(&fault_lock);
+    fault_state_t *state = &states[site];
+    stats[site].calls++;
+    if (state->armed) {
+        if (state->rule.skip > 0) {
+            state->rule.skip--;
+        } else if (state->rule.permille >= 1000 || esp_random() % 1000 < state->rule.permille) {
+            fail = true;
+            if (state->rule.count > 0 && --state->rule.count == 0) state->armed = false;
+        }
+    }
+    if (fail) {
+        stats[site].injected++;
+        stats[site].last_ms = esp_timer_get_time() / 1000;
+    }
+    portEXIT_CRITICAL(&fault_lock);
+
+    if (fail) ESP_LOGW(TAG, "Injected %s failure", site_names[site]);
+    return fail;
+}
+
+/**
+ * @brief Partial mode of a site, only meaningful while a call fails
+ */
+static bool partial(fault_site_t site) {
+    return states[site].rule.partial;
+}
+
+/**
+ * @brief Keeps the rules of the previous boot, clears the statistics
+ */
+void fault_inject_init(void) {
+    if (magic != FAULT_MAGIC) {
+        memset(states, 0, sizeof(states));
+        magic = FAULT_MAGIC;
+    }
+    for (int i = 0; i < FAULT_SITE_COUNT; i++) {
+        stats[i] = (fault_stats_t){ .last_ms = -1 };
+        if (states[i].armed) ESP_LOGW(TAG, "Rule for %s kept from the previous boot", site_names[i]);
+    }
+}
+
+/**
+ * @brief Finds a site by its dump name
+ * @return The site, FAULT_SITE_COUNT if unknown
+ */
+fault_site_t fault_inject_site(const char *name) {
+    for (int i = 0; i < FAULT_SITE_COUNT; i++) {
+        if (strcmp(site_names[i], name) == 0) return i;
+    }
+    return FAULT_SITE_COUNT;
+}
+
+/**
+ * @brief Replaces the rule of a site
+ * @param site Site
+ * @param rule New rule
+ */
+void fault_inject_set(fault_site_t site, const fault_rule_t *rule) {
+    portENTER_CRITICAL(&fault_lock);
+    states[site].rule = *rule;
+    states[site].armed = rule->permille > 0;
+    portEXIT_CRITICAL(&fault_lock);
+}
+
+/**
+ * @brief Disarms all sites
+ */
+void fault_inject_clear(void) {
+    portENTER_CRITICAL(&fault_lock);
+    memset(states, 0, sizeof(states));
+    portEXIT_CRITICAL(&fault_lock);
+}
+
+/**
+ * @brief Writes the rules and statistics
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void fault_inject_dump(fault_write_fn write, void *arg) {
+    char line[96];
+    int len;
+
+    len = snprintf(line, sizeof(line), "# faults now_ms=%" PRId64 "\n", esp_timer_get_time() / 1000);
+    write(line, len, arg);
+    for (int i = 0; i < FAULT_SITE_COUNT; i++) {
+        portENTER_CRITICAL(&fault_lock);
+        bool armed = states[i].armed;
+        fault_stats_t site = stats[i];
+        portEXIT_CRITICAL(&fault_lock);
+        len = snprintf(line, sizeof(line), "%s armed=%d calls=%" PRIu32 " injected=%" PRIu32 " last_ms=%" PRId64 "\n",
+                       site_names[i], armed, site.calls, site.injected, site.last_ms);
+        write(line, len, arg);
+    }
+}
+
+esp_err_t fault_nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    if (hit(FAULT_NVS_OPEN)) return ESP_FAIL;
+    return nvs_open(name, mode, handle);
+}
+
+esp_err_t fault_nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *length) {
+    if (hit(FAULT_NVS_GET)) return ESP_ERR_NVS_INVALID_LENGTH;
+    return nvs_get_str(handle, key, out, length);
+}
+
+esp_err_t fault_nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    if (hit(FAULT_NVS_SET)) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    return nvs_set_str(handle, key, value);
+}
+
+esp_err_t fault_nvs_commit(nvs_handle_t handle) {
+    if (hit(FAULT_NVS_COMMIT)) return ESP_FAIL;
+    return nvs_commit(handle);
+}
+
+int fault_bind(int s, const struct sockaddr *name, socklen_t namelen) {
+    if (hit(FAULT_BIND)) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    return bind(s, name, namelen);
+}
+
+int fault_listen(int s, int backlog) {
+    if (hit(FAULT_LISTEN)) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    return listen(s, backlog);
+}
+
+int fault_accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
+    // The pending connection stays queued, the next accept() gets it
+    if (hit(FAULT_ACCEPT)) {
+        errno = ENFILE;
+        return -1;
+    }
+    return accept(s, addr, addrlen);
+}
+
+ssize_t fault_recv(int s, void *mem, size_t len, int flags) {
+    if (!hit(FAULT_RECV)) return recv(s, mem, len, flags);
+    if (!partial(FAULT_RECV)) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    // Waits for the data, then leaves its second half for the next call
+    ssize_t available = recv(s, mem, len, flags | MSG_PEEK);
+    if (available <= 1) return recv(s, mem, len, flags);
+    return recv(s, mem, available / 2, flags);
+}
+
+ssize_t fault_send(int s, const void *data, size_t size, int flags) {
+    if (!hit(FAULT_SEND)) return send(s, data, size, flags);
+    if (!partial(FAULT_SEND)) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    return send(s, data, size / 2, flags);
+}
+
+esp_err_t fault_wifi_set_mode(wifi_mode_t mode) {
+    if (hit(FAULT_WIFI_MODE)) return ESP_ERR_NO_MEM;
+    return esp_wifi_set_mode(mode);
+}
+
+esp_err_t fault_wifi_start(void) {
+    if (hit(FAULT_WIFI_START)) return ESP_ERR_NO_MEM;
+    return esp_wifi_start();
+}
+
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include "lwip/sockets.h"
+
+// Built only with `idf.py -DFAULT_INJECT_ENABLED=1 build`, see main/CMakeLists.txt
+#ifndef FAULT_INJECT_ENABLED
+#define FAULT_INJECT_ENABLED 0
+#endif
+
+/**
+ * @brief Calls that can be made to fail
+ */
+typedef enum {
+    FAULT_NVS_OPEN,                       // ESP_FAIL
+    FAULT_NVS_GET,                        // ESP_ERR_NVS_INVALID_LENGTH, the value does not fit
+    FAULT_NVS_SET,                        // ESP_ERR_NVS_NOT_ENOUGH_SPACE
+    FAULT_NVS_COMMIT,                     // ESP_FAIL
+    FAULT_BIND,                           // -1, errno EADDRINUSE
+    FAULT_LISTEN,                         // -1, errno ENOBUFS
+    FAULT_ACCEPT,                         // -1, errno ENFILE
+    FAULT_RECV,                           // -1, errno ECONNRESET; partial: the first half of the data
+    FAULT_SEND,                           // -1, errno ECONNRESET, nothing sent; partial: half sent
+    FAULT_WIFI_MODE,                      // esp_wifi_set_mode(): ESP_ERR_NO_MEM
+    FAULT_WIFI_START,                     // esp_wifi_start(): ESP_ERR_NO_MEM
+    FAULT_SITE_COUNT,
+} fault_site_t;
+
+/**
+ * @brief When a site fails
+ * @details Scripted: skip 2, count 1, permille 1000 fails the third call only.
+ * Probabilistic: permille 50, count 0 fails about every 20th call for good.
+ */
+typedef struct {
+    uint32_t skip;                        // Calls passed before failures start
+    uint32_t count;                       // Failures, then the rule is done; 0 for no limit
+    uint16_t permille;                    // Chance of failing each call after skip, 1000 for always
+    bool partial;                         // recv and send: move half of the data instead of failing
+} fault_rule_t;
+
+/**
+ * @brief Receives the dump one line at a time
+ */
+typedef void (*fault_write_fn)(const char *line, size_t len, void *arg);
+
+#if FAULT_INJECT_ENABLED
+
+/**
+ * @brief Keeps the rules of the previous boot, clears the statistics
+ * @details Rules live in RTC memory, so they survive esp_restart() and
+ * crashes but not a power cycle. This makes faults during boot testable:
+ * arm the rule, restart. Call first in app_main().
+ */
+void fault_inject_init(void);
+
+/**
+ * @brief Finds a site by its dump name (nvs_open, nvs_get, ..., wifi_start)
+ * @return The site, FAULT_SITE_COUNT if unknown
+ */
+fault_site_t fault_inject_site(const char *name);
+
+/**
+ * @brief Replaces the rule of a site, count 0 and permille 0 disarms it
+ * @param site Site
+ * @param rule New rule
+ */
+void fault_inject_set(fault_site_t site, const fault_rule_t *rule);
+
+/**
+ * @brief Disarms all sites
+ */
+void fault_inject_clear(void);
+
+/**
+ * @brief Writes the rules and statistics
+ * @details Format:
+ *   # faults now_ms=<n>
+ *   <site> armed=<0|1> calls=<n> injected=<n> last_ms=<n, -1 if none>
+ * tools/fault_run.py measures recovery from each site.
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void fault_inject_dump(fault_write_fn write, void *arg);
+
+// Same contract as the wrapped call, plus the injected failures
+esp_err_t fault_nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle);
+esp_err_t fault_nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *length);
+esp_err_t fault_nvs_set_str(nvs_handle_t handle, const char *key, const char *value);
+esp_err_t fault_nvs_commit(nvs_handle_t handle);
+int fault_bind(int s, const struct sockaddr *name, socklen_t namelen);
+int fault_listen(int s, int backlog);
+int fault_accept(int s, struct sockaddr *addr, socklen_t *addrlen);
+ssize_t fault_recv(int s, void *mem, size_t len, int flags);
+ssize_t fault_send(int s, const void *data, size_t size, int flags);
+esp_err_t fault_wifi_set_mode(wifi_mode_t mode);
+esp_err_t fault_wifi_start(void);
+
+#else
+
+static inline void fault_inject_init(void) {}
+static inline fault_site_t fault_inject_site(const char *name) { return FAULT_SITE_COUNT; }
+static inline void fault_inject_set(fault_site_t site, const fault_rule_t *rule) {}
+static inline void fault_inject_clear(void) {}
+static inline void fault_inject_dump(fault_write_fn write, void *arg) {}
+
+static inline esp_err_t fault_nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    return nvs_open(name, mode, handle);
+}
+static inline esp_err_t fault_nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *length) {
+    return nvs_get_str(handle, key, out, length);
+}
+static inline esp_err_t fault_nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return nvs_set_str(handle, key, value);
+}
+static inline esp_err_t fault_nvs_commit(nvs_handle_t handle) { return nvs_commit(handle); }
+static inline int fault_bind(int s, const struct sockaddr *name, socklen_t namelen) {
+    return bind(s, name, namelen);
+}
+static inline int fault_listen(int s, int backlog) { return listen(s, backlog); }
+static inline int fault_accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
+    return accept(s, addr, addrlen);
+}
+static inline ssize_t fault_recv(int s, void *mem, size_t len, int flags) { return recv(s, mem, len, flags); }
+static inline ssize_t fault_send(int s, const void *data, size_t size, int flags) {
+    return send(s, data, size, flags);
+}
+static inline esp_err_t fault_wifi_set_mode(wifi_mode_t mode) { return esp_wifi_set_mode(mode); }
+static inline esp_err_t fault_wifi_start(void) { return esp_wifi_start(); }
+
+#endif
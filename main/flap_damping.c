@@ -0,0 +1,87 @@
+#include <math.h>
+#include <string.h>
+#include "flap_damping.h"
+
+/**
+ * @brief Initializes the damping state
+ * @param damping State to initialize
+ * @param config Tuning values
+ */
+void flap_damping_init(flap_damping_t *damping, const flap_damping_config_t *config) {
+    memset(damping, 0, sizeof(*damping));
+    damping->config = *config;
+}
+
+/**
+ * @brief Clears the penalty, e.g. when switching to another network
+ */
+void flap_damping_reset(flap_damping_t *damping) {
+    damping->penalty = 0;
+    damping->suppressed = false;
+    damping->flap_count = 0;
+}
+
+/**
+ * @brief Applies the exponential decay up to the given time
+ */
+static void decay(flap_damping_t *damping, int64_t now_ms) {
+    int64_t elapsed = now_ms - damping->last_update_ms;
+    damping->last_update_ms = now_ms;
+
+    if (elapsed <= 0 || damping->penalty == 0) return;
+
+    // penalty * 2^(-elapsed / half_life)
+    float factor = exp2f(-(float)elapsed / (float)damping->config.half_life_ms);
+    damping->penalty = (uint32_t)((float)damping->penalty * factor);
+
+    // Hysteresis: suppression only ends below the reuse threshold
+    if (damping->suppressed && damping->penalty < damping->config.reuse_threshold) {
+        damping->suppressed = false;
+    }
+}
+
+/**
+ * @brief Records a flap of the link
+ * @param damping Damping state
+ * @param now_ms Current time in milliseconds
+ * @return true if the link is suppressed after this flap
+ */
+bool flap_damping_record_flap(flap_damping_t *damping, int64_t now_ms) {
+    decay(damping, now_ms);
+
+    damping->penalty += damping->config.penalty_per_flap;
+    if (damping->penalty > damping->config.max_penalty) {
+        damping->penalty = damping->config.max_penalty;
+    }
+    damping->flap_count++;
+
+    if (damping->penalty > damping->config.suppress_threshold) {
+        damping->suppressed = true;
+    }
+    return damping->suppressed;
+}
+
+/**
+ * @brief Decays the penalty and reports whether the link is suppressed
+ * @param damping Damping state
+ * @param now_ms Current time in milliseconds
+ * @return true if the link is suppressed
+ */
+bool flap_damping_is_suppressed(flap_damping_t *damping, int64_t now_ms) {
+    decay(damping, now_ms);
+    return damping->suppressed;
+}
+
+/**
+ * @brief Time until a suppressed link becomes usable again
+ * @param damping Damping state
+ * @param now_ms Current time in milliseconds
+ * @return Milliseconds until reuse, 0 if the link is not suppressed
+ */
+uint32_t flap_damping_reuse_delay_ms(flap_damping_t *damping, int64_t now_ms) {
+    if (!flap_damping_is_suppressed(damping, now_ms)) return 0;
+
+    // Solve penalty * 2^(-t / half_life) < reuse_threshold for t
+    float halvings = log2f((float)damping->penalty / (float)damping->config.reuse_threshold);
+    return (uint32_t)(halvings * (float)damping->config.half_life_ms) + 1;
+}
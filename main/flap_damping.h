@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Tuning of the link flap damping
+ * @details Works like BGP route flap damping: every flap adds a penalty that
+ * decays exponentially. Once the penalty exceeds the suppress threshold the
+ * link is considered unstable until the penalty decays below the reuse
+ * threshold.
+ */
+typedef struct {
+    uint32_t penalty_per_flap;            // Penalty added for every flap
+    uint32_t suppress_threshold;          // Suppress when penalty goes above this
+    uint32_t reuse_threshold;             // Stop suppressing when penalty goes below this
+    uint32_t max_penalty;                 // Ceiling, bounds the maximum suppression time
+    uint32_t half_life_ms;                // Time for the penalty to halve
+} flap_damping_config_t;
+
+/**
+ * @brief Damping state of a single link
+ */
+typedef struct {
+    flap_damping_config_t config;
+    uint32_t penalty;                     // Penalty at last_update_ms
+    int64_t last_update_ms;               // Time of the last decay step
+    bool suppressed;                      // Link is currently suppressed
+    uint32_t flap_count;                  // Total flaps seen since the last reset
+} flap_damping_t;
+
+// Defaults tuned for disconnect storms a few seconds apart
+#define FLAP_DAMPING_DEFAULT_CONFIG() { \
+    .penalty_per_flap = 1000,           \
+    .suppress_threshold = 2500,         \
+    .reuse_threshold = 800,             \
+    .max_penalty = 6000,                \
+    .half_life_ms = 20000,              \
+}
+
+/**
+ * @brief Initializes the damping state
+ * @param damping State to initialize
+ * @param config Tuning values
+ */
+void flap_damping_init(flap_damping_t *damping, const flap_damping_config_t *config);
+
+/**
+ * @brief Clears the penalty, e.g. when switching to another network
+ */
+void flap_damping_reset(flap_damping_t *damping);
+
+/**
+ * @brief Records a flap of the link
+ * @param damping Damping state
+ * @param now_ms Current time in milliseconds
+ * @return true if the link is suppressed after this flap
+ */
+bool flap_damping_record_flap(flap_damping_t *damping, int64_t now_ms);
+
+/**
+ * @brief Decays the penalty and reports whether the link is suppressed
+ * @param damping Damping state
+ * @param now_ms Current time in milliseconds
+ * @return true if the link is suppressed
+ */
+bool flap_damping_is_suppressed(flap_damping_t *damping, int64_t now_ms);
+
+/**
+ * @brief Time until a suppressed link becomes usable again
+ * @param damping Damping state
+ * @param now_ms Current time in milliseconds
+ * @return Milliseconds until reuse, 0 if the link is not suppressed
+ */
+uint32_t flap_damping_reuse_delay_ms(flap_damping_t *damping, int64_t now_ms);
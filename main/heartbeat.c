@@ -0,0 +1,108 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_app_desc.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "lwip/sockets.h"
+#include "config_apply.h"
+#include "config_push.h"
+#include "net_status.h"
+#include "heartbeat.h"
+
+#define READY_WAIT_MS     60000           // Wait for the network between checks
+#define DISABLED_CHECK_MS 10000           // Period of the check while heartbeats are off
+
+static const char *TAG = "heartbeat";                      // Logging tag
+static struct sockaddr_in collector_addr;                  // Collector address
+static heartbeat_packet_t packet;                          // Reused for every beat
+
+/**
+ * @brief Fills the variable part of the packet
+ */
+static void fill_packet(const net_status_t *status, const device_config_t *config) {
+    packet.state = status->state;
+    packet.flags = (config->ssid[0] ? HEARTBEAT_FLAG_PROVISIONED : 0) |
+                   (config->relay ? HEARTBEAT_FLAG_RELAY : 0);
+    packet.rssi = status->rssi;
+    packet.seq = htonl(ntohl(packet.seq) + 1);
+    packet.uptime_s = htonl((uint32_t)(esp_timer_get_time() / 1000000));
+    packet.link_uptime_s = htonl(status->link_uptime_ms / 1000);
+    packet.reconnect_count = htonl(status->reconnect_count);
+    packet.heap_free = htonl(esp_get_free_heap_size());
+    packet.heap_min_free = htonl(esp_get_minimum_free_heap_size());
+    packet.config_version = htonl(config_push_version());
+}
+
+/**
+ * @brief Sends a beat at every interval while the network is ready
+ */
+static void heartbeat_task(void *pvParameters) {
+    int sock = -1;
+
+    while (1) {
+        uint32_t interval_ms = config_apply_active()->heartbeat_s * 1000;
+        if (interval_ms == 0) {
+            vTaskDelay(pdMS_TO_TICKS(DISABLED_CHECK_MS));
+            continue;
+        }
+        if (!net_status_wait_ready(READY_WAIT_MS)) continue;
+
+        // Spread the fleet: each interval is drawn again
+        uint32_t jitter_ms = interval_ms * HEARTBEAT_JITTER_PCT / 100;
+        vTaskDelay(pdMS_TO_TICKS(interval_ms - jitter_ms + esp_random() % (2 * jitter_ms + 1)));
+
+        // Fresh signal strength, shared with the other status readers
+        wifi_ap_record_t ap_info;
+        if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+            net_status_update_rssi(ap_info.rssi);
+        }
+
+        net_status_t status;
+        net_status_get(&status);
+        if (status.state != NET_STATE_READY) continue;
+
+        if (sock < 0) {
+            sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (sock < 0) {
+                ESP_LOGE(TAG, "Socket creation failed! Error: %d", errno);
+                continue;
+            }
+        }
+
+        fill_packet(&status, config_apply_active());
+        if (sendto(sock, &packet, sizeof(packet), 0, (struct sockaddr *)&collector_addr,
+                   sizeof(collector_addr)) < 0) {
+            ESP_LOGW(TAG, "Send failed! Error: %d", errno);
+            close(sock);
+            sock = -1;
+        }
+    }
+}
+
+/**
+ * @brief Starts the heartbeat task
+ * @param config Collector address, copied
+ * @return ESP_OK if successful, ESP_ERR_INVALID_ARG for a bad address,
+ * ESP_ERR_NO_MEM if the task can not be created
+ */
+esp_err_t heartbeat_init(const heartbeat_config_t *config) {
+    collector_addr.sin_family = AF_INET;
+    collector_addr.sin_port = htons(config->port);
+    if (inet_pton(AF_INET, config->host, &collector_addr.sin_addr) != 1) return ESP_ERR_INVALID_ARG;
+
+    // Constant part of the packet
+    packet.magic = htons(HEARTBEAT_MAGIC);
+    packet.format = HEARTBEAT_FORMAT;
+    esp_read_mac(packet.device_id, ESP_MAC_WIFI_STA);
+    memcpy(packet.fw_sha, esp_app_get_description()->app_elf_sha256, sizeof(packet.fw_sha));
+
+    if (xTaskCreate(heartbeat_task, "heartbeat", 3072, NULL, 4, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
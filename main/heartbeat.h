@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define HEARTBEAT_MAGIC     0x4842        // "HB"
+#define HEARTBEAT_FORMAT    1             // Layout of heartbeat_packet_t
+#define HEARTBEAT_JITTER_PCT 10           // Interval varies by up to +/- this much
+
+// heartbeat_packet_t flags
+#define HEARTBEAT_FLAG_PROVISIONED 0x01   // Credentials are configured
+#define HEARTBEAT_FLAG_RELAY       0x02   // Relay mode is on
+
+/**
+ * @brief Heartbeat datagram, 48 bytes, multi-byte fields big-endian
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;                       // HEARTBEAT_MAGIC
+    uint8_t format;                       // HEARTBEAT_FORMAT
+    uint8_t state;                        // net_state_t
+    uint8_t device_id[6];                 // STA MAC address
+    uint8_t flags;                        // HEARTBEAT_FLAG_*
+    int8_t rssi;                          // Signal of the AP in dBm
+    uint32_t seq;                         // Beat counter since boot, gaps are lost beats
+    uint32_t uptime_s;                    // Time since boot
+    uint32_t link_uptime_s;               // Time the link has been ready
+    uint32_t reconnect_count;             // Times the link came back
+    uint32_t heap_free;                   // Free heap now
+    uint32_t heap_min_free;               // Free heap low-water mark since boot
+    uint32_t config_version;              // Last multicast configuration applied
+    uint8_t fw_sha[8];                    // Start of the application ELF SHA-256
+} heartbeat_packet_t;
+
+/**
+ * @brief Destination of the heartbeats
+ */
+typedef struct {
+    const char *host;                     // Collector IPv4 address
+    uint16_t port;                        // Collector UDP port
+} heartbeat_config_t;
+
+/**
+ * @brief Starts the heartbeat task
+ * @details While the network is ready, one datagram is sent every
+ * heartbeat_s seconds of the active configuration, +/- HEARTBEAT_JITTER_PCT.
+ * The packet and the socket are allocated once. sendto() still allocates: lwIP
+ * on ESP-IDF takes the header pbuf of every datagram from the heap, and frees
+ * it once the frame is sent. A beat leaves the heap as it found it, but it
+ * needs a few hundred free bytes.
+ * @param config Collector address, copied
+ * @return ESP_OK if successful, ESP_ERR_INVALID_ARG for a bad address,
+ * ESP_ERR_NO_MEM if the task can not be created
+ */
+esp_err_t heartbeat_init(const heartbeat_config_t *config);
@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "bench.h"
+#include "device_config.h"
+#include "json_value.h"
+
+/**
+ * @brief Extracts a value from a JSON formatted string and cleans control characters
+ * @param json_str The input JSON string
+ * @param key The key to search for
+ * @param output The output buffer to store the extracted value
+ * @param output_size The size of the output buffer
+ * @return true if successful, false if failed
+ */
+bool validate_and_extract_value(const char *json_str, const char *key, char *output, size_t output_size) {
+    // Search for the given key in the JSON string
+    char *key_start = strstr(json_str, key);
+    if (!key_start) return false;  // Failed if the key is not found
+    
+    // Find the ':' character after the key
+    key_start = strchr(key_start, ':');
+    if (!key_start) return false;  // Failed if the ':' character is not found
+    
+    // Find the starting double quote of the value
+    key_start = strchr(key_start, '"');
+    if (!key_start) return false;  // Failed if the starting quote is not found
+    
+    // Move to the character after the starting quote
+    key_start++;
+    
+    // Find the ending double quote of the value
+    char *key_end = strchr(key_start, '"');
+    if (!key_end) return false;  // Failed if the ending quote is not found
+    
+    // Calculate the length of the value and compare with the output buffer size
+    size_t key_len = key_end - key_start;
+    if (key_len >= output_size) return false;  // Failed if the value doesn't fit in the output buffer
+    
+    // Copy the value to the output buffer
+    strncpy(output, key_start, key_len);
+    output[key_len] = '\0';  // Add string terminator
+    
+    // Clean control characters (ASCII values less than 32)
+    for (size_t i = 0; i < key_len; i++) {
+        if (output[i] < 32) {  // ASCII 32: space character
+            output[i] = '_';   // Replace control characters with an underscore
+        }
+    }
+    
+    return true;  // Successful operation
+}
+
+/**
+ * @brief Measures validate_and_extract_value() on a typical provisioning message
+ */
+void json_value_bench(void) {
+    static const char message[] = "{\"hostname\":\"esp32-c6\",\"log_level\":\"info\",\"scan_dwell\":\"40\","
+                                  "\"heartbeat_s\":\"60\",\"wifi_name\":\"MySSID\"}";
+    char value[WIFI_NAME_SIZE];
+    int found = 0;
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < JSON_VALUE_BENCH_RUNS; i++) {
+        found += validate_and_extract_value(message, "\"wifi_name\"", value, sizeof(value));
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    if (found != JSON_VALUE_BENCH_RUNS) return;
+    bench_set("parser.ps_per_byte", elapsed_us * 1000000 / ((int64_t)JSON_VALUE_BENCH_RUNS * (sizeof(message) - 1)));
+}
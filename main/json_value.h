@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_VALUE_BENCH_RUNS 1000        // Parses per parser benchmark
+
+/**
+ * @brief Extracts a value from a JSON formatted string and cleans control characters
+ * @details Finds the key, then the quoted string after the next ':'. Control
+ * characters of the value are replaced with '_'. Pure, without driver calls,
+ * so it also runs in the host bench (tools/bench_host.c).
+ * @param json_str The input JSON string
+ * @param key The key to search for, with its quotes
+ * @param output The output buffer to store the extracted value
+ * @param output_size The size of the output buffer
+ * @return true if successful, false if failed
+ */
+bool validate_and_extract_value(const char *json_str, const char *key, char *output, size_t output_size);
+
+/**
+ * @brief Measures validate_and_extract_value() on a typical provisioning message
+ * @details The key is near the end, so most of the message is searched.
+ * Parses it JSON_VALUE_BENCH_RUNS times and stores parser.ps_per_byte (ns per
+ * byte times 1000), see bench.h.
+ */
+void json_value_bench(void);
@@ -1,8 +1,15 @@
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
@@ -11,162 +18,439 @@
 #include "lwip/err.h"
 #include "lwip/sys.h"
 #include "lwip/sockets.h"
+#include "dhcpserver/dhcpserver.h"
+#include "device_config.h"
+#include "config_apply.h"
+#include "config_ops.h"
+#include "flap_damping.h"
+#include "conn_policy.h"
+#include "conn_step.h"
+#include "boot_guard.h"
+#include "profiler.h"
+#include "alloc_trace.h"
+#include "capture.h"
+#include "bench.h"
+#include "json_value.h"
+#include "wifi_store.h"
+#include "fault_inject.h"
+#include "conn_events.h"
+#include "conn_timer.h"
+#include "wifi_netif.h"
+#include "uplink_queue.h"
+#include "net_status.h"
+#include "ap_admission.h"
+#include "ap_lifecycle.h"
+#include "csa_plan.h"
+#include "scan_sched.h"
+#include "scan_cache.h"
+#include "site_auth.h"
+#include "relay.h"
+#include "config_push.h"
+#include "heartbeat.h"
+#include "provisioning.h"
 
 // WiFi and network configuration constants
 #define WIFI_AP_SSID     "ESP32_C6_AP"    // SSID name for Access Point mode
 #define WIFI_AP_PASS     "12345678"       // Password for Access Point mode
-#define MAX_CLIENTS      1                // Maximum number of clients that can connect
 #define PORT            3333              // Port number for the TCP server
-#define WIFI_TIMEOUT_MS 30000             // WiFi connection timeout (30 seconds)
 #define RX_BUFFER_SIZE  512               // TCP receiver buffer size
+#define AP_CHECK_MS     5000              // Period of the idle station and AP lifecycle check
+#define SESSION_YIELD_MS 15000            // Silence after which a session gives way to a waiting client
+#define AP_DHCP_LEASE_MIN 10              // Soft-AP lease time in minutes, sized for provisioning sessions
+#define AP_DHCP_POOL_SIZE (2 * AP_MAX_STATIONS) // Addresses handed out from 192.168.1.2
+#define SCAN_MAX_RECORDS 20               // BSSIDs read from one scan run
+#define NETWORK_LIST_SIZE 1280            // Buffer for the list_networks response
+#define RELAY_PEER_ADDR  "192.168.1.1"    // Soft-AP address of every unit (configure_ap_dhcp())
+#define RELAY_START_DELAY_MS AP_FINISHED_LINGER_MS // Lets the phone read its result first
+#define RELAY_CONNECT_TIMEOUT_MS 10000    // Association and DHCP on a neighbour AP
+#define RELAY_REPLY_TIMEOUT_S 5           // Wait for the neighbour to check the message
+#define RELAY_ROUND_GAP_MS 10000          // Time at home between relay rounds
 
-// NVS (Non-Volatile Storage) configuration constants
-#define NVS_NAMESPACE   "wifi_table"      // NVS namespace
-#define WIFI_SSID_KEY   "wifi_ssid"       // Key to store the SSID
-#define WIFI_PASS_KEY   "wifi_pass"       // Key to store the password
-#define TABLE_FLAG_KEY  "table_flag"      // Key for the table flag
-#define WIFI_NAME_SIZE  32                // Maximum size for SSID
-#define WIFI_PASS_SIZE  64                // Maximum size for password
-#define MAX_RETRY 5                       // Maximum number of connection attempts
+#define OUTAGE_GRACE_MS 5000              // Keep the STA IP across outages shorter than this
+#define HEARTBEAT_HOST   "192.168.0.10"   // UDP collector receiving the heartbeats
+#define HEARTBEAT_PORT   5001             // Port of the heartbeat collector
+#define SAFE_RETRY_BUSY_MS 60000          // Retry delay while a station is on the provisioning AP
+#define ADMIN_CHALLENGE_SIZE 16           // Random challenge of the restart and reconnect commands
+
+// bench, events_dump and capture_dump, off unless built with
+// `idf.py -DDEBUG_COMMANDS=1 build`, see main/CMakeLists.txt
+#ifndef DEBUG_COMMANDS
+#define DEBUG_COMMANDS 0
+#endif
 
 // Global variables and definitions
 static const char *TAG = "wifi_manager";                   // Logging tag
 static EventGroupHandle_t wifi_event_group;                // Event group for WiFi events
 static const int WIFI_CONNECTED_BIT = BIT0;               // WiFi connection status bit
-static nvs_handle_t my_nvs_handle;                        // NVS operation handle
-static int retry_count = 0;                               // Connection attempt counter
+static const int RELAY_LINK_BIT = BIT1;                   // Got an address from a neighbour AP
+static conn_policy_t conn_policy;                         // Reconnection decisions of the STA
+static flap_damping_t link_damping;                       // Flap damping of the STA link
+static portMUX_TYPE damping_lock = portMUX_INITIALIZER_UNLOCKED; // Protects link_damping
+static conn_timer_t reuse_timer;                          // Publishes the link once damping ends
+static bool link_up = false;                              // STA has an IP address
+static conn_timer_t ap_check_timer;                       // Periodic idle station and lifecycle check
+static ap_lifecycle_t ap_lifecycle;                       // Provisioning AP power state
+static volatile bool ap_wake_requested = false;           // Set by provisioning_ap_wake()
+static TaskHandle_t ap_start_task_handle;                 // Running AP start task, if any
+static TaskHandle_t link_save_task_handle;                // Saves the credentials of a published link
+static wifi_sta_config_t link_save_config;                // Credentials to save, taken when the link was published
+static portMUX_TYPE link_save_lock = portMUX_INITIALIZER_UNLOCKED; // Protects link_save_config
+static const ap_lifecycle_policy_t ap_policy = AP_LIFECYCLE_DEFAULT_POLICY();
+static bool sta_connect_wanted = false;                   // STA should connect when it starts
+static SemaphoreHandle_t scan_lock;                       // One scan run at a time
+static volatile bool relaying = false;                    // STA is away on a neighbour AP
+static TaskHandle_t relay_task_handle;                    // Running relay task, if any
+static char relay_ssid[WIFI_NAME_SIZE];                    // Credentials pushed by the relay task
+static char relay_password[WIFI_PASS_SIZE];
+static RTC_NOINIT_ATTR boot_guard_t boot_guard;           // Early crash history, survives resets
+static conn_timer_t boot_stable_timer;                    // Marks the boot as good after stable_ms
+static conn_timer_t safe_retry_timer;                     // Retries the stored network from safe mode
 
 /**
- * @brief Initializes and opens NVS
- * @return true if successful, false if failed
+ * @brief Returns the current time in milliseconds for the flap damping
  */
-bool nvs_init(void) {
-    // Initialize NVS flash
-    esp_err_t err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        // If NVS section is full or version mismatch, erase and initialize again
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        err = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(err);
+static int64_t now_ms(void) {
+    return esp_timer_get_time() / 1000;
+}
 
-    // Open NVS in read-write mode
-    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS!");
-        return false;
-    }
+/**
+ * @brief Saves the credentials of each published link to NVS
+ * @details An NVS write can wait for a flash erase. Here it holds up neither
+ * the event handler nor the timer task that publish the link. Links published
+ * during a write are saved once more afterwards, with the latest credentials.
+ */
+static void link_save_task(void *pvParameters) {
+    wifi_sta_config_t sta;
 
-    return true;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&link_save_lock);
+        sta = link_save_config;
+        portEXIT_CRITICAL(&link_save_lock);
+
+        if (nvs_write_wifi_data((char*)sta.ssid, (char*)sta.password)) {
+            ESP_LOGI(TAG, "WiFi information successfully saved to NVS");
+        } else {
+            ESP_LOGE(TAG, "Failed to save WiFi information to NVS!");
+        }
+    }
 }
 
 /**
- * @brief Saves WiFi information to NVS
- * @param ssid WiFi network name
- * @param password WiFi password
- * @return true if successful, false if failed
+ * @brief Announces an established link: sets the connected bit, link_save_task() saves the credentials
  */
-bool nvs_write_wifi_data(const char* ssid, const char* password) {
-    esp_err_t err;
+static void publish_link_up(void) {
+    // Take the credentials now, the relay may repoint the STA before the save runs
+    wifi_config_t wifi_config;
+    esp_wifi_get_config(WIFI_IF_STA, &wifi_config);
+    portENTER_CRITICAL(&link_save_lock);
+    link_save_config = wifi_config.sta;
+    portEXIT_CRITICAL(&link_save_lock);
+    xTaskNotifyGive(link_save_task_handle);
 
-    // Save SSID
-    err = nvs_set_str(my_nvs_handle, WIFI_SSID_KEY, ssid);
-    if (err != ESP_OK) return false;
+    xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
 
-    // Save password
-    err = nvs_set_str(my_nvs_handle, WIFI_PASS_KEY, password);
-    if (err != ESP_OK) return false;
+    // Application side: snapshot, waiters and subscribers
+    esp_netif_ip_info_t ip_info;
+    esp_netif_get_ip_info(wifi_netif_sta(), &ip_info);
+    net_status_set_ready(&ip_info);
+}
 
-    // Commit changes to NVS
-    err = nvs_commit(my_nvs_handle);
-    if (err != ESP_OK) return false;
+/**
+ * @brief Publishes the link if it is still up once the flap penalty has decayed
+ */
+static void reuse_timer_callback(void *arg) {
+    portENTER_CRITICAL(&damping_lock);
+    uint32_t delay_ms = flap_damping_reuse_delay_ms(&link_damping, now_ms());
+    portEXIT_CRITICAL(&damping_lock);
 
-    ESP_LOGI(TAG, "WiFi information successfully saved");
-    return true;
+    if (delay_ms > 0) {
+        // Flapped again in the meantime, wait for the new penalty to decay
+        conn_timer_start_once(&reuse_timer, delay_ms);
+        return;
+    }
+    if (link_up) {
+        ESP_LOGI(TAG, "Link stable again, publishing connection");
+        publish_link_up();
+    }
 }
 
 /**
- * @brief Reads WiFi information from NVS
- * @param ssid_out SSID output buffer
- * @param pass_out Password output buffer
- * @return true if successful, false if failed
+ * @brief Deauthenticates a soft-AP station to free its slot
  */
-bool nvs_read_wifi_data(char* ssid_out, char* pass_out) {
-    size_t ssid_size = WIFI_NAME_SIZE;
-    size_t pass_size = WIFI_PASS_SIZE;
+static void deauth_station(const uint8_t mac[6]) {
+    uint16_t aid;
+    if (esp_wifi_ap_get_sta_aid(mac, &aid) == ESP_OK) {
+        ESP_LOGI(TAG, "Deauthenticating station " MACSTR, MAC2STR(mac));
+        esp_wifi_deauth_sta(aid);
+    }
+}
 
-    // Read SSID
-    esp_err_t err = nvs_get_str(my_nvs_handle, WIFI_SSID_KEY, ssid_out, &ssid_size);
-    if (err != ESP_OK) return false;
+/**
+ * @brief Counts frames from a soft-AP station as activity, runs in the WiFi task
+ */
+static void ap_station_traffic(const uint8_t mac[6]) {
+    ap_admission_note_station(mac, now_ms());
+}
 
-    // Read password
-    err = nvs_get_str(my_nvs_handle, WIFI_PASS_KEY, pass_out, &pass_size);
-    if (err != ESP_OK) return false;
+/**
+ * @brief Records a WiFi or IP event in the session capture
+ * @details Only the fields the decisions depend on are kept.
+ */
+static void capture_event(esp_event_base_t event_base, int32_t event_id, void *event_data) {
+    uint8_t base = event_base == WIFI_EVENT ? CAPTURE_BASE_WIFI : CAPTURE_BASE_IP;
+    uint16_t code = CAPTURE_EVENT_CODE(base, event_id);
 
-    return true;
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        wifi_event_sta_disconnected_t *event = event_data;
+        capture_disconnect_t payload = { .reason = event->reason, .rssi = event->rssi };
+        capture_record(CAPTURE_EVENT, code, &payload, sizeof(payload));
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t *event = event_data;
+        capture_record(CAPTURE_EVENT, code, &event->channel, sizeof(event->channel));
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
+        wifi_event_ap_staconnected_t *event = event_data;
+        capture_record(CAPTURE_EVENT, code, event->mac, sizeof(event->mac));
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+        wifi_event_ap_stadisconnected_t *event = event_data;
+        capture_record(CAPTURE_EVENT, code, event->mac, sizeof(event->mac));
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = event_data;
+        capture_record(CAPTURE_EVENT, code, &event->ip_info.ip.addr, sizeof(event->ip_info.ip.addr));
+    } else {
+        capture_record(CAPTURE_EVENT, code, NULL, 0);
+    }
 }
 
 /**
  * @brief WiFi event handler callback function
+ * @details Runs in the default event loop task, timed by conn_events.c.
  */
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data) {
+    capture_event(event_base, event_id, event_data);
+
     // When WiFi Station starts
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        ESP_LOGI(TAG, "Trying to connect to WiFi...");
-        esp_wifi_connect();
+        // A STA started only to scan stays idle
+        if (sta_connect_wanted) {
+            ESP_LOGI(TAG, "Trying to connect to WiFi...");
+            esp_wifi_connect();
+        }
     } 
+    // When the STA associates: a running soft-AP follows it to its channel
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
+        wifi_config_t ap_config;
+        wifi_mode_t mode;
+        if (esp_wifi_get_mode(&mode) != ESP_OK || mode != WIFI_MODE_APSTA ||
+            esp_wifi_get_config(WIFI_IF_AP, &ap_config) != ESP_OK) {
+            return;
+        }
+
+        // Advisory: the driver starts the switch at the association, with the
+        // ap.csa_count that wifi_init_softap() and set_ap_beacon() planned
+        csa_plan_params_t params = CSA_PLAN_DEFAULT_PARAMS(ap_config.ap.beacon_interval,
+                                                           ap_config.ap.dtim_period);
+        csa_plan_t plan;
+        csa_plan(ap_config.ap.channel, event->channel, ap_admission_station_count(), &params, &plan);
+        if (plan.announce) {
+            ESP_LOGI(TAG, "Soft-AP moving from channel %d to %d, announced for %d beacons (%" PRIu32 " ms)",
+                     ap_config.ap.channel, event->channel, plan.count, plan.delay_ms);
+            if (plan.count != ap_config.ap.csa_count) {
+                ESP_LOGW(TAG, "CSA count %d configured, %d planned", ap_config.ap.csa_count, plan.count);
+            }
+        } else if (plan.switch_needed) {
+            ESP_LOGI(TAG, "Soft-AP moving from channel %d to %d", ap_config.ap.channel, event->channel);
+        }
+    }
     // When WiFi connection is lost
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (retry_count < MAX_RETRY) {
+        // Leaving a neighbour AP is part of the relay, not an outage
+        if (relaying) return;
+
+        // Losing an established link counts as a flap
+        bool suppressed = false;
+        if (link_up) {
+            link_up = false;
+            // Whoever waits for the bit now waits for the link to come back
+            xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+            net_status_set_down(NET_STATE_CONNECTING);
+            portENTER_CRITICAL(&damping_lock);
+            suppressed = flap_damping_record_flap(&link_damping, now_ms());
+            portEXIT_CRITICAL(&damping_lock);
+            if (suppressed) {
+                ESP_LOGW(TAG, "Link is flapping (%" PRIu32 " flaps), suppressing notifications",
+                         link_damping.flap_count);
+            }
+        }
+
+        conn_action_t action = conn_policy_on_disconnect(&conn_policy);
+        capture_reconnect_t decision = { .action = action, .suppressed = suppressed };
+        capture_record(CAPTURE_DECISION, CAPTURE_DECISION_RECONNECT, &decision, sizeof(decision));
+        if (action == CONN_RETRY) {
             ESP_LOGI(TAG, "WiFi connection lost. Trying to reconnect...");
             esp_wifi_connect();
-            retry_count++;
         } else {
             ESP_LOGE(TAG, "WiFi connection attempts exhausted!");
             xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+            net_status_set_down(NET_STATE_DOWN);
         }
     } 
+    // When a station joins the soft-AP
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
+        wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
+        uint8_t evict_mac[6];
+
+        switch (ap_admission_on_connect(event->mac, now_ms(), evict_mac)) {
+        case AP_ADMIT:
+            ESP_LOGI(TAG, "Station " MACSTR " joined", MAC2STR(event->mac));
+            break;
+        case AP_ADMIT_AFTER_EVICT:
+            ESP_LOGI(TAG, "Station " MACSTR " joined, freeing a slot", MAC2STR(event->mac));
+            deauth_station(evict_mac);
+            break;
+        case AP_REJECT:
+            ESP_LOGW(TAG, "All slots busy, rejecting station " MACSTR, MAC2STR(event->mac));
+            esp_wifi_deauth_sta(event->aid);
+            break;
+        }
+    }
+    // When a station leaves the soft-AP
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+        wifi_event_ap_stadisconnected_t* event = (wifi_event_ap_stadisconnected_t*) event_data;
+        ap_admission_on_disconnect(event->mac);
+    }
+    // When a soft-AP station gets its DHCP lease
+    else if (event_base == IP_EVENT && event_id == IP_EVENT_AP_STAIPASSIGNED) {
+        ip_event_ap_staipassigned_t* event = (ip_event_ap_staipassigned_t*) event_data;
+        ESP_LOGI(TAG, "Station " MACSTR " leased " IPSTR, MAC2STR(event->mac), IP2STR(&event->ip));
+        ap_admission_on_lease(event->mac, event->ip.addr, now_ms());
+    }
     // When IP address is obtained
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+        if (relaying) {
+            xEventGroupSetBits(wifi_event_group, RELAY_LINK_BIT);
+            return;
+        }
         ESP_LOGI(TAG, "Successfully connected to WiFi! IP address: " IPSTR,
                  IP2STR(&event->ip_info.ip));
-        
-        // Get the current WiFi configuration and save to NVS
-        wifi_config_t wifi_config;
-        esp_wifi_get_config(WIFI_IF_STA, &wifi_config);
-        
-        if (nvs_write_wifi_data((char*)wifi_config.sta.ssid, (char*)wifi_config.sta.password)) {
-            ESP_LOGI(TAG, "WiFi information successfully saved to NVS");
+        link_up = true;
+        conn_policy_reset(&conn_policy);
+
+        // While the link is flapping, hold back persistence and notifications
+        portENTER_CRITICAL(&damping_lock);
+        uint32_t delay_ms = flap_damping_reuse_delay_ms(&link_damping, now_ms());
+        portEXIT_CRITICAL(&damping_lock);
+        capture_record(CAPTURE_DECISION, CAPTURE_DECISION_PUBLISH, &delay_ms, sizeof(delay_ms));
+        if (delay_ms > 0) {
+            ESP_LOGW(TAG, "Link suppressed, publishing in %" PRIu32 " ms if it stays up", delay_ms);
+            conn_timer_start_once(&reuse_timer, delay_ms);
         } else {
-            ESP_LOGE(TAG, "Failed to save WiFi information to NVS!");
+            publish_link_up();
         }
-        
-        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
-        retry_count = 0;
     }
 }
 
+/**
+ * @brief Waits out the backoff after a failed setup step
+ * @details A transient driver or stack error is retried in place, which costs
+ * milliseconds; aborting would cost a reboot and the full boot sequence.
+ * @param step Step that failed
+ * @return true to try the step again, false once the policy gives up
+ */
+static bool step_backoff(conn_step_t step) {
+    return conn_step_backoff(&conn_policy, step);
+}
+
+/**
+ * @brief Restarts the chip when the unit can not be reached any other way
+ * @details Last resort after step_backoff() gave up on a step the unit can
+ * not run without.
+ */
+static void restart_last_resort(const char *reason) {
+    ESP_LOGE(TAG, "%s, restarting", reason);
+    boot_guard_on_failure(&boot_guard);  // Counts as an early crash if the boot was not stable yet
+    vTaskDelay(pdMS_TO_TICKS(100));  // Lets the log drain
+    esp_restart();
+}
+
+/**
+ * @brief Configures and starts the STA
+ * @param wifi_config STA configuration
+ * @param keep_ap A running provisioning AP stays up in APSTA mode
+ * @return ESP_OK if successful, the failing driver error otherwise
+ */
+static esp_err_t start_sta(wifi_config_t *wifi_config, bool keep_ap) {
+    esp_err_t err;
+
+    if (keep_ap) {
+        err = fault_wifi_set_mode(WIFI_MODE_APSTA);
+        if (err != ESP_OK) return err;
+        err = esp_wifi_set_config(WIFI_IF_STA, wifi_config);
+        if (err != ESP_OK) return err;
+        // May already be connecting from WIFI_EVENT_STA_START
+        esp_wifi_connect();
+        return ESP_OK;
+    }
+
+    err = esp_wifi_stop();
+    if (err != ESP_OK) return err;
+    err = fault_wifi_set_mode(WIFI_MODE_STA);
+    if (err != ESP_OK) return err;
+    err = esp_wifi_set_config(WIFI_IF_STA, wifi_config);
+    if (err != ESP_OK) return err;
+    return fault_wifi_start();
+}
+
 /**
  * @brief Connects to the specified WiFi network
+ * @details Driver errors while setting up the STA are retried with backoff
+ * (step_backoff()) before they are returned.
  * @param ssid WiFi network name
  * @param password WiFi password
- * @return ESP_OK if successful, ESP_FAIL if failed
+ * @return ESP_OK if successful, ESP_ERR_TIMEOUT if no IP was obtained in time,
+ * or the driver error that stayed after the retries
  */
 static esp_err_t connect_wifi(const char* ssid, const char* password) {
     wifi_config_t wifi_config = {0};
+    int64_t start_ms = now_ms();
 
     // Securely copy SSID and password
     strncpy((char*)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid));
     strncpy((char*)wifi_config.sta.password, password, sizeof(wifi_config.sta.password));
     wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+
+    // A new connection starts without flap history
+    portENTER_CRITICAL(&damping_lock);
+    flap_damping_reset(&link_damping);
+    portEXIT_CRITICAL(&damping_lock);
+    conn_timer_stop(&reuse_timer);
+    link_up = false;
+    // The bit of the previous link would end the wait below at once
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+    net_status_set_down(NET_STATE_CONNECTING);
+    conn_policy_reset(&conn_policy);
+    capture_record(CAPTURE_MARK, CAPTURE_MARK_CONNECT, NULL, 0);
+    sta_connect_wanted = true;
+
+    // A running provisioning AP stays up in APSTA mode: its clients get the
+    // result and follow the channel switch announced once the STA associates
+    wifi_mode_t mode = WIFI_MODE_NULL;
+    esp_wifi_get_mode(&mode);
+    bool keep_ap = mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA;
     
     // Configure and start WiFi
-    ESP_ERROR_CHECK(esp_wifi_stop());
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    esp_err_t err;
+    while ((err = start_sta(&wifi_config, keep_ap)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the STA: %s", esp_err_to_name(err));
+        if (!step_backoff(CONN_STEP_STA)) {
+            sta_connect_wanted = false;
+            return err;
+        }
+    }
+    conn_policy_on_step_ok(&conn_policy, CONN_STEP_STA);
 
     ESP_LOGI(TAG, "Trying to connect to the %s network...", ssid);
     
@@ -175,102 +459,900 @@ static esp_err_t connect_wifi(const char* ssid, const char* password) {
             WIFI_CONNECTED_BIT,
             pdFALSE,
             pdFALSE,
-            pdMS_TO_TICKS(WIFI_TIMEOUT_MS));
+            pdMS_TO_TICKS(config_apply_active()->wifi_timeout_ms));
 
     if (bits & WIFI_CONNECTED_BIT) {
         ESP_LOGI(TAG, "Connection successful!");
+        bench_set("connect.ms", now_ms() - start_ms);
+        // STA mode: there is no provisioning AP left to manage
+        if (!keep_ap) conn_timer_stop(&ap_check_timer);
         return ESP_OK;
     }
 
     ESP_LOGE(TAG, "Connection failed! Timeout");
-    ESP_ERROR_CHECK(esp_wifi_stop());
-    return ESP_FAIL;
+    sta_connect_wanted = false;
+    if (keep_ap) {
+        // Back to AP only, the provisioning clients stay associated
+        esp_wifi_disconnect();
+        err = fault_wifi_set_mode(WIFI_MODE_AP);
+    } else {
+        err = esp_wifi_stop();
+    }
+    // The next connect_wifi() or wifi_init_softap() sets the mode again
+    if (err != ESP_OK) ESP_LOGW(TAG, "Failed to stop the STA: %s", esp_err_to_name(err));
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Configures the soft-AP address and its DHCP server
+ * @details A server that is already running with this address is left alone:
+ * its per-MAC lease list survives AP restarts (see wifi_netif_set_ap_keep_leases())
+ * so returning phones get their INIT-REBOOT request acknowledged at once
+ * instead of a NAK and a full DISCOVER.
+ * @param ap_netif AP interface
+ * @return ESP_OK if successful, the failing esp_netif error otherwise
+ */
+static esp_err_t configure_ap_dhcp(esp_netif_t *ap_netif) {
+    esp_netif_ip_info_t ip_info;
+    IP4_ADDR(&ip_info.ip, 192, 168, 1, 1);
+    IP4_ADDR(&ip_info.gw, 192, 168, 1, 1);
+    IP4_ADDR(&ip_info.netmask, 255, 255, 255, 0);
+
+    esp_netif_dhcp_status_t status;
+    esp_netif_ip_info_t current;
+    if (esp_netif_dhcps_get_status(ap_netif, &status) == ESP_OK && status == ESP_NETIF_DHCP_STARTED &&
+        esp_netif_get_ip_info(ap_netif, &current) == ESP_OK && current.ip.addr == ip_info.ip.addr) {
+        ESP_LOGI(TAG, "DHCP server already running, keeping its leases");
+        return ESP_OK;
+    }
+
+    // Short leases from a small pool: sessions last minutes and slots recycle quickly
+    uint32_t lease_time = AP_DHCP_LEASE_MIN;
+    dhcps_lease_t pool = { .enable = true };
+    IP4_ADDR(&pool.start_ip, 192, 168, 1, 2);
+    IP4_ADDR(&pool.end_ip, 192, 168, 1, 1 + AP_DHCP_POOL_SIZE);
+
+    esp_err_t err = esp_netif_dhcps_stop(ap_netif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) return err;
+    err = esp_netif_set_ip_info(ap_netif, &ip_info);
+    if (err != ESP_OK) return err;
+    err = esp_netif_dhcps_option(ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_IP_ADDRESS_LEASE_TIME,
+                                 &lease_time, sizeof(lease_time));
+    if (err != ESP_OK) return err;
+    err = esp_netif_dhcps_option(ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_REQUESTED_IP_ADDRESS,
+                                 &pool, sizeof(pool));
+    if (err != ESP_OK) return err;
+    return esp_netif_dhcps_start(ap_netif);
+}
+
+/**
+ * @brief Configures and starts the soft-AP
+ * @param wifi_config AP configuration
+ * @return ESP_OK if successful, the failing driver error otherwise
+ */
+static esp_err_t start_softap(wifi_config_t *wifi_config) {
+    // Interface, IP configuration and DHCP server for AP
+    esp_err_t err = wifi_netif_ap_create();
+    if (err != ESP_OK) return err;
+    err = configure_ap_dhcp(wifi_netif_ap());
+    if (err != ESP_OK) return err;
+    err = fault_wifi_set_mode(WIFI_MODE_AP);
+    if (err != ESP_OK) return err;
+    err = esp_wifi_set_config(WIFI_IF_AP, wifi_config);
+    if (err != ESP_OK) return err;
+    return fault_wifi_start();
 }
 
 /**
  * @brief Starts Access Point mode
+ * @details Driver errors are retried with backoff (step_backoff()) before
+ * they are returned.
+ * @return ESP_OK if successful, the driver error that stayed after the retries otherwise
  */
-static void wifi_init_softap(void) {
+static esp_err_t wifi_init_softap(void) {
+    csa_plan_params_t csa = CSA_PLAN_DEFAULT_PARAMS(ap_policy.active_beacon_tu, ap_policy.active_dtim);
+
     // AP mode configuration
     wifi_config_t wifi_config = {
         .ap = {
             .ssid = WIFI_AP_SSID,
             .ssid_len = strlen(WIFI_AP_SSID),
-            .channel = 1,
+            .channel = config_apply_active()->ap_channel,
             .password = WIFI_AP_PASS,
-            .max_connection = MAX_CLIENTS,
+            // One slot more than served, so admission can decide about newcomers
+            .max_connection = AP_MAX_STATIONS + 1,
             .authmode = WIFI_AUTH_WPA_WPA2_PSK,
+            .beacon_interval = ap_policy.active_beacon_tu,
+            .dtim_period = ap_policy.active_dtim,
+            // Beacons announcing a move to the STA channel before switching
+            .csa_count = csa_plan_count(&csa),
         },
     };
 
-    // IP configuration for AP
-    esp_netif_t *ap_netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
-    esp_netif_ip_info_t ip_info;
-    IP4_ADDR(&ip_info.ip, 192, 168, 1, 1);
-    IP4_ADDR(&ip_info.gw, 192, 168, 1, 1);
-    IP4_ADDR(&ip_info.netmask, 255, 255, 255, 0);
-
-    // Configure DHCP server
-    ESP_ERROR_CHECK(esp_netif_dhcps_stop(ap_netif));
-    ESP_ERROR_CHECK(esp_netif_set_ip_info(ap_netif, &ip_info));
-    ESP_ERROR_CHECK(esp_netif_dhcps_start(ap_netif));
+    // Start AP mode with an empty station table and a new provisioning window
+    ap_admission_init();
+    ap_lifecycle_init(&ap_lifecycle, &ap_policy, now_ms());
+    ap_wake_requested = false;
+    if (!conn_timer_is_active(&ap_check_timer)) {
+        conn_timer_start_periodic(&ap_check_timer, AP_CHECK_MS);
+    }
 
-    // Start AP mode
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    esp_err_t err;
+    while ((err = start_softap(&wifi_config)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the AP: %s", esp_err_to_name(err));
+        if (!step_backoff(CONN_STEP_AP)) return err;
+    }
+    conn_policy_on_step_ok(&conn_policy, CONN_STEP_AP);
 
     ESP_LOGI(TAG, "WiFi AP mode started:");
     ESP_LOGI(TAG, "SSID: %s", WIFI_AP_SSID);
     ESP_LOGI(TAG, "Password: %s", WIFI_AP_PASS);
     ESP_LOGI(TAG, "IP Address: 192.168.1.1");
-    ESP_LOGI(TAG, "Channel: 1");
+    ESP_LOGI(TAG, "Channel: %d", wifi_config.ap.channel);
+    return ESP_OK;
 }
 
 /**
- * @brief Extracts a value from a JSON formatted string and cleans control characters
- * @param json_str The input JSON string
- * @param key The key to search for
- * @param output The output buffer to store the extracted value
- * @param output_size The size of the output buffer
- * @return true if successful, false if failed
+ * @brief Changes the beacon interval and DTIM period of the running soft-AP
+ * @details The CSA count is replanned for the new beacon timing.
  */
-static bool validate_and_extract_value(const char *json_str, const char *key, char *output, size_t output_size) {
-    // Search for the given key in the JSON string
-    char *key_start = strstr(json_str, key);
-    if (!key_start) return false;  // Failed if the key is not found
-    
-    // Find the ':' character after the key
-    key_start = strchr(key_start, ':');
-    if (!key_start) return false;  // Failed if the ':' character is not found
-    
-    // Find the starting double quote of the value
-    key_start = strchr(key_start, '"');
-    if (!key_start) return false;  // Failed if the starting quote is not found
-    
-    // Move to the character after the starting quote
-    key_start++;
-    
-    // Find the ending double quote of the value
-    char *key_end = strchr(key_start, '"');
-    if (!key_end) return false;  // Failed if the ending quote is not found
-    
-    // Calculate the length of the value and compare with the output buffer size
-    size_t key_len = key_end - key_start;
-    if (key_len >= output_size) return false;  // Failed if the value doesn't fit in the output buffer
-    
-    // Copy the value to the output buffer
-    strncpy(output, key_start, key_len);
-    output[key_len] = '\0';  // Add string terminator
-    
-    // Clean control characters (ASCII values less than 32)
-    for (size_t i = 0; i < key_len; i++) {
-        if (output[i] < 32) {  // ASCII 32: space character
-            output[i] = '_';   // Replace control characters with an underscore
+static void set_ap_beacon(uint16_t beacon_tu, uint8_t dtim) {
+    wifi_config_t ap_config;
+    csa_plan_params_t csa = CSA_PLAN_DEFAULT_PARAMS(beacon_tu, dtim);
+    if (esp_wifi_get_config(WIFI_IF_AP, &ap_config) != ESP_OK) return;
+    ap_config.ap.beacon_interval = beacon_tu;
+    ap_config.ap.dtim_period = dtim;
+    ap_config.ap.csa_count = csa_plan_count(&csa);
+    esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+}
+
+/**
+ * @brief Stops the soft-AP for good once the STA is connected
+ * @details The AP is only needed again if the STA connection is lost, so
+ * the lifecycle check stops too.
+ */
+static void close_provisioning_ap(void) {
+    wifi_mode_t mode;
+    if (esp_wifi_get_mode(&mode) == ESP_OK && mode == WIFI_MODE_APSTA) {
+        ESP_LOGI(TAG, "STA connected, closing the provisioning AP");
+        conn_timer_stop(&ap_check_timer);
+        wifi_netif_ap_release();
+        esp_wifi_set_mode(WIFI_MODE_STA);
+    }
+}
+
+/**
+ * @brief Starts the soft-AP when the provisioning window reopens
+ * @details wifi_init_softap() retries with backoff, which must not hold up the
+ * timer task the AP check runs in. The check leaves the lifecycle alone until
+ * this task ends.
+ */
+static void ap_start_task(void *pvParameters) {
+    // Not fatal, the unit keeps its STA link
+    wifi_init_softap();
+    ap_start_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Moves the soft-AP to a new lifecycle state
+ */
+static void apply_ap_state(ap_state_t previous, ap_state_t state) {
+    wifi_mode_t mode;
+
+    switch (state) {
+    case AP_STATE_ACTIVE:
+        ESP_LOGI(TAG, "Provisioning AP active");
+        if (previous == AP_STATE_OFF) {
+            if (xTaskCreate(ap_start_task, "ap_start", 4096, NULL, 5, &ap_start_task_handle) != pdPASS) {
+                ESP_LOGE(TAG, "Failed to create the AP start task!");
+            }
+        } else {
+            set_ap_beacon(ap_policy.active_beacon_tu, ap_policy.active_dtim);
         }
+        break;
+    case AP_STATE_IDLE:
+        ESP_LOGI(TAG, "Provisioning AP idle, beacon interval %d TU", ap_policy.idle_beacon_tu);
+        set_ap_beacon(ap_policy.idle_beacon_tu, ap_policy.idle_dtim);
+        break;
+    case AP_STATE_OFF:
+        ESP_LOGI(TAG, "Provisioning window closed, stopping AP");
+        if (esp_wifi_get_mode(&mode) != ESP_OK) break;
+        if (mode == WIFI_MODE_AP) {
+            // Not provisioned: a wake reopens the window, the parked interface keeps
+            // the DHCP leases for the returning phones (no STA needs the RAM)
+            esp_wifi_stop();
+        } else if (mode == WIFI_MODE_APSTA) {
+            close_provisioning_ap();
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Periodically evicts idle soft-AP stations and runs the AP lifecycle
+ */
+static void ap_check_timer_callback(void *arg) {
+    uint8_t mac[6];
+    while (ap_admission_next_eviction(now_ms(), mac)) {
+        deauth_station(mac);
+    }
+    // wifi_init_softap() opens a new window once the AP is up
+    if (ap_start_task_handle) return;
+
+    ap_state_t previous = ap_lifecycle.state;
+    if (ap_wake_requested) {
+        ap_wake_requested = false;
+        ap_lifecycle_wake(&ap_lifecycle, now_ms());
+    }
+    ap_state_t state = ap_lifecycle_update(&ap_lifecycle, ap_admission_station_count(), now_ms());
+    if (state != previous) {
+        apply_ap_state(previous, state);
+    }
+}
+
+/**
+ * @brief Reopens the provisioning window
+ */
+void provisioning_ap_wake(void) {
+    ap_wake_requested = true;
+}
+
+/**
+ * @brief Scans one channel range and appends the results
+ * @param first First channel, 0 scans all channels
+ * @param last Last channel
+ * @param dwell_ms Active scan time per channel, 0 for the driver default
+ * @param home_ms Time back on the AP channel between channels of an
+ * all-channel scan, 0 for the driver default
+ * @param records Result buffer
+ * @param capacity Size of the result buffer
+ * @param count Records already in the buffer, updated
+ */
+static esp_err_t scan_range(uint8_t first, uint8_t last, uint16_t dwell_ms, uint16_t home_ms,
+                            wifi_ap_record_t *records, uint16_t capacity, uint16_t *count) {
+    for (uint8_t channel = first; channel <= last; channel++) {
+        wifi_scan_config_t scan_config = {
+            .channel = channel,
+            .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+            .scan_time.active = { .min = dwell_ms, .max = dwell_ms },
+            .home_chan_dwell_time = (uint8_t)home_ms,
+        };
+        esp_err_t err = esp_wifi_scan_start(&scan_config, true);
+        if (err != ESP_OK) return err;
+
+        uint16_t number = capacity - *count;
+        if (number > 0) {
+            esp_wifi_scan_get_ap_records(&number, records + *count);
+            *count += number;
+        } else {
+            esp_wifi_clear_ap_list();
+        }
+        if (first == 0) break;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Scans for networks without disrupting the soft-AP clients
+ * @details Without AP clients this is a single all-channel scan. While clients
+ * are served, each channel is scanned for scan_dwell_ms and the radio returns
+ * to the AP channel for scan_home_ms between channels, so their traffic is
+ * delayed by one channel at most. The driver does this itself with
+ * home_chan_dwell_time when scan_home_ms is in its range; otherwise the scan
+ * is run slice by slice from here. A soft-AP without STA interface is
+ * switched to APSTA for the scan. Blocking, call it from a task.
+ * @param records Result buffer
+ * @param count In: size of the buffer, out: number of records found
+ * @return ESP_OK if successful, the failing esp_wifi error otherwise
+ */
+static esp_err_t scan_networks(wifi_ap_record_t *records, uint16_t *count) {
+    const device_config_t *config = config_apply_active();
+    uint16_t capacity = *count;
+    wifi_mode_t mode;
+    esp_err_t err;
+
+    *count = 0;
+    xSemaphoreTake(scan_lock, portMAX_DELAY);
+    err = esp_wifi_get_mode(&mode);
+    if (err == ESP_OK && mode == WIFI_MODE_AP) {
+        err = esp_wifi_set_mode(WIFI_MODE_APSTA);
+    }
+    if (err != ESP_OK) {
+        xSemaphoreGive(scan_lock);
+        return err;
+    }
+
+    bool serving = mode != WIFI_MODE_STA && ap_admission_station_count() > 0;
+    if (!serving) {
+        err = scan_range(0, 0, 0, 0, records, capacity, count);
+    } else {
+        scan_sched_budget_t budget = SCAN_SCHED_DEFAULT_BUDGET();
+        budget.dwell_ms = config->scan_dwell_ms;
+        budget.home_ms = config->scan_home_ms;
+
+        if (scan_sched_driver_home(&budget)) {
+            err = scan_range(0, 0, budget.dwell_ms, budget.home_ms, records, capacity, count);
+        } else {
+            uint8_t slices = scan_sched_slices(&budget);
+            for (uint8_t i = 0; i < slices && err == ESP_OK; i++) {
+                uint8_t first, last;
+                if (i > 0) vTaskDelay(pdMS_TO_TICKS(budget.home_ms));
+                scan_sched_slice(&budget, i, &first, &last);
+                err = scan_range(first, last, budget.dwell_ms, 0, records, capacity, count);
+            }
+        }
+    }
+
+    // Back to AP only if the STA was started for the scan
+    if (mode == WIFI_MODE_AP) {
+        esp_wifi_set_mode(WIFI_MODE_AP);
+    }
+    xSemaphoreGive(scan_lock);
+
+    ESP_LOGI(TAG, "Scan found %d networks%s", *count, serving ? " (sliced)" : "");
+    return err;
+}
+
+/**
+ * @brief Short name of an authentication mode for the network list
+ */
+static const char *auth_mode_name(uint8_t authmode) {
+    switch (authmode) {
+    case WIFI_AUTH_OPEN:          return "open";
+    case WIFI_AUTH_WEP:           return "wep";
+    case WIFI_AUTH_WPA_PSK:       return "wpa";
+    case WIFI_AUTH_WPA2_PSK:      return "wpa2";
+    case WIFI_AUTH_WPA_WPA2_PSK:  return "wpa/wpa2";
+    case WIFI_AUTH_ENTERPRISE:    return "enterprise";
+    case WIFI_AUTH_WPA3_PSK:      return "wpa3";
+    case WIFI_AUTH_WPA2_WPA3_PSK: return "wpa2/wpa3";
+    default:                      return "other";
+    }
+}
+
+/**
+ * @brief Refreshes the scan cache if a scan is due
+ * @param fresh Client asked for fresh results
+ */
+static void refresh_scan_cache(bool fresh) {
+    int64_t scan_ms = now_ms();
+    if (!scan_cache_claim_scan(fresh, scan_ms)) return;
+
+    // Static, the scan runs after steady state; scan_cache_claim_scan() lets one caller in at a time
+    static wifi_ap_record_t records[SCAN_MAX_RECORDS];
+    uint16_t count = SCAN_MAX_RECORDS;
+    if (scan_networks(records, &count) == ESP_OK) {
+        for (uint16_t i = 0; i < count; i++) {
+            scan_cache_add((const char *)records[i].ssid, records[i].rssi, records[i].primary,
+                           records[i].authmode, scan_ms);
+        }
+    } else {
+        ESP_LOGW(TAG, "Scan failed, serving cached networks");
+    }
+    scan_cache_scan_done();
+}
+
+/**
+ * @brief Sends the visible networks to a client
+ * @details Served from the scan cache, so repeated requests cost no airtime.
+ * Format: {"networks":[{"ssid":"...","rssi":-52,"auth":"wpa2","ch":6},...]}
+ * @param sock Client socket
+ * @param fresh Client asked for fresh results, rate limited
+ */
+static void send_network_list(int sock, bool fresh) {
+    static char response[NETWORK_LIST_SIZE];
+    scan_cache_entry_t networks[SCAN_CACHE_SIZE];
+
+    refresh_scan_cache(fresh);
+    int count = scan_cache_list(now_ms(), networks, SCAN_CACHE_SIZE);
+
+    size_t len = snprintf(response, sizeof(response), "{\"networks\":[");
+    for (int i = 0; i < count; i++) {
+        // Escape the characters that would break the JSON string
+        char ssid[2 * sizeof(networks[i].ssid)];
+        size_t n = 0;
+        for (const char *c = networks[i].ssid; *c; c++) {
+            if (*c == '"' || *c == '\\') ssid[n++] = '\\';
+            ssid[n++] = (unsigned char)*c < 32 ? '_' : *c;
+        }
+        ssid[n] = '\0';
+
+        int written = snprintf(response + len, sizeof(response) - len,
+                               "%s{\"ssid\":\"%s\",\"rssi\":%d,\"auth\":\"%s\",\"ch\":%d}",
+                               i ? "," : "", ssid, networks[i].rssi,
+                               auth_mode_name(networks[i].authmode), networks[i].channel);
+        if (written < 0 || len + written >= sizeof(response) - 3) break;  // Keep room for the end
+        len += written;
+    }
+    len += snprintf(response + len, sizeof(response) - len, "]}\n");
+    fault_send(sock, response, len, 0);
+}
+
+/**
+ * @brief Sends one line of a diagnostic dump to the client socket
+ */
+static void send_dump_line(const char *line, size_t len, void *arg) {
+    send(*(int *)arg, line, len, 0);
+}
+
+/**
+ * @brief Decodes a hex string of exactly len bytes
+ * @return true if successful
+ */
+static bool hex_decode(const char *hex, uint8_t *out, size_t len) {
+    if (strlen(hex) != 2 * len) return false;
+    for (size_t i = 0; i < 2 * len; i++) {
+        char c = hex[i];
+        int nibble = c >= '0' && c <= '9' ? c - '0' :
+                     c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                     c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (nibble < 0) return false;
+        if (i % 2 == 0) {
+            out[i / 2] = nibble << 4;
+        } else {
+            out[i / 2] |= nibble;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Encodes bytes as a NUL terminated lowercase hex string
+ */
+static void hex_encode(const uint8_t *in, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0x0f];
+    }
+    out[2 * len] = '\0';
+}
+
+/**
+ * @brief Pushes the credentials to one neighbour provisioning AP
+ * @details Builds a relay message for the neighbour, joins its AP with the
+ * well-known provisioning password and sends the message over the
+ * provisioning TCP protocol. The credentials are encrypted, the AP password
+ * protects nothing. The caller brings the STA back home afterwards.
+ * @return true if the neighbour accepted the message
+ */
+static bool relay_push(const relay_target_t *target) {
+    relay_msg_t msg;
+    uint8_t sender[6];
+    uint32_t counter;
+    esp_wifi_get_mac(WIFI_IF_STA, sender);
+    if (site_auth_next_counter(&counter) != ESP_OK ||
+        relay_msg_build(&msg, relay_ssid, relay_password, RELAY_FLAG_RELAY, sender, target->bssid,
+                        counter) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not build the relay message");
+        return false;
+    }
+
+    wifi_config_t wifi_config = {0};
+    strncpy((char*)wifi_config.sta.ssid, WIFI_AP_SSID, sizeof(wifi_config.sta.ssid));
+    strncpy((char*)wifi_config.sta.password, WIFI_AP_PASS, sizeof(wifi_config.sta.password));
+    wifi_config.sta.bssid_set = true;
+    memcpy(wifi_config.sta.bssid, target->bssid, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.channel = target->channel;
+
+    // Leave home, the event handler ignores the STA while relaying
+    relaying = true;
+    if (link_up) {
+        link_up = false;
+        net_status_set_down(NET_STATE_CONNECTING);
+    }
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT | RELAY_LINK_BIT);
+    esp_wifi_disconnect();
+    if (esp_wifi_set_config(WIFI_IF_STA, &wifi_config) != ESP_OK || esp_wifi_connect() != ESP_OK) {
+        return false;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group, RELAY_LINK_BIT, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(RELAY_CONNECT_TIMEOUT_MS));
+    if (!(bits & RELAY_LINK_BIT)) {
+        ESP_LOGW(TAG, "Neighbour " MACSTR " unreachable", MAC2STR(target->bssid));
+        esp_wifi_disconnect();
+        return false;
+    }
+
+    bool accepted = false;
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock >= 0) {
+        struct sockaddr_in peer_addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons(PORT),
+        };
+        inet_pton(AF_INET, RELAY_PEER_ADDR, &peer_addr.sin_addr);
+        struct timeval timeout = { .tv_sec = RELAY_REPLY_TIMEOUT_S };
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        if (connect(sock, (struct sockaddr *)&peer_addr, sizeof(peer_addr)) == 0) {
+            char message[RELAY_MSG_HEX_SIZE + 16];
+            char reply[32];
+            strcpy(message, "{\"relay\":\"");
+            hex_encode((const uint8_t *)&msg, sizeof(msg), message + strlen(message));
+            strcat(message, "\"}");
+            fault_send(sock, message, strlen(message), 0);
+
+            int len = fault_recv(sock, reply, sizeof(reply) - 1, 0);
+            if (len > 0) {
+                reply[len] = '\0';
+                accepted = strncmp(reply, "Relay accepted", 14) == 0;
+            }
+        }
+        close(sock);
+    }
+
+    ESP_LOGI(TAG, "Neighbour " MACSTR " %s the credentials", MAC2STR(target->bssid),
+             accepted ? "accepted" : "did not accept");
+    esp_wifi_disconnect();
+    return accepted;
+}
+
+/**
+ * @brief Relays the credentials to neighbour units, round by round
+ * @details Each round scans for provisioning APs, pushes the credentials to
+ * RELAY_FANOUT neighbours picked by relay_plan_select() and goes back home for
+ * RELAY_ROUND_GAP_MS. Neighbours relay further once connected, so a site
+ * converges in a logarithmic number of rounds.
+ */
+static void relay_task(void *pvParameters) {
+    static wifi_ap_record_t records[SCAN_MAX_RECORDS];  // Static, the relay runs after steady state
+    char ssid[WIFI_NAME_SIZE];
+    char password[WIFI_PASS_SIZE];
+    relay_plan_t plan;
+
+    memcpy(ssid, relay_ssid, sizeof(ssid));
+    memcpy(password, relay_password, sizeof(password));
+    relay_plan_init(&plan);
+
+    // Let the phone read its result, then this unit has no use for its AP
+    vTaskDelay(pdMS_TO_TICKS(RELAY_START_DELAY_MS));
+    close_provisioning_ap();
+
+    for (int round = 0; round < RELAY_MAX_ROUNDS; round++) {
+        relay_target_t found[SCAN_MAX_RECORDS];
+        relay_target_t targets[RELAY_FANOUT];
+        int found_count = 0;
+
+        // Neighbours all use the provisioning SSID, they differ by BSSID
+        uint16_t count = SCAN_MAX_RECORDS;
+        if (scan_networks(records, &count) == ESP_OK) {
+            for (uint16_t i = 0; i < count; i++) {
+                if (strcmp((const char *)records[i].ssid, WIFI_AP_SSID) != 0) continue;
+                memcpy(found[found_count].bssid, records[i].bssid, 6);
+                found[found_count].rssi = records[i].rssi;
+                found[found_count].channel = records[i].primary;
+                found_count++;
+            }
+        }
+
+        int target_count = relay_plan_select(&plan, found, found_count, targets, RELAY_FANOUT,
+                                             esp_random());
+        ESP_LOGI(TAG, "Relay round %d: %d neighbours found, %d to provision", round + 1,
+                 found_count, target_count);
+        if (target_count == 0) break;
+
+        for (int i = 0; i < target_count; i++) {
+            relay_push(&targets[i]);
+            relay_plan_mark_done(&plan, targets[i].bssid);
+        }
+
+        // Back home between rounds
+        relaying = false;
+        if (connect_wifi(ssid, password) != ESP_OK && connect_wifi(ssid, password) != ESP_OK) {
+            ESP_LOGE(TAG, "Could not get back to the network, relay stopped");
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(RELAY_ROUND_GAP_MS));
+    }
+
+    relaying = false;
+    ESP_LOGI(TAG, "Relay finished");
+    relay_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Starts relaying freshly verified credentials to the neighbours
+ * @param ssid STA network name
+ * @param password STA network password
+ */
+static void start_relay(const char *ssid, const char *password) {
+    if (relay_task_handle) return;
+    if (!site_auth_has_key()) {
+        ESP_LOGW(TAG, "Relay mode needs a site key, not relaying");
+        return;
+    }
+    strncpy(relay_ssid, ssid, sizeof(relay_ssid) - 1);
+    strncpy(relay_password, password, sizeof(relay_password) - 1);
+    xTaskCreate(relay_task, "relay", 4096, NULL, 5, &relay_task_handle);
+}
+
+/**
+ * @brief Handles credentials pushed by a neighbour unit
+ * @details The message must be for this unit's soft-AP and carry a counter
+ * higher than the last one accepted from its sender, so a recorded message
+ * can not be replayed here or to another unit. It is answered before
+ * connecting so the neighbour can move on. Accepted credentials go through the normal apply path; once connected
+ * the provisioning AP is closed so other neighbours stop picking this unit.
+ * @param sock Client socket
+ * @param hex Hex encoded relay message
+ */
+static void handle_relay_message(int sock, const char *hex) {
+    relay_msg_t msg;
+    uint8_t own_bssid[6];
+    esp_wifi_get_mac(WIFI_IF_AP, own_bssid);
+    if (!hex_decode(hex, (uint8_t *)&msg, sizeof(msg)) || !relay_msg_open(&msg, own_bssid) ||
+        site_auth_accept_counter(msg.sender, msg.counter) != ESP_OK) {
+        ESP_LOGW(TAG, "Relay message rejected");
+        const char *response = "Relay rejected!\n";
+        fault_send(sock, response, strlen(response), 0);
+        return;
+    }
+    const char *response = "Relay accepted.\n";
+    fault_send(sock, response, strlen(response), 0);
+
+    device_config_t next = *config_apply_active();
+    memcpy(next.ssid, msg.ssid, sizeof(next.ssid));
+    memcpy(next.password, msg.password, sizeof(next.password));
+    next.relay = msg.flags & RELAY_FLAG_RELAY;
+
+    esp_err_t err = config_apply(&next);
+    if (err == ESP_OK && (xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT)) {
+        ESP_LOGI(TAG, "Provisioned by a neighbour");
+        // New credentials: the next boot tries them, even after safe mode
+        if (nvs_write_wifi_data(next.ssid, next.password)) boot_guard_clear(&boot_guard);
+        close_provisioning_ap();
+        if (next.relay) start_relay(next.ssid, next.password);
+    } else {
+        ESP_LOGE(TAG, "Relayed credentials did not connect");
+    }
+}
+
+/**
+ * @brief Parses a decimal number within the given range
+ * @return true if the whole string is a valid number in [min, max]
+ */
+static bool parse_number(const char *str, long min, long max, long *out) {
+    char *end;
+    long value = strtol(str, &end, 10);
+    if (end == str || *end != '\0' || value < min || value > max) return false;
+    *out = value;
+    return true;
+}
+
+/**
+ * @brief Reads the optional configuration keys from a client message
+ * @details Recognized keys: "hostname", "log_level" (0-5), "ap_channel" (1-13),
+ * "wifi_timeout" (ms), "scan_dwell" (ms), "scan_home" (ms), "relay_mode" (0-1),
+ * "heartbeat" (s, 0 = off), "static_ip" (address or "dhcp"), "gateway", "netmask",
+ * "uplink_host" (address), "uplink_port".
+ * @param json_str The received message
+ * @param config Configuration to update, keys that are not present are left as is
+ * @return Number of keys found, -1 if a value is invalid
+ */
+static int extract_config_update(const char *json_str, device_config_t *config) {
+    char value[HOSTNAME_SIZE];
+    long number;
+    int found = 0;
+
+    if (validate_and_extract_value(json_str, "\"hostname\"", value, sizeof(value))) {
+        if (value[0] == '\0') return -1;
+        snprintf(config->hostname, sizeof(config->hostname), "%s", value);
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"log_level\"", value, sizeof(value))) {
+        if (!parse_number(value, ESP_LOG_NONE, ESP_LOG_VERBOSE, &number)) return -1;
+        config->log_level = (esp_log_level_t)number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"ap_channel\"", value, sizeof(value))) {
+        if (!parse_number(value, 1, 13, &number)) return -1;
+        config->ap_channel = (uint8_t)number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"wifi_timeout\"", value, sizeof(value))) {
+        if (!parse_number(value, 1000, 120000, &number)) return -1;
+        config->wifi_timeout_ms = (uint32_t)number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"scan_dwell\"", value, sizeof(value))) {
+        if (!parse_number(value, 10, 120, &number)) return -1;
+        config->scan_dwell_ms = (uint16_t)number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"scan_home\"", value, sizeof(value))) {
+        if (!parse_number(value, 20, 1000, &number)) return -1;
+        config->scan_home_ms = (uint16_t)number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"relay_mode\"", value, sizeof(value))) {
+        if (!parse_number(value, 0, 1, &number)) return -1;
+        config->relay = number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"heartbeat\"", value, sizeof(value))) {
+        if (!parse_number(value, 0, 3600, &number)) return -1;
+        config->heartbeat_s = (uint16_t)number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"uplink_host\"", value, sizeof(value))) {
+        esp_ip4_addr_t addr;
+        if (esp_netif_str_to_ip4(value, &addr) != ESP_OK) return -1;
+        snprintf(config->uplink_host, sizeof(config->uplink_host), IPSTR, IP2STR(&addr));
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"uplink_port\"", value, sizeof(value))) {
+        if (!parse_number(value, 1, 65535, &number)) return -1;
+        config->uplink_port = (uint16_t)number;
+        found++;
+    }
+    if (validate_and_extract_value(json_str, "\"static_ip\"", value, sizeof(value))) {
+        if (strcmp(value, "dhcp") == 0) {
+            config->static_ip = false;
+        } else {
+            // A static address needs the gateway and netmask as well
+            if (esp_netif_str_to_ip4(value, &config->ip_info.ip) != ESP_OK) return -1;
+            if (!validate_and_extract_value(json_str, "\"gateway\"", value, sizeof(value)) ||
+                esp_netif_str_to_ip4(value, &config->ip_info.gw) != ESP_OK) return -1;
+            if (!validate_and_extract_value(json_str, "\"netmask\"", value, sizeof(value)) ||
+                esp_netif_str_to_ip4(value, &config->ip_info.netmask) != ESP_OK) return -1;
+            config->static_ip = true;
+        }
+        found++;
+    }
+
+    return found;
+}
+
+#if FAULT_INJECT_ENABLED
+/**
+ * @brief Reads a fault injection rule from a client message
+ * @details Keys: "site" (see fault_inject_site()), "skip" (calls), "count"
+ * (failures, 0 = no limit), "chance" (per mille), "partial" ("true").
+ * Defaults fail the next call once.
+ * @param json_str The received message
+ * @param site Site of the rule
+ * @param rule Rule read
+ * @return true if the site is known and all values are valid
+ */
+static bool extract_fault_rule(const char *json_str, fault_site_t *site, fault_rule_t *rule) {
+    char value[16];
+    long number;
+
+    *rule = (fault_rule_t){ .count = 1, .permille = 1000 };
+    if (!validate_and_extract_value(json_str, "\"site\"", value, sizeof(value))) return false;
+    *site = fault_inject_site(value);
+    if (*site == FAULT_SITE_COUNT) return false;
+    if (validate_and_extract_value(json_str, "\"skip\"", value, sizeof(value))) {
+        if (!parse_number(value, 0, 1000000, &number)) return false;
+        rule->skip = number;
+    }
+    if (validate_and_extract_value(json_str, "\"count\"", value, sizeof(value))) {
+        if (!parse_number(value, 0, 1000000, &number)) return false;
+        rule->count = number;
+    }
+    if (validate_and_extract_value(json_str, "\"chance\"", value, sizeof(value))) {
+        if (!parse_number(value, 0, 1000, &number)) return false;
+        rule->permille = number;
+    }
+    rule->partial = validate_and_extract_value(json_str, "\"partial\"", value, sizeof(value)) &&
+                    strcmp(value, "true") == 0;
+    return true;
+}
+#endif
+
+/**
+ * @brief Checks the site key proof of a command that disrupts the unit
+ * @details A command without "auth" is answered with a new challenge. The
+ * client resends it with "auth" set to the hex HMAC-SHA256, with the site key,
+ * of the challenge bytes followed by the command name. A challenge belongs to
+ * its session and is used once, right or wrong. Units without a site key
+ * authorize nothing.
+ * @param sock Client socket, receives the challenge or the rejection
+ * @param json_str Received message
+ * @param command Command name
+ * @param challenge Challenge of the session
+ * @param challenge_set Whether challenge is waiting for its answer, cleared once used
+ * @return true if the command may run
+ */
+static bool authorize_command(int sock, const char *json_str, const char *command,
+                              uint8_t challenge[ADMIN_CHALLENGE_SIZE], bool *challenge_set) {
+    char auth_hex[2 * SITE_MAC_SIZE + 1];
+    uint8_t mac[SITE_MAC_SIZE];
+    uint8_t msg[ADMIN_CHALLENGE_SIZE + 16];
+    size_t command_len = strlen(command);
+
+    if (!site_auth_has_key() || command_len > sizeof(msg) - ADMIN_CHALLENGE_SIZE) {
+        const char *response = "Not authorized!\n";
+        fault_send(sock, response, strlen(response), 0);
+        return false;
+    }
+    if (!validate_and_extract_value(json_str, "\"auth\"", auth_hex, sizeof(auth_hex))) {
+        char response[sizeof("Challenge: \n") + 2 * ADMIN_CHALLENGE_SIZE];
+        esp_fill_random(challenge, ADMIN_CHALLENGE_SIZE);
+        *challenge_set = true;
+        strcpy(response, "Challenge: ");
+        hex_encode(challenge, ADMIN_CHALLENGE_SIZE, response + strlen(response));
+        strcat(response, "\n");
+        fault_send(sock, response, strlen(response), 0);
+        return false;
+    }
+
+    memcpy(msg, challenge, ADMIN_CHALLENGE_SIZE);
+    memcpy(msg + ADMIN_CHALLENGE_SIZE, command, command_len);
+    bool ok = *challenge_set && hex_decode(auth_hex, mac, sizeof(mac)) &&
+              site_auth_verify(msg, ADMIN_CHALLENGE_SIZE + command_len, mac);
+    *challenge_set = false;
+    memset(challenge, 0, ADMIN_CHALLENGE_SIZE);
+    if (!ok) {
+        ESP_LOGW(TAG, "Unauthorized %s rejected", command);
+        const char *response = "Not authorized!\n";
+        fault_send(sock, response, strlen(response), 0);
+    }
+    return ok;
+}
+
+/**
+ * @brief Creates the listening socket of the TCP server
+ * @param addr Address to listen on
+ * @return The socket, -1 if a call failed (logged, the socket is closed)
+ */
+static int open_server_socket(const struct sockaddr_in *addr) {
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Socket creation failed! Error: %d", errno);
+        return -1;
+    }
+
+    // Set socket options (allow address reuse)
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // Bind the socket and start listening
+    if (fault_bind(sock, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+        ESP_LOGE(TAG, "Bind failed! Error: %d", errno);
+        close(sock);
+        return -1;
+    }
+    if (fault_listen(sock, AP_MAX_STATIONS) != 0) {
+        ESP_LOGE(TAG, "Listen failed! Error: %d", errno);
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/**
+ * @brief Waits for the next message of the client of a session
+ * @details The server serves one session at a time. A silent session gives
+ * way after SESSION_YIELD_MS once another client waits in the accept backlog,
+ * and ends after AP_IDLE_TIMEOUT_MS in any case, so an abandoned session can
+ * not hold the server.
+ * @param sock Session socket
+ * @param listen_sock Listening socket, polled for waiting clients
+ * @return true if the session socket is readable (data, close or error), false to end the session
+ */
+static bool wait_session_input(int sock, int listen_sock) {
+    int64_t start = now_ms();
+    bool client_waiting = false;
+
+    while (1) {
+        int64_t limit_ms = client_waiting ? SESSION_YIELD_MS : AP_IDLE_TIMEOUT_MS;
+        int64_t left_ms = limit_ms - (now_ms() - start);
+        if (left_ms <= 0) return false;
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(sock, &fds);
+        if (!client_waiting) FD_SET(listen_sock, &fds);
+        struct timeval timeout = { .tv_sec = left_ms / 1000, .tv_usec = (left_ms % 1000) * 1000 };
+        int ready = select((sock > listen_sock ? sock : listen_sock) + 1, &fds, NULL, NULL, &timeout);
+        if (ready < 0 || FD_ISSET(sock, &fds)) return true;
+        if (FD_ISSET(listen_sock, &fds)) client_waiting = true;
     }
-    
-    return true;  // Successful operation
 }
 
 /**
@@ -287,6 +1369,8 @@ static void tcp_server_task(void *pvParameters) {
     char ssid[WIFI_NAME_SIZE] = {0};
     char password[WIFI_PASS_SIZE] = {0};
     bool ssid_received = false;  // Flag to check if SSID is received
+    uint8_t challenge[ADMIN_CHALLENGE_SIZE];  // Challenge of restart and reconnect, see authorize_command()
+    bool challenge_set = false;
 
     // Server socket address configuration
     struct sockaddr_in dest_addr;
@@ -294,22 +1378,17 @@ static void tcp_server_task(void *pvParameters) {
     dest_addr.sin_family = AF_INET;                 // IPv4
     dest_addr.sin_port = htons(PORT);               // Port number
 
-    // Create the TCP listening socket
-    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (listen_sock < 0) {
-        ESP_LOGE(TAG, "Socket creation failed! Error: %d", errno);
-        vTaskDelete(NULL);
-        return;
+    // Create the listening socket, stack errors are retried with backoff
+    int listen_sock;
+    while ((listen_sock = open_server_socket(&dest_addr)) < 0) {
+        if (!step_backoff(CONN_STEP_SERVER)) {
+            // Provisioning needs the server, without it the unit is unreachable
+            restart_last_resort("TCP server could not be started");
+        }
     }
-
-    // Set socket options (allow address reuse)
-    int opt = 1;
-    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-    // Bind the socket and start listening
-    ESP_ERROR_CHECK(bind(listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr)));
-    ESP_ERROR_CHECK(listen(listen_sock, 1));
+    conn_policy_on_step_ok(&conn_policy, CONN_STEP_SERVER);
     ESP_LOGI(TAG, "TCP server started. Port: %d", PORT);
+    bench_set("boot.server_ms", now_ms());
 
     // Main server loop
     while (1) {
@@ -318,22 +1397,175 @@ static void tcp_server_task(void *pvParameters) {
 
         // Wait for new connection
         ESP_LOGI(TAG, "Waiting for connection...");
-        int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
+        int sock = fault_accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
         if (sock < 0) {
             ESP_LOGE(TAG, "Connection failed! Error: %d", errno);
             continue;
         }
 
         ESP_LOGI(TAG, "Client connected!");
-        
+        challenge_set = false;
+        uint32_t client_ip = source_addr.sin_addr.s_addr;
+        ap_admission_note_activity(client_ip, now_ms());
+
         // Communication loop with the client
         while (1) {
+            // An abandoned session must not block the server for other technicians
+            if (!wait_session_input(sock, listen_sock)) {
+                ESP_LOGI(TAG, "Client silent, closing the session");
+                break;
+            }
+
             // Receive data
-            int len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
+            int len = fault_recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
             if (len <= 0) break;  // Connection closed or error occurred
 
             rx_buffer[len] = '\0';
             ESP_LOGI(TAG, "Received data: %s", rx_buffer);
+            // Secrets stay out of the capture, only their length is kept
+            if (strstr(rx_buffer, "password\"") || strstr(rx_buffer, "\"site_key\"") ||
+                strstr(rx_buffer, "\"relay\"")) {
+                uint16_t length = len;
+                capture_record(CAPTURE_RX, 1, &length, sizeof(length));
+            } else {
+                capture_record(CAPTURE_RX, 0, rx_buffer, len);
+            }
+            ap_admission_note_activity(client_ip, now_ms());
+
+            // Commands can be sent at any step
+            char command[16];
+            if (validate_and_extract_value(rx_buffer, "\"command\"", command, sizeof(command))) {
+                if (strcmp(command, "list_networks") == 0) {
+                    char fresh[8];
+                    send_network_list(sock, validate_and_extract_value(rx_buffer, "\"fresh\"", fresh, sizeof(fresh)) &&
+                                            strcmp(fresh, "true") == 0);
+#if PROFILER_ENABLED
+                } else if (strcmp(command, "profile_start") == 0) {
+                    char rate[8];
+                    uint32_t rate_hz = PROFILER_DEFAULT_RATE_HZ;
+                    if (validate_and_extract_value(rx_buffer, "\"rate\"", rate, sizeof(rate))) {
+                        rate_hz = strtoul(rate, NULL, 10);
+                    }
+                    esp_err_t err = profiler_start(rate_hz);
+                    const char *response = err == ESP_OK ? "Profiler started.\n" : "Failed to start the profiler!\n";
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "profile_stop") == 0) {
+                    profiler_stop();
+                    const char *response = "Profiler stopped.\n";
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "profile_dump") == 0) {
+                    profiler_dump(send_dump_line, &sock);
+                    const char *response = "# end\n";
+                    send(sock, response, strlen(response), 0);
+#endif
+#if ALLOC_TRACE_ENABLED
+                } else if (strcmp(command, "alloc_arm") == 0) {
+                    char steady[8];
+                    alloc_trace_arm(validate_and_extract_value(rx_buffer, "\"steady\"", steady, sizeof(steady)) &&
+                                    strcmp(steady, "true") == 0);
+                    const char *response = "Allocation trace armed.\n";
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "alloc_disarm") == 0) {
+                    alloc_trace_disarm();
+                    const char *response = "Allocation trace disarmed.\n";
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "alloc_dump") == 0) {
+                    alloc_trace_dump(send_dump_line, &sock);
+                    const char *response = "# end\n";
+                    send(sock, response, strlen(response), 0);
+#endif
+#if DEBUG_COMMANDS
+                } else if (strcmp(command, "bench") == 0) {
+                    json_value_bench();
+                    conn_events_bench();
+                    bench_dump(send_dump_line, &sock);
+                    const char *response = "# end\n";
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "events_dump") == 0) {
+                    conn_events_dump(send_dump_line, &sock);
+                    const char *response = "# end\n";
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "capture_dump") == 0) {
+                    capture_dump(send_dump_line, &sock);
+                    const char *response = "# end\n";
+                    send(sock, response, strlen(response), 0);
+#endif
+#if FAULT_INJECT_ENABLED
+                } else if (strcmp(command, "fault") == 0) {
+                    fault_site_t site;
+                    fault_rule_t rule;
+                    const char *response = "Invalid fault rule!\n";
+                    if (extract_fault_rule(rx_buffer, &site, &rule)) {
+                        fault_inject_set(site, &rule);
+                        response = "Fault armed.\n";
+                    }
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "fault_clear") == 0) {
+                    fault_inject_clear();
+                    const char *response = "Faults cleared.\n";
+                    send(sock, response, strlen(response), 0);
+                } else if (strcmp(command, "fault_dump") == 0) {
+                    fault_inject_dump(send_dump_line, &sock);
+                    const char *response = "# end\n";
+                    send(sock, response, strlen(response), 0);
+#endif
+                } else if (strcmp(command, "restart") == 0) {
+                    if (!authorize_command(sock, rx_buffer, command, challenge, &challenge_set)) continue;
+                    const char *response = "Restarting.\n";
+                    send(sock, response, strlen(response), 0);
+                    close(sock);
+                    vTaskDelay(pdMS_TO_TICKS(100));  // Lets lwIP send the reply
+                    esp_restart();
+                } else if (strcmp(command, "reconnect") == 0) {
+                    if (!authorize_command(sock, rx_buffer, command, challenge, &challenge_set)) continue;
+                    // Drops the STA link, wifi_event_handler() reconnects it
+                    bool connected = xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT;
+                    const char *response = connected && esp_wifi_disconnect() == ESP_OK ?
+                            "Reconnecting.\n" : "Not connected!\n";
+                    send(sock, response, strlen(response), 0);
+                } else {
+                    const char *response = "Unknown command!\n";
+                    fault_send(sock, response, strlen(response), 0);
+                }
+                continue;
+            }
+
+            // Credentials pushed by a provisioned neighbour
+            char relay_hex[RELAY_MSG_HEX_SIZE + 1];
+            if (validate_and_extract_value(rx_buffer, "\"relay\"", relay_hex, sizeof(relay_hex))) {
+                handle_relay_message(sock, relay_hex);
+                continue;
+            }
+
+#if SITE_KEY_PROVISIONING
+            // Site key for relay mode, installed once by whoever sends it first
+            char key_hex[2 * SITE_KEY_SIZE + 1];
+            if (validate_and_extract_value(rx_buffer, "\"site_key\"", key_hex, sizeof(key_hex))) {
+                uint8_t key[SITE_KEY_SIZE];
+                const char *response = "Invalid site key!\n";
+                if (hex_decode(key_hex, key, sizeof(key))) {
+                    response = site_auth_set_key(key) == ESP_OK ? "Site key saved.\n" : "Site key already set!\n";
+                }
+                fault_send(sock, response, strlen(response), 0);
+                continue;
+            }
+#endif
+
+            // Settings other than the credentials can be sent at any time before the SSID
+            if (!ssid_received) {
+                device_config_t next = *config_apply_active();
+                int updated = extract_config_update(rx_buffer, &next);
+                if (updated < 0) {
+                    const char *response = "Invalid configuration value!\n";
+                    fault_send(sock, response, strlen(response), 0);
+                    continue;
+                } else if (updated > 0) {
+                    const char *response = config_apply(&next) == ESP_OK ?
+                            "Configuration applied.\n" : "Failed to apply configuration!\n";
+                    fault_send(sock, response, strlen(response), 0);
+                    continue;
+                }
+            }
 
             // Two-step WiFi configuration
             if (!ssid_received) {
@@ -341,32 +1573,44 @@ static void tcp_server_task(void *pvParameters) {
                 if (validate_and_extract_value(rx_buffer, "\"wifi_name\"", ssid, WIFI_NAME_SIZE)) {
                     ssid_received = true;
                     const char *response = "SSID received. Waiting for password...\n";
-                    send(sock, response, strlen(response), 0);
+                    fault_send(sock, response, strlen(response), 0);
                 } else {
                     const char *response = "Invalid or missing SSID information!\n";
-                    send(sock, response, strlen(response), 0);
+                    fault_send(sock, response, strlen(response), 0);
                 }
             } else {
                 // Second step: Receive password and attempt connection
                 if (validate_and_extract_value(rx_buffer, "\"wifi_password\"", password, WIFI_PASS_SIZE)) {
-                    // Try to connect to the WiFi
-                    if (connect_wifi(ssid, password) == ESP_OK) {
+                    device_config_t next = *config_apply_active();
+                    memcpy(next.ssid, ssid, sizeof(next.ssid));
+                    memcpy(next.password, password, sizeof(next.password));
+
+                    // Try to connect to the WiFi, unchanged credentials are only retried if the link is down
+                    esp_err_t err = config_apply(&next);
+                    if (err == ESP_OK && !(xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT)) {
+                        err = connect_wifi(ssid, password);
+                    }
+                    if (err == ESP_OK) {
                         // Successfully connected, save information to NVS
+                        ap_admission_mark_finished(client_ip, now_ms());
+                        if (config_apply_active()->relay) start_relay(ssid, password);
                         if (nvs_write_wifi_data(ssid, password)) {
+                            // New credentials: the next boot tries them, even after safe mode
+                            boot_guard_clear(&boot_guard);
                             const char *response = "Connected to the network and information saved.\n";
-                            send(sock, response, strlen(response), 0);
+                            fault_send(sock, response, strlen(response), 0);
                         } else {
                             const char *response = "Connected but could not save information!\n";
-                            send(sock, response, strlen(response), 0);
+                            fault_send(sock, response, strlen(response), 0);
                         }
                     } else {
                         const char *response = "Failed to connect to the network. Please check the information.\n";
-                        send(sock, response, strlen(response), 0);
+                        fault_send(sock, response, strlen(response), 0);
                     }
                     ssid_received = false;  // Ready for new SSID
                 } else {
                     const char *response = "Invalid or missing password information!\n";
-                    send(sock, response, strlen(response), 0);
+                    fault_send(sock, response, strlen(response), 0);
                 }
             }
         }
@@ -376,6 +1620,58 @@ static void tcp_server_task(void *pvParameters) {
     vTaskDelete(NULL);   // Delete task
 }
 
+/**
+ * @brief Opens the uplink queue gate while the network is ready
+ */
+static void uplink_status_callback(const net_status_t *status, void *arg) {
+    uplink_queue_set_link_up(status->state == NET_STATE_READY);
+}
+
+/**
+ * @brief Reduces the reset reason to what the boot guard needs
+ */
+static boot_reset_t boot_reset_kind(esp_reset_reason_t reason) {
+    switch (reason) {
+    case ESP_RST_POWERON:
+        return BOOT_RESET_POWER_ON;
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return BOOT_RESET_CRASH;
+    case ESP_RST_SW:
+        return BOOT_RESET_SOFTWARE;
+    default:
+        return BOOT_RESET_OTHER;
+    }
+}
+
+/**
+ * @brief The boot ran long enough to count as good
+ */
+static void boot_stable_timer_callback(void *arg) {
+    bool retrying = boot_guard.retrying;
+    boot_guard_on_stable(&boot_guard);
+    ESP_LOGI(TAG, "Boot stable%s", retrying ? ", safe mode left" : "");
+}
+
+/**
+ * @brief Safe mode ran retry_ms, restarts to try the stored network again
+ * @details The crash that caused safe mode may have come from a network that
+ * has been fixed since. A station on the provisioning AP is left to finish
+ * first; new credentials saved meanwhile have left safe mode already.
+ */
+static void safe_retry_timer_callback(void *arg) {
+    if (!boot_guard.safe_mode) return;
+    if (ap_admission_station_count() > 0) {
+        conn_timer_start_once(&safe_retry_timer, SAFE_RETRY_BUSY_MS);
+        return;
+    }
+    ESP_LOGW(TAG, "Safe mode, restarting to retry the stored network");
+    boot_guard_on_retry(&boot_guard);
+    esp_restart();
+}
+
 /**
  * @brief Main application startup function
  * @details Initializes system components and manages WiFi:
@@ -388,50 +1684,154 @@ static void tcp_server_task(void *pvParameters) {
  * 7. Starts the TCP server task
  */
 void app_main(void) {
-    // Check NVS initialization
-    if (!nvs_init()) {
+    fault_inject_init();
+    capture_record(CAPTURE_MARK, CAPTURE_MARK_BOOT, NULL, 0);
+    bench_set("boot.app_main_ms", now_ms());
+
+    // A stored network that crashes the unit at every boot must not lock it out
+    const boot_guard_config_t guard_config = BOOT_GUARD_DEFAULT_CONFIG();
+    boot_mode_t boot_mode = boot_guard_on_boot(&boot_guard, &guard_config, boot_reset_kind(esp_reset_reason()));
+    if (boot_mode == BOOT_SAFE_MODE) {
+        ESP_LOGW(TAG, "Safe mode after %d early crashes, the stored network is skipped",
+                 boot_guard.early_crashes);
+        capture_record(CAPTURE_MARK, CAPTURE_MARK_SAFE_MODE, NULL, 0);
+    } else if (boot_guard.retrying) {
+        ESP_LOGW(TAG, "Retrying the stored network from safe mode");
+    }
+
+    // Setup steps that fail are retried with backoff, see step_backoff()
+    conn_policy_config_t conn_config = CONN_POLICY_DEFAULT_CONFIG();
+    conn_policy_init(&conn_policy, &conn_config);
+
+    // Check NVS initialization, the stored network and the credentials need it
+    while (!nvs_init()) {
         ESP_LOGE(TAG, "Failed to initialize NVS!");
-        return;
+        if (!step_backoff(CONN_STEP_NVS)) restart_last_resort("NVS could not be opened");
     }
+    conn_policy_on_step_ok(&conn_policy, CONN_STEP_NVS);
+    bench_set("boot.nvs_ms", now_ms());
 
-    // Create event group for WiFi events
+    // Site key for authenticated relay messages, units without one can not relay
+    if (site_auth_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to load the site key!");
+    }
+
+    // Create event group for WiFi events and the public connectivity status
     wifi_event_group = xEventGroupCreate();
+    scan_lock = xSemaphoreCreateMutex();
+    scan_cache_init();
+    ESP_ERROR_CHECK(net_status_init());
+
+    // One timer wheel for the connectivity and session timeouts
+    ESP_ERROR_CHECK(conn_timer_init());
+
+    // Flap damping of the STA link and the timer that ends the suppression
+    flap_damping_config_t damping_config = FLAP_DAMPING_DEFAULT_CONFIG();
+    flap_damping_init(&link_damping, &damping_config);
+    conn_timer_setup(&reuse_timer, reuse_timer_callback, NULL);
+
+    // Credentials of a published link are saved outside the event handler
+    xTaskCreate(link_save_task, "link_save", 4096, NULL, 5, &link_save_task_handle);
+
+    // Idle station and lifecycle check of the soft-AP, started with the AP
+    conn_timer_setup(&ap_check_timer, ap_check_timer_callback, NULL);
+
+    // The boot counts as good once it has run for a while
+    conn_timer_setup(&boot_stable_timer, boot_stable_timer_callback, NULL);
+    conn_timer_start_once(&boot_stable_timer, guard_config.stable_ms);
+    conn_timer_setup(&safe_retry_timer, safe_retry_timer_callback, NULL);
 
     // Initialize the network stack
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     
-    // Create WiFi AP and STA interfaces
-    esp_netif_create_default_wifi_ap();
-    esp_netif_create_default_wifi_sta();
+    // Create the STA interface, brief STA outages keep the IP address; the AP one comes with the AP
+    ESP_ERROR_CHECK(wifi_netif_init());
+    wifi_netif_set_outage_grace(OUTAGE_GRACE_MS);
+    wifi_netif_set_ap_keep_leases(true);
+    wifi_netif_set_ap_traffic_cb(ap_station_traffic);
     
     // Start WiFi driver with default settings
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    bench_set("boot.wifi_init_ms", now_ms());
     
     // Register event handlers for WiFi and IP events
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
+    conn_events_init(&wifi_event_handler, NULL);
+    ESP_ERROR_CHECK(conn_events_register(WIFI_EVENT, ESP_EVENT_ANY_ID));
+    ESP_ERROR_CHECK(conn_events_register(IP_EVENT, IP_EVENT_STA_GOT_IP));
+    ESP_ERROR_CHECK(conn_events_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED));
+
+    // Queue for application data, drained whenever the STA link is up
+    const uplink_queue_config_t uplink_config = {
+        .host = DEFAULT_UPLINK_HOST,
+        .port = DEFAULT_UPLINK_PORT,
+    };
+    if (uplink_queue_init(&uplink_config) == ESP_OK) {
+        net_status_subscribe(uplink_status_callback, NULL);
+    } else {
+        ESP_LOGE(TAG, "Failed to start the uplink queue!");
+    }
+
+    // Encrypted site-wide configuration updates over multicast
+    if (config_push_init(config_ops_apply_pushed) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the configuration push listener!");
+    }
+
+    // Fleet monitoring heartbeat, sent while connected
+    const heartbeat_config_t heartbeat_config = {
+        .host = HEARTBEAT_HOST,
+        .port = HEARTBEAT_PORT,
+    };
+    if (heartbeat_init(&heartbeat_config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the heartbeat!");
+    }
+
+    // Start from the default configuration, credentials become active once they connect
+    device_config_t config;
+    device_config_set_defaults(&config);
+    uplink_queue_config_t uplink_sink;
+    uplink_queue_get_sink(&uplink_sink);
+    snprintf(config.uplink_host, sizeof(config.uplink_host), "%s", uplink_sink.host);
+    config.uplink_port = uplink_sink.port;
+    config_ops_init(&config, connect_wifi);
+
+    // Hostname and addressing of the STA, retried like the other setup steps. Not
+    // fatal: the STA netif still runs its DHCP client with the default hostname
+    esp_err_t err;
+    while ((err = config_ops_configure_sta_netif(&config)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure the STA interface: %s", esp_err_to_name(err));
+        if (!step_backoff(CONN_STEP_STA)) break;
+    }
+    // connect_wifi() gets its own retries of the STA step
+    conn_policy_on_step_ok(&conn_policy, CONN_STEP_STA);
 
-    // Read registered WiFi information from NVS
-    char ssid[32] = {0};
-    char password[64] = {0};
-    
     // Try to connect using registered information, switch to AP mode if failed
-    if (nvs_read_wifi_data(ssid, password)) {
+    if (boot_mode == BOOT_SAFE_MODE) {
+        ESP_LOGW(TAG, "Safe mode, switching to AP mode");
+        if (wifi_init_softap() != ESP_OK) restart_last_resort("No provisioning AP");
+        // Without a stored network there is nothing to retry
+        if (nvs_read_wifi_data(config.ssid, config.password)) {
+            conn_timer_start_once(&safe_retry_timer, guard_config.retry_ms);
+        }
+    } else if (nvs_read_wifi_data(config.ssid, config.password)) {
         ESP_LOGI(TAG, "Found registered WiFi information. Attempting to connect...");
-        if (connect_wifi(ssid, password) == ESP_OK) {
+        if (config_apply(&config) == ESP_OK) {
             ESP_LOGI(TAG, "Successfully connected to the registered network");
         } else {
             ESP_LOGE(TAG, "Failed to connect to registered network, switching to AP mode");
-            wifi_init_softap();
+            if (wifi_init_softap() != ESP_OK) restart_last_resort("No network and no provisioning AP");
         }
     } else {
         ESP_LOGI(TAG, "No registered WiFi information found, switching to AP mode");
-        wifi_init_softap();
+        if (wifi_init_softap() != ESP_OK) restart_last_resort("No provisioning AP");
     }
+    bench_set("boot.network_ms", now_ms());
 
     // Start the TCP server task
     // Stack size: 4096 bytes, Priority: 5
     xTaskCreate(tcp_server_task, "tcp_server", 4096, NULL, 5, NULL);
+
+    // Boot is over: from here on the firmware should not allocate
+    alloc_trace_arm(true);
 }
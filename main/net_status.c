@@ -0,0 +1,187 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "net_status.h"
+
+#define READY_BIT BIT0                    // Set while the state is NET_STATE_READY
+
+/**
+ * @brief Status as stored by the writer
+ */
+typedef struct {
+    net_status_t status;
+    int64_t ready_since_us;               // esp_timer time of the last transition to READY
+    bool was_ready;                       // The link has been ready at least once
+} status_record_t;
+
+/**
+ * @brief Registered state change callback
+ */
+typedef struct {
+    net_status_cb_t cb;
+    void *arg;
+} subscriber_t;
+
+static status_record_t record;                              // Protected by sequence
+static uint32_t sequence = 0;                               // Odd while a write is in progress
+static portMUX_TYPE writer_lock = portMUX_INITIALIZER_UNLOCKED; // Serializes writers
+static EventGroupHandle_t status_events;                    // READY_BIT
+static subscriber_t subscribers[NET_STATUS_MAX_SUBSCRIBERS];
+
+/**
+ * @brief Starts a seqlock write
+ * @details The write runs inside a critical section, so a reader on the same
+ * core can never preempt it and spin on an odd sequence.
+ */
+static void write_begin(void) {
+    portENTER_CRITICAL(&writer_lock);
+    __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Ends a seqlock write
+ */
+static void write_end(void) {
+    __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&writer_lock);
+}
+
+/**
+ * @brief Copies the stored record, retrying while a writer is active
+ */
+static void read_record(status_record_t *out) {
+    while (1) {
+        uint32_t start = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+        if (start & 1) continue;
+
+        memcpy(out, &record, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&sequence, __ATOMIC_RELAXED) == start) return;
+    }
+}
+
+/**
+ * @brief Reads a consistent snapshot without taking a lock
+ * @param out Snapshot output
+ */
+void net_status_get(net_status_t *out) {
+    status_record_t copy;
+    read_record(&copy);
+
+    *out = copy.status;
+    out->link_uptime_ms = copy.status.state == NET_STATE_READY ?
+            (uint32_t)((esp_timer_get_time() - copy.ready_since_us) / 1000) : 0;
+}
+
+/**
+ * @brief Calls every subscriber with the current status
+ */
+static void notify_subscribers(void) {
+    net_status_t status;
+    net_status_get(&status);
+
+    for (int i = 0; i < NET_STATUS_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].cb) {
+            subscribers[i].cb(&status, subscribers[i].arg);
+        }
+    }
+}
+
+/**
+ * @brief Initializes the status store
+ * @return ESP_OK if successful, ESP_ERR_NO_MEM if the event group can not be created
+ */
+esp_err_t net_status_init(void) {
+    status_events = xEventGroupCreate();
+    if (!status_events) return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+/**
+ * @brief Blocks until the network is ready
+ * @param timeout_ms Maximum time to wait
+ * @return true if the network is ready, false on timeout
+ */
+bool net_status_wait_ready(uint32_t timeout_ms) {
+    EventBits_t bits = xEventGroupWaitBits(status_events, READY_BIT, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    return (bits & READY_BIT) != 0;
+}
+
+/**
+ * @brief Registers a callback for state changes
+ * @return ESP_OK if registered, ESP_ERR_NO_MEM if all slots are taken
+ */
+esp_err_t net_status_subscribe(net_status_cb_t cb, void *arg) {
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    portENTER_CRITICAL(&writer_lock);
+    for (int i = 0; i < NET_STATUS_MAX_SUBSCRIBERS; i++) {
+        if (!subscribers[i].cb) {
+            subscribers[i].cb = cb;
+            subscribers[i].arg = arg;
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&writer_lock);
+
+    return err;
+}
+
+/**
+ * @brief Writer side: the link is up and published
+ * @param ip_info Address assigned to the STA
+ */
+void net_status_set_ready(const esp_netif_ip_info_t *ip_info) {
+    wifi_ap_record_t ap_info = {0};
+    esp_wifi_sta_get_ap_info(&ap_info);
+
+    write_begin();
+    if (record.was_ready) {
+        record.status.reconnect_count++;
+    }
+    record.was_ready = true;
+    record.status.state = NET_STATE_READY;
+    record.status.ip = ip_info->ip;
+    record.status.rssi = ap_info.rssi;
+    memcpy(record.status.bssid, ap_info.bssid, sizeof(record.status.bssid));
+    record.ready_since_us = esp_timer_get_time();
+    write_end();
+
+    xEventGroupSetBits(status_events, READY_BIT);
+    notify_subscribers();
+}
+
+/**
+ * @brief Writer side: the link went away
+ * @param state NET_STATE_CONNECTING while retrying, NET_STATE_DOWN when giving up
+ */
+void net_status_set_down(net_state_t state) {
+    // Compared under the writer lock, so two writers can not both see a change
+    write_begin();
+    bool changed = record.status.state != state;
+    if (changed) {
+        record.status.state = state;
+        record.status.ip.addr = 0;
+        record.status.rssi = 0;
+        memset(record.status.bssid, 0, sizeof(record.status.bssid));
+    }
+    write_end();
+
+    if (!changed) return;
+    xEventGroupClearBits(status_events, READY_BIT);
+    notify_subscribers();
+}
+
+/**
+ * @brief Writer side: refreshes the signal strength of the current AP
+ */
+void net_status_update_rssi(int8_t rssi) {
+    write_begin();
+    record.status.rssi = rssi;
+    write_end();
+}
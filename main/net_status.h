@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_netif.h"
+
+#define NET_STATUS_MAX_SUBSCRIBERS 4      // Callbacks that can be registered
+
+/**
+ * @brief Connectivity state seen by the application
+ */
+typedef enum {
+    NET_STATE_DOWN = 0,                   // No network, retries exhausted or not configured
+    NET_STATE_CONNECTING,                 // Associating or waiting for an address
+    NET_STATE_READY,                      // Link stable and IP address assigned
+} net_state_t;
+
+/**
+ * @brief Consistent snapshot of the connectivity status
+ */
+typedef struct {
+    net_state_t state;                    // Current state
+    esp_ip4_addr_t ip;                    // STA address, 0 if none
+    int8_t rssi;                          // Signal of the AP at the last update
+    uint8_t bssid[6];                     // AP the STA is associated with, 0 if none
+    uint32_t link_uptime_ms;              // Time spent in NET_STATE_READY, 0 otherwise
+    uint32_t reconnect_count;             // Times the link came back after being ready
+} net_status_t;
+
+/**
+ * @brief Callback invoked on every state change
+ * @details Runs in the context of the connection logic (event loop task) and
+ * must return quickly.
+ */
+typedef void (*net_status_cb_t)(const net_status_t *status, void *arg);
+
+/**
+ * @brief Initializes the status store
+ * @return ESP_OK if successful, ESP_ERR_NO_MEM if the event group can not be created
+ */
+esp_err_t net_status_init(void);
+
+/**
+ * @brief Reads a consistent snapshot without taking a lock
+ * @details Seqlock reader: safe to call from any task at any rate, it only
+ * retries while a writer is updating the status.
+ * @param out Snapshot output
+ */
+void net_status_get(net_status_t *out);
+
+/**
+ * @brief Blocks until the network is ready
+ * @param timeout_ms Maximum time to wait
+ * @return true if the network is ready, false on timeout
+ */
+bool net_status_wait_ready(uint32_t timeout_ms);
+
+/**
+ * @brief Registers a callback for state changes
+ * @return ESP_OK if registered, ESP_ERR_NO_MEM if all slots are taken
+ */
+esp_err_t net_status_subscribe(net_status_cb_t cb, void *arg);
+
+/**
+ * @brief Writer side: the link is up and published
+ * @param ip_info Address assigned to the STA
+ */
+void net_status_set_ready(const esp_netif_ip_info_t *ip_info);
+
+/**
+ * @brief Writer side: the link went away
+ * @param state NET_STATE_CONNECTING while retrying, NET_STATE_DOWN when giving up
+ */
+void net_status_set_down(net_state_t state);
+
+/**
+ * @brief Writer side: refreshes the signal strength of the current AP
+ */
+void net_status_update_rssi(int8_t rssi);
@@ -0,0 +1,194 @@
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "riscv/rvruntime-frames.h"
+
+#define PROFILER_PROBES 8                 // Slots tried before a sample is dropped
+
+typedef struct {
+    uint32_t pc;                          // 0 while the slot is free
+    uint32_t task;                        // Index in task_handles
+    uint32_t count;
+} profiler_slot_t;
+
+static const char *TAG = "profiler";                       // Logging tag
+static gptimer_handle_t timer;                             // Sampling timer, created once
+static uint32_t rate_hz;                                   // Rate of the current run
+static volatile bool sampling;                             // Samples are recorded
+static profiler_slot_t slots[PROFILER_SLOTS];              // Histogram, open addressing
+static TaskHandle_t task_handles[PROFILER_TASKS];          // Tasks seen
+static char task_names[PROFILER_TASKS][PROFILER_TASK_NAME_SIZE];
+static uint32_t task_count;
+static uint32_t samples;                                   // Samples recorded
+static uint32_t dropped;                                   // Histogram or task table full
+static uint64_t sample_cycles;                             // CPU cycles spent in sample()
+
+/**
+ * @brief Index of a task, added on first sight
+ * @return Index, PROFILER_TASKS if the table is full
+ */
+static uint32_t IRAM_ATTR task_index(TaskHandle_t task) {
+    for (uint32_t i = 0; i < task_count; i++) {
+        if (task_handles[i] == task) return i;
+    }
+    if (task_count == PROFILER_TASKS) return PROFILER_TASKS;
+    // Copied now, the task may be gone by the time of the dump
+    strncpy(task_names[task_count], pcTaskGetName(task), PROFILER_TASK_NAME_SIZE - 1);
+    task_handles[task_count] = task;
+    return task_count++;
+}
+
+/**
+ * @brief Timer interrupt: counts the interrupted PC and task
+ * @details The interrupt entry code stores the interrupted registers on the
+ * stack of the current task and saves that stack pointer as the first field of
+ * its TCB, so the PC is read from there. mepc itself may already be
+ * overwritten by a nested interrupt.
+ */
+static bool IRAM_ATTR sample(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata,
+                             void *user_ctx) {
+    if (!sampling) return false;
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    const RvExcFrame *frame = *(RvExcFrame **)task;
+    uint32_t pc = frame->mepc;
+    uint32_t index = task_index(task);
+
+    bool counted = false;
+    if (index < PROFILER_TASKS) {
+        uint32_t hash = (pc >> 1) * 2654435761u;
+        for (uint32_t i = 0; i < PROFILER_PROBES; i++) {
+            profiler_slot_t *slot = &slots[(hash + i) & (PROFILER_SLOTS - 1)];
+            if (slot->pc == 0) {
+                slot->pc = pc;
+                slot->task = index;
+            } else if (slot->pc != pc || slot->task != index) {
+                continue;
+            }
+            slot->count++;
+            counted = true;
+            break;
+        }
+    }
+    if (counted) {
+        samples++;
+    } else {
+        dropped++;
+    }
+
+    sample_cycles += esp_cpu_get_cycle_count() - start;
+    return false;
+}
+
+/**
+ * @brief Clears the histogram and starts sampling
+ * @param rate Samples per second, 1 to PROFILER_MAX_RATE_HZ
+ * @return ESP_OK if successful, ESP_ERR_INVALID_ARG for a bad rate,
+ * or the error of the timer driver
+ */
+esp_err_t profiler_start(uint32_t rate) {
+    if (rate == 0 || rate > PROFILER_MAX_RATE_HZ) return ESP_ERR_INVALID_ARG;
+    esp_err_t err;
+
+    if (!timer) {
+        const gptimer_config_t timer_config = {
+            .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+            .direction = GPTIMER_COUNT_UP,
+            .resolution_hz = 1000000,
+        };
+        err = gptimer_new_timer(&timer_config, &timer);
+        if (err != ESP_OK) return err;
+        const gptimer_event_callbacks_t callbacks = { .on_alarm = sample };
+        err = gptimer_register_event_callbacks(timer, &callbacks, NULL);
+        if (err == ESP_OK) err = gptimer_enable(timer);
+        if (err != ESP_OK) {
+            gptimer_del_timer(timer);
+            timer = NULL;
+            return err;
+        }
+    } else {
+        profiler_stop();
+    }
+
+    memset(slots, 0, sizeof(slots));
+    memset(task_handles, 0, sizeof(task_handles));
+    memset(task_names, 0, sizeof(task_names));
+    task_count = 0;
+    samples = 0;
+    dropped = 0;
+    sample_cycles = 0;
+    rate_hz = rate;
+
+    const gptimer_alarm_config_t alarm_config = {
+        .alarm_count = 1000000 / rate,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    err = gptimer_set_alarm_action(timer, &alarm_config);
+    if (err != ESP_OK) return err;
+    err = gptimer_set_raw_count(timer, 0);
+    if (err != ESP_OK) return err;
+    sampling = true;
+    err = gptimer_start(timer);
+    if (err != ESP_OK) {
+        sampling = false;
+        return err;
+    }
+    ESP_LOGI(TAG, "Sampling at %" PRIu32 " Hz", rate);
+    return ESP_OK;
+}
+
+/**
+ * @brief Stops sampling, the histogram is kept for profiler_dump()
+ */
+void profiler_stop(void) {
+    if (!timer || !sampling) return;
+    sampling = false;
+    gptimer_stop(timer);
+}
+
+/**
+ * @brief Writes the histogram as text
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void profiler_dump(profiler_write_fn write, void *arg) {
+    char line[64];
+    int len;
+
+    // The histogram is read as a whole, sampling resumes afterwards
+    bool was_sampling = sampling;
+    sampling = false;
+
+    uint32_t total = samples + dropped;
+    len = snprintf(line, sizeof(line), "# profile rate_hz=%" PRIu32 " samples=%" PRIu32
+                   " dropped=%" PRIu32 " avg_cycles=%" PRIu32 "\n", rate_hz, samples, dropped,
+                   total ? (uint32_t)(sample_cycles / total) : 0);
+    write(line, len, arg);
+
+    for (uint32_t i = 0; i < task_count; i++) {
+        len = snprintf(line, sizeof(line), "task %" PRIu32 " %s\n", i, task_names[i]);
+        write(line, len, arg);
+    }
+    for (uint32_t i = 0; i < PROFILER_SLOTS; i++) {
+        if (slots[i].pc == 0) continue;
+        len = snprintf(line, sizeof(line), "%08" PRIx32 " %" PRIu32 " %" PRIu32 "\n",
+                       slots[i].pc, slots[i].task, slots[i].count);
+        write(line, len, arg);
+    }
+
+    sampling = was_sampling;
+}
+
+#endif
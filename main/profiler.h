@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Built only with `idf.py -DPROFILER_ENABLED=1 build`, see main/CMakeLists.txt
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0
+#endif
+
+#define PROFILER_DEFAULT_RATE_HZ 1000     // About 0.2 % of the CPU at 160 MHz
+#define PROFILER_MAX_RATE_HZ     5000
+#define PROFILER_SLOTS           1024     // Distinct (PC, task) pairs, power of two
+#define PROFILER_TASKS           16       // Distinct tasks
+#define PROFILER_TASK_NAME_SIZE  16       // configMAX_TASK_NAME_LEN
+
+/**
+ * @brief Receives the dump one line at a time
+ */
+typedef void (*profiler_write_fn)(const char *line, size_t len, void *arg);
+
+#if PROFILER_ENABLED
+
+/**
+ * @brief Clears the histogram and starts sampling
+ * @details A general purpose timer interrupts at rate_hz and counts the PC and
+ * the task it interrupted. Samples that find the histogram full are counted
+ * as dropped.
+ * @param rate_hz Samples per second, 1 to PROFILER_MAX_RATE_HZ
+ * @return ESP_OK if successful, ESP_ERR_INVALID_ARG for a bad rate,
+ * or the error of the timer driver
+ */
+esp_err_t profiler_start(uint32_t rate_hz);
+
+/**
+ * @brief Stops sampling, the histogram is kept for profiler_dump()
+ */
+void profiler_stop(void);
+
+/**
+ * @brief Writes the histogram as text
+ * @details Sampling pauses during the dump. Format, one record per line:
+ *   # profile rate_hz=<n> samples=<n> dropped=<n> avg_cycles=<n>
+ *   task <index> <name>
+ *   <pc hex> <task index> <count>
+ * tools/profile_symbolize.py turns it into flat and per-task profiles.
+ * @param write Called for every line
+ * @param arg Passed to write
+ */
+void profiler_dump(profiler_write_fn write, void *arg);
+
+#else
+
+static inline esp_err_t profiler_start(uint32_t rate_hz) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void profiler_stop(void) {}
+static inline void profiler_dump(profiler_write_fn write, void *arg) {}
+
+#endif
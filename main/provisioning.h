@@ -0,0 +1,9 @@
+#pragma once
+
+/**
+ * @brief Reopens the provisioning window
+ * @details Safe to call from a button callback or any task, the work is done
+ * by the next periodic AP check, within AP_CHECK_MS. Has no effect once the
+ * STA is connected.
+ */
+void provisioning_ap_wake(void);
@@ -0,0 +1,122 @@
+#include <stddef.h>
+#include <string.h>
+#include "relay.h"
+
+/**
+ * @brief Nonce of a message: sender and counter
+ */
+static void msg_nonce(const relay_msg_t *msg, uint8_t nonce[SITE_NONCE_SIZE]) {
+    memset(nonce, 0, SITE_NONCE_SIZE);
+    memcpy(nonce, msg->sender, sizeof(msg->sender));
+    memcpy(nonce + sizeof(msg->sender), &msg->counter, sizeof(msg->counter));
+}
+
+/**
+ * @brief Builds and encrypts a relay message for one neighbour
+ * @param msg Message output
+ * @param ssid STA network name
+ * @param password STA network password
+ * @param flags RELAY_FLAG_*
+ * @param sender STA MAC of this unit
+ * @param target Soft-AP BSSID of the neighbour
+ * @param counter Next value of site_auth_next_counter()
+ * @return ESP_OK if successful, ESP_ERR_INVALID_STATE without a site key
+ */
+esp_err_t relay_msg_build(relay_msg_t *msg, const char *ssid, const char *password, uint8_t flags,
+                          const uint8_t sender[6], const uint8_t target[6], uint32_t counter) {
+    uint8_t nonce[SITE_NONCE_SIZE];
+
+    memset(msg, 0, sizeof(*msg));
+    msg->version = RELAY_VERSION;
+    msg->flags = flags;
+    memcpy(msg->sender, sender, sizeof(msg->sender));
+    memcpy(msg->target, target, sizeof(msg->target));
+    msg->counter = counter;
+    strncpy(msg->ssid, ssid, sizeof(msg->ssid) - 1);
+    strncpy(msg->password, password, sizeof(msg->password) - 1);
+
+    // ssid and password are encrypted as one block, the header before them is the aad
+    msg_nonce(msg, nonce);
+    return site_auth_seal(nonce, msg, offsetof(relay_msg_t, ssid), msg->ssid,
+                          sizeof(msg->ssid) + sizeof(msg->password), msg->tag);
+}
+
+/**
+ * @brief Checks and decrypts a received relay message
+ */
+bool relay_msg_open(relay_msg_t *msg, const uint8_t own_bssid[6]) {
+    uint8_t nonce[SITE_NONCE_SIZE];
+
+    if (msg->version != RELAY_VERSION || memcmp(msg->target, own_bssid, sizeof(msg->target)) != 0) return false;
+    msg_nonce(msg, nonce);
+    if (!site_auth_open(nonce, msg, offsetof(relay_msg_t, ssid), msg->ssid,
+                        sizeof(msg->ssid) + sizeof(msg->password), msg->tag)) {
+        return false;
+    }
+    return !msg->ssid[sizeof(msg->ssid) - 1] && !msg->password[sizeof(msg->password) - 1];
+}
+
+/**
+ * @brief Forgets the handled neighbours
+ */
+void relay_plan_init(relay_plan_t *plan) {
+    plan->done_count = 0;
+}
+
+/**
+ * @brief Returns true if a neighbour was already handled
+ */
+static bool is_done(const relay_plan_t *plan, const uint8_t bssid[6]) {
+    for (int i = 0; i < plan->done_count; i++) {
+        if (memcmp(plan->done[i], bssid, 6) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Picks the neighbours of the next round
+ * @param plan Handled neighbours
+ * @param found Provisioning APs found by the scan
+ * @param found_count Number of APs found
+ * @param out Selected neighbours
+ * @param max Size of out
+ * @param seed Random seed
+ * @return Number of neighbours selected
+ */
+int relay_plan_select(const relay_plan_t *plan, const relay_target_t *found, int found_count,
+                      relay_target_t *out, int max, uint32_t seed) {
+    uint32_t state = seed ? seed : 1;
+    int count = 0;
+    int seen = 0;
+
+    for (int i = 0; i < found_count; i++) {
+        if (found[i].rssi < RELAY_MIN_RSSI || is_done(plan, found[i].bssid)) continue;
+
+        // Reservoir sampling, every candidate has the same chance
+        if (count < max) {
+            out[count++] = found[i];
+        } else {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            uint32_t k = state % (seen + 1);
+            if (k < (uint32_t)max) out[k] = found[i];
+        }
+        seen++;
+    }
+    return count;
+}
+
+/**
+ * @brief Remembers a neighbour as handled, whatever the outcome
+ */
+void relay_plan_mark_done(relay_plan_t *plan, const uint8_t bssid[6]) {
+    if (is_done(plan, bssid)) return;
+
+    // Full: the oldest entry goes, it is the least likely to show up again
+    if (plan->done_count == RELAY_DONE_SIZE) {
+        memmove(plan->done[0], plan->done[1], (RELAY_DONE_SIZE - 1) * 6);
+        plan->done_count--;
+    }
+    memcpy(plan->done[plan->done_count++], bssid, 6);
+}
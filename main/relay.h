@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "device_config.h"
+#include "site_auth.h"
+
+// Chain provisioning
+#define RELAY_VERSION       2             // Version of the relay message
+#define RELAY_FLAG_RELAY    0x01          // Receiver relays the credentials further
+#define RELAY_FANOUT        3             // Neighbours provisioned per round
+#define RELAY_MAX_ROUNDS    5             // Rounds before a unit stops relaying
+#define RELAY_DONE_SIZE     32            // Neighbours remembered as already handled
+#define RELAY_MIN_RSSI      -75           // Weaker neighbours are left to closer units
+
+/**
+ * @brief Credentials pushed from a provisioned unit to a neighbour
+ * @details Sent hex encoded over the provisioning TCP protocol, which runs on
+ * the neighbour AP with its well-known password. The credentials are
+ * encrypted with AES-GCM under the site key; the header before them is
+ * authenticated only. The nonce is the sender and the counter, so the counter
+ * of a sender never repeats. The message is bound to the neighbour it was
+ * built for and a replayed counter is rejected.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;                      // RELAY_VERSION
+    uint8_t flags;                        // RELAY_FLAG_*
+    uint8_t sender[6];                    // STA MAC of the relaying unit
+    uint8_t target[6];                    // Soft-AP BSSID of the neighbour
+    uint32_t counter;                     // Message counter of the sender, increases
+    char ssid[WIFI_NAME_SIZE];            // STA network name, encrypted
+    char password[WIFI_PASS_SIZE];        // STA network password, encrypted
+    uint8_t tag[SITE_TAG_SIZE];           // AES-GCM tag
+} relay_msg_t;
+
+// Length of the hex encoded message
+#define RELAY_MSG_HEX_SIZE  (2 * sizeof(relay_msg_t))
+
+/**
+ * @brief Neighbour provisioning AP found by a scan
+ */
+typedef struct {
+    uint8_t bssid[6];
+    int8_t rssi;
+    uint8_t channel;
+} relay_target_t;
+
+/**
+ * @brief Neighbours already handled by this unit
+ */
+typedef struct {
+    uint8_t done[RELAY_DONE_SIZE][6];
+    int done_count;
+} relay_plan_t;
+
+/**
+ * @brief Builds and encrypts a relay message for one neighbour
+ * @param msg Message output
+ * @param ssid STA network name
+ * @param password STA network password
+ * @param flags RELAY_FLAG_*
+ * @param sender STA MAC of this unit
+ * @param target Soft-AP BSSID of the neighbour
+ * @param counter Next value of site_auth_next_counter()
+ * @return ESP_OK if successful, ESP_ERR_INVALID_STATE without a site key
+ */
+esp_err_t relay_msg_build(relay_msg_t *msg, const char *ssid, const char *password, uint8_t flags,
+                          const uint8_t sender[6], const uint8_t target[6], uint32_t counter);
+
+/**
+ * @brief Checks and decrypts a received relay message
+ * @details Checks the version, that the message is for this unit, the tag,
+ * and that the strings are NUL terminated. The counter is left to
+ * site_auth_accept_counter().
+ * @param msg Received message, decrypted in place
+ * @param own_bssid Soft-AP BSSID of this unit
+ * @return true if the message can be trusted
+ */
+bool relay_msg_open(relay_msg_t *msg, const uint8_t own_bssid[6]);
+
+/**
+ * @brief Forgets the handled neighbours
+ */
+void relay_plan_init(relay_plan_t *plan);
+
+/**
+ * @brief Picks the neighbours of the next round
+ * @details At most max neighbours not handled yet, picked at random among those
+ * above RELAY_MIN_RSSI. Random picks spread over the whole radio range, so
+ * the provisioned area grows faster than with the strongest (nearest)
+ * neighbours, and relayers of one round rarely pick the same neighbour.
+ * @param plan Handled neighbours
+ * @param found Provisioning APs found by the scan
+ * @param found_count Number of APs found
+ * @param out Selected neighbours
+ * @param max Size of out
+ * @param seed Random seed
+ * @return Number of neighbours selected
+ */
+int relay_plan_select(const relay_plan_t *plan, const relay_target_t *found, int found_count,
+                      relay_target_t *out, int max, uint32_t seed);
+
+/**
+ * @brief Remembers a neighbour as handled, whatever the outcome
+ */
+void relay_plan_mark_done(relay_plan_t *plan, const uint8_t bssid[6]);
@@ -0,0 +1,131 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "scan_cache.h"
+
+static scan_cache_entry_t entries[SCAN_CACHE_SIZE];
+static int entry_count;
+static int64_t last_scan_ms;              // Start of the last scan, 0 = never scanned
+static bool scanning;                     // A caller claimed the scan
+static portMUX_TYPE cache_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Empties the cache
+ */
+void scan_cache_init(void) {
+    portENTER_CRITICAL(&cache_lock);
+    entry_count = 0;
+    last_scan_ms = 0;
+    scanning = false;
+    portEXIT_CRITICAL(&cache_lock);
+}
+
+/**
+ * @brief Decides whether a request is served by a new scan
+ * @param fresh Client asked for fresh results
+ * @param now_ms Current time in milliseconds
+ * @return true if the caller should scan
+ */
+bool scan_cache_claim_scan(bool fresh, int64_t now_ms) {
+    bool scan;
+
+    portENTER_CRITICAL(&cache_lock);
+    if (scanning) {
+        scan = false;
+    } else if (last_scan_ms == 0) {
+        scan = true;
+    } else {
+        int64_t age_ms = now_ms - last_scan_ms;
+        scan = age_ms >= SCAN_CACHE_MIN_SCAN_MS && (fresh || age_ms >= SCAN_CACHE_REFRESH_MS);
+    }
+    if (scan) {
+        scanning = true;
+        last_scan_ms = now_ms;
+    }
+    portEXIT_CRITICAL(&cache_lock);
+    return scan;
+}
+
+/**
+ * @brief Adds a scan result, duplicates of an SSID keep the strongest signal
+ */
+void scan_cache_add(const char *ssid, int8_t rssi, uint8_t channel, uint8_t authmode, int64_t now_ms) {
+    if (ssid[0] == '\0') return;
+
+    portENTER_CRITICAL(&cache_lock);
+    scan_cache_entry_t *slot = NULL;
+    for (int i = 0; i < entry_count; i++) {
+        if (strncmp(entries[i].ssid, ssid, sizeof(entries[i].ssid)) == 0) {
+            slot = &entries[i];
+            break;
+        }
+    }
+
+    if (slot) {
+        // Another BSSID of a network already seen in this scan
+        if (slot->seen_ms == now_ms && slot->rssi >= rssi) slot = NULL;
+    } else if (entry_count < SCAN_CACHE_SIZE) {
+        slot = &entries[entry_count++];
+    } else {
+        // Full: replace the weakest network if this one is stronger
+        scan_cache_entry_t *weakest = &entries[0];
+        for (int i = 1; i < entry_count; i++) {
+            if (entries[i].rssi < weakest->rssi) weakest = &entries[i];
+        }
+        if (weakest->rssi < rssi) slot = weakest;
+    }
+
+    if (slot) {
+        strncpy(slot->ssid, ssid, sizeof(slot->ssid) - 1);
+        slot->ssid[sizeof(slot->ssid) - 1] = '\0';
+        slot->rssi = rssi;
+        slot->channel = channel;
+        slot->authmode = authmode;
+        slot->seen_ms = now_ms;
+    }
+    portEXIT_CRITICAL(&cache_lock);
+}
+
+/**
+ * @brief Ends the scan claimed with scan_cache_claim_scan()
+ */
+void scan_cache_scan_done(void) {
+    portENTER_CRITICAL(&cache_lock);
+    scanning = false;
+    portEXIT_CRITICAL(&cache_lock);
+}
+
+/**
+ * @brief Lists the cached networks, strongest first
+ * @param now_ms Current time in milliseconds, aged out networks are dropped
+ * @param out Output array
+ * @param max Size of the output array
+ * @return Number of networks written
+ */
+int scan_cache_list(int64_t now_ms, scan_cache_entry_t *out, int max) {
+    int count = 0;
+
+    portENTER_CRITICAL(&cache_lock);
+    // Drop networks that have not been seen for too long
+    for (int i = 0; i < entry_count;) {
+        if (now_ms - entries[i].seen_ms >= SCAN_CACHE_MAX_AGE_MS) {
+            entries[i] = entries[--entry_count];
+        } else {
+            i++;
+        }
+    }
+
+    // Insertion sort by signal strength, the cache is small
+    for (int i = 0; i < entry_count; i++) {
+        int pos = count < max ? count : max;
+        while (pos > 0 && out[pos - 1].rssi < entries[i].rssi) {
+            if (pos < max) out[pos] = out[pos - 1];
+            pos--;
+        }
+        if (pos < max) {
+            out[pos] = entries[i];
+            if (count < max) count++;
+        }
+    }
+    portEXIT_CRITICAL(&cache_lock);
+    return count;
+}
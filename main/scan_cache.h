@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Scan cache limits
+#define SCAN_CACHE_SIZE          16       // Networks kept, the weakest are dropped first
+#define SCAN_CACHE_MAX_AGE_MS    120000   // Networks not seen for this long are dropped
+#define SCAN_CACHE_REFRESH_MS    60000    // Cached results older than this trigger a new scan
+#define SCAN_CACHE_MIN_SCAN_MS   15000    // Minimum time between scans, even when asked for fresh results
+
+/**
+ * @brief One visible network, strongest BSSID of its SSID
+ */
+typedef struct {
+    char ssid[33];                        // Network name, NUL terminated
+    int8_t rssi;                          // Signal strength in dBm
+    uint8_t channel;                      // Primary channel
+    uint8_t authmode;                     // wifi_auth_mode_t
+    int64_t seen_ms;                      // Last scan the network was seen in
+} scan_cache_entry_t;
+
+/**
+ * @brief Empties the cache
+ */
+void scan_cache_init(void);
+
+/**
+ * @brief Decides whether a request is served by a new scan
+ * @details A scan is due when the cache is empty or older than
+ * SCAN_CACHE_REFRESH_MS, or when fresh results are asked for. Scans are never
+ * closer than SCAN_CACHE_MIN_SCAN_MS, whoever asks. When true is returned the
+ * scan is claimed, other callers get the cache until scan_cache_scan_done().
+ * @param fresh Client asked for fresh results
+ * @param now_ms Current time in milliseconds
+ * @return true if the caller should scan
+ */
+bool scan_cache_claim_scan(bool fresh, int64_t now_ms);
+
+/**
+ * @brief Adds a scan result, duplicates of an SSID keep the strongest signal
+ * @param ssid Network name, hidden networks (empty name) are ignored
+ * @param rssi Signal strength in dBm
+ * @param channel Primary channel
+ * @param authmode wifi_auth_mode_t
+ * @param now_ms Time of the scan, the same for all results of one scan
+ */
+void scan_cache_add(const char *ssid, int8_t rssi, uint8_t channel, uint8_t authmode, int64_t now_ms);
+
+/**
+ * @brief Ends the scan claimed with scan_cache_claim_scan()
+ */
+void scan_cache_scan_done(void);
+
+/**
+ * @brief Lists the cached networks, strongest first
+ * @param now_ms Current time in milliseconds, aged out networks are dropped
+ * @param out Output array
+ * @param max Size of the output array
+ * @return Number of networks written
+ */
+int scan_cache_list(int64_t now_ms, scan_cache_entry_t *out, int max);
@@ -0,0 +1,81 @@
+#include <string.h>
+#include "scan_sched.h"
+
+/**
+ * @brief Number of scanned channels
+ */
+static uint8_t channel_count(const scan_sched_budget_t *budget) {
+    if (budget->last_channel < budget->first_channel) return 0;
+    return budget->last_channel - budget->first_channel + 1;
+}
+
+/**
+ * @brief Number of slices of a scan run
+ */
+uint8_t scan_sched_slices(const scan_sched_budget_t *budget) {
+    uint8_t per_slice = budget->slice_channels ? budget->slice_channels : 1;
+    return (channel_count(budget) + per_slice - 1) / per_slice;
+}
+
+/**
+ * @brief Channel range of a slice
+ * @param budget Scan budget
+ * @param slice Slice index, 0 to scan_sched_slices() - 1
+ * @param first Output: first channel of the slice
+ * @param last Output: last channel of the slice
+ */
+void scan_sched_slice(const scan_sched_budget_t *budget, uint8_t slice, uint8_t *first, uint8_t *last) {
+    uint8_t per_slice = budget->slice_channels ? budget->slice_channels : 1;
+    *first = budget->first_channel + slice * per_slice;
+    *last = *first + per_slice - 1;
+    if (*last > budget->last_channel) *last = budget->last_channel;
+}
+
+/**
+ * @brief Tells if the driver can run the budget in one scan
+ */
+bool scan_sched_driver_home(const scan_sched_budget_t *budget) {
+    return budget->slice_channels <= 1 &&
+           budget->home_ms >= SCAN_SCHED_DRIVER_HOME_MIN_MS && budget->home_ms <= SCAN_SCHED_DRIVER_HOME_MAX_MS;
+}
+
+/**
+ * @brief Simulates AP client traffic during a scan run
+ * @param budget Scan budget
+ * @param packet_interval_ms Time between client packets
+ * @param out Latency statistics
+ */
+void scan_sched_simulate(const scan_sched_budget_t *budget, uint32_t packet_interval_ms,
+                         scan_sched_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    uint8_t slices = scan_sched_slices(budget);
+    if (slices == 0 || packet_interval_ms == 0) return;
+
+    // Timeline: [off slice][home] ... [off slice], no home time after the last slice
+    uint32_t t = 0;
+    uint32_t next_packet = 0;
+    uint64_t latency_sum = 0;
+    uint32_t packets = 0;
+
+    for (uint8_t i = 0; i < slices; i++) {
+        uint8_t first, last;
+        scan_sched_slice(budget, i, &first, &last);
+        uint32_t off_start = t;
+        uint32_t off_end = t + (uint32_t)(last - first + 1) * budget->dwell_ms;
+        uint32_t home_end = off_end + (i + 1 < slices ? budget->home_ms : 0);
+
+        // Packets arriving off channel wait for the radio to come back
+        for (; next_packet < home_end; next_packet += packet_interval_ms) {
+            uint32_t latency = next_packet >= off_start && next_packet < off_end ? off_end - next_packet : 0;
+            if (latency > out->max_latency_ms) out->max_latency_ms = latency;
+            latency_sum += latency;
+            packets++;
+        }
+
+        out->off_channel_ms += off_end - off_start;
+        t = home_end;
+    }
+
+    out->scan_ms = t;
+    out->mean_latency_ms = packets ? (uint32_t)(latency_sum / packets) : 0;
+}
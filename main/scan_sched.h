@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Time budget of a scan run while soft-AP clients are served
+ * @details The scan is split into slices of slice_channels channels. Each
+ * channel is scanned for dwell_ms, then the radio returns to the AP channel for
+ * home_ms before the next slice.
+ */
+typedef struct {
+    uint16_t dwell_ms;                    // Active scan time per channel
+    uint16_t home_ms;                     // Time back on the AP channel between slices
+    uint8_t slice_channels;               // Channels scanned back to back
+    uint8_t first_channel;                // Scanned channel range
+    uint8_t last_channel;
+} scan_sched_budget_t;
+
+// At most 40 ms away from the AP channel, then 100 ms back home
+#define SCAN_SCHED_DEFAULT_BUDGET() { \
+    .dwell_ms = 40,                   \
+    .home_ms = 100,                   \
+    .slice_channels = 1,              \
+    .first_channel = 1,               \
+    .last_channel = 13,               \
+}
+
+// Range of the driver's home channel dwell time (wifi_scan_config_t.home_chan_dwell_time)
+#define SCAN_SCHED_DRIVER_HOME_MIN_MS 30
+#define SCAN_SCHED_DRIVER_HOME_MAX_MS 150
+
+/**
+ * @brief AP client traffic latency during a scan, from the radio model
+ */
+typedef struct {
+    uint32_t scan_ms;                     // Duration of the whole scan run
+    uint32_t off_channel_ms;              // Time spent away from the AP channel
+    uint32_t max_latency_ms;              // Worst extra delay of a client packet
+    uint32_t mean_latency_ms;             // Mean extra delay over all client packets
+} scan_sched_stats_t;
+
+/**
+ * @brief Number of slices of a scan run
+ */
+uint8_t scan_sched_slices(const scan_sched_budget_t *budget);
+
+/**
+ * @brief Channel range of a slice
+ * @param budget Scan budget
+ * @param slice Slice index, 0 to scan_sched_slices() - 1
+ * @param first Output: first channel of the slice
+ * @param last Output: last channel of the slice
+ */
+void scan_sched_slice(const scan_sched_budget_t *budget, uint8_t slice, uint8_t *first, uint8_t *last);
+
+/**
+ * @brief Tells if the driver can run the budget in one scan
+ * @details With home_chan_dwell_time the driver returns to the AP channel
+ * between two channels of an all-channel scan. That is the schedule of
+ * single-channel slices, without one scan start per channel. Slices of several
+ * channels and home times out of the driver range are run slice by slice.
+ */
+bool scan_sched_driver_home(const scan_sched_budget_t *budget);
+
+/**
+ * @brief Simulates AP client traffic during a scan run
+ * @details Simple radio model: client packets arrive every packet_interval_ms;
+ * a packet arriving while the radio is off the AP channel waits until it comes
+ * back. Channel switches are considered free.
+ * @param budget Scan budget
+ * @param packet_interval_ms Time between client packets
+ * @param out Latency statistics
+ */
+void scan_sched_simulate(const scan_sched_budget_t *budget, uint32_t packet_interval_ms,
+                         scan_sched_stats_t *out);
@@ -0,0 +1,208 @@
+#include <string.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/md.h"
+#include "bench.h"
+#include "site_auth.h"
+
+#define SITE_AUTH_NAMESPACE "site_auth"   // NVS namespace
+#define SITE_KEY_KEY        "hmac_key"    // NVS key of the site key
+#define COUNTER_KEY         "counter"     // NVS key of the reserved counter values
+#define PEERS_KEY           "peers"       // NVS key of the peer counters
+#define COUNTER_BLOCK       16            // Counter values reserved per NVS write
+
+// Last counter accepted from a peer
+typedef struct {
+    uint8_t id[6];
+    uint32_t counter;
+} peer_counter_t;
+
+static const char *TAG = "site_auth";                      // Logging tag
+static uint8_t site_key[SITE_KEY_SIZE];                    // Shared site key
+static uint8_t seal_key[SITE_KEY_SIZE];                    // AES-GCM key derived from site_key
+static bool has_key = false;                               // site_key is valid
+static uint32_t next_counter = 1;                          // Next message counter of this unit
+static uint32_t reserved_counter = 1;                      // Counter values below are reserved in NVS
+static peer_counter_t peers[SITE_PEERS];                   // Most recent peer first
+static int peer_count = 0;                                 // Valid entries of peers
+
+/**
+ * @brief Derives the AES-GCM key from the site key
+ * @details A separate key, so the HMAC and AES-GCM uses of the site key do
+ * not interact.
+ */
+static void derive_seal_key(void) {
+    static const char label[] = "site_auth seal";
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), site_key, sizeof(site_key),
+                    (const uint8_t *)label, sizeof(label) - 1, seal_key);
+}
+
+/**
+ * @brief Loads the site key from NVS
+ */
+esp_err_t site_auth_init(void) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SITE_AUTH_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) return ESP_OK;  // Namespace not created yet
+    if (err != ESP_OK) return err;
+
+    // Counters first, they are kept even without a key
+    nvs_get_u32(handle, COUNTER_KEY, &reserved_counter);
+    next_counter = reserved_counter;
+    size_t size = sizeof(peers);
+    if (nvs_get_blob(handle, PEERS_KEY, peers, &size) == ESP_OK) {
+        peer_count = size / sizeof(peers[0]);
+    }
+
+    size = sizeof(site_key);
+    err = nvs_get_blob(handle, SITE_KEY_KEY, site_key, &size);
+    nvs_close(handle);
+
+    if (err == ESP_ERR_NVS_NOT_FOUND) return ESP_OK;
+    if (err != ESP_OK) return err;
+    has_key = size == sizeof(site_key);
+    if (has_key) derive_seal_key();
+    ESP_LOGI(TAG, "Site key %s", has_key ? "loaded" : "has a wrong size, ignored");
+    return ESP_OK;
+}
+
+/**
+ * @brief Returns true if a site key is installed
+ */
+bool site_auth_has_key(void) {
+    return has_key;
+}
+
+/**
+ * @brief Installs the site key and saves it to NVS
+ */
+esp_err_t site_auth_set_key(const uint8_t key[SITE_KEY_SIZE]) {
+    if (has_key) return ESP_ERR_INVALID_STATE;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SITE_AUTH_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(handle, SITE_KEY_KEY, key, SITE_KEY_SIZE);
+    if (err == ESP_OK) err = nvs_commit(handle);
+    if (err == ESP_OK) bench_add("nvs.commits", 1);
+    nvs_close(handle);
+    if (err != ESP_OK) return err;
+
+    memcpy(site_key, key, SITE_KEY_SIZE);
+    derive_seal_key();
+    has_key = true;
+    ESP_LOGI(TAG, "Site key installed");
+    return ESP_OK;
+}
+
+/**
+ * @brief Computes the HMAC-SHA256 tag of a message with the site key
+ */
+esp_err_t site_auth_sign(const void *msg, size_t len, uint8_t mac[SITE_MAC_SIZE]) {
+    if (!has_key) return ESP_ERR_INVALID_STATE;
+    int ret = mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), site_key, sizeof(site_key),
+                              msg, len, mac);
+    return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Checks the HMAC-SHA256 tag of a message in constant time
+ */
+bool site_auth_verify(const void *msg, size_t len, const uint8_t mac[SITE_MAC_SIZE]) {
+    uint8_t expected[SITE_MAC_SIZE];
+    if (site_auth_sign(msg, len, expected) != ESP_OK) return false;
+
+    uint8_t diff = 0;
+    for (int i = 0; i < SITE_MAC_SIZE; i++) {
+        diff |= expected[i] ^ mac[i];
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief Encrypts and authenticates a message with AES-256-GCM
+ */
+esp_err_t site_auth_seal(const uint8_t nonce[SITE_NONCE_SIZE], const void *aad, size_t aad_len,
+                         void *data, size_t len, uint8_t tag[SITE_TAG_SIZE]) {
+    if (!has_key) return ESP_ERR_INVALID_STATE;
+
+    mbedtls_gcm_context gcm;
+    mbedtls_gcm_init(&gcm);
+    int ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, seal_key, 8 * sizeof(seal_key));
+    if (ret == 0) {
+        ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, nonce, SITE_NONCE_SIZE, aad, aad_len,
+                                        data, data, SITE_TAG_SIZE, tag);
+    }
+    mbedtls_gcm_free(&gcm);
+    return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Checks and decrypts a message sealed by site_auth_seal()
+ */
+bool site_auth_open(const uint8_t nonce[SITE_NONCE_SIZE], const void *aad, size_t aad_len,
+                    void *data, size_t len, const uint8_t tag[SITE_TAG_SIZE]) {
+    if (!has_key) return false;
+
+    mbedtls_gcm_context gcm;
+    mbedtls_gcm_init(&gcm);
+    int ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, seal_key, 8 * sizeof(seal_key));
+    if (ret == 0) {
+        ret = mbedtls_gcm_auth_decrypt(&gcm, len, nonce, SITE_NONCE_SIZE, aad, aad_len, tag, SITE_TAG_SIZE,
+                                       data, data);
+    }
+    mbedtls_gcm_free(&gcm);
+    return ret == 0;
+}
+
+/**
+ * @brief Returns the next value of this unit's message counter
+ */
+esp_err_t site_auth_next_counter(uint32_t *counter) {
+    if (next_counter == reserved_counter) {
+        nvs_handle_t handle;
+        esp_err_t err = nvs_open(SITE_AUTH_NAMESPACE, NVS_READWRITE, &handle);
+        if (err != ESP_OK) return err;
+        err = nvs_set_u32(handle, COUNTER_KEY, reserved_counter + COUNTER_BLOCK);
+        if (err == ESP_OK) err = nvs_commit(handle);
+        if (err == ESP_OK) bench_add("nvs.commits", 1);
+        nvs_close(handle);
+        if (err != ESP_OK) return err;
+        reserved_counter += COUNTER_BLOCK;
+    }
+    *counter = next_counter++;
+    return ESP_OK;
+}
+
+/**
+ * @brief Accepts the counter of an authenticated message from a peer
+ */
+esp_err_t site_auth_accept_counter(const uint8_t peer[6], uint32_t counter) {
+    int i = 0;
+    while (i < peer_count && memcmp(peers[i].id, peer, 6) != 0) i++;
+    if (i < peer_count && counter <= peers[i].counter) return ESP_ERR_INVALID_STATE;
+
+    // Most recent first, the least recent peer goes when the table is full
+    peer_counter_t updated[SITE_PEERS];
+    int count = i == peer_count && peer_count < SITE_PEERS ? peer_count + 1 : peer_count;
+    if (i == SITE_PEERS) i--;
+    memcpy(updated[0].id, peer, 6);
+    updated[0].counter = counter;
+    memcpy(&updated[1], &peers[0], i * sizeof(peers[0]));
+    memcpy(&updated[i + 1], &peers[i + 1], (count - i - 1) * sizeof(peers[0]));
+
+    // Saved before it counts, a reset must not forget an accepted counter
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SITE_AUTH_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(handle, PEERS_KEY, updated, count * sizeof(updated[0]));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    if (err == ESP_OK) bench_add("nvs.commits", 1);
+    nvs_close(handle);
+    if (err != ESP_OK) return err;
+
+    memcpy(peers, updated, count * sizeof(updated[0]));
+    peer_count = count;
+    return ESP_OK;
+}
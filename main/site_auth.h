@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define SITE_KEY_SIZE  32                 // HMAC-SHA256 key shared by the units of a site
+#define SITE_MAC_SIZE  32                 // HMAC-SHA256 tag
+#define SITE_NONCE_SIZE 12                // AES-GCM nonce
+#define SITE_TAG_SIZE  16                 // AES-GCM tag
+#define SITE_PEERS     8                  // Senders whose last counter is remembered
+
+// Site key sent over the provisioning protocol, off unless built with
+// `idf.py -DSITE_KEY_PROVISIONING=1 build`, see main/CMakeLists.txt
+#ifndef SITE_KEY_PROVISIONING
+#define SITE_KEY_PROVISIONING 0
+#endif
+
+/**
+ * @brief Loads the site key from NVS
+ * @details NVS must be initialized. A missing key is not an error, units
+ * without a key reject every authenticated message.
+ * @return ESP_OK if successful, the failing NVS error otherwise
+ */
+esp_err_t site_auth_init(void);
+
+/**
+ * @brief Returns true if a site key is installed
+ */
+bool site_auth_has_key(void);
+
+/**
+ * @brief Installs the site key and saves it to NVS
+ * @details The key can only be set once, so a visitor on the provisioning AP
+ * can not replace the key of a unit that already has one. Over the
+ * provisioning protocol whoever comes first sets it, so that path is only
+ * built with SITE_KEY_PROVISIONING; production units get their key in NVS at
+ * manufacturing.
+ * @param key Site key
+ * @return ESP_OK if successful, ESP_ERR_INVALID_STATE if a key is already
+ * installed, the failing NVS error otherwise
+ */
+esp_err_t site_auth_set_key(const uint8_t key[SITE_KEY_SIZE]);
+
+/**
+ * @brief Computes the HMAC-SHA256 tag of a message with the site key
+ * @param msg Message
+ * @param len Message length
+ * @param mac Output tag
+ * @return ESP_OK if successful, ESP_ERR_INVALID_STATE without a site key
+ */
+esp_err_t site_auth_sign(const void *msg, size_t len, uint8_t mac[SITE_MAC_SIZE]);
+
+/**
+ * @brief Checks the HMAC-SHA256 tag of a message in constant time
+ * @return true if the tag is valid
+ */
+bool site_auth_verify(const void *msg, size_t len, const uint8_t mac[SITE_MAC_SIZE]);
+
+/**
+ * @brief Encrypts and authenticates a message with AES-256-GCM
+ * @details The key is derived from the site key. A nonce must never be used
+ * twice with the same site key.
+ * @param nonce Unique nonce
+ * @param aad Data authenticated but not encrypted
+ * @param aad_len Length of aad
+ * @param data Data encrypted in place
+ * @param len Length of data
+ * @param tag Output tag
+ * @return ESP_OK if successful, ESP_ERR_INVALID_STATE without a site key
+ */
+esp_err_t site_auth_seal(const uint8_t nonce[SITE_NONCE_SIZE], const void *aad, size_t aad_len,
+                         void *data, size_t len, uint8_t tag[SITE_TAG_SIZE]);
+
+/**
+ * @brief Checks and decrypts a message sealed by site_auth_seal()
+ * @details data is decrypted in place; it is zeroed if the tag is wrong.
+ * @return true if the tag is valid
+ */
+bool site_auth_open(const uint8_t nonce[SITE_NONCE_SIZE], const void *aad, size_t aad_len,
+                    void *data, size_t len, const uint8_t tag[SITE_TAG_SIZE]);
+
+/**
+ * @brief Returns the next value of this unit's message counter
+ * @details The counter only increases, also across resets: values are
+ * reserved in NVS by blocks, a reset skips the rest of the block.
+ * @param counter Output counter, never 0
+ * @return ESP_OK if successful, the failing NVS error otherwise
+ */
+esp_err_t site_auth_next_counter(uint32_t *counter);
+
+/**
+ * @brief Accepts the counter of an authenticated message from a peer
+ * @details A counter is accepted if it is higher than the last one accepted
+ * from the same peer, and then saved to NVS. The last SITE_PEERS peers are
+ * remembered; a message of a forgotten peer is accepted like a first one.
+ * Call it after the tag check, so forged messages can not move the counter.
+ * @param peer Sender identity, its STA MAC
+ * @param counter Counter of the message
+ * @return ESP_OK if accepted, ESP_ERR_INVALID_STATE for a replayed counter,
+ * the failing NVS error otherwise
+ */
+esp_err_t site_auth_accept_counter(const uint8_t peer[6], uint32_t counter);
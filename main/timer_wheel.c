@@ -0,0 +1,210 @@
+#include <string.h>
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define EXPIRED_SLOT (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS) // timer_wheel_timer_t.slot of the expired list
+
+/**
+ * @brief Links a timer at the head of a list
+ */
+static void link_timer(timer_wheel_timer_t **head, timer_wheel_timer_t *timer) {
+    timer->next = *head;
+    if (timer->next) timer->next->pprev = &timer->next;
+    *head = timer;
+    timer->pprev = head;
+}
+
+/**
+ * @brief Puts a timer into the slot its distance to the wheel time calls for
+ */
+static void place(timer_wheel_t *wheel, timer_wheel_timer_t *timer) {
+    // Overdue timers are due on the tick processed next
+    if (timer->expires < wheel->now) timer->expires = wheel->now;
+    uint64_t at = timer->expires;
+    uint64_t delta = at - wheel->now;
+    int level = 0;
+
+    if (delta > TIMER_WHEEL_MAX_DELAY) {
+        // Waits in the last level, placed again when that slot is spread
+        at = wheel->now + TIMER_WHEEL_MAX_DELAY;
+        level = TIMER_WHEEL_LEVELS - 1;
+    } else {
+        while (level < TIMER_WHEEL_LEVELS - 1 && delta >> (TIMER_WHEEL_BITS * (level + 1))) level++;
+    }
+
+    int index = (at >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK;
+    link_timer(&wheel->slots[level][index], timer);
+    timer->slot = level * TIMER_WHEEL_SLOTS + index;
+    wheel->occupied[level] |= 1ULL << index;
+}
+
+/**
+ * @brief Unlinks a pending timer
+ */
+static void unlink_timer(timer_wheel_t *wheel, timer_wheel_timer_t *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->pprev = NULL;
+    wheel->count--;
+
+    if (timer->slot == EXPIRED_SLOT) return;
+    int level = timer->slot / TIMER_WHEEL_SLOTS;
+    int index = timer->slot % TIMER_WHEEL_SLOTS;
+    if (!wheel->slots[level][index]) wheel->occupied[level] &= ~(1ULL << index);
+}
+
+/**
+ * @brief Takes the whole list of a slot out of the wheel
+ */
+static timer_wheel_timer_t *take_slot(timer_wheel_t *wheel, int level, int index) {
+    timer_wheel_timer_t *list = wheel->slots[level][index];
+    wheel->slots[level][index] = NULL;
+    wheel->occupied[level] &= ~(1ULL << index);
+    return list;
+}
+
+/**
+ * @brief Processes the tick wheel->now: spreads higher slots that are due, moves the due timers out
+ */
+static void process_tick(timer_wheel_t *wheel) {
+    uint64_t tick = wheel->now;
+
+    // On a level 0 wrap the next slot of level 1 comes down, on a level 1 wrap level 2 too, ...
+    if ((tick & SLOT_MASK) == 0) {
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            int index = (tick >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK;
+            timer_wheel_timer_t *timer = take_slot(wheel, level, index);
+            while (timer) {
+                timer_wheel_timer_t *next = timer->next;
+                place(wheel, timer);
+                timer = next;
+            }
+            if (index != 0) break;
+        }
+    }
+
+    timer_wheel_timer_t *timer = take_slot(wheel, 0, tick & SLOT_MASK);
+    while (timer) {
+        timer_wheel_timer_t *next = timer->next;
+        link_timer(&wheel->expired, timer);
+        timer->slot = EXPIRED_SLOT;
+        timer = next;
+    }
+    wheel->now = tick + 1;
+}
+
+/**
+ * @brief Rotates the occupancy bits so that bit 0 is slot start
+ */
+static uint64_t rotate(uint64_t bits, int start) {
+    return start ? (bits >> start) | (bits << (TIMER_WHEEL_SLOTS - start)) : bits;
+}
+
+/**
+ * @brief Initializes an empty wheel
+ * @param wheel Wheel to initialize
+ * @param now Current tick
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+/**
+ * @brief Initializes a timer, not pending
+ * @param timer Timer to initialize
+ * @param callback Called by the wheel user when the timer is handed out
+ * @param arg Passed to callback
+ */
+void timer_wheel_timer_init(timer_wheel_timer_t *timer, timer_wheel_cb_t callback, void *arg) {
+    memset(timer, 0, sizeof(*timer));
+    timer->callback = callback;
+    timer->arg = arg;
+}
+
+/**
+ * @brief Schedules a timer, moving it if it is already pending
+ * @param wheel Wheel
+ * @param timer Timer
+ * @param expires Tick it is due; a past tick makes it due on the next expiry
+ * @param period Ticks between expiries of a periodic timer, 0 for one-shot
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint64_t expires, uint32_t period) {
+    if (timer->pprev) unlink_timer(wheel, timer);
+    timer->expires = expires;
+    timer->period = period;
+    place(wheel, timer);
+    wheel->count++;
+}
+
+/**
+ * @brief Cancels a pending timer
+ * @return true if it was pending
+ */
+bool timer_wheel_cancel(timer_wheel_t *wheel, timer_wheel_timer_t *timer) {
+    if (!timer->pprev) return false;
+    unlink_timer(wheel, timer);
+    return true;
+}
+
+/**
+ * @brief Advances the wheel up to a tick and hands out one due timer
+ * @param wheel Wheel
+ * @param now Current tick
+ * @return A due timer, NULL once none is left up to now
+ */
+timer_wheel_timer_t *timer_wheel_expire(timer_wheel_t *wheel, uint64_t now) {
+    while (!wheel->expired) {
+        uint64_t next;
+        if (wheel->now > now) return NULL;
+        if (!timer_wheel_next(wheel, &next) || next > now) {
+            // Nothing to do before now: skip the empty ticks
+            wheel->now = now + 1;
+            return NULL;
+        }
+        if (next > wheel->now) wheel->now = next;
+        process_tick(wheel);
+    }
+
+    timer_wheel_timer_t *timer = wheel->expired;
+    unlink_timer(wheel, timer);
+    if (timer->period) {
+        // Periods missed while the wheel was not driven are skipped, not caught up
+        uint64_t expires = timer->expires + timer->period;
+        if (expires < wheel->now) expires += (wheel->now - expires + timer->period - 1) / timer->period * timer->period;
+        timer_wheel_add(wheel, timer, expires, timer->period);
+    }
+    return timer;
+}
+
+/**
+ * @brief Returns the tick at which the wheel has work next
+ * @param wheel Wheel
+ * @param tick Receives the tick
+ * @return false if no timer is pending
+ */
+bool timer_wheel_next(const timer_wheel_t *wheel, uint64_t *tick) {
+    uint64_t now = wheel->now;
+    uint64_t best = UINT64_MAX;
+
+    if (wheel->count == 0) return false;
+    if (wheel->expired) {
+        *tick = now;
+        return true;
+    }
+
+    // Level 0: the first occupied slot from the current one is due at once
+    if (wheel->occupied[0]) {
+        best = now + __builtin_ctzll(rotate(wheel->occupied[0], now & SLOT_MASK));
+    }
+    // Higher levels: the first occupied slot is spread at its next boundary
+    for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if (!wheel->occupied[level]) continue;
+        int shift = TIMER_WHEEL_BITS * level;
+        uint64_t boundary = (now + (1ULL << shift) - 1) >> shift;
+        uint64_t spread = (boundary + __builtin_ctzll(rotate(wheel->occupied[level], boundary & SLOT_MASK))) << shift;
+        if (spread < best) best = spread;
+    }
+    *tick = best;
+    return true;
+}
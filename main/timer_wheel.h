@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_BITS   6                                // Slots per level: 64
+#define TIMER_WHEEL_SLOTS  (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4                                // Reach: 64^4 ticks, longer ones wait in the last level
+#define TIMER_WHEEL_MAX_DELAY ((1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+typedef void (*timer_wheel_cb_t)(void *arg);
+
+/**
+ * @brief A timer, owned by the caller and linked into the wheel while pending
+ */
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer *next;
+    struct timer_wheel_timer **pprev;     // Link pointing at this timer, NULL while not pending
+    uint64_t expires;                     // Tick it is due
+    uint32_t period;                      // Ticks, 0 for a one-shot timer
+    uint16_t slot;                        // level * TIMER_WHEEL_SLOTS + index, or the expired list
+    timer_wheel_cb_t callback;
+    void *arg;
+} timer_wheel_timer_t;
+
+/**
+ * @brief Hierarchical timing wheel
+ * @details Level 0 holds the timers due within 64 ticks, one slot per tick.
+ * Each further level covers 64 times the span of the one below, one slot per
+ * span of the level below. When level 0 wraps, the next slot of level 1 is
+ * spread over level 0, and so on up: a timer moves down at most
+ * TIMER_WHEEL_LEVELS - 1 times. Insert and cancel are O(1).
+ *
+ * Pure logic without driver calls, shared by the firmware (conn_timer.c) and
+ * the host benchmark (tools/timer_wheel_bench.c). The caller serializes
+ * access and supplies the tick.
+ */
+typedef struct {
+    uint64_t now;                         // Next tick to process
+    uint64_t occupied[TIMER_WHEEL_LEVELS]; // Bit per non-empty slot
+    timer_wheel_timer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    timer_wheel_timer_t *expired;         // Due, not handed out yet
+    uint32_t count;                       // Pending timers
+} timer_wheel_t;
+
+/**
+ * @brief Initializes an empty wheel
+ * @param wheel Wheel to initialize
+ * @param now Current tick
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now);
+
+/**
+ * @brief Initializes a timer, not pending
+ * @param timer Timer to initialize
+ * @param callback Called by the wheel user when the timer is handed out
+ * @param arg Passed to callback
+ */
+void timer_wheel_timer_init(timer_wheel_timer_t *timer, timer_wheel_cb_t callback, void *arg);
+
+/**
+ * @brief Schedules a timer, moving it if it is already pending
+ * @param wheel Wheel
+ * @param timer Timer
+ * @param expires Tick it is due; a past tick is moved to the next tick processed
+ * @param period Ticks between expiries of a periodic timer, 0 for one-shot
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint64_t expires, uint32_t period);
+
+/**
+ * @brief Cancels a pending timer
+ * @return true if it was pending
+ */
+bool timer_wheel_cancel(timer_wheel_t *wheel, timer_wheel_timer_t *timer);
+
+/**
+ * @brief Tells if a timer is pending
+ */
+static inline bool timer_wheel_pending(const timer_wheel_timer_t *timer) {
+    return timer->pprev != 0;
+}
+
+/**
+ * @brief Advances the wheel up to a tick and hands out one due timer
+ * @details Call until it returns NULL, then run the callbacks of the timers
+ * handed out, in order. A one-shot timer is no longer pending when handed
+ * out; a periodic one is already scheduled for its next period, counted from
+ * the tick it was due so that it does not drift. Periods that passed while
+ * the wheel was not driven are skipped.
+ * @param wheel Wheel
+ * @param now Current tick
+ * @return A due timer, NULL once none is left up to now
+ */
+timer_wheel_timer_t *timer_wheel_expire(timer_wheel_t *wheel, uint64_t now);
+
+/**
+ * @brief Returns the tick at which the wheel has work next
+ * @details Either a timer is due or a higher level slot is spread; the
+ * wheel's driver sleeps until then. O(TIMER_WHEEL_LEVELS).
+ * @param wheel Wheel
+ * @param tick Receives the tick
+ * @return false if no timer is pending
+ */
+bool timer_wheel_next(const timer_wheel_t *wheel, uint64_t *tick);
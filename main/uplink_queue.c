@@ -0,0 +1,467 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "nvs.h"
+#include "lwip/sockets.h"
+#include "uplink_queue.h"
+
+#define LINK_UP_BIT       BIT0            // STA link is usable
+#define DATA_BIT          BIT1            // Records are waiting
+#define FLASH_SECTOR_SIZE 4096            // Erase unit of the spill log
+#define RETRY_DELAY_MS    2000            // Pause after a failed connect or send
+#define SEND_TIMEOUT_S    5               // Give up on a stalled sink after this
+#define UPLINK_NAMESPACE  "uplink"        // NVS namespace
+#define LOG_KEY           "log"           // Head and tail of the flash log
+#define SINK_HOST_KEY     "sink_host"     // Configured sink address
+#define SINK_PORT_KEY     "sink_port"     // Configured sink port
+
+#define SECTOR_ALIGN(pos) (((pos) + FLASH_SECTOR_SIZE - 1) & ~(uint32_t)(FLASH_SECTOR_SIZE - 1))
+
+// Flash log bounds as stored in NVS
+typedef struct {
+    uint32_t head;                        // Oldest byte not accepted by the sink
+    uint32_t tail;                        // End of the last spill, sector aligned
+} log_state_t;
+
+static const char *TAG = "uplink_queue";                   // Logging tag
+static EventGroupHandle_t queue_events;                    // LINK_UP_BIT and DATA_BIT
+static SemaphoreHandle_t queue_lock;                       // Protects everything below
+static uplink_queue_stats_t stats;                         // Counters
+static uplink_queue_config_t sink;                         // Sink address
+static bool sink_changed = false;                          // Reconnect to the new sink
+
+// RAM ring holding length-prefixed records
+static uint8_t ram_ring[UPLINK_RAM_SIZE];
+static size_t ram_head = 0;                                // Oldest byte
+static size_t ram_used = 0;                                // Bytes in the ring
+
+// Flash log the RAM ring spills into, drained before the ring. Every spill
+// starts on a sector boundary, the erased rest of its last sector is padding.
+static const esp_partition_t *spill_partition;
+static uint32_t flash_acked = 0;                           // Oldest byte the sink has not accepted
+static uint32_t flash_read = 0;                            // Oldest byte not taken into a batch
+static uint32_t flash_write = 0;                           // Next free byte, sector aligned
+static uint32_t flash_erased = 0;                          // Sectors below this are erased
+
+// Batch in flight, kept until the sink accepted it so nothing is lost on errors
+static uint8_t batch[UPLINK_BATCH_SIZE];
+static size_t batch_len = 0;
+static bool batch_from_flash = false;                      // Acknowledge up to batch_flash_end
+static uint32_t batch_flash_end = 0;
+
+/**
+ * @brief Copies bytes into the RAM ring at its tail
+ */
+static void ring_write(const uint8_t *data, size_t len) {
+    size_t tail = (ram_head + ram_used) % UPLINK_RAM_SIZE;
+    size_t first = UPLINK_RAM_SIZE - tail;
+    if (first > len) first = len;
+
+    memcpy(&ram_ring[tail], data, first);
+    memcpy(ram_ring, data + first, len - first);
+    ram_used += len;
+}
+
+/**
+ * @brief Copies bytes from the head of the RAM ring without removing them
+ */
+static void ring_peek(uint8_t *out, size_t len) {
+    size_t first = UPLINK_RAM_SIZE - ram_head;
+    if (first > len) first = len;
+
+    memcpy(out, &ram_ring[ram_head], first);
+    memcpy(out + first, ram_ring, len - first);
+}
+
+/**
+ * @brief Removes bytes from the head of the RAM ring
+ */
+static void ring_consume(size_t len) {
+    ram_head = (ram_head + len) % UPLINK_RAM_SIZE;
+    ram_used -= len;
+}
+
+/**
+ * @brief Trims a buffer of length-prefixed records to whole records
+ * @return Length of the complete records at the start of the buffer
+ */
+static size_t whole_records(const uint8_t *buf, size_t len) {
+    size_t pos = 0;
+    while (pos + 2 <= len) {
+        size_t record = 2 + (((size_t)buf[pos] << 8) | buf[pos + 1]);
+        if (pos + record > len) break;
+        pos += record;
+    }
+    return pos;
+}
+
+/**
+ * @brief Saves the flash log bounds, called with queue_lock held
+ * @details Called once per spill and once per batch sent from flash, so NVS
+ * sees one write per few KB of logged data.
+ */
+static void save_log_state(void) {
+    log_state_t state = { .head = flash_acked, .tail = flash_write };
+    nvs_handle_t handle;
+
+    if (nvs_open(UPLINK_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return;
+    if (nvs_set_blob(handle, LOG_KEY, &state, sizeof(state)) != ESP_OK || nvs_commit(handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save the flash log bounds!");
+    }
+    nvs_close(handle);
+}
+
+/**
+ * @brief Reads back the unsent part of the flash log after a reset
+ * @details The tail is saved only once a spill is fully written, so a spill
+ * cut short by the reset is not part of the log, and its sectors are erased
+ * again before the next one.
+ */
+static void recover_log_state(void) {
+    log_state_t state = { 0 };
+    size_t size = sizeof(state);
+    nvs_handle_t handle;
+
+    if (nvs_open(UPLINK_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_blob(handle, LOG_KEY, &state, &size);
+        nvs_close(handle);
+    }
+    if (size != sizeof(state) || state.tail > spill_partition->size || state.tail % FLASH_SECTOR_SIZE != 0 ||
+        state.head >= state.tail) {
+        return;
+    }
+
+    flash_acked = flash_read = state.head;
+    flash_write = flash_erased = state.tail;
+    ESP_LOGI(TAG, "Recovered %u unsent bytes from the flash log", (unsigned)(state.tail - state.head));
+}
+
+/**
+ * @brief Appends the whole RAM ring to the flash log in one write
+ * @return ESP_OK if the ring is empty afterwards
+ */
+static esp_err_t spill_ram_to_flash(void) {
+    size_t len = ram_used;
+    esp_err_t err;
+
+    if (!spill_partition || flash_write + len > spill_partition->size) return ESP_ERR_NO_MEM;
+
+    // Erase the sectors the write is going to reach
+    uint32_t end = flash_write + len;
+    if (end > flash_erased) {
+        uint32_t erase_end = SECTOR_ALIGN(end);
+        err = esp_partition_erase_range(spill_partition, flash_erased, erase_end - flash_erased);
+        if (err != ESP_OK) return err;
+        flash_erased = erase_end;
+    }
+
+    // The ring is at most two contiguous pieces
+    size_t first = UPLINK_RAM_SIZE - ram_head;
+    if (first > len) first = len;
+    err = esp_partition_write(spill_partition, flash_write, &ram_ring[ram_head], first);
+    if (err == ESP_OK && len > first) {
+        err = esp_partition_write(spill_partition, flash_write + first, ram_ring, len - first);
+    }
+    if (err != ESP_OK) return err;
+
+    ESP_LOGI(TAG, "RAM ring full, spilled %u bytes to flash", (unsigned)len);
+    flash_write = SECTOR_ALIGN(flash_write + len);
+    ram_head = 0;
+    ram_used = 0;
+    save_log_state();
+    return ESP_OK;
+}
+
+/**
+ * @brief Queues one record for the sink
+ * @param data Record bytes
+ * @param len Record length, at most UPLINK_MAX_RECORD
+ * @return ESP_OK if queued, ESP_ERR_INVALID_SIZE or ESP_ERR_NO_MEM otherwise
+ */
+esp_err_t uplink_queue_push(const void *data, size_t len) {
+    uint8_t header[2] = { (uint8_t)(len >> 8), (uint8_t)len };
+
+    if (len == 0 || len > UPLINK_MAX_RECORD) return ESP_ERR_INVALID_SIZE;
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    if (ram_used + sizeof(header) + len > UPLINK_RAM_SIZE && spill_ram_to_flash() != ESP_OK) {
+        stats.records_dropped++;
+        xSemaphoreGive(queue_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    ring_write(header, sizeof(header));
+    ring_write(data, len);
+    stats.records_queued++;
+    xEventGroupSetBits(queue_events, DATA_BIT);
+    xSemaphoreGive(queue_lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Takes the next batch of whole records, oldest (flash) first
+ * @return true if a batch is ready in the batch buffer
+ */
+static bool fill_batch(void) {
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+
+    batch_from_flash = false;
+    while (batch_len == 0 && flash_write > flash_read) {
+        size_t len = flash_write - flash_read;
+        if (len > sizeof(batch)) len = sizeof(batch);
+        if (esp_partition_read(spill_partition, flash_read, batch, len) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to read the flash log, discarding %u bytes!",
+                     (unsigned)(flash_write - flash_read));
+            flash_acked = flash_read = flash_write = flash_erased = 0;
+            save_log_state();
+            break;
+        }
+        batch_len = whole_records(batch, len);
+        flash_read += batch_len;
+
+        // Erased padding (a 0xFFFF length) up to the sector of the next spill
+        size_t rest = len - batch_len;
+        if ((rest >= 2 && batch[batch_len] == 0xFF && batch[batch_len + 1] == 0xFF) ||
+            (rest == 1 && flash_read + rest == flash_write)) {
+            flash_read = SECTOR_ALIGN(flash_read);
+        } else if (batch_len == 0) {
+            ESP_LOGE(TAG, "Flash log corrupt, discarding %u bytes!", (unsigned)(flash_write - flash_read));
+            flash_read = flash_write;
+        }
+
+        if (batch_len > 0) {
+            batch_from_flash = true;
+            batch_flash_end = flash_read;
+        } else {
+            // Nothing in flight, the padding needs no acknowledgement
+            flash_acked = flash_read;
+            if (flash_acked == flash_write) flash_acked = flash_read = flash_write = flash_erased = 0;
+            save_log_state();
+        }
+    }
+
+    if (batch_len == 0 && ram_used > 0) {
+        size_t len = ram_used;
+        if (len > sizeof(batch)) len = sizeof(batch);
+
+        // Only whole records leave the ring
+        ring_peek(batch, len);
+        batch_len = whole_records(batch, len);
+        ring_consume(batch_len);
+    }
+
+    // Clearing under the lock so a concurrent push can not be missed
+    if (batch_len == 0 && ram_used == 0 && flash_write == flash_read) {
+        xEventGroupClearBits(queue_events, DATA_BIT);
+    }
+    xSemaphoreGive(queue_lock);
+
+    return batch_len > 0;
+}
+
+/**
+ * @brief Opens a TCP connection to the sink
+ * @return Socket descriptor, -1 if failed
+ */
+static int connect_sink(void) {
+    struct sockaddr_in dest_addr = {0};
+    uplink_queue_config_t target;
+
+    uplink_queue_get_sink(&target);
+    dest_addr.sin_addr.s_addr = inet_addr(target.host);
+    dest_addr.sin_family = AF_INET;
+    dest_addr.sin_port = htons(target.port);
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) return -1;
+
+    struct timeval timeout = { .tv_sec = SEND_TIMEOUT_S };
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    if (connect(sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr)) != 0) {
+        ESP_LOGW(TAG, "Sink %s:%u unreachable! Error: %d", target.host, target.port, errno);
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/**
+ * @brief Sends the whole buffer
+ * @return true if every byte was accepted
+ */
+static bool send_all(int sock, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        int sent = send(sock, data, len, 0);
+        if (sent <= 0) return false;
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+/**
+ * @brief Drain task: sends batches while the link is up and records are waiting
+ */
+static void uplink_drain_task(void *pvParameters) {
+    int sock = -1;
+
+    while (1) {
+        xEventGroupWaitBits(queue_events, LINK_UP_BIT | DATA_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+
+        // A batch that failed before is resent first to keep the order
+        if (batch_len == 0 && !fill_batch()) continue;
+
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        bool reconnect = sink_changed;
+        sink_changed = false;
+        xSemaphoreGive(queue_lock);
+        if (reconnect && sock >= 0) {
+            close(sock);
+            sock = -1;
+        }
+
+        if (sock < 0) {
+            sock = connect_sink();
+            if (sock < 0) {
+                vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS));
+                continue;
+            }
+        }
+
+        if (!send_all(sock, batch, batch_len)) {
+            ESP_LOGW(TAG, "Send failed, keeping %u bytes for the next connection", (unsigned)batch_len);
+            close(sock);
+            sock = -1;
+            vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS));
+            continue;
+        }
+
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        stats.batches_sent++;
+        stats.bytes_sent += batch_len;
+        if (batch_from_flash) {
+            flash_acked = batch_flash_end;
+            // Fully drained: start over, sectors are erased again on the next spill
+            if (flash_acked == flash_write) flash_acked = flash_read = flash_write = flash_erased = 0;
+            save_log_state();
+        }
+        xSemaphoreGive(queue_lock);
+        batch_len = 0;
+    }
+}
+
+/**
+ * @brief Reads the sink stored by uplink_queue_set_sink(), if any
+ */
+static void load_sink(void) {
+    nvs_handle_t handle;
+    uplink_queue_config_t stored;
+    size_t size = sizeof(stored.host);
+
+    if (nvs_open(UPLINK_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
+    if (nvs_get_str(handle, SINK_HOST_KEY, stored.host, &size) == ESP_OK &&
+        nvs_get_u16(handle, SINK_PORT_KEY, &stored.port) == ESP_OK) {
+        sink = stored;
+    }
+    nvs_close(handle);
+}
+
+/**
+ * @brief Initializes the queue and starts the drain task
+ * @param config Default sink address, copied
+ * @return ESP_OK if successful, ESP_ERR_NOT_FOUND if the spill partition is missing
+ */
+esp_err_t uplink_queue_init(const uplink_queue_config_t *config) {
+    sink = *config;
+    load_sink();
+    queue_events = xEventGroupCreate();
+    queue_lock = xSemaphoreCreateMutex();
+    if (!queue_events || !queue_lock) return ESP_ERR_NO_MEM;
+
+    spill_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                               UPLINK_PARTITION);
+    if (!spill_partition) {
+        ESP_LOGE(TAG, "Partition '%s' not found!", UPLINK_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    recover_log_state();
+    if (flash_write > flash_read) xEventGroupSetBits(queue_events, DATA_BIT);
+
+    // Stack size: 3072 bytes, Priority: 4 (below the TCP server)
+    if (xTaskCreate(uplink_drain_task, "uplink_drain", 3072, NULL, 4, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Changes the sink and saves it to NVS
+ * @param config New sink address, copied
+ * @return ESP_OK if successful, ESP_ERR_INVALID_ARG for a bad address, the NVS error otherwise
+ */
+esp_err_t uplink_queue_set_sink(const uplink_queue_config_t *config) {
+    nvs_handle_t handle;
+
+    if (config->port == 0 || memchr(config->host, '\0', sizeof(config->host)) == NULL ||
+        inet_addr(config->host) == INADDR_NONE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!queue_lock) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = nvs_open(UPLINK_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+    err = nvs_set_str(handle, SINK_HOST_KEY, config->host);
+    if (err == ESP_OK) err = nvs_set_u16(handle, SINK_PORT_KEY, config->port);
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+    if (err != ESP_OK) return err;
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    sink = *config;
+    sink_changed = true;
+    xSemaphoreGive(queue_lock);
+    ESP_LOGI(TAG, "Sink set to %s:%u", config->host, config->port);
+    return ESP_OK;
+}
+
+/**
+ * @brief Reads the sink in use
+ */
+void uplink_queue_get_sink(uplink_queue_config_t *config) {
+    if (!queue_lock) {
+        *config = sink;
+        return;
+    }
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    *config = sink;
+    xSemaphoreGive(queue_lock);
+}
+
+/**
+ * @brief Gates the drain task on the connection state
+ * @param up true once the STA link is usable, false when it goes away
+ */
+void uplink_queue_set_link_up(bool up) {
+    if (!queue_events) return;
+    if (up) {
+        xEventGroupSetBits(queue_events, LINK_UP_BIT);
+    } else {
+        xEventGroupClearBits(queue_events, LINK_UP_BIT);
+    }
+}
+
+/**
+ * @brief Reads the queue counters
+ */
+void uplink_queue_get_stats(uplink_queue_stats_t *out) {
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    stats.ram_used = ram_used;
+    stats.flash_used = flash_write - flash_read;
+    *out = stats;
+    xSemaphoreGive(queue_lock);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Store-and-forward queue sizing
+#define UPLINK_RAM_SIZE      8192         // RAM ring for queued records
+#define UPLINK_BATCH_SIZE    4096         // Largest single send() to the sink
+#define UPLINK_MAX_RECORD    512          // Largest record accepted by uplink_queue_push()
+#define UPLINK_PARTITION     "uplink"     // Data partition used as spill log
+#define UPLINK_HOST_SIZE     16           // Dotted IPv4 address with its terminator
+
+/**
+ * @brief Destination of the queued records
+ * @details Records are streamed to a TCP sink as a 2-byte big-endian length
+ * followed by the record bytes.
+ */
+typedef struct {
+    char host[UPLINK_HOST_SIZE];          // Sink IPv4 address
+    uint16_t port;                        // Sink TCP port
+} uplink_queue_config_t;
+
+/**
+ * @brief Queue counters
+ */
+typedef struct {
+    uint32_t ram_used;                    // Bytes waiting in the RAM ring
+    uint32_t flash_used;                  // Bytes waiting in the flash log
+    uint32_t records_queued;              // Records accepted since boot
+    uint32_t records_dropped;             // Records lost because both stores were full
+    uint32_t batches_sent;                // send() calls that delivered a batch
+    uint32_t bytes_sent;                  // Bytes delivered to the sink
+} uplink_queue_stats_t;
+
+/**
+ * @brief Initializes the queue and starts the drain task
+ * @details NVS must be initialized. A sink saved by uplink_queue_set_sink()
+ * replaces the default one. Records left in the flash log by the previous
+ * boot are sent first: the log head and tail are kept in NVS, the head moves
+ * once the sink accepted a batch, so a reset may send a batch twice but
+ * never loses one. Records still in the RAM ring are lost on a reset.
+ * @param config Default sink address, copied
+ * @return ESP_OK if successful, ESP_ERR_NOT_FOUND if the spill partition is missing
+ */
+esp_err_t uplink_queue_init(const uplink_queue_config_t *config);
+
+/**
+ * @brief Queues one record for the sink
+ * @details Never blocks on the network. When the RAM ring is full its content is
+ * moved to the flash log in one write, starting on a new sector.
+ * @param data Record bytes
+ * @param len Record length, at most UPLINK_MAX_RECORD
+ * @return ESP_OK if queued, ESP_ERR_INVALID_SIZE or ESP_ERR_NO_MEM otherwise
+ */
+esp_err_t uplink_queue_push(const void *data, size_t len);
+
+/**
+ * @brief Changes the sink and saves it to NVS
+ * @details The drain task reconnects before its next batch.
+ * @param config New sink address, copied
+ * @return ESP_OK if successful, ESP_ERR_INVALID_ARG for a bad address, the NVS error otherwise
+ */
+esp_err_t uplink_queue_set_sink(const uplink_queue_config_t *config);
+
+/**
+ * @brief Reads the sink in use
+ */
+void uplink_queue_get_sink(uplink_queue_config_t *config);
+
+/**
+ * @brief Gates the drain task on the connection state
+ * @param up true once the STA link is usable, false when it goes away
+ */
+void uplink_queue_set_link_up(bool up);
+
+/**
+ * @brief Reads the queue counters
+ */
+void uplink_queue_get_stats(uplink_queue_stats_t *stats);
@@ -0,0 +1,407 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_wifi_default.h"
+#include "esp_wifi_netif.h"
+#include "esp_netif_net_stack.h"
+#include "esp_private/wifi.h"
+#include "lwip/dhcp.h"
+#include "lwip/netif.h"
+#include "conn_timer.h"
+#include "wifi_netif.h"
+
+ESP_EVENT_DEFINE_BASE(WIFI_NETIF_EVENT);
+
+#define LEASE_CHECK_MS      50            // DHCP client poll after a reassociation
+#define OUTAGE_RETRY_MS     100           // Next try when the expiry could not be posted
+
+typedef enum {
+    LEASE_PENDING,                        // INIT-REBOOT not answered yet
+    LEASE_BOUND,                          // Lease confirmed
+    LEASE_LOST,                           // NAK or no answer, the address is gone
+} lease_state_t;
+
+static const char *TAG = "wifi_netif";                     // Logging tag
+static esp_netif_t *sta_netif;                             // STA interface
+static esp_netif_t *ap_netif;                              // AP interface, NULL outside provisioning
+static uint32_t outage_grace_ms = 0;                       // 0: drop the IP on disconnect
+static conn_timer_t outage_timer;                          // Ends the grace period
+static bool outage_active = false;                         // Link down, IP kept
+static uint8_t outage_ssid[32];                            // Network the IP belongs to
+static conn_timer_t lease_timer;                           // Polls the lease after a reassociation
+static bool ap_keep_leases = false;                        // Keep the AP netif across AP stops
+static bool ap_parked = false;                             // AP netif kept with its link down
+static bool ap_release = false;                            // Destroy the AP netif at the next AP stop
+static wifi_netif_ap_traffic_cb_t ap_traffic_cb;           // Told the sender of unicast AP frames
+
+/**
+ * @brief Sets the lwIP link state, runs in the TCP/IP task
+ */
+static esp_err_t set_link_down(void *ctx) {
+    netif_set_link_down((struct netif *)ctx);
+    return ESP_OK;
+}
+
+static esp_err_t set_link_up(void *ctx) {
+    // In BOUND state lwIP revalidates the lease with a DHCP INIT-REBOOT here
+    netif_set_link_up((struct netif *)ctx);
+    return ESP_OK;
+}
+
+/**
+ * @brief Reads the DHCP client state, runs in the TCP/IP task
+ */
+static esp_err_t read_lease(void *ctx) {
+    struct netif *netif = esp_netif_get_netif_impl(sta_netif);
+    lease_state_t *state = (lease_state_t *)ctx;
+
+    if (dhcp_supplied_address(netif)) {
+        *state = LEASE_BOUND;
+    } else if (ip4_addr_isany_val(*netif_ip4_addr(netif))) {
+        *state = LEASE_LOST;
+    } else {
+        *state = LEASE_PENDING;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief AP receive path: reports the sender, then hands the frame to lwIP
+ * @details Runs in the WiFi task. The frame starts with its Ethernet header,
+ * destination MAC first, then the source.
+ */
+static esp_err_t ap_receive(esp_netif_t *netif, void *buffer, size_t len, void *eb) {
+    const uint8_t *frame = buffer;
+    wifi_netif_ap_traffic_cb_t cb = ap_traffic_cb;
+
+    // The group bit of the destination marks broadcast and multicast
+    if (cb && len >= 12 && !(frame[0] & 0x01)) cb(&frame[6]);
+    return esp_netif_receive(netif, buffer, len, eb);
+}
+
+/**
+ * @brief Attaches the driver receive path and starts the interface
+ * @details Same steps as the default WiFi handlers of ESP-IDF.
+ */
+static void start_netif(esp_netif_t *netif, esp_event_base_t base, int32_t event_id, void *data) {
+    uint8_t mac[6];
+    wifi_netif_driver_t driver = esp_netif_get_io_driver(netif);
+
+    if (esp_wifi_get_if_mac(driver, mac) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read the interface MAC!");
+        return;
+    }
+    if (esp_wifi_is_if_ready_when_started(driver)) {
+        esp_netif_receive_t receive = netif == ap_netif ? ap_receive : esp_netif_receive;
+        if (esp_wifi_register_if_rxcb(driver, receive, netif) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register the receive callback!");
+            return;
+        }
+    }
+    esp_netif_set_mac(netif, mac);
+    esp_netif_action_start(netif, base, event_id, data);
+}
+
+/**
+ * @brief Restarts the AP interface that was kept across an AP stop
+ */
+static void resume_ap_netif(void) {
+    wifi_netif_driver_t driver = esp_netif_get_io_driver(ap_netif);
+
+    if (esp_wifi_register_if_rxcb(driver, ap_receive, ap_netif) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register the receive callback!");
+        return;
+    }
+    ap_parked = false;
+    esp_netif_tcpip_exec(set_link_up, esp_netif_get_netif_impl(ap_netif));
+    ESP_LOGI(TAG, "AP interface resumed with its DHCP leases");
+}
+
+/**
+ * @brief Destroys the stopped AP interface with its DHCP server and lwIP netif
+ */
+static void destroy_ap_netif(esp_event_base_t base, int32_t event_id, void *data) {
+    uint32_t heap_before = esp_get_free_heap_size();
+
+    // A parked interface is still started, its DHCP server runs
+    if (ap_parked) esp_netif_action_stop(ap_netif, base, event_id, data);
+    esp_netif_destroy_default_wifi(ap_netif);
+    ap_netif = NULL;
+    ap_parked = false;
+    ap_release = false;
+    ESP_LOGI(TAG, "AP interface destroyed, free heap %" PRIu32 " -> %" PRIu32 " bytes",
+             heap_before, esp_get_free_heap_size());
+}
+
+/**
+ * @brief Ends a short outage by really taking the interface down
+ */
+static void end_outage(esp_event_base_t base, int32_t event_id, void *data) {
+    conn_timer_stop(&outage_timer);
+    outage_active = false;
+    esp_netif_action_disconnected(sta_netif, base, event_id, data);
+}
+
+/**
+ * @brief Grace timer callback, hands over to the event loop
+ * @details Waits at most one tick for room in the queue, then tries again
+ * later, so a full queue can not leave the outage open.
+ */
+static void outage_timer_callback(void *arg) {
+    if (esp_event_post(WIFI_NETIF_EVENT, WIFI_NETIF_EVENT_OUTAGE_EXPIRED, NULL, 0,
+                       pdMS_TO_TICKS(CONN_TIMER_TICK_MS)) != ESP_OK) {
+        conn_timer_start_once(&outage_timer, OUTAGE_RETRY_MS);
+    }
+}
+
+/**
+ * @brief Lease poll timer callback, hands over to the event loop
+ * @details A dropped post is made up by the next period.
+ */
+static void lease_timer_callback(void *arg) {
+    esp_event_post(WIFI_NETIF_EVENT, WIFI_NETIF_EVENT_LEASE_CHECK, NULL, 0, 0);
+}
+
+/**
+ * @brief Tells the application the link is back once the kept lease is confirmed
+ * @details lwIP does not report a lease it revalidated without a change, so
+ * IP_EVENT_STA_GOT_IP is posted here, and only once the DHCP client is BOUND
+ * again. After a NAK the address goes away and esp_netif posts the new one.
+ */
+static void check_lease(void) {
+    esp_netif_dhcp_status_t dhcp = ESP_NETIF_DHCP_STARTED;
+    lease_state_t state = LEASE_BOUND;
+
+    // A static address has no lease to wait for
+    esp_netif_dhcpc_get_status(sta_netif, &dhcp);
+    if (dhcp == ESP_NETIF_DHCP_STARTED) {
+        esp_netif_tcpip_exec(read_lease, &state);
+    }
+    if (state == LEASE_PENDING) return;
+
+    if (state == LEASE_LOST) {
+        conn_timer_stop(&lease_timer);
+        ESP_LOGI(TAG, "Lease not confirmed after the outage, waiting for a new one");
+        return;
+    }
+
+    // This runs in the loop the event goes to: a full queue is tried again at the next check
+    ip_event_got_ip_t got_ip = { .esp_netif = sta_netif, .ip_changed = false };
+    esp_netif_get_ip_info(sta_netif, &got_ip.ip_info);
+    if (esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip), 0) != ESP_OK) return;
+    conn_timer_stop(&lease_timer);
+    ESP_LOGI(TAG, "Lease confirmed after the outage, kept " IPSTR, IP2STR(&got_ip.ip_info.ip));
+}
+
+/**
+ * @brief STA disconnected: keep the address for a while if short-outage mode is on
+ */
+static void handle_sta_disconnected(esp_event_base_t base, int32_t event_id, void *data) {
+    wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)data;
+    esp_netif_ip_info_t ip_info;
+
+    // A lease still being confirmed: the address is kept as after any other drop
+    conn_timer_stop(&lease_timer);
+
+    // Retries during an outage arrive as further disconnect events
+    if (outage_active) return;
+
+    if (outage_grace_ms > 0 && esp_netif_get_ip_info(sta_netif, &ip_info) == ESP_OK &&
+        ip_info.ip.addr != 0) {
+        ESP_LOGI(TAG, "Link lost, keeping " IPSTR " for %" PRIu32 " ms",
+                 IP2STR(&ip_info.ip), outage_grace_ms);
+        memcpy(outage_ssid, event->ssid, sizeof(outage_ssid));
+        outage_active = true;
+        esp_netif_tcpip_exec(set_link_down, esp_netif_get_netif_impl(sta_netif));
+        conn_timer_start_once(&outage_timer, outage_grace_ms);
+        return;
+    }
+
+    esp_netif_action_disconnected(sta_netif, base, event_id, data);
+}
+
+/**
+ * @brief STA connected: resume a short outage or bring the interface up normally
+ */
+static void handle_sta_connected(esp_event_base_t base, int32_t event_id, void *data) {
+    wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)data;
+    wifi_netif_driver_t driver = esp_netif_get_io_driver(sta_netif);
+
+    if (!esp_wifi_is_if_ready_when_started(driver)) {
+        if (esp_wifi_register_if_rxcb(driver, esp_netif_receive, sta_netif) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register the receive callback!");
+            return;
+        }
+    }
+
+    if (outage_active) {
+        if (memcmp(outage_ssid, event->ssid, sizeof(outage_ssid)) == 0) {
+            conn_timer_stop(&outage_timer);
+            outage_active = false;
+            ESP_LOGI(TAG, "Reassociated within grace period, revalidating the lease");
+            esp_netif_tcpip_exec(set_link_up, esp_netif_get_netif_impl(sta_netif));
+            conn_timer_start_periodic(&lease_timer, LEASE_CHECK_MS);
+            check_lease();
+            return;
+        }
+        // Another network: the old address is no longer valid
+        end_outage(base, event_id, data);
+    }
+
+    esp_netif_action_connected(sta_netif, base, event_id, data);
+}
+
+/**
+ * @brief Event handler replacing the default WiFi netif handlers
+ */
+static void wifi_netif_event_handler(void *arg, esp_event_base_t event_base,
+                                     int32_t event_id, void *event_data) {
+    if (event_base == WIFI_EVENT) {
+        switch (event_id) {
+        case WIFI_EVENT_STA_START:
+            start_netif(sta_netif, event_base, event_id, event_data);
+            break;
+        case WIFI_EVENT_STA_STOP:
+            conn_timer_stop(&lease_timer);
+            if (outage_active) {
+                conn_timer_stop(&outage_timer);
+                outage_active = false;
+            }
+            esp_netif_action_stop(sta_netif, event_base, event_id, event_data);
+            break;
+        case WIFI_EVENT_STA_CONNECTED:
+            handle_sta_connected(event_base, event_id, event_data);
+            break;
+        case WIFI_EVENT_STA_DISCONNECTED:
+            handle_sta_disconnected(event_base, event_id, event_data);
+            break;
+        case WIFI_EVENT_AP_START:
+            if (!ap_netif) {
+                ESP_LOGE(TAG, "AP started without an interface!");
+            } else if (ap_parked) {
+                resume_ap_netif();
+            } else {
+                start_netif(ap_netif, event_base, event_id, event_data);
+            }
+            break;
+        case WIFI_EVENT_AP_STOP:
+            if (!ap_netif) break;
+            if (ap_release) {
+                destroy_ap_netif(event_base, event_id, event_data);
+            } else if (ap_keep_leases) {
+                // Stopping the netif would also stop the DHCP server and drop its leases
+                ap_parked = true;
+                esp_netif_tcpip_exec(set_link_down, esp_netif_get_netif_impl(ap_netif));
+            } else {
+                esp_netif_action_stop(ap_netif, event_base, event_id, event_data);
+            }
+            break;
+        default:
+            break;
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        esp_wifi_internal_set_sta_ip();
+    } else if (event_base == WIFI_NETIF_EVENT && event_id == WIFI_NETIF_EVENT_OUTAGE_EXPIRED) {
+        if (outage_active) {
+            ESP_LOGI(TAG, "Grace period expired, releasing the IP address");
+            end_outage(event_base, event_id, event_data);
+        }
+    } else if (event_base == WIFI_NETIF_EVENT && event_id == WIFI_NETIF_EVENT_LEASE_CHECK) {
+        if (conn_timer_is_active(&lease_timer)) check_lease();
+    }
+}
+
+/**
+ * @brief Creates the STA interface and connects it to the WiFi driver
+ * @return ESP_OK if successful, the failing esp_netif/esp_event error otherwise
+ */
+esp_err_t wifi_netif_init(void) {
+    esp_netif_config_t sta_config = ESP_NETIF_DEFAULT_WIFI_STA();
+    esp_err_t err;
+
+    sta_netif = esp_netif_new(&sta_config);
+    if (!sta_netif) return ESP_ERR_NO_MEM;
+
+    err = esp_netif_attach_wifi_station(sta_netif);
+    if (err != ESP_OK) return err;
+
+    conn_timer_setup(&outage_timer, outage_timer_callback, NULL);
+    conn_timer_setup(&lease_timer, lease_timer_callback, NULL);
+
+    // Registered before the application handlers so the netif is ready when they run
+    err = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_netif_event_handler, NULL);
+    if (err != ESP_OK) return err;
+    err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_netif_event_handler, NULL);
+    if (err != ESP_OK) return err;
+    return esp_event_handler_register(WIFI_NETIF_EVENT, ESP_EVENT_ANY_ID, &wifi_netif_event_handler, NULL);
+}
+
+/**
+ * @brief Returns the STA interface created by wifi_netif_init()
+ */
+esp_netif_t *wifi_netif_sta(void) {
+    return sta_netif;
+}
+
+/**
+ * @brief Creates the AP interface unless it exists
+ * @return ESP_OK if successful, the failing esp_netif error otherwise
+ */
+esp_err_t wifi_netif_ap_create(void) {
+    ap_release = false;
+    if (ap_netif) return ESP_OK;
+
+    uint32_t heap_before = esp_get_free_heap_size();
+    esp_netif_config_t ap_config = ESP_NETIF_DEFAULT_WIFI_AP();
+    esp_netif_t *netif = esp_netif_new(&ap_config);
+    if (!netif) return ESP_ERR_NO_MEM;
+    esp_err_t err = esp_netif_attach_wifi_ap(netif);
+    if (err != ESP_OK) {
+        esp_netif_destroy(netif);
+        return err;
+    }
+    ap_netif = netif;
+    ESP_LOGI(TAG, "AP interface created, free heap %" PRIu32 " -> %" PRIu32 " bytes",
+             heap_before, esp_get_free_heap_size());
+    return ESP_OK;
+}
+
+/**
+ * @brief Destroys the AP interface once the soft-AP stops
+ */
+void wifi_netif_ap_release(void) {
+    if (ap_netif) ap_release = true;
+}
+
+/**
+ * @brief Returns the AP interface, NULL if it does not exist
+ */
+esp_netif_t *wifi_netif_ap(void) {
+    return ap_netif;
+}
+
+/**
+ * @brief Sets the short-outage grace period
+ * @param grace_ms Grace period in milliseconds, 0 to disable
+ */
+void wifi_netif_set_outage_grace(uint32_t grace_ms) {
+    outage_grace_ms = grace_ms;
+}
+
+/**
+ * @brief Keeps the AP interface and its DHCP server running across AP restarts
+ * @param keep true to keep the leases
+ */
+void wifi_netif_set_ap_keep_leases(bool keep) {
+    ap_keep_leases = keep;
+}
+
+/**
+ * @brief Reports the traffic of the soft-AP stations
+ * @param cb Callback, NULL to stop reporting
+ */
+void wifi_netif_set_ap_traffic_cb(wifi_netif_ap_traffic_cb_t cb) {
+    ap_traffic_cb = cb;
+}
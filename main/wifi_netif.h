@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+
+// Events posted by the WiFi netif glue
+ESP_EVENT_DECLARE_BASE(WIFI_NETIF_EVENT);
+
+typedef enum {
+    WIFI_NETIF_EVENT_OUTAGE_EXPIRED,      // Short-outage grace period ran out
+    WIFI_NETIF_EVENT_LEASE_CHECK,         // Time to poll the lease revalidated after an outage
+} wifi_netif_event_t;
+
+/**
+ * @brief Callback told the sender of each unicast frame received on the AP
+ * @details Runs in the WiFi task for every frame and must return quickly.
+ */
+typedef void (*wifi_netif_ap_traffic_cb_t)(const uint8_t mac[6]);
+
+/**
+ * @brief Creates the STA interface and connects it to the WiFi driver
+ * @details Replaces esp_netif_create_default_wifi_sta()/_ap() and their default
+ * event handlers so that a brief STA disconnect can keep the IP address. The
+ * AP interface is only created for provisioning, see wifi_netif_ap_create().
+ * conn_timer_init() must have run, the outage grace period is a conn_timer.
+ * @return ESP_OK if successful, the failing esp_netif/esp_event error otherwise
+ */
+esp_err_t wifi_netif_init(void);
+
+/**
+ * @brief Returns the STA interface created by wifi_netif_init()
+ */
+esp_netif_t *wifi_netif_sta(void);
+
+/**
+ * @brief Creates the AP interface unless it exists
+ * @details Call before the soft-AP starts. The interface, its DHCP server and
+ * lwIP netif take several KB of RAM that units running as STA only do not
+ * need. The free heap before and after is logged.
+ * @return ESP_OK if successful, the failing esp_netif error otherwise
+ */
+esp_err_t wifi_netif_ap_create(void);
+
+/**
+ * @brief Destroys the AP interface once the soft-AP stops
+ * @details Call when the provisioning window closes, before stopping the
+ * soft-AP. The interface goes at the next WIFI_EVENT_AP_STOP, taking its
+ * DHCP leases with it. wifi_netif_ap_create() before then keeps it.
+ */
+void wifi_netif_ap_release(void);
+
+/**
+ * @brief Returns the AP interface, NULL if it does not exist
+ */
+esp_netif_t *wifi_netif_ap(void);
+
+/**
+ * @brief Sets the short-outage grace period
+ * @details When the STA loses its AP, the netif link goes down but the address
+ * and the lwIP PCBs are kept. Reassociating to the same SSID within the grace
+ * period revalidates the lease with a DHCP INIT-REBOOT instead of dropping the
+ * IP. IP_EVENT_STA_GOT_IP follows once the DHCP server confirmed the lease; a
+ * NAK drops the address and the new lease is reported as usual. 0 restores
+ * the default behaviour (the IP is dropped on disconnect).
+ * @param grace_ms Grace period in milliseconds
+ */
+void wifi_netif_set_outage_grace(uint32_t grace_ms);
+
+/**
+ * @brief Keeps the AP interface and its DHCP server running across AP restarts
+ * @details When enabled, stopping the soft-AP only takes the netif link down,
+ * so the DHCP server keeps its per-MAC lease list for the next start. A
+ * released interface (wifi_netif_ap_release()) is destroyed all the same.
+ * @param keep true to keep the leases
+ */
+void wifi_netif_set_ap_keep_leases(bool keep);
+
+/**
+ * @brief Reports the traffic of the soft-AP stations
+ * @details Broadcast and multicast frames (ARP, mDNS) are background chatter
+ * of any associated device and are not reported.
+ * @param cb Callback, NULL to stop reporting
+ */
+void wifi_netif_set_ap_traffic_cb(wifi_netif_ap_traffic_cb_t cb);
@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "bench.h"
+#include "capture.h"
+#include "device_config.h"
+#include "fault_inject.h"
+#include "wifi_store.h"
+
+// NVS (Non-Volatile Storage) configuration constants
+#define NVS_NAMESPACE   "wifi_table"      // NVS namespace
+#define WIFI_SSID_KEY   "wifi_ssid"       // Key to store the SSID
+#define WIFI_PASS_KEY   "wifi_pass"       // Key to store the password
+
+static const char *TAG = "wifi_store";                     // Logging tag
+static nvs_handle_t nvs_handle;                            // NVS operation handle
+
+/**
+ * @brief Records the result and duration of an NVS call in the session capture
+ * @param op CAPTURE_NVS_* operation
+ * @param err Result of the call
+ * @param start_us esp_timer time before the call
+ * @return err
+ */
+static esp_err_t capture_nvs(uint16_t op, esp_err_t err, int64_t start_us) {
+    capture_nvs_t result = { .err = err, .duration_us = esp_timer_get_time() - start_us };
+    capture_record(CAPTURE_NVS, op, &result, sizeof(result));
+    return err;
+}
+
+/**
+ * @brief Initializes and opens NVS
+ * @return true if successful, false if failed
+ */
+bool nvs_init(void) {
+    // Initialize NVS flash
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        // If NVS section is full or version mismatch, erase and initialize again
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+
+    // Open NVS in read-write mode
+    int64_t start = esp_timer_get_time();
+    err = capture_nvs(CAPTURE_NVS_OPEN, fault_nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle), start);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS!");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Saves WiFi information to NVS
+ * @param ssid WiFi network name
+ * @param password WiFi password
+ * @return true if successful, false if failed
+ */
+bool nvs_write_wifi_data(const char* ssid, const char* password) {
+    char stored_ssid[WIFI_NAME_SIZE];
+    char stored_pass[WIFI_PASS_SIZE];
+    esp_err_t err;
+
+    // Every published link saves its credentials, mostly the stored ones: a
+    // commit then only wears the flash
+    if (nvs_read_wifi_data(stored_ssid, stored_pass) && strcmp(stored_ssid, ssid) == 0 &&
+        strcmp(stored_pass, password) == 0) {
+        ESP_LOGD(TAG, "WiFi information unchanged, not saved");
+        return true;
+    }
+
+    // Save SSID
+    int64_t start = esp_timer_get_time();
+    err = capture_nvs(CAPTURE_NVS_SET, fault_nvs_set_str(nvs_handle, WIFI_SSID_KEY, ssid), start);
+    if (err != ESP_OK) return false;
+
+    // Save password
+    start = esp_timer_get_time();
+    err = capture_nvs(CAPTURE_NVS_SET, fault_nvs_set_str(nvs_handle, WIFI_PASS_KEY, password), start);
+    if (err != ESP_OK) return false;
+
+    // Commit changes to NVS
+    start = esp_timer_get_time();
+    err = capture_nvs(CAPTURE_NVS_COMMIT, fault_nvs_commit(nvs_handle), start);
+    bench_add("nvs.commits", 1);
+    if (err != ESP_OK) return false;
+
+    ESP_LOGI(TAG, "WiFi information successfully saved");
+    return true;
+}
+
+/**
+ * @brief Reads WiFi information from NVS
+ * @param ssid_out SSID output buffer
+ * @param pass_out Password output buffer
+ * @return true if successful, false if failed
+ */
+bool nvs_read_wifi_data(char* ssid_out, char* pass_out) {
+    size_t ssid_size = WIFI_NAME_SIZE;
+    size_t pass_size = WIFI_PASS_SIZE;
+
+    // Read SSID
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = capture_nvs(CAPTURE_NVS_GET,
+                                fault_nvs_get_str(nvs_handle, WIFI_SSID_KEY, ssid_out, &ssid_size), start);
+    if (err != ESP_OK) return false;
+
+    // Read password
+    start = esp_timer_get_time();
+    err = capture_nvs(CAPTURE_NVS_GET, fault_nvs_get_str(nvs_handle, WIFI_PASS_KEY, pass_out, &pass_size),
+                      start);
+    if (err != ESP_OK) return false;
+
+    return true;
+}
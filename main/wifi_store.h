@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @brief Initializes and opens NVS
+ * @details A full or incompatible partition is erased and initialized again.
+ * @return true if successful, false if the namespace could not be opened
+ */
+bool nvs_init(void);
+
+/**
+ * @brief Saves WiFi information to NVS
+ * @details Credentials equal to the stored ones are not written again, so
+ * saving the credentials of every published link costs no commit. Counts the
+ * commits in the nvs.commits bench metric.
+ * @param ssid WiFi network name
+ * @param password WiFi password
+ * @return true if successful or unchanged, false if failed
+ */
+bool nvs_write_wifi_data(const char* ssid, const char* password);
+
+/**
+ * @brief Reads WiFi information from NVS
+ * @param ssid_out SSID output buffer, WIFI_NAME_SIZE bytes
+ * @param pass_out Password output buffer, WIFI_PASS_SIZE bytes
+ * @return true if successful, false if failed
+ */
+bool nvs_read_wifi_data(char* ssid_out, char* pass_out);
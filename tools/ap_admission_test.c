@@ -0,0 +1,214 @@
+/**
+ * @file ap_admission_test.c
+ * @brief Host test of the soft-AP admission and eviction in main/ap_admission.c
+ * @details Drives the station table the way main.c does: association and
+ * lease events, unicast frames reported by the AP receive path, TCP activity
+ * and finished sessions, and the periodic eviction check every AP_CHECK_MS.
+ * Time is virtual.
+ *
+ * Each scenario fills the AP and checks who is admitted, rejected or evicted.
+ * The backlog scenarios are the case the frame counting is for: a technician
+ * whose phone waits in the accept backlog of the busy server has no TCP
+ * activity, but its frames keep it from looking idle. The same scenario
+ * counting TCP activity only checks that it would be evicted. A wrong result
+ * is printed as FAIL.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Itools/host -Imain -o ap_admission_test tools/ap_admission_test.c main/ap_admission.c
+ *   ./ap_admission_test
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "ap_admission.h"
+
+#define AP_CHECK_MS     5000              // Period of the eviction check in main.c
+#define FRAME_PERIOD_MS 2000              // DNS and connectivity checks of a waiting phone
+
+static int64_t now;
+static bool failed_check;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("     %s\n", what);
+        failed_check = true;
+    }
+}
+
+static void mac_of(int station, uint8_t mac[6]) {
+    static const uint8_t base[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    memcpy(mac, base, 6);
+    mac[5] = (uint8_t)station;
+}
+
+static uint32_t ip_of(int station) {
+    return 0x0001a8c0 | ((uint32_t)(station + 1) << 24);      // 192.168.1.x in network order
+}
+
+/**
+ * @brief Associates a station and hands out its lease
+ * @return Admission decision, the evicted station in evicted (-1 if none)
+ */
+static ap_admission_decision_t join(int station, int *evicted) {
+    uint8_t mac[6], evict_mac[6];
+    mac_of(station, mac);
+    ap_admission_decision_t decision = ap_admission_on_connect(mac, now, evict_mac);
+    *evicted = decision == AP_ADMIT_AFTER_EVICT ? evict_mac[5] : -1;
+    if (decision == AP_ADMIT_AFTER_EVICT) ap_admission_on_disconnect(evict_mac);
+    if (decision != AP_REJECT) ap_admission_on_lease(mac, ip_of(station), now);
+    return decision;
+}
+
+static void frame_from(int station) {
+    uint8_t mac[6];
+    mac_of(station, mac);
+    ap_admission_note_station(mac, now);
+}
+
+/**
+ * @brief Runs the periodic check until a time, with traffic
+ * @param until End of the run
+ * @param tcp_station Station with an active TCP session, -1 for none
+ * @param frame_stations Bitmask of the stations sending frames without a session
+ * @return Bitmask of the stations evicted
+ */
+static uint32_t run_until(int64_t until, int tcp_station, uint32_t frame_stations) {
+    uint32_t evicted = 0;
+    uint8_t mac[6];
+
+    while (now + AP_CHECK_MS <= until) {
+        int64_t check_at = now + AP_CHECK_MS;
+        for (now += FRAME_PERIOD_MS; now <= check_at; now += FRAME_PERIOD_MS) {
+            if (tcp_station >= 0) ap_admission_note_activity(ip_of(tcp_station), now);
+            for (int i = 0; i < 32; i++) {
+                if (frame_stations & (1u << i)) frame_from(i);
+            }
+        }
+        now = check_at;
+        while (ap_admission_next_eviction(now, mac)) evicted |= 1u << mac[5];
+    }
+    return evicted;
+}
+
+static void start(void) {
+    ap_admission_init();
+    now = 0;
+}
+
+/**
+ * @brief Fills the AP with stations 0..AP_MAX_STATIONS-1
+ */
+static void fill(void) {
+    int evicted;
+    for (int i = 0; i < AP_MAX_STATIONS; i++) join(i, &evicted);
+}
+
+// Every slot busy with active stations: the newcomer is turned away
+static void full_and_active(void) {
+    int evicted;
+    start();
+    fill();
+    now = 30000;
+    for (int i = 0; i < AP_MAX_STATIONS; i++) frame_from(i);
+    now = 40000;
+    check(join(AP_MAX_STATIONS, &evicted) == AP_REJECT, "newcomer admitted");
+    check(ap_admission_station_count() == AP_MAX_STATIONS, "table changed");
+}
+
+// Full with two stations silent: the periodic check frees one slot after a minute
+static void full_two_idle(void) {
+    int evicted;
+    start();
+    fill();
+    uint32_t gone = run_until(55000, 1, 1u << 2);
+    check(gone == 0, "evicted before the idle timeout");
+    gone = run_until(65000, 1, 1u << 2);
+    check(gone == 1u << 0 || gone == 1u << 3, "not one idle station evicted");
+    check(join(AP_MAX_STATIONS, &evicted) == AP_ADMIT, "newcomer rejected");
+}
+
+// A finished session goes first, even before a longer idle one
+static void finished_first(void) {
+    int evicted;
+    start();
+    fill();
+    now = 65000;
+    ap_admission_mark_finished(ip_of(2), now);
+    check(join(AP_MAX_STATIONS, &evicted) == AP_ADMIT_AFTER_EVICT && evicted == 2, "finished station kept");
+}
+
+// Not full: a finished station lingers AP_FINISHED_LINGER_MS, an idle one the hard timeout
+static void not_full_timeouts(void) {
+    int evicted;
+    start();
+    join(0, &evicted);
+    join(1, &evicted);
+    ap_admission_mark_finished(ip_of(0), now);
+    uint32_t gone = run_until(AP_FINISHED_LINGER_MS - AP_CHECK_MS, -1, 0);
+    check(gone == 0, "finished station evicted early");
+    gone = run_until(AP_FINISHED_LINGER_MS, -1, 0);
+    check(gone == 1u << 0, "finished station not evicted after the linger time");
+    gone = run_until(AP_IDLE_HARD_TIMEOUT_MS - AP_CHECK_MS, -1, 0);
+    check(gone == 0, "idle station evicted before the hard timeout");
+    gone = run_until(AP_IDLE_HARD_TIMEOUT_MS, -1, 0);
+    check(gone == 1u << 1, "idle station kept after the hard timeout");
+}
+
+// Station 0 holds the server for two minutes, stations 1-3 wait in the
+// accept backlog: their frames keep them, the newcomer is turned away
+static void backlog_with_frames(void) {
+    int evicted;
+    start();
+    fill();
+    uint32_t gone = run_until(120000, 0, 0xe);
+    check(gone == 0, "a waiting station was evicted");
+    check(join(AP_MAX_STATIONS, &evicted) == AP_REJECT, "a waiting station made room for the newcomer");
+}
+
+// The same counting TCP activity only: a waiting station looks idle and goes
+static void backlog_tcp_only(void) {
+    start();
+    fill();
+    uint32_t gone = run_until(120000, 0, 0);
+    check((gone & 0xe) != 0, "no waiting station evicted");
+    check((gone & 1) == 0, "the station in session was evicted");
+}
+
+// A station that reassociates keeps its slot
+static void reassociation(void) {
+    int evicted;
+    start();
+    fill();
+    now = 1000;
+    check(join(1, &evicted) == AP_ADMIT && evicted < 0, "reassociation needed a slot");
+    check(ap_admission_station_count() == AP_MAX_STATIONS, "station counted twice");
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "full, all active", full_and_active },
+    { "full, two idle", full_two_idle },
+    { "finished goes first", finished_first },
+    { "linger and hard timeout", not_full_timeouts },
+    { "backlog, frames counted", backlog_with_frames },
+    { "backlog, TCP activity only", backlog_tcp_only },
+    { "reassociation", reassociation },
+};
+
+int main(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        failed_check = false;
+        scenarios[i].run();
+        printf("%-4s %s\n", failed_check ? "FAIL" : "ok", scenarios[i].name);
+        failed += failed_check;
+    }
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file ap_lifecycle_test.c
+ * @brief Host test of the provisioning AP lifecycle and of its cost estimate
+ * @details Runs main/ap_lifecycle.c with the default policy on a virtual clock.
+ * Every step feeds ap_lifecycle_update() a station count at a given time and
+ * checks the state that comes out:
+ *   active -> idle   after 2 minutes without stations
+ *   idle -> off      when the 10 minute window closes
+ *   off -> active    30 minutes later, or at once on ap_lifecycle_wake()
+ * and that an associated station keeps the state, even past a deadline.
+ *
+ * Then it prints the cost table of README.md from ap_lifecycle_estimate_hour(),
+ * with a 1.8 ms beacon, and checks every row against the README values.
+ * A wrong state or estimate is printed as FAIL.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o ap_lifecycle_test tools/ap_lifecycle_test.c main/ap_lifecycle.c
+ *   ./ap_lifecycle_test
+ */
+#include <stdio.h>
+#include "ap_lifecycle.h"
+
+#define MIN_MS            (60 * 1000)
+#define BEACON_AIRTIME_US 1800            // One beacon at the lowest rate, as in README.md
+
+typedef enum {
+    UPDATE = 0,                           // ap_lifecycle_update()
+    WAKE,                                 // ap_lifecycle_wake(), then ap_lifecycle_update()
+} action_t;
+
+typedef struct {
+    const char *name;
+    action_t action;
+    int64_t at_ms;
+    int stations;
+    ap_state_t expected;
+} step_t;
+
+static const step_t steps[] = {
+    { "still active",              UPDATE, 2 * MIN_MS - 1,  0, AP_STATE_ACTIVE },
+    { "active -> idle",            UPDATE, 2 * MIN_MS,      0, AP_STATE_IDLE },
+    { "station keeps idle",        UPDATE, 5 * MIN_MS,      1, AP_STATE_IDLE },
+    { "station past the window",   UPDATE, 11 * MIN_MS,     1, AP_STATE_IDLE },
+    { "station leaves -> off",     UPDATE, 12 * MIN_MS,     0, AP_STATE_OFF },
+    { "still off",                 UPDATE, 42 * MIN_MS - 1, 0, AP_STATE_OFF },
+    { "off -> active, timer",      UPDATE, 42 * MIN_MS,     0, AP_STATE_ACTIVE },
+    { "station keeps active",      UPDATE, 45 * MIN_MS,     2, AP_STATE_ACTIVE },
+    // Idle time counts from the last station, not from the wake
+    { "active after the station",  UPDATE, 46 * MIN_MS,     0, AP_STATE_ACTIVE },
+    { "active -> idle",            UPDATE, 47 * MIN_MS,     0, AP_STATE_IDLE },
+    { "idle -> off",               UPDATE, 52 * MIN_MS,     0, AP_STATE_OFF },
+    { "off -> active, wake",       WAKE,   53 * MIN_MS,     0, AP_STATE_ACTIVE },
+    { "window restarts at wake",   UPDATE, 62 * MIN_MS,     1, AP_STATE_ACTIVE },
+    { "closes 10 min after wake",  UPDATE, 63 * MIN_MS,     0, AP_STATE_OFF },
+};
+
+static const char *state_name(ap_state_t state) {
+    switch (state) {
+    case AP_STATE_ACTIVE: return "active";
+    case AP_STATE_IDLE:   return "idle";
+    case AP_STATE_OFF:    return "off";
+    }
+    return "?";
+}
+
+typedef void (*policy_fn_t)(ap_lifecycle_policy_t *policy);
+
+typedef struct {
+    const char *name;
+    policy_fn_t change;                   // Applied to the default policy
+    uint32_t radio_on_s;                  // README.md value
+    uint32_t airtime_ds;                  // README.md value, in tenths of a second
+} estimate_case_t;
+
+static void always_active(ap_lifecycle_policy_t *p) { p->window_ms = 0; p->idle_after_ms = UINT32_MAX; }
+static void no_window(ap_lifecycle_policy_t *p) { p->window_ms = 0; }
+static void default_policy(ap_lifecycle_policy_t *p) {}
+static void no_wake(ap_lifecycle_policy_t *p) { p->wake_interval_ms = 0; }
+
+static const estimate_case_t estimates[] = {
+    { "Always active",             always_active,  3600, 633 },
+    { "Idle beaconing, no window", no_window,      3600, 82 },
+    { "Default",                   default_policy, 1200, 59 },
+    { "10 min window, no wake",    no_wake,        600,  30 },
+};
+
+int main(void) {
+    const ap_lifecycle_policy_t policy = AP_LIFECYCLE_DEFAULT_POLICY();
+    ap_lifecycle_t lc;
+    int failed = 0;
+
+    ap_lifecycle_init(&lc, &policy, 0);
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        const step_t *step = &steps[i];
+        if (step->action == WAKE) ap_lifecycle_wake(&lc, step->at_ms);
+        ap_state_t state = ap_lifecycle_update(&lc, step->stations, step->at_ms);
+        bool ok = state == step->expected;
+        printf("%-4s %-26s %6.2f min  %d sta  %s\n", ok ? "ok" : "FAIL", step->name, step->at_ms / 60000.0,
+               step->stations, state_name(state));
+        failed += !ok;
+    }
+
+    printf("\n     policy                     radio on  beacon airtime\n");
+    for (size_t i = 0; i < sizeof(estimates) / sizeof(estimates[0]); i++) {
+        const estimate_case_t *c = &estimates[i];
+        ap_lifecycle_policy_t estimated = policy;
+        ap_lifecycle_estimate_t e;
+        c->change(&estimated);
+        ap_lifecycle_estimate_hour(&estimated, BEACON_AIRTIME_US, &e);
+        // Rounded as the README table is
+        bool ok = (e.radio_on_ms + 500) / 1000 == c->radio_on_s && (e.beacon_airtime_ms + 50) / 100 == c->airtime_ds;
+        printf("%-4s %-26s %6u s  %6.1f s\n", ok ? "ok" : "FAIL", c->name, (unsigned)((e.radio_on_ms + 500) / 1000),
+               e.beacon_airtime_ms / 1000.0);
+        failed += !ok;
+    }
+
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Benchmark regression check (see tools/bench_run.py).
+
+Compares a result file to the committed baseline, metric by metric. Lower
+is better for every metric. A metric regresses when the two-sided
+Mann-Whitney U test finds the samples different (p < --alpha) and the median
+got worse by more than the threshold. Metrics that never vary, such as
+nvs.commits, are compared directly. Exits with 1 if any metric regressed,
+if the baseline is missing, or if it has no samples of a measured metric:
+a check without a baseline must not pass.
+
+    bench_compare.py baseline.json results.json
+    bench_compare.py baseline.json results.json --threshold boot.server_ms=10 --alpha 0.01
+    bench_compare.py baseline.json results.json --update     # accept results as the new baseline, or create it
+"""
+import argparse
+import json
+import math
+import os
+import shutil
+import sys
+
+MIN_SAMPLES = 5                           # Fewer samples can not reach p < 0.05 reliably
+EXACT_LIMIT = 400                         # Exact p-value up to this n1 * n2 without ties
+
+
+def median(values):
+    s = sorted(values)
+    n = len(s)
+    return s[n // 2] if n % 2 else (s[n // 2 - 1] + s[n // 2]) / 2
+
+
+def ranks(values):
+    """Ranks starting at 1, ties share their mean rank; also returns the tie sizes."""
+    order = sorted(range(len(values)), key=lambda i: values[i])
+    result = [0.0] * len(values)
+    ties = []
+    i = 0
+    while i < len(order):
+        j = i
+        while j + 1 < len(order) and values[order[j + 1]] == values[order[i]]:
+            j += 1
+        for k in range(i, j + 1):
+            result[order[k]] = (i + j) / 2 + 1
+        if j > i:
+            ties.append(j - i + 1)
+        i = j + 1
+    return result, ties
+
+
+def exact_p(u, n1, n2):
+    """Two-sided exact p-value: counts the rank arrangements with U at least as extreme."""
+    # counts[i][j][u]: arrangements of i + j values with statistic u, built up one value at a time
+    size = n1 * n2 + 1
+    prev = [[0] * size for _ in range(n2 + 1)]
+    for j in range(n2 + 1):
+        prev[j][0] = 1
+    for i in range(1, n1 + 1):
+        cur = [[0] * size for _ in range(n2 + 1)]
+        cur[0][0] = 1
+        for j in range(1, n2 + 1):
+            for k in range(size):
+                # Largest value from sample 1 beats all j of sample 2, or comes from sample 2
+                cur[j][k] = (prev[j][k - j] if k >= j else 0) + cur[j - 1][k]
+        prev = cur
+    counts = prev[n2]
+    total = math.comb(n1 + n2, n1)
+    extreme = min(u, n1 * n2 - u)
+    tail = sum(counts[: int(math.floor(extreme)) + 1])
+    return min(1.0, 2 * tail / total)
+
+
+def mann_whitney(a, b):
+    """Returns (U of a, two-sided p-value)."""
+    n1, n2 = len(a), len(b)
+    r, ties = ranks(list(a) + list(b))
+    u = sum(r[:n1]) - n1 * (n1 + 1) / 2
+    if not ties and n1 * n2 <= EXACT_LIMIT:
+        return u, exact_p(u, n1, n2)
+    # Normal approximation with tie and continuity correction
+    n = n1 + n2
+    mean = n1 * n2 / 2
+    tie_term = sum(t ** 3 - t for t in ties) / (n * (n - 1))
+    sigma = math.sqrt(n1 * n2 / 12 * ((n + 1) - tie_term))
+    if sigma == 0:
+        return u, 1.0
+    z = (abs(u - mean) - 0.5) / sigma
+    return u, min(1.0, math.erfc(max(z, 0) / math.sqrt(2)))
+
+
+def verdict(base, cur, threshold_pct, alpha):
+    """Returns (verdict, detail)."""
+    if not base or not cur:
+        return "missing", "only in " + ("results" if cur else "baseline")
+    mb, mc = median(base), median(cur)
+    change = (mc - mb) / mb * 100 if mb else (0.0 if mc == mb else math.inf)
+    detail = f"median {mb:g} -> {mc:g} ({change:+.1f} %)"
+    if len(set(base)) == 1 and len(set(cur)) == 1:
+        # Deterministic metric: any change counts
+        if mc == mb:
+            return "same", detail
+        return ("REGRESSED" if mc > mb else "improved"), detail + ", deterministic"
+    if len(base) < MIN_SAMPLES or len(cur) < MIN_SAMPLES:
+        return "too few", detail + f", n={len(base)}/{len(cur)}, need {MIN_SAMPLES}"
+    _, p = mann_whitney(base, cur)
+    detail += f", p={p:.3g}"
+    if p >= alpha or abs(change) <= threshold_pct:
+        return "same", detail
+    return ("REGRESSED" if change > 0 else "improved"), detail
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--alpha", type=float, default=0.05, help="significance level")
+    parser.add_argument("--default-threshold", type=float, default=5.0, help="minimum median change in %%")
+    parser.add_argument("--threshold", action="append", default=[], metavar="METRIC=PCT",
+                        help="threshold of one metric")
+    parser.add_argument("--update", action="store_true", help="copy the results over the baseline")
+    args = parser.parse_args()
+
+    if args.update:
+        if os.path.dirname(args.baseline):
+            os.makedirs(os.path.dirname(args.baseline), exist_ok=True)
+        shutil.copyfile(args.results, args.baseline)
+        print(f"{args.baseline} updated")
+        return
+    if not os.path.exists(args.baseline):
+        print(f"{args.baseline} missing: collect results on the reference board and create it with --update",
+              file=sys.stderr)
+        sys.exit(1)
+    thresholds = {}
+    for item in args.threshold:
+        metric, pct = item.split("=")
+        thresholds[metric] = float(pct)
+
+    with open(args.baseline) as f:
+        base = json.load(f)["metrics"]
+    with open(args.results) as f:
+        cur = json.load(f)["metrics"]
+
+    regressed = 0
+    unbased = 0
+    for metric in sorted(set(base) | set(cur)):
+        if cur.get(metric) and not base.get(metric):
+            # A new metric is judged once the baseline is refreshed with --update
+            unbased += 1
+            print(f"{'NO BASE':10} {metric:24} n={len(cur[metric])}, no baseline samples")
+            continue
+        result, detail = verdict(base.get(metric, []), cur.get(metric, []),
+                                 thresholds.get(metric, args.default_threshold), args.alpha)
+        regressed += result == "REGRESSED"
+        print(f"{result:10} {metric:24} {detail}")
+    print(f"{regressed} regressed, {unbased} without baseline")
+    sys.exit(1 if regressed or unbased else 0)
+
+
+if __name__ == "__main__":
+    main()
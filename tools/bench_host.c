@@ -0,0 +1,227 @@
+/**
+ * @file bench_host.c
+ * @brief Host benchmark of the parser and the NVS path, written as a result file
+ * @details Runs the metrics of main/bench.h that do not need the radio:
+ *   parser.ps_per_byte  json_value_bench() of main/json_value.c, the same code
+ *                       the bench command runs on the unit, best of BEST_OF
+ *                       calls per sample
+ *   nvs.commits         commits made by main/wifi_store.c in one session:
+ *                       a provisioning, the link published after it and
+ *                       after 3 reconnects, then a provisioning to another
+ *                       network and its link
+ * NVS is a table in RAM, so nvs.commits counts every commit that would reach
+ * the flash. Each metric gets -n samples.
+ *
+ * The result file has the format of tools/bench_run.py, for
+ * tools/bench_compare.py. bench/baseline.json is a result of this tool;
+ * tools/host_tests.sh checks every run against it.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Itools/host -Imain -o bench_host tools/bench_host.c main/json_value.c main/wifi_store.c main/bench.c
+ *   ./bench_host [-n samples] [-o results.json]
+ */
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "bench.h"
+#include "capture.h"
+#include "device_config.h"
+#include "json_value.h"
+#include "wifi_store.h"
+
+#define FORMAT          1                 // Result file format of tools/bench_run.py
+#define MAX_SAMPLES     100
+#define BEST_OF         50                // Parser runs per sample, the fastest counts
+#define NVS_ENTRIES     4
+#define NVS_VALUE_SIZE  64
+
+typedef struct {
+    char key[16];
+    char value[NVS_VALUE_SIZE];
+} nvs_entry_t;
+
+static nvs_entry_t nvs_table[NVS_ENTRIES];
+static int nvs_count;
+
+/* ---- Stand-ins ---- */
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void capture_record(capture_type_t type, uint16_t code, const void *payload, size_t len) {
+}
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    nvs_count = 0;
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *handle) {
+    *handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value, size_t *length) {
+    for (int i = 0; i < nvs_count; i++) {
+        if (strcmp(nvs_table[i].key, key) != 0) continue;
+        size_t needed = strlen(nvs_table[i].value) + 1;
+        if (needed > *length) return ESP_ERR_NVS_INVALID_LENGTH;
+        memcpy(value, nvs_table[i].value, needed);
+        *length = needed;
+        return ESP_OK;
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    int i = 0;
+    while (i < nvs_count && strcmp(nvs_table[i].key, key) != 0) i++;
+    if (i == NVS_ENTRIES) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    if (i == nvs_count) nvs_count++;
+    snprintf(nvs_table[i].key, sizeof(nvs_table[i].key), "%s", key);
+    snprintf(nvs_table[i].value, sizeof(nvs_table[i].value), "%s", value);
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+/* ---- Metrics ---- */
+
+typedef struct {
+    const char *metric;
+    int64_t value;
+    bool found;
+} lookup_t;
+
+static void find_metric(const char *line, size_t len, void *arg) {
+    lookup_t *lookup = arg;
+    char key[64];
+    snprintf(key, sizeof(key), "{\"metric\":\"%s\",\"value\":", lookup->metric);
+    if (strncmp(line, key, strlen(key)) == 0) {
+        lookup->value = strtoll(line + strlen(key), NULL, 10);
+        lookup->found = true;
+    }
+}
+
+/**
+ * @brief Reads a metric back from bench.c, as the bench command dumps it
+ */
+static int64_t metric_value(const char *metric) {
+    lookup_t lookup = { .metric = metric };
+    bench_dump(find_metric, &lookup);
+    return lookup.found ? lookup.value : -1;
+}
+
+/**
+ * @brief One parser sample: the fastest of BEST_OF benchmark runs
+ */
+static int64_t parser_sample(void) {
+    int64_t best = INT64_MAX;
+    for (int i = 0; i < BEST_OF; i++) {
+        json_value_bench();
+        int64_t value = metric_value("parser.ps_per_byte");
+        if (value >= 0 && value < best) best = value;
+    }
+    return best;
+}
+
+/**
+ * @brief One NVS sample: the commits of a provisioning session on an empty NVS
+ * @details Every published link saves its credentials (link_save_task() in
+ * main.c), a provisioning saves them once more after the connect.
+ */
+static int64_t nvs_sample(void) {
+    nvs_flash_erase();
+    if (!nvs_init()) return -1;
+    int64_t before = metric_value("nvs.commits");
+    if (before < 0) before = 0;
+
+    nvs_write_wifi_data("Site", "Secret");      // Link published after the provisioning connect
+    nvs_write_wifi_data("Site", "Secret");      // Provisioning save
+    for (int i = 0; i < 3; i++) {
+        nvs_write_wifi_data("Site", "Secret");  // Link published after a reconnect
+    }
+    nvs_write_wifi_data("Other", "Secret2");    // Link of the new network
+    nvs_write_wifi_data("Other", "Secret2");    // Provisioning save
+
+    char ssid[WIFI_NAME_SIZE], password[WIFI_PASS_SIZE];
+    if (!nvs_read_wifi_data(ssid, password) || strcmp(ssid, "Other") != 0) return -1;
+    return metric_value("nvs.commits") - before;
+}
+
+static int compare_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void write_samples(FILE *f, const char *metric, const int64_t *samples, int count, bool last) {
+    fprintf(f, "  \"%s\": [", metric);
+    for (int i = 0; i < count; i++) fprintf(f, "%s%" PRId64, i ? ", " : "", samples[i]);
+    fprintf(f, "]%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv) {
+    int count = 20;
+    const char *out = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:o:")) != -1) {
+        switch (opt) {
+        case 'n': count = atoi(optarg); break;
+        case 'o': out = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples] [-o results.json]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1 || count > MAX_SAMPLES) {
+        fprintf(stderr, "samples must be 1 to %d\n", MAX_SAMPLES);
+        return 2;
+    }
+
+    int64_t parser[MAX_SAMPLES], commits[MAX_SAMPLES], sorted[MAX_SAMPLES];
+    for (int i = 0; i < count; i++) {
+        parser[i] = parser_sample();
+        commits[i] = nvs_sample();
+        if (parser[i] < 0 || commits[i] < 0) {
+            fprintf(stderr, "sample %d failed\n", i);
+            return 1;
+        }
+    }
+
+    memcpy(sorted, parser, count * sizeof(int64_t));
+    qsort(sorted, count, sizeof(int64_t), compare_i64);
+    printf("parser.ps_per_byte  n=%d  median %" PRId64 "  min %" PRId64 "  max %" PRId64 "\n", count,
+           sorted[count / 2], sorted[0], sorted[count - 1]);
+    printf("nvs.commits         n=%d  %" PRId64 " per session\n", count, commits[0]);
+
+    if (out) {
+        FILE *f = fopen(out, "w");
+        if (f == NULL) {
+            perror(out);
+            return 1;
+        }
+        fprintf(f, "{\n \"format\": %d,\n \"metrics\": {\n", FORMAT);
+        write_samples(f, "nvs.commits", commits, count, false);
+        write_samples(f, "parser.ps_per_byte", parser, count, true);
+        fprintf(f, " }\n}\n");
+        fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Benchmark collector (see main/bench.h).
+
+Collects the benchmark metrics of a unit into a result file for
+tools/bench_compare.py. Metrics, lower is better for all of them:
+
+    boot.*_ms            boot timeline, time since reset of each milestone
+    connect.ms           last connect_wifi() that succeeded
+    nvs.commits          NVS commits since boot
+    parser.ps_per_byte   validate_and_extract_value(), ns per byte x 1000
+    rtt.*_ms             round trips measured here: list_networks, each provisioning step
+
+Per-boot metrics are taken once per boot, the others once per run.
+
+    bench_run.py --host 192.168.4.1 --runs 20 --ssid Site --password Secret --out results.json
+    bench_run.py --log boot1.log --log boot2.log --out results.json --append
+"""
+import argparse
+import json
+import os
+import re
+import socket
+import time
+
+PORT = 3333
+FORMAT = 1
+LOG_LINE = re.compile(r"BENCH: (\{.*\})")
+PER_RUN = ("parser.", "rtt.")
+
+
+class Unit:
+    def __init__(self, host):
+        self.sock = socket.create_connection((host, PORT), timeout=60)
+
+    def ask(self, payload):
+        """Sends a message, returns the reply and its round trip in ms."""
+        start = time.perf_counter()
+        self.sock.sendall(payload.encode())
+        reply = self.sock.recv(2048)
+        return reply.decode(), (time.perf_counter() - start) * 1000
+
+    def bench(self):
+        self.sock.sendall(b'{"command":"bench"}')
+        data = b""
+        while not data.endswith(b"# end\n"):
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+        return [json.loads(line) for line in data.decode().splitlines() if line.startswith("{")]
+
+    def close(self):
+        self.sock.close()
+
+
+def collect_unit(args, metrics):
+    for run in range(args.runs):
+        unit = Unit(args.host)
+        for entry in unit.bench():
+            if run == 0 or entry["metric"].startswith(PER_RUN):
+                metrics.setdefault(entry["metric"], []).append(entry["value"])
+        _, rtt = unit.ask('{"command":"list_networks"}')
+        metrics.setdefault("rtt.list_networks_ms", []).append(round(rtt, 2))
+        if args.ssid:
+            _, rtt = unit.ask(f'{{"wifi_name":"{args.ssid}"}}')
+            metrics.setdefault("rtt.wifi_name_ms", []).append(round(rtt, 2))
+            reply, rtt = unit.ask(f'{{"wifi_password":"{args.password}"}}')
+            if reply.startswith("Connected"):
+                metrics.setdefault("rtt.provision_ms", []).append(round(rtt, 2))
+        unit.close()
+
+
+def collect_log(path, metrics):
+    """Each boot.app_main_ms line starts a new boot, values of a boot count once."""
+    boot = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            match = LOG_LINE.search(line)
+            if not match:
+                continue
+            entry = json.loads(match.group(1))
+            if entry["metric"] == "boot.app_main_ms" and boot:
+                for metric, value in boot.items():
+                    metrics.setdefault(metric, []).append(value)
+                boot = {}
+            boot[entry["metric"]] = entry["value"]
+    for metric, value in boot.items():
+        metrics.setdefault(metric, []).append(value)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", help="unit to measure")
+    parser.add_argument("--runs", type=int, default=10)
+    parser.add_argument("--ssid", help="also time provisioning with these credentials")
+    parser.add_argument("--password", default="")
+    parser.add_argument("--log", action="append", default=[], help="serial log with BENCH lines")
+    parser.add_argument("--out", required=True, help="result file")
+    parser.add_argument("--append", action="store_true", help="add to the samples already in --out")
+    args = parser.parse_args()
+    if not args.host and not args.log:
+        parser.error("--host or --log needed")
+
+    metrics = {}
+    if args.append and os.path.exists(args.out):
+        with open(args.out) as f:
+            metrics = json.load(f)["metrics"]
+    if args.host:
+        collect_unit(args, metrics)
+    for path in args.log:
+        collect_log(path, metrics)
+
+    with open(args.out, "w") as f:
+        json.dump({"format": FORMAT, "metrics": metrics}, f, indent=1, sort_keys=True)
+    for metric, values in sorted(metrics.items()):
+        print(f"{metric:24} n={len(values):3}  median {sorted(values)[len(values) // 2]}")
+
+
+if __name__ == "__main__":
+    main()
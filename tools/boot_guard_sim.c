@@ -0,0 +1,197 @@
+/**
+ * @file boot_guard_sim.c
+ * @brief Host simulation of reset sequences through the boot loop guard
+ * @details Runs main/boot_guard.c the way app_main() does: the guard lives in
+ * memory that survives resets, starts out random as RTC memory does at
+ * power-on, and every boot reports how the previous one ended.
+ *
+ * Scripted sequences list, for every boot, how it ends and the mode it must
+ * get; a wrong mode is printed as MISMATCH. Only a provisioning save clears
+ * the guard: the credentials saved again at every GOT_IP are the stored ones,
+ * so a crash 10 s after GOT_IP still counts. A safe mode boot that runs
+ * retry_ms restarts to retry the stored network. The boot loop model then puts a
+ * unit with a stored network that crashes it during connect_wifi() through
+ * boots until it can be provisioned, for each crash limit: a normal boot
+ * crashes at -c ms, a safe mode boot has its provisioning AP and server up
+ * after -a ms.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o boot_guard_sim tools/boot_guard_sim.c main/boot_guard.c
+ *   ./boot_guard_sim [-v] [-c crash_ms] [-a ap_ms]
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boot_guard.h"
+
+#define MAX_BOOTS       16
+#define MODEL_MAX_BOOTS 20                // The model stops here: never serviceable
+
+typedef enum {
+    END_CRASH,                            // Panic or watchdog
+    END_RESTART,                          // Restart asked for by a client
+    END_FAILURE,                          // restart_last_resort()
+    END_PROVISION,                        // New credentials saved, then a client restart
+    END_POWER,                            // Power cycle
+    END_RETRY,                            // Safe mode ran retry_ms, restart to retry the stored network
+} boot_end_t;
+
+typedef struct {
+    boot_end_t end;
+    uint32_t uptime_ms;                   // When the boot ends
+    boot_mode_t expected;                 // Mode this boot must get
+} boot_step_t;
+
+typedef struct {
+    const char *name;
+    boot_step_t steps[MAX_BOOTS];
+    int count;
+} sequence_t;
+
+#define CRASH(ms, mode)   { END_CRASH, ms, mode }
+#define RESTART(ms, mode) { END_RESTART, ms, mode }
+#define FAILURE(ms, mode) { END_FAILURE, ms, mode }
+#define PROVISION(mode)   { END_PROVISION, 90000, mode }
+#define POWER(mode)       { END_POWER, 90000, mode }
+#define RETRY(mode)       { END_RETRY, 600000, mode }
+#define N BOOT_NORMAL
+#define S BOOT_SAFE_MODE
+
+static const sequence_t sequences[] = {
+    { "bad stored network", { CRASH(8000, N), CRASH(8000, N), CRASH(8000, N), POWER(S), POWER(N) }, 5 },
+    { "single crash", { CRASH(8000, N), POWER(N), CRASH(8000, N), CRASH(90000, N), CRASH(8000, N),
+                        POWER(N) }, 6 },
+    // GOT_IP about 3 s into each boot, the crash 10 s later
+    { "crash 10 s after GOT_IP", { CRASH(13000, N), CRASH(13000, N), CRASH(13000, N), POWER(S), POWER(N) }, 5 },
+    { "crashes after stable", { CRASH(90000, N), CRASH(120000, N), CRASH(61000, N), CRASH(90000, N),
+                                POWER(N) }, 5 },
+    { "client restarts", { RESTART(5000, N), RESTART(5000, N), RESTART(5000, N), RESTART(5000, N),
+                           POWER(N) }, 5 },
+    { "last resort restarts", { FAILURE(3000, N), FAILURE(3000, N), FAILURE(3000, N), POWER(S) }, 4 },
+    { "crash after last resort", { FAILURE(3000, N), CRASH(8000, N), CRASH(8000, N), POWER(S) }, 4 },
+    { "safe mode stays", { CRASH(8000, N), CRASH(8000, N), CRASH(8000, N), RESTART(5000, S),
+                           CRASH(90000, S), RESTART(90000, S), POWER(S) }, 7 },
+    { "provisioning leaves safe mode", { CRASH(8000, N), CRASH(8000, N), CRASH(8000, N), PROVISION(S),
+                                         CRASH(8000, N), POWER(N) }, 6 },
+    { "stable retry leaves safe mode", { CRASH(8000, N), CRASH(8000, N), CRASH(8000, N), RETRY(S),
+                                         RESTART(90000, N), CRASH(8000, N), POWER(N) }, 7 },
+    { "crashing retry back to safe", { CRASH(8000, N), CRASH(8000, N), CRASH(8000, N), RETRY(S),
+                                       CRASH(8000, N), RETRY(S), FAILURE(3000, N), RESTART(5000, S),
+                                       POWER(S) }, 9 },
+};
+
+static const char *mode_name(boot_mode_t mode) {
+    return mode == BOOT_SAFE_MODE ? "safe mode" : "normal";
+}
+
+/**
+ * @brief Reset reason seen by the boot after one that ended this way
+ */
+static boot_reset_t reset_after(boot_end_t end) {
+    switch (end) {
+    case END_CRASH:
+        return BOOT_RESET_CRASH;
+    case END_POWER:
+        return BOOT_RESET_POWER_ON;
+    default:
+        return BOOT_RESET_SOFTWARE;
+    }
+}
+
+/**
+ * @brief Runs one boot: the decision of app_main(), then the boot until its end
+ */
+static boot_mode_t run_boot(boot_guard_t *guard, const boot_guard_config_t *config, boot_reset_t reset,
+                            boot_end_t end, uint32_t uptime_ms) {
+    boot_mode_t mode = boot_guard_on_boot(guard, config, reset);
+    if (uptime_ms >= config->stable_ms) boot_guard_on_stable(guard);
+    if (end == END_FAILURE) boot_guard_on_failure(guard);
+    if (end == END_PROVISION) boot_guard_clear(guard);
+    if (end == END_RETRY) boot_guard_on_retry(guard);
+    return mode;
+}
+
+/**
+ * @brief Runs the scripted sequences
+ * @return Number of mismatches
+ */
+static int run_sequences(const boot_guard_config_t *config, bool verbose) {
+    int mismatches = 0;
+
+    for (size_t i = 0; i < sizeof(sequences) / sizeof(sequences[0]); i++) {
+        const sequence_t *seq = &sequences[i];
+        boot_guard_t guard;
+        memset(&guard, 0xa5, sizeof(guard));  // RTC memory after power-on
+        boot_reset_t reset = BOOT_RESET_POWER_ON;
+        int seq_mismatches = 0;
+
+        for (int b = 0; b < seq->count; b++) {
+            const boot_step_t *step = &seq->steps[b];
+            boot_mode_t mode = run_boot(&guard, config, reset, step->end, step->uptime_ms);
+            bool match = mode == step->expected;
+            seq_mismatches += !match;
+            if (verbose || !match) {
+                printf("  %-30s boot %d: %s, expected %s%s\n", seq->name, b + 1, mode_name(mode),
+                       mode_name(step->expected), match ? "" : "  MISMATCH");
+            }
+            reset = reset_after(step->end);
+        }
+        printf("%-32s %d boots, %s\n", seq->name, seq->count, seq_mismatches ? "FAILED" : "ok");
+        mismatches += seq_mismatches;
+    }
+    return mismatches;
+}
+
+/**
+ * @brief Boots a unit whose stored network crashes it until it is serviceable
+ * @return Time from the first power-on to a running provisioning AP, -1 if never
+ */
+static int64_t model_boot_loop(const boot_guard_config_t *config, uint32_t crash_ms, uint32_t ap_ms,
+                               int *boots) {
+    boot_guard_t guard;
+    memset(&guard, 0xa5, sizeof(guard));
+    boot_reset_t reset = BOOT_RESET_POWER_ON;
+    int64_t t = 0;
+
+    for (*boots = 1; *boots <= MODEL_MAX_BOOTS; (*boots)++) {
+        if (boot_guard_on_boot(&guard, config, reset) == BOOT_SAFE_MODE) return t + ap_ms;
+        t += crash_ms;
+        reset = BOOT_RESET_CRASH;
+    }
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    bool verbose = false;
+    uint32_t crash_ms = 8000, ap_ms = 900;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "vc:a:")) != -1) {
+        switch (opt) {
+        case 'v': verbose = true; break;
+        case 'c': crash_ms = strtoul(optarg, NULL, 10); break;
+        case 'a': ap_ms = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "usage: %s [-v] [-c crash_ms] [-a ap_ms]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const boot_guard_config_t config = BOOT_GUARD_DEFAULT_CONFIG();
+    int mismatches = run_sequences(&config, verbose);
+
+    printf("\nBoot loop, crash %.1f s into each normal boot, provisioning AP %.1f s into safe mode:\n",
+           crash_ms / 1000.0, ap_ms / 1000.0);
+    for (uint8_t limit = 1; limit <= 5; limit++) {
+        boot_guard_config_t model = config;
+        model.crash_limit = limit;
+        int boots;
+        int64_t serviceable_ms = model_boot_loop(&model, crash_ms, ap_ms, &boots);
+        printf("  crash_limit %d: serviceable after %.1f s, boot %d%s\n", limit, serviceable_ms / 1000.0, boots,
+               limit == config.crash_limit ? " (default)" : "");
+    }
+    printf("  without the guard: never serviceable\n");
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Session capture export and decoder (see main/capture.h).
+
+Fetches the capture ring of a unit, or reads a saved dump, writes the binary
+capture for tools/capture_replay.c and prints the session timeline.
+
+    capture_decode.py --host 192.168.4.1 --out field.cap
+    capture_decode.py --file dump.txt --out field.cap --quiet
+"""
+import argparse
+import socket
+import struct
+import sys
+
+PORT = 3333
+FORMAT = 1
+RECORD = struct.Struct("<IHBB")           # capture_record_t
+
+MARKS = {1: "boot", 2: "connect_wifi", 3: "safe mode"}
+NVS_OPS = {1: "open", 2: "get", 3: "set", 4: "commit"}
+# esp_wifi_types.h and esp_netif_types.h
+WIFI_EVENTS = {0: "WIFI_READY", 1: "SCAN_DONE", 2: "STA_START", 3: "STA_STOP", 4: "STA_CONNECTED",
+               5: "STA_DISCONNECTED", 12: "AP_START", 13: "AP_STOP", 14: "AP_STACONNECTED",
+               15: "AP_STADISCONNECTED"}
+IP_EVENTS = {0: "STA_GOT_IP", 1: "STA_LOST_IP", 2: "AP_STAIPASSIGNED"}
+ACTIONS = {0: "retry", 1: "give up"}
+
+
+def fetch(host):
+    with socket.create_connection((host, PORT), timeout=10) as sock:
+        sock.sendall(b'{"command":"capture_dump"}')
+        data = b""
+        while not data.endswith(b"# end\n"):
+            chunk = sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+    return data.decode()
+
+
+def parse_dump(text):
+    header, raw = {}, bytearray()
+    for line in text.splitlines():
+        if line.startswith("# capture"):
+            header = {k: int(v) for k, v in (field.split("=") for field in line.split()[2:])}
+        elif line == "# overrun":
+            print("warning: records were dropped during the dump, the capture is cut short", file=sys.stderr)
+        elif line and not line.startswith("#"):
+            raw += bytes.fromhex(line)
+    return header, bytes(raw)
+
+
+def records(raw):
+    """Yields (t_ms, type, code, payload), a cut last record is ignored."""
+    pos = 0
+    while pos + RECORD.size <= len(raw):
+        t_ms, code, kind, length = RECORD.unpack_from(raw, pos)
+        if pos + RECORD.size + length > len(raw):
+            break
+        yield t_ms, kind, code, raw[pos + RECORD.size:pos + RECORD.size + length]
+        pos += RECORD.size + length
+
+
+def describe(kind, code, payload):
+    if kind == 1:
+        return f"mark {MARKS.get(code, code)}"
+    if kind == 2:
+        base, event = code >> 8, code & 0xff
+        name = (WIFI_EVENTS if base == 1 else IP_EVENTS).get(event, f"{base}:{event}")
+        if name == "STA_DISCONNECTED" and len(payload) == 2:
+            reason, rssi = struct.unpack("<Bb", payload)
+            return f"event {name} reason {reason} rssi {rssi}"
+        if name == "STA_CONNECTED" and payload:
+            return f"event {name} channel {payload[0]}"
+        if name == "STA_GOT_IP" and len(payload) == 4:
+            return f"event {name} {socket.inet_ntoa(payload)}"
+        if name in ("AP_STACONNECTED", "AP_STADISCONNECTED") and len(payload) == 6:
+            return f"event {name} {payload.hex(':')}"
+        return f"event {name}"
+    if kind == 3:
+        if code == 1:
+            return f"rx {struct.unpack('<H', payload)[0]} bytes (redacted)"
+        return f"rx {payload.decode(errors='replace')!r}"
+    if kind == 4:
+        err, duration_us = struct.unpack("<iI", payload)
+        return f"nvs {NVS_OPS.get(code, code)} err {err:#x} in {duration_us} us"
+    if kind == 5:
+        if code == 1:
+            action, suppressed = struct.unpack("<BB", payload)
+            return f"decision {ACTIONS.get(action, action)}" + (", link suppressed" if suppressed else "")
+        if code == 2:
+            return f"decision publish in {struct.unpack('<I', payload)[0]} ms"
+    return f"type {kind} code {code} {payload.hex()}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--host", help="unit to fetch the capture from")
+    source.add_argument("--file", help="saved text dump")
+    parser.add_argument("--out", help="binary capture for tools/capture_replay.c")
+    parser.add_argument("--quiet", action="store_true", help="no timeline")
+    args = parser.parse_args()
+
+    text = fetch(args.host) if args.host else open(args.file).read()
+    header, raw = parse_dump(text)
+    if not header:
+        sys.exit("No capture in the dump")
+    if header["format"] != FORMAT:
+        sys.exit(f"Capture format {header['format']}, this tool reads {FORMAT}")
+
+    decoded = list(records(raw))
+    print(f"{len(decoded)} records, {header['dropped']} older ones dropped on the unit, "
+          f"unit time {header['now_ms'] / 1000:.3f} s", file=sys.stderr)
+    if args.out:
+        end = sum(RECORD.size + len(payload) for _, _, _, payload in decoded)
+        with open(args.out, "wb") as f:
+            f.write(raw[:end])
+    if not args.quiet:
+        previous = None
+        for t_ms, kind, code, payload in decoded:
+            delta = f"+{t_ms - previous:6}" if previous is not None else " " * 7
+            print(f"{t_ms / 1000:10.3f} {delta}  {describe(kind, code, payload)}")
+            previous = t_ms
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,192 @@
+/**
+ * @file capture_replay.c
+ * @brief Replays a field session capture through the reconnect logic
+ * @details Feeds the WiFi and IP events of a capture (main/capture.h, written
+ * by tools/capture_decode.py) into the same conn_policy.c and flap_damping.c
+ * the firmware runs, on a virtual clock taken from the record times, like
+ * wifi_event_handler() and connect_wifi() in main/main.c:
+ * - mark connect_wifi: policy and damping reset
+ * - STA_DISCONNECTED: a lost link counts as a flap, then the policy decides
+ * - STA_GOT_IP: the policy resets, damping gives the publish delay
+ * Every decision is compared to the one the unit recorded, so a replay is
+ * deterministic and shows where a change to the logic would behave
+ * differently on the same session. Disconnects the unit took no decision on
+ * (relay mode) are skipped. Records before the first boot or connect mark
+ * are skipped, the state they depend on is gone.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o capture_replay tools/capture_replay.c main/conn_policy.c main/flap_damping.c -lm
+ *   ./capture_replay [-v] field.cap
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+#include "conn_policy.h"
+#include "flap_damping.h"
+
+// Same values as esp_wifi_types.h and esp_netif_types.h
+#define WIFI_EVENT_STA_DISCONNECTED 5
+#define IP_EVENT_STA_GOT_IP         0
+
+#define MAX_CONNECTS 64                   // connect_wifi() calls kept for the summary
+
+typedef struct {
+    bool started;                         // A boot or connect mark was seen
+    conn_policy_t policy;
+    flap_damping_t damping;
+    bool link_up;
+    int64_t disconnect_ms;                // Pending STA_DISCONNECTED, -1 if none
+    int64_t got_ip_ms;                    // Pending STA_GOT_IP, -1 if none
+} replay_t;
+
+typedef struct {
+    int64_t start_ms;                     // connect_wifi() called
+    int64_t ip_ms;                        // First GOT_IP after it, -1 if none
+    int retries;
+} connect_t;
+
+static const char *action_name(int action) {
+    return action == CONN_RETRY ? "retry" : "give up";
+}
+
+/**
+ * @brief Starts over as connect_wifi() does
+ */
+static void replay_connect(replay_t *r) {
+    flap_damping_reset(&r->damping);
+    conn_policy_reset(&r->policy);
+    r->link_up = false;
+    r->disconnect_ms = -1;
+    r->got_ip_ms = -1;
+    r->started = true;
+}
+
+int main(int argc, char **argv) {
+    bool verbose = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        if (opt != 'v') {
+            fprintf(stderr, "usage: %s [-v] capture.cap\n", argv[0]);
+            return 2;
+        }
+        verbose = true;
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-v] capture.cap\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(argv[optind], "rb");
+    if (!f) {
+        perror(argv[optind]);
+        return 2;
+    }
+    static uint8_t raw[CAPTURE_RING_SIZE];
+    size_t size = fread(raw, 1, sizeof(raw), f);
+    fclose(f);
+
+    replay_t r = { .disconnect_ms = -1, .got_ip_ms = -1 };
+    conn_policy_config_t policy_config = CONN_POLICY_DEFAULT_CONFIG();
+    flap_damping_config_t damping_config = FLAP_DAMPING_DEFAULT_CONFIG();
+    conn_policy_init(&r.policy, &policy_config);
+    flap_damping_init(&r.damping, &damping_config);
+
+    connect_t connects[MAX_CONNECTS];
+    int connect_count = 0;
+    int compared = 0, mismatches = 0, records = 0;
+
+    for (size_t pos = 0; pos + sizeof(capture_record_t) <= size; records++) {
+        capture_record_t rec;
+        memcpy(&rec, raw + pos, sizeof(rec));
+        const uint8_t *payload = raw + pos + sizeof(rec);
+        if (pos + sizeof(rec) + rec.len > size) break;
+        pos += sizeof(rec) + rec.len;
+        int64_t now = rec.t_ms;
+
+        if (rec.type == CAPTURE_MARK && rec.code == CAPTURE_MARK_SAFE_MODE) {
+            if (verbose) printf("%10.3f  safe mode\n", now / 1000.0);
+        } else if (rec.type == CAPTURE_MARK) {
+            if (rec.code == CAPTURE_MARK_BOOT) {
+                conn_policy_init(&r.policy, &policy_config);
+                flap_damping_init(&r.damping, &damping_config);
+                if (verbose) printf("%10.3f  boot\n", now / 1000.0);
+            }
+            replay_connect(&r);
+            if (rec.code == CAPTURE_MARK_CONNECT && connect_count < MAX_CONNECTS) {
+                connects[connect_count++] = (connect_t){ .start_ms = now, .ip_ms = -1 };
+                if (verbose) printf("%10.3f  connect_wifi()\n", now / 1000.0);
+            }
+        } else if (rec.type == CAPTURE_EVENT && r.started) {
+            if (rec.code == CAPTURE_EVENT_CODE(CAPTURE_BASE_WIFI, WIFI_EVENT_STA_DISCONNECTED)) {
+                r.disconnect_ms = now;
+            } else if (rec.code == CAPTURE_EVENT_CODE(CAPTURE_BASE_IP, IP_EVENT_STA_GOT_IP)) {
+                r.got_ip_ms = now;
+            }
+        } else if (rec.type == CAPTURE_DECISION && r.started) {
+            if (rec.code == CAPTURE_DECISION_RECONNECT && r.disconnect_ms >= 0 &&
+                rec.len >= sizeof(capture_reconnect_t)) {
+                capture_reconnect_t unit;
+                memcpy(&unit, payload, sizeof(unit));
+
+                // wifi_event_handler(): WIFI_EVENT_STA_DISCONNECTED
+                bool suppressed = false;
+                if (r.link_up) {
+                    r.link_up = false;
+                    suppressed = flap_damping_record_flap(&r.damping, r.disconnect_ms);
+                }
+                conn_action_t action = conn_policy_on_disconnect(&r.policy);
+                r.disconnect_ms = -1;
+
+                bool match = action == unit.action && suppressed == unit.suppressed;
+                compared++;
+                mismatches += !match;
+                if (verbose || !match) {
+                    printf("%10.3f  disconnect: replay %s%s, unit %s%s%s\n", now / 1000.0,
+                           action_name(action), suppressed ? " suppressed" : "",
+                           action_name(unit.action), unit.suppressed ? " suppressed" : "",
+                           match ? "" : "  MISMATCH");
+                }
+                if (action == CONN_RETRY && connect_count > 0 && connects[connect_count - 1].ip_ms < 0) {
+                    connects[connect_count - 1].retries++;
+                }
+            } else if (rec.code == CAPTURE_DECISION_PUBLISH && r.got_ip_ms >= 0 && rec.len >= 4) {
+                uint32_t unit_delay;
+                memcpy(&unit_delay, payload, sizeof(unit_delay));
+
+                // wifi_event_handler(): IP_EVENT_STA_GOT_IP
+                r.link_up = true;
+                conn_policy_reset(&r.policy);
+                uint32_t delay = flap_damping_reuse_delay_ms(&r.damping, r.got_ip_ms);
+                if (connect_count > 0 && connects[connect_count - 1].ip_ms < 0) {
+                    connects[connect_count - 1].ip_ms = r.got_ip_ms;
+                }
+                r.got_ip_ms = -1;
+
+                // The delay is computed a few ms apart on the unit, allow for it
+                bool match = (delay == 0) == (unit_delay == 0) &&
+                             (delay > unit_delay ? delay - unit_delay : unit_delay - delay) <= 50;
+                compared++;
+                mismatches += !match;
+                if (verbose || !match) {
+                    printf("%10.3f  got ip: replay publish in %u ms, unit %u ms%s\n", now / 1000.0,
+                           delay, unit_delay, match ? "" : "  MISMATCH");
+                }
+            }
+        }
+    }
+
+    printf("%d records, %d decisions compared, %d mismatches\n", records, compared, mismatches);
+    for (int i = 0; i < connect_count; i++) {
+        if (connects[i].ip_ms >= 0) {
+            printf("  connect at %.3f s: IP after %.3f s, %d retries\n", connects[i].start_ms / 1000.0,
+                   (connects[i].ip_ms - connects[i].start_ms) / 1000.0, connects[i].retries);
+        } else {
+            printf("  connect at %.3f s: no IP, %d retries\n", connects[i].start_ms / 1000.0,
+                   connects[i].retries);
+        }
+    }
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file config_apply_test.c
+ * @brief Host test of the configuration apply engine and its driver actions
+ * @details Runs main/config_apply.c with the driver actions of
+ * main/config_ops.c, against esp_wifi, esp_netif and connect stand-ins that
+ * only count their calls. Every case applies one change to a known active
+ * configuration and checks how many times each driver call ran and what
+ * became active, so a change that restarts more than it needs to shows up as
+ * a wrong count. The connect stand-in stands for connect_wifi() in main.c,
+ * one call being one STA restart. A wrong count is printed as FAIL.
+ *
+ * The pushed configuration cases run config_ops_apply_pushed(): credentials
+ * that never get an address must be rolled back to the previous network.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Itools/host -Imain -o config_apply_test tools/config_apply_test.c main/config_apply.c main/config_ops.c
+ *   ./config_apply_test
+ */
+#include <stdio.h>
+#include <string.h>
+#include "config_apply.h"
+#include "config_ops.h"
+#include "esp_wifi.h"
+#include "uplink_queue.h"
+#include "wifi_netif.h"
+
+/**
+ * @brief Driver calls made by one apply
+ */
+typedef struct {
+    int log_level;                        // esp_log_level_set()
+    int sink;                             // uplink_queue_set_sink()
+    int hostname;                         // esp_netif_set_hostname()
+    int dhcp_stop;                        // esp_netif_dhcpc_stop()
+    int dhcp_start;                       // esp_netif_dhcpc_start()
+    int ip_info;                          // esp_netif_set_ip_info()
+    int ap_get;                           // esp_wifi_get_config(WIFI_IF_AP)
+    int ap_set;                           // esp_wifi_set_config(WIFI_IF_AP)
+    int connect;                          // connect_wifi()
+} driver_calls_t;
+
+#define BAD_SSID "Bad"                    // Network connect_wifi() never gets an address from
+
+struct esp_netif_obj {
+    int unused;
+};
+
+static driver_calls_t calls;
+static wifi_mode_t wifi_mode = WIFI_MODE_APSTA;
+static esp_err_t connect_result;          // Returned by connect_wifi(), except for BAD_SSID
+static char connected_ssid[WIFI_NAME_SIZE + 1]; // Network of the last connect_wifi() that succeeded
+static struct esp_netif_obj sta_netif;
+
+/* ---- Stand-ins ---- */
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    calls.log_level++;
+}
+
+esp_err_t uplink_queue_set_sink(const uplink_queue_config_t *config) {
+    calls.sink++;
+    return ESP_OK;
+}
+
+esp_netif_t *wifi_netif_sta(void) {
+    return &sta_netif;
+}
+
+esp_err_t esp_netif_set_hostname(esp_netif_t *netif, const char *hostname) {
+    calls.hostname++;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *netif) {
+    calls.dhcp_stop++;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *netif) {
+    calls.dhcp_start++;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info) {
+    calls.ip_info++;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode) {
+    *mode = wifi_mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf) {
+    if (interface == WIFI_IF_AP) calls.ap_get++;
+    memset(conf, 0, sizeof(*conf));
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf) {
+    if (interface == WIFI_IF_AP) calls.ap_set++;
+    return ESP_OK;
+}
+
+static esp_err_t connect_wifi(const char *ssid, const char *password) {
+    calls.connect++;
+    // Associates but never gets an address, like a wrong password
+    if (strcmp(ssid, BAD_SSID) == 0) return ESP_ERR_TIMEOUT;
+    if (connect_result == ESP_OK) snprintf(connected_ssid, sizeof(connected_ssid), "%s", ssid);
+    return connect_result;
+}
+
+/* ---- Cases ---- */
+
+typedef void (*change_fn_t)(device_config_t *config);
+
+typedef struct {
+    const char *name;
+    change_fn_t change;
+    wifi_mode_t mode;                     // Mode the driver reports, 0 for APSTA
+    esp_err_t connect_result;             // Returned by connect_wifi()
+    driver_calls_t expected;              // Expected driver calls
+    esp_err_t result;                     // Expected result of config_apply()
+    bool becomes_active;                  // The whole change is active afterwards
+} test_case_t;
+
+static void no_change(device_config_t *c) {}
+static void log_level(device_config_t *c) { c->log_level = ESP_LOG_DEBUG; }
+static void timeout(device_config_t *c) { c->wifi_timeout_ms = 10000; }
+static void scan(device_config_t *c) { c->scan_home_ms = 200; }
+static void relay_heartbeat(device_config_t *c) { c->relay = true; c->heartbeat_s = 0; }
+static void uplink(device_config_t *c) { strcpy(c->uplink_host, "10.0.0.5"); c->uplink_port = 6000; }
+static void hostname(device_config_t *c) { strcpy(c->hostname, "line3-unit12"); }
+static void static_ip(device_config_t *c) { c->static_ip = true; IP4_ADDR(&c->ip_info.ip, 192, 168, 0, 50); }
+static void dhcp_address(device_config_t *c) { IP4_ADDR(&c->ip_info.ip, 192, 168, 0, 50); }
+static void ssid(device_config_t *c) { strcpy(c->ssid, "Other"); }
+static void password(device_config_t *c) { strcpy(c->password, "NewSecret"); }
+static void ap_channel(device_config_t *c) { c->ap_channel = 6; }
+static void ssid_hostname(device_config_t *c) { ssid(c); hostname(c); }
+static void ssid_password(device_config_t *c) { ssid(c); password(c); }
+static void everything(device_config_t *c) { ssid(c); hostname(c); log_level(c); timeout(c); }
+
+static const test_case_t cases[] = {
+    { "unchanged",           no_change,       0, ESP_OK, { 0 }, ESP_OK, true },
+    { "log level",           log_level,       0, ESP_OK, { .log_level = 1 }, ESP_OK, true },
+    { "timeout",             timeout,         0, ESP_OK, { 0 }, ESP_OK, true },
+    { "scan budget",         scan,            0, ESP_OK, { 0 }, ESP_OK, true },
+    { "relay and heartbeat", relay_heartbeat, 0, ESP_OK, { 0 }, ESP_OK, true },
+    { "uplink sink",         uplink,          0, ESP_OK, { .sink = 1 }, ESP_OK, true },
+    { "hostname",            hostname,        0, ESP_OK, { .hostname = 1, .dhcp_stop = 1, .dhcp_start = 1 },
+      ESP_OK, true },
+    { "static IP",           static_ip,       0, ESP_OK, { .hostname = 1, .dhcp_stop = 1, .ip_info = 1 },
+      ESP_OK, true },
+    // Ignored while DHCP is on, so the stored address stays as it was
+    { "address under DHCP",  dhcp_address,    0, ESP_OK, { 0 }, ESP_OK, false },
+    { "SSID",                ssid,            0, ESP_OK, { .connect = 1 }, ESP_OK, true },
+    { "password",            password,        0, ESP_OK, { .connect = 1 }, ESP_OK, true },
+    { "SSID and password",   ssid_password,   0, ESP_OK, { .connect = 1 }, ESP_OK, true },
+    { "AP channel",          ap_channel,      0, ESP_OK, { .ap_get = 1, .ap_set = 1 }, ESP_OK, true },
+    { "AP channel, no AP",   ap_channel,      WIFI_MODE_STA, ESP_OK, { 0 }, ESP_OK, true },
+    // The STA restart brings the netif up: no separate DHCP restart
+    { "SSID and hostname",   ssid_hostname,   0, ESP_OK, { .hostname = 1, .dhcp_start = 1, .connect = 1 },
+      ESP_OK, true },
+    { "everything",          everything,      0, ESP_OK,
+      { .log_level = 1, .hostname = 1, .dhcp_start = 1, .connect = 1 }, ESP_OK, true },
+    { "failed SSID",         ssid,            0, ESP_ERR_TIMEOUT, { .connect = 1 }, ESP_ERR_TIMEOUT, false },
+};
+
+static void start(device_config_t *initial) {
+    device_config_set_defaults(initial);
+    strcpy(initial->ssid, "Site");
+    strcpy(initial->password, "Secret");
+    config_ops_init(initial, connect_wifi);
+    memset(&calls, 0, sizeof(calls));
+    wifi_mode = WIFI_MODE_APSTA;
+    connect_result = ESP_OK;
+    strcpy(connected_ssid, initial->ssid);
+}
+
+/**
+ * @brief Prints the calls that ran, name=count
+ */
+static void print_calls(const driver_calls_t *c) {
+    const struct { const char *name; int count; } list[] = {
+        { "log_level", c->log_level }, { "sink", c->sink }, { "hostname", c->hostname },
+        { "dhcp_stop", c->dhcp_stop }, { "dhcp_start", c->dhcp_start }, { "ip_info", c->ip_info },
+        { "ap_get", c->ap_get }, { "ap_set", c->ap_set }, { "connect", c->connect },
+    };
+    int printed = 0;
+    for (size_t i = 0; i < sizeof(list) / sizeof(list[0]); i++) {
+        if (list[i].count == 0) continue;
+        printf(" %s=%d", list[i].name, list[i].count);
+        printed++;
+    }
+    if (!printed) printf(" none");
+}
+
+/**
+ * @brief Runs one case
+ * @return true if it passed
+ */
+static bool run(const test_case_t *test) {
+    device_config_t initial, next;
+
+    start(&initial);
+    if (test->mode) wifi_mode = test->mode;
+    connect_result = test->connect_result;
+    next = initial;
+    test->change(&next);
+    esp_err_t result = config_apply(&next);
+
+    bool active = memcmp(config_apply_active(), &next, sizeof(next)) == 0;
+    bool ok = result == test->result && memcmp(&calls, &test->expected, sizeof(calls)) == 0 &&
+              active == test->becomes_active;
+    printf("%-4s %-20s", ok ? "ok" : "FAIL", test->name);
+    print_calls(&calls);
+    printf("%s\n", active ? "" : ", not active");
+    return ok;
+}
+
+int main(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        failed += !run(&cases[i]);
+    }
+
+    // A failed radio action leaves the live fields of the same change applied
+    device_config_t initial, next;
+    start(&initial);
+    next = initial;
+    everything(&next);
+    connect_result = ESP_ERR_TIMEOUT;
+    config_apply(&next);
+    const device_config_t *active = config_apply_active();
+    bool ok = active->log_level == next.log_level && strcmp(active->ssid, initial.ssid) == 0 &&
+              strcmp(active->hostname, initial.hostname) == 0;
+    printf("%-4s %-20s live fields active, radio and netif fields not\n", ok ? "ok" : "FAIL", "partial failure");
+    failed += !ok;
+
+    // A pushed SSID that does not connect: error, so it is not acked, and back on the previous network
+    start(&initial);
+    next = initial;
+    strcpy(next.ssid, BAD_SSID);
+    next.log_level = ESP_LOG_DEBUG;
+    esp_err_t result = config_ops_apply_pushed(&next);
+    ok = result == ESP_ERR_TIMEOUT && calls.connect == 2 && strcmp(connected_ssid, initial.ssid) == 0 &&
+         strcmp(config_apply_active()->ssid, initial.ssid) == 0;
+    printf("%-4s %-20s error %s, %d connects, back on %s\n", ok ? "ok" : "FAIL", "bad pushed SSID",
+           esp_err_to_name(result), calls.connect, connected_ssid);
+    failed += !ok;
+
+    // A pushed SSID that connects stays, without a rollback
+    start(&initial);
+    next = initial;
+    ssid(&next);
+    result = config_ops_apply_pushed(&next);
+    ok = result == ESP_OK && calls.connect == 1 && strcmp(connected_ssid, next.ssid) == 0 &&
+         strcmp(config_apply_active()->ssid, next.ssid) == 0;
+    printf("%-4s %-20s %d connect, on %s\n", ok ? "ok" : "FAIL", "good pushed SSID", calls.connect, connected_ssid);
+    failed += !ok;
+
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
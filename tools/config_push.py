@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Encrypted multicast configuration push (see main/config_push.h).
+
+Sends one encrypted configuration update to every unit listening on the group,
+repeats it to cover packet loss, and collects the acks.
+
+    config_push.py --key <64 hex> --version 7 --ssid Site --password NewSecret
+    config_push.py --simulate 500     # ack storm model, no network traffic
+
+Pushes need the cryptography package (pip install cryptography).
+"""
+import argparse
+import collections
+import hashlib
+import hmac
+import os
+import random
+import socket
+import struct
+import time
+
+GROUP = "239.255.67.80"
+PORT = 3334
+MAGIC = 0x4350
+ACK_MAGIC = 0x4341
+FORMAT = 2
+ACK_JITTER_MS = 5000
+
+# CONFIG_FIELD_* bits from main/config_apply.h
+FIELD_SSID = 1 << 0
+FIELD_PASSWORD = 1 << 1
+FIELD_LOG_LEVEL = 1 << 4
+FIELD_TIMEOUT = 1 << 6
+
+STATUS = {0: "applied", 1: "current", 2: "failed", 3: "unsupported"}
+
+HEADER = struct.Struct(">HBBIHBI12s")   # config_push_msg_t up to the nonce
+SECRET = struct.Struct("32s64s")         # SSID and password, encrypted
+ACK = struct.Struct(">HBBI6s")           # config_push_ack_t
+
+
+def seal_key(key):
+    """AES-GCM key derived from the site key, like derive_seal_key() in main/site_auth.c"""
+    return hmac.new(key, b"site_auth seal", hashlib.sha256).digest()
+
+
+def build(key, version, ssid, password, log_level, timeout_ms, nonce=None):
+    from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+
+    fields = 0
+    if ssid is not None:
+        fields |= FIELD_SSID
+    if password is not None:
+        fields |= FIELD_PASSWORD
+    if log_level is not None:
+        fields |= FIELD_LOG_LEVEL
+    if timeout_ms is not None:
+        fields |= FIELD_TIMEOUT
+    # A random nonce per message; the repeats of one push are the same datagram
+    nonce = nonce or os.urandom(12)
+    header = HEADER.pack(MAGIC, FORMAT, 0, version, fields, log_level or 0, timeout_ms or 0, nonce)
+    secret = SECRET.pack((ssid or "").encode()[:31], (password or "").encode()[:63])
+    # encrypt() returns the ciphertext followed by the 16-byte tag
+    return header + AESGCM(seal_key(key)).encrypt(nonce, secret, header)
+
+
+def histogram(times_ms, bucket_ms):
+    buckets = collections.Counter(int(t // bucket_ms) for t in times_ms)
+    for b in sorted(buckets):
+        print(f"  {b * bucket_ms / 1000:5.1f} s  {'#' * buckets[b]} {buckets[b]}")
+    return max(buckets.values()) if buckets else 0
+
+
+def simulate(units, bucket_ms):
+    """Arrival of the acks of a fleet with the firmware jitter"""
+    times = [random.uniform(0, ACK_JITTER_MS) for _ in range(units)]
+    peak = histogram(times, bucket_ms)
+    print(f"{units} units: peak {peak} acks per {bucket_ms} ms, "
+          f"mean {units * 1000 / ACK_JITTER_MS:.0f} acks/s")
+
+
+def push(args):
+    msg = build(bytes.fromhex(args.key), args.version, args.ssid, args.password,
+                args.log_level, args.timeout)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    sock.settimeout(0.1)
+
+    start = time.monotonic()
+    sent = 0
+    acks = {}
+    arrivals = []
+    while time.monotonic() - start < args.wait:
+        # Repeats are spread over the first second, duplicates are acked as "current"
+        if sent < args.repeat and time.monotonic() - start >= sent / args.repeat:
+            sock.sendto(msg, (GROUP, PORT))
+            sent += 1
+        try:
+            data, addr = sock.recvfrom(64)
+        except socket.timeout:
+            continue
+        if len(data) != ACK.size:
+            continue
+        magic, status, _, version, mac = ACK.unpack(data)
+        if magic != ACK_MAGIC or version != args.version:
+            continue
+        arrivals.append((time.monotonic() - start) * 1000)
+        # The first answer of a unit tells what happened, later ones answer the repeats
+        acks.setdefault(mac.hex(":"), (STATUS.get(status, status), addr[0]))
+
+    for mac, (status, ip) in sorted(acks.items()):
+        print(f"{mac}  {ip:15}  {status}")
+    print(f"{len(acks)} units answered:",
+          dict(collections.Counter(status for status, _ in acks.values())))
+    if arrivals:
+        histogram(arrivals, args.bucket)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--key", help="site key, 64 hex digits")
+    parser.add_argument("--version", type=int, help="configuration version, must increase")
+    parser.add_argument("--ssid")
+    parser.add_argument("--password")
+    parser.add_argument("--log-level", type=int)
+    parser.add_argument("--timeout", type=int, help="WiFi connection timeout in ms")
+    parser.add_argument("--repeat", type=int, default=3, help="copies of the push")
+    parser.add_argument("--wait", type=float, default=40, help="seconds to collect acks, "
+                        "credentials changes reconnect before acking")
+    parser.add_argument("--bucket", type=int, default=250, help="histogram bucket in ms")
+    parser.add_argument("--simulate", type=int, metavar="UNITS", help="model the ack storm only")
+    args = parser.parse_args()
+
+    if args.simulate:
+        simulate(args.simulate, args.bucket)
+    elif args.key and args.version is not None:
+        push(args)
+    else:
+        parser.error("--key and --version are required")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,80 @@
+/**
+ * @file csa_plan_test.c
+ * @brief Host test of the channel switch planning in main/csa_plan.c
+ * @details Checks csa_plan_count() and csa_plan() against hand-computed
+ * plans: the active and idle beacon settings of the provisioning AP, a DTIM
+ * period that does not fit the delay limit, the clamps to [1, 255] and the
+ * degenerate inputs (DTIM 0, beacon interval 0, no delay allowed). A wrong
+ * result is printed as FAIL.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o csa_plan_test tools/csa_plan_test.c main/csa_plan.c
+ *   ./csa_plan_test
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "csa_plan.h"
+
+typedef struct {
+    const char *name;
+    csa_plan_params_t params;
+    uint8_t count;                        // Expected csa_plan_count()
+} count_case_t;
+
+typedef struct {
+    const char *name;
+    uint8_t ap_channel;
+    uint8_t sta_channel;
+    int stations;
+    csa_plan_t plan;                      // Expected plan, 100 TU beacons and DTIM 1
+} plan_case_t;
+
+#define PARAMS(beacon, dtim_period, heard, delay) \
+    { .beacon_tu = (beacon), .dtim = (dtim_period), .min_heard = (heard), .max_delay_ms = (delay) }
+
+static const count_case_t count_cases[] = {
+    { "active, 100 TU DTIM 1", CSA_PLAN_DEFAULT_PARAMS(100, 1), 3 },        // 307 ms
+    { "idle, 1000 TU DTIM 3", CSA_PLAN_DEFAULT_PARAMS(1000, 3), 3 },        // One DTIM period, 3 s
+    { "100 TU DTIM 3", CSA_PLAN_DEFAULT_PARAMS(100, 3), 9 },                // 921 ms
+    { "300 TU DTIM 3, shortened", CSA_PLAN_DEFAULT_PARAMS(300, 3), 6 },     // 9 beacons are 2.7 s
+    { "200 TU DTIM 10, one DTIM", CSA_PLAN_DEFAULT_PARAMS(200, 10), 10 },   // 2 s fit 9 beacons
+    { "DTIM 0 taken as 1", CSA_PLAN_DEFAULT_PARAMS(100, 0), 3 },
+    { "beacon interval 0", CSA_PLAN_DEFAULT_PARAMS(0, 1), 3 },
+    { "no delay allowed", PARAMS(100, 1, 3, 0), 1 },
+    { "clamped to 255", PARAMS(1, 10, 100, 2000), 255 },                  // 1000 beacons of 1 TU
+    { "nothing to hear", PARAMS(100, 1, 0, 2000), 1 },
+};
+
+static const plan_case_t plan_cases[] = {
+    { "same channel", 6, 6, 2, { false, false, 1, 0 } },
+    { "no stations", 1, 6, 0, { true, false, 1, 102 } },
+    { "stations to warn", 1, 11, 2, { true, true, 3, 307 } },
+};
+
+int main(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(count_cases) / sizeof(count_cases[0]); i++) {
+        const count_case_t *c = &count_cases[i];
+        uint8_t count = csa_plan_count(&c->params);
+        bool ok = count == c->count;
+        printf("%-4s %-28s count %3d, expected %3d\n", ok ? "ok" : "FAIL", c->name, count, c->count);
+        failed += !ok;
+    }
+
+    for (size_t i = 0; i < sizeof(plan_cases) / sizeof(plan_cases[0]); i++) {
+        const plan_case_t *c = &plan_cases[i];
+        csa_plan_params_t params = CSA_PLAN_DEFAULT_PARAMS(100, 1);
+        csa_plan_t plan;
+        csa_plan(c->ap_channel, c->sta_channel, c->stations, &params, &plan);
+        bool ok = plan.switch_needed == c->plan.switch_needed && plan.announce == c->plan.announce &&
+                  plan.count == c->plan.count && plan.delay_ms == c->plan.delay_ms;
+        printf("%-4s %-28s switch %d, announce %d, count %d, %u ms\n", ok ? "ok" : "FAIL", c->name,
+               plan.switch_needed, plan.announce, plan.count, (unsigned)plan.delay_ms);
+        failed += !ok;
+    }
+
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
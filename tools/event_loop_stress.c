@@ -0,0 +1,390 @@
+/**
+ * @file event_loop_stress.c
+ * @brief Host stress test of the connectivity event path under unrelated event load
+ * @details Simulates the single core of the C6 with the default event loop
+ * task and, for comparison, a private loop one priority above it. Other
+ * components post unrelated events to the default loop at a Poisson rate;
+ * their handlers take some CPU, then block (a socket write, a flash access).
+ * Meanwhile the STA goes through a disconnect, reassociate, got-IP cycle every
+ * 1 to 3 s, as in a disconnect storm.
+ *
+ * Every connectivity event is first handled by the netif glue of
+ * wifi_netif.c in the default loop. The connection logic of
+ * wifi_event_handler() then runs either in the default loop too (shared, what
+ * main/conn_events.c does) or in a private loop after a forwarder copied the
+ * event (private, the design it replaced). The credentials of a new link are
+ * saved by link_save_task() below both loops, so the handler does not write
+ * NVS. The WiFi driver waits for room in a full default queue, and so does the
+ * forwarder in a full private queue: connectivity events are never dropped,
+ * only unrelated ones.
+ *
+ * Latencies are measured from the post by the WiFi driver or component:
+ *   netif  to the netif glue (link state, DHCP)
+ *   conn   to wifi_event_handler()
+ *   done   to the end of wifi_event_handler()
+ *   other  to the handler of an unrelated event
+ * The private queue is measured with main/event_stats.c.
+ *
+ * The shared setup must get the connection logic going within
+ * CONN_P99_BOUND_MS at the 99th percentile up to BOUND_RATE unrelated events/s;
+ * a row over the bound is marked FAIL and the exit status is 1.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o event_loop_stress tools/event_loop_stress.c main/event_stats.c -lm
+ *   ./event_loop_stress [-d seconds] [-u handler_ms] [-r seed]
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "event_stats.h"
+
+#define QUEUE_SIZE      32                // Default loop, CONFIG_ESP_SYSTEM_EVENT_QUEUE_SIZE
+#define PRIVATE_QUEUE   32                // Same value as CONN_EVENTS_QUEUE_SIZE
+#define MAX_SEGMENTS    3
+#define MAX_WAITING     8                 // Connectivity posts waiting for room
+#define CONN_P99_BOUND_MS 60.0            // conn p99 of the shared setup
+#define BOUND_RATE      300               // Highest unrelated rate held to the bound
+#define NETIF_CPU_US    80                // wifi_netif.c handler
+#define FORWARD_CPU_US  15                // Copy and post to the private loop
+#define UNRELATED_CPU_SHARE 0.25          // Part of an unrelated handler that takes the CPU
+
+typedef enum {
+    CLASS_NETIF,
+    CLASS_CONN,
+    CLASS_DONE,
+    CLASS_OTHER,
+    CLASS_COUNT,
+} class_t;
+
+typedef enum {
+    SEG_NETIF,                            // Netif glue
+    SEG_FORWARD,                          // Forwarder, the rest of the job goes to the private loop
+    SEG_CONN,                             // wifi_event_handler()
+    SEG_OTHER,                            // Unrelated handler
+} segment_kind_t;
+
+typedef struct {
+    segment_kind_t kind;
+    uint32_t cpu_us;                      // Runs on the core
+    uint32_t wait_us;                     // Then blocks, the core is free
+} segment_t;
+
+typedef struct {
+    int64_t post_us;                      // Posted by the driver or component
+    int64_t queued_us;                    // Queued on this loop
+    segment_t segments[MAX_SEGMENTS];
+    int count;
+} job_t;
+
+typedef struct {
+    job_t queue[QUEUE_SIZE];
+    int head, length, size;
+    job_t waiting[MAX_WAITING];           // Connectivity posts blocked on the full queue, in order
+    int waiting_count;
+    bool busy;                            // Has a job, running or blocked
+    job_t job;
+    int segment;
+    uint32_t cpu_left;
+    int64_t wake_us;                      // Blocked until, 0 while on the CPU
+    uint32_t max_depth;
+    uint32_t dropped;                     // Unrelated events lost to a full queue
+} loop_t;
+
+typedef struct {
+    uint32_t *values;
+    size_t count, capacity;
+} samples_t;
+
+typedef struct {
+    uint32_t seconds;
+    uint32_t handler_us;                  // Mean unrelated handler time, CPU and blocked
+    uint32_t seed;
+} params_t;
+
+static uint32_t rng_state;
+static samples_t samples[CLASS_COUNT];
+static event_stats_t private_stats;
+static loop_t default_loop, private_loop;
+
+/**
+ * @brief xorshift32, uniform in [0, 1)
+ */
+static double rnd(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state >> 8) / 16777216.0;
+}
+
+/**
+ * @brief Exponentially distributed time with the given mean
+ */
+static int64_t rnd_exp(double mean_us) {
+    return (int64_t)(-mean_us * log(1.0 - rnd()));
+}
+
+static void sample(class_t cls, int64_t value) {
+    samples_t *s = &samples[cls];
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? 2 * s->capacity : 1024;
+        s->values = realloc(s->values, s->capacity * sizeof(uint32_t));
+    }
+    s->values[s->count++] = (uint32_t)value;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Percentile of sorted samples in milliseconds
+ */
+static double percentile_ms(const samples_t *s, double percent) {
+    if (s->count == 0) return 0;
+    return s->values[(size_t)(percent / 100.0 * (s->count - 1) + 0.5)] / 1000.0;
+}
+
+/**
+ * @brief Queues a job, false if the queue is full
+ */
+static bool push(loop_t *loop, const job_t *job) {
+    if (loop->length == loop->size) return false;
+    loop->queue[(loop->head + loop->length) % loop->size] = *job;
+    loop->length++;
+    if ((uint32_t)loop->length > loop->max_depth) loop->max_depth = loop->length;
+    return true;
+}
+
+/**
+ * @brief Posts an unrelated event, dropped if the queue is full
+ */
+static void post_unrelated(loop_t *loop, const job_t *job) {
+    if (!push(loop, job)) loop->dropped++;
+}
+
+/**
+ * @brief Posts a connectivity event, waiting for room like the WiFi driver
+ */
+static void post_conn(loop_t *loop, const job_t *job) {
+    if (loop->waiting_count == 0 && push(loop, job)) return;
+    if (loop->waiting_count == MAX_WAITING) {
+        fprintf(stderr, "more than %d connectivity posts waiting\n", MAX_WAITING);
+        exit(2);
+    }
+    loop->waiting[loop->waiting_count++] = *job;
+}
+
+/**
+ * @brief Connection logic for one step of the storm
+ * @details 0: disconnected, calls esp_wifi_connect(); 1: associated; 2: got-IP,
+ * publishes the link and wakes link_save_task().
+ */
+static segment_t conn_segment(int stage) {
+    switch (stage) {
+    case 0: return (segment_t){ SEG_CONN, 150, 300 };
+    case 1: return (segment_t){ SEG_CONN, 100, 0 };
+    default: return (segment_t){ SEG_CONN, 400, 0 };
+    }
+}
+
+/**
+ * @brief Starts the current segment and records the latency it stands for
+ */
+static void begin_segment(loop_t *loop, int64_t now) {
+    const segment_t *seg = &loop->job.segments[loop->segment];
+    loop->cpu_left = seg->cpu_us;
+    loop->wake_us = 0;
+    if (seg->kind == SEG_NETIF) sample(CLASS_NETIF, now - loop->job.post_us);
+    if (seg->kind == SEG_CONN) sample(CLASS_CONN, now - loop->job.post_us);
+    if (seg->kind == SEG_OTHER) sample(CLASS_OTHER, now - loop->job.post_us);
+}
+
+/**
+ * @brief Takes the next job off the queue if the loop is idle
+ */
+static void dispatch(loop_t *loop, int64_t now) {
+    if (loop->busy || loop->length == 0) return;
+    loop->job = loop->queue[loop->head];
+    loop->head = (loop->head + 1) % loop->size;
+    loop->length--;
+    // The highest priority task blocked on the queue, the WiFi driver, gets the room
+    if (loop->waiting_count > 0) {
+        push(loop, &loop->waiting[0]);
+        loop->waiting_count--;
+        memmove(loop->waiting, loop->waiting + 1, loop->waiting_count * sizeof(job_t));
+    }
+    loop->busy = true;
+    loop->segment = 0;
+    if (loop == &private_loop) event_stats_on_dispatch(&private_stats, (uint32_t)(now - loop->job.queued_us));
+    begin_segment(loop, now);
+}
+
+/**
+ * @brief Ends the current segment, moves to the next one or ends the job
+ * @return false if the forwarder waits for room in the private queue
+ */
+static bool end_segment(loop_t *loop, int64_t now) {
+    const segment_t *seg = &loop->job.segments[loop->segment];
+
+    if (seg->kind == SEG_CONN) sample(CLASS_DONE, now - loop->job.post_us);
+    if (seg->kind == SEG_FORWARD) {
+        job_t copy = { .post_us = loop->job.post_us, .queued_us = now };
+        for (int i = loop->segment + 1; i < loop->job.count; i++) copy.segments[copy.count++] = loop->job.segments[i];
+        if (private_loop.length == private_loop.size) return false;
+        event_stats_on_post(&private_stats);
+        push(&private_loop, &copy);
+        loop->busy = false;
+        return true;
+    }
+    if (++loop->segment == loop->job.count) {
+        loop->busy = false;
+        return true;
+    }
+    begin_segment(loop, now);
+    return true;
+}
+
+/**
+ * @brief Brings a loop up to date: wakes it, ends finished segments, takes new jobs
+ */
+static void settle(loop_t *loop, int64_t now) {
+    for (;;) {
+        dispatch(loop, now);
+        if (!loop->busy) return;
+        if (loop->wake_us) {
+            if (loop->wake_us > now) return;
+            if (!end_segment(loop, now)) return;
+        } else if (loop->cpu_left == 0) {
+            uint32_t wait_us = loop->job.segments[loop->segment].wait_us;
+            if (wait_us) {
+                loop->wake_us = now + wait_us;
+                return;
+            }
+            if (!end_segment(loop, now)) return;
+        } else {
+            return;
+        }
+    }
+}
+
+static int64_t min64(int64_t a, int64_t b) {
+    return a < b ? a : b;
+}
+
+/**
+ * @brief True if the loop has a job on the CPU
+ */
+static bool on_cpu(const loop_t *loop) {
+    return loop->busy && !loop->wake_us && loop->cpu_left > 0;
+}
+
+/**
+ * @brief Runs one configuration and prints its row
+ * @param p Parameters
+ * @param rate Unrelated events per second
+ * @param use_private Connection logic in the private loop
+ * @return p99 of the conn latency in milliseconds
+ */
+static double run(const params_t *p, uint32_t rate, bool use_private) {
+    memset(&default_loop, 0, sizeof(default_loop));
+    memset(&private_loop, 0, sizeof(private_loop));
+    memset(&private_stats, 0, sizeof(private_stats));
+    default_loop.size = QUEUE_SIZE;
+    private_loop.size = PRIVATE_QUEUE;
+    for (int c = 0; c < CLASS_COUNT; c++) samples[c].count = 0;
+    rng_state = p->seed ? p->seed : 1;
+
+    const int64_t end_us = (int64_t)p->seconds * 1000000;
+    const double gap_us = rate ? 1e6 / rate : 0;
+    int64_t next_unrelated = rate ? rnd_exp(gap_us) : INT64_MAX;
+    int64_t next_conn = 1000000;
+    int stage = 0;
+    int64_t now = 0;
+
+    while (now < end_us) {
+        while (next_unrelated <= now) {
+            uint32_t total = rnd_exp(p->handler_us) + 1;
+            uint32_t cpu = total * UNRELATED_CPU_SHARE;
+            job_t job = { .post_us = next_unrelated, .queued_us = next_unrelated, .count = 1 };
+            job.segments[0] = (segment_t){ SEG_OTHER, cpu, total - cpu };
+            post_unrelated(&default_loop, &job);
+            next_unrelated += rnd_exp(gap_us) + 1;
+        }
+        while (next_conn <= now) {
+            job_t job = { .post_us = next_conn, .queued_us = next_conn };
+            job.segments[job.count++] = (segment_t){ SEG_NETIF, NETIF_CPU_US, 0 };
+            if (use_private) job.segments[job.count++] = (segment_t){ SEG_FORWARD, FORWARD_CPU_US, 0 };
+            job.segments[job.count++] = conn_segment(stage);
+            post_conn(&default_loop, &job);
+            stage = (stage + 1) % 3;
+            // Reassociation, then DHCP, then the next disconnect
+            next_conn += stage == 1 ? 100000 + rnd() * 200000 :
+                         stage == 2 ? 50000 + rnd() * 100000 : 1000000 + rnd() * 2000000;
+        }
+
+        // The private loop first: its task runs one priority above
+        settle(&private_loop, now);
+        settle(&default_loop, now);
+        settle(&private_loop, now);
+
+        loop_t *running = NULL;
+        if (on_cpu(&private_loop)) running = &private_loop;
+        else if (on_cpu(&default_loop)) running = &default_loop;
+
+        int64_t next = min64(min64(next_unrelated, next_conn), end_us);
+        if (private_loop.busy && private_loop.wake_us) next = min64(next, private_loop.wake_us);
+        if (default_loop.busy && default_loop.wake_us) next = min64(next, default_loop.wake_us);
+        if (running) next = min64(next, now + running->cpu_left);
+        if (running) running->cpu_left -= next - now;
+        now = next;
+    }
+
+    for (int c = 0; c < CLASS_COUNT; c++) qsort(samples[c].values, samples[c].count, sizeof(uint32_t), compare_u32);
+    printf("%6u  %-7s", rate, use_private ? "private" : "shared");
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        printf("  %6.2f %7.2f", percentile_ms(&samples[c], 50), percentile_ms(&samples[c], 99));
+    }
+    printf("  %5u %3u", default_loop.dropped, default_loop.max_depth);
+    if (use_private) {
+        printf("  %3u %6.2f", private_stats.max_depth, event_stats_percentile_us(&private_stats, 99) / 1000.0);
+    }
+    return percentile_ms(&samples[CLASS_CONN], 99);
+}
+
+int main(int argc, char **argv) {
+    params_t p = { .seconds = 600, .handler_us = 2500, .seed = 1 };
+    static const uint32_t rates[] = { 0, 100, 200, 300, 350 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:u:r:")) != -1) {
+        switch (opt) {
+        case 'd': p.seconds = strtoul(optarg, NULL, 10); break;
+        case 'u': p.handler_us = strtod(optarg, NULL) * 1000; break;
+        case 'r': p.seed = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-d seconds] [-u handler_ms] [-r seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("Unrelated handlers %.1f ms mean (%.0f %% on the CPU), %u s per row\n\n",
+           p.handler_us / 1000.0, UNRELATED_CPU_SHARE * 100, p.seconds);
+    printf("                     latency p50 / p99 in ms                                      default    private\n");
+    printf("rate/s  mode        netif           conn            done            other      drops max  max    p99\n");
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        bool over = run(&p, rates[i], false) > CONN_P99_BOUND_MS && rates[i] <= BOUND_RATE;
+        printf("%s\n", over ? "  FAIL" : "");
+        failed += over;
+        run(&p, rates[i], true);
+        printf("\n");
+    }
+    printf("\nshared conn p99 up to %u/s within %.0f ms: %s\n", BOUND_RATE, CONN_P99_BOUND_MS,
+           failed ? "FAIL" : "ok");
+    return failed ? 1 : 0;
+}
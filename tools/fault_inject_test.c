@@ -0,0 +1,287 @@
+/**
+ * @file fault_inject_test.c
+ * @brief Host test of the failure decisions in main/fault_inject.c
+ * @details Drives the wrappers against stand-ins that always succeed, so
+ * every failure seen comes from a rule: skip, count and permille, the
+ * disarming once count is used up, partial recv and send, clearing, the
+ * rules kept over a restart and the counters of the dump. esp_random() is a
+ * fixed xorshift sequence, so the probabilistic rule gives the same result
+ * on every run. A wrong result is printed as FAIL.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -DFAULT_INJECT_ENABLED=1 -Itools/host -Imain -o fault_inject_test tools/fault_inject_test.c main/fault_inject.c
+ *   ./fault_inject_test
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "fault_inject.h"
+
+static int64_t now_us;
+static uint32_t random_state = 0x2545f491;
+static bool failed_check;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("     %s\n", what);
+        failed_check = true;
+    }
+}
+
+/* ---- Stand-ins ---- */
+
+int64_t esp_timer_get_time(void) {
+    return now_us;
+}
+
+uint32_t esp_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *handle) {
+    *handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value, size_t *length) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+    return ESP_OK;
+}
+
+// The socket calls succeed, recv() always has len bytes waiting
+int bind(int s, const struct sockaddr *name, socklen_t namelen) {
+    return 0;
+}
+
+int listen(int s, int backlog) {
+    return 0;
+}
+
+int accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
+    return 3;
+}
+
+ssize_t recv(int s, void *mem, size_t len, int flags) {
+    return len;
+}
+
+ssize_t send(int s, const void *data, size_t size, int flags) {
+    return size;
+}
+
+/* ---- Helpers ---- */
+
+static void start(void) {
+    fault_inject_clear();
+    fault_inject_init();
+    now_us = 0;
+}
+
+static void arm(fault_site_t site, uint32_t skip, uint32_t count, uint16_t permille, bool partial) {
+    fault_rule_t rule = { .skip = skip, .count = count, .permille = permille, .partial = partial };
+    fault_inject_set(site, &rule);
+}
+
+/**
+ * @brief Calls nvs_commit() through the shim
+ * @return Bitmask of the calls that failed, call i in bit i
+ */
+static uint32_t commit_calls(int calls) {
+    uint32_t failed = 0;
+    for (int i = 0; i < calls; i++) {
+        if (fault_nvs_commit(1) != ESP_OK) failed |= 1u << i;
+    }
+    return failed;
+}
+
+typedef struct {
+    char text[1024];
+    size_t len;
+} dump_t;
+
+static void write_dump(const char *line, size_t len, void *arg) {
+    dump_t *dump = arg;
+    if (dump->len + len < sizeof(dump->text)) {
+        memcpy(dump->text + dump->len, line, len);
+        dump->len += len;
+        dump->text[dump->len] = '\0';
+    }
+}
+
+/**
+ * @brief Reads the dump line of a site
+ * @return true if the line was found
+ */
+static bool dump_site(const char *name, int *armed, uint32_t *calls, uint32_t *injected, long long *last_ms) {
+    dump_t dump = { .len = 0 };
+    char key[24];
+    fault_inject_dump(write_dump, &dump);
+    snprintf(key, sizeof(key), "\n%s armed=", name);
+    const char *line = strstr(dump.text, key);
+    if (line == NULL) return false;
+    return sscanf(line + strlen(key) - strlen("armed="), "armed=%d calls=%u injected=%u last_ms=%lld",
+                  armed, calls, injected, last_ms) == 4;
+}
+
+/* ---- Scenarios ---- */
+
+// Skip 2, count 1, permille 1000: the third call fails, then the rule is done
+static void scripted(void) {
+    start();
+    arm(FAULT_NVS_COMMIT, 2, 1, 1000, false);
+    check(commit_calls(8) == 1u << 2, "not only the third call failed");
+}
+
+// Count 3: three failures after the skip, then disarmed
+static void count_disarms(void) {
+    int armed;
+    uint32_t calls, injected;
+    long long last_ms;
+    start();
+    arm(FAULT_NVS_COMMIT, 1, 3, 1000, false);
+    check(commit_calls(8) == 0x0e, "not calls 2-4 failed");
+    check(dump_site("nvs_commit", &armed, &calls, &injected, &last_ms), "nvs_commit missing from the dump");
+    check(armed == 0, "rule still armed after its count");
+}
+
+// Count 0, permille 1000: every call fails for good
+static void no_limit(void) {
+    start();
+    arm(FAULT_WIFI_START, 0, 0, 1000, false);
+    int failures = 0;
+    for (int i = 0; i < 1000; i++) failures += fault_wifi_start() == ESP_ERR_NO_MEM;
+    check(failures == 1000, "a call went through");
+}
+
+// Permille 50, count 0: about 5 % of 20000 calls, other sites untouched
+static void probabilistic(void) {
+    start();
+    arm(FAULT_NVS_SET, 0, 0, 50, false);
+    int failures = 0;
+    for (int i = 0; i < 20000; i++) failures += fault_nvs_set_str(1, "key", "value") != ESP_OK;
+    check(failures > 850 && failures < 1150, "not about 5 % failed");
+    check(commit_calls(32) == 0, "an unarmed site failed");
+}
+
+// Permille 0 disarms whatever the count
+static void permille_zero(void) {
+    start();
+    arm(FAULT_NVS_COMMIT, 0, 0, 1000, false);
+    arm(FAULT_NVS_COMMIT, 0, 5, 0, false);
+    check(commit_calls(8) == 0, "permille 0 rule failed a call");
+}
+
+// The error of each site, partial recv and send move half of the data
+static void failure_modes(void) {
+    char buf[64];
+    nvs_handle_t handle;
+    size_t length = sizeof(buf);
+    start();
+    for (int i = 0; i < FAULT_SITE_COUNT; i++) arm(i, 0, 0, 1000, false);
+    check(fault_nvs_open("net", NVS_READWRITE, &handle) == ESP_FAIL, "nvs_open did not fail");
+    check(fault_nvs_get_str(1, "ssid", buf, &length) == ESP_ERR_NVS_INVALID_LENGTH, "nvs_get did not fail");
+    check(fault_nvs_set_str(1, "ssid", "x") == ESP_ERR_NVS_NOT_ENOUGH_SPACE, "nvs_set did not fail");
+    check(fault_bind(3, NULL, 0) == -1 && errno == EADDRINUSE, "bind did not fail");
+    check(fault_listen(3, 1) == -1 && errno == ENOBUFS, "listen did not fail");
+    check(fault_accept(3, NULL, NULL) == -1 && errno == ENFILE, "accept did not fail");
+    check(fault_recv(3, buf, sizeof(buf), 0) == -1 && errno == ECONNRESET, "recv did not fail");
+    check(fault_send(3, buf, sizeof(buf), 0) == -1 && errno == ECONNRESET, "send did not fail");
+    check(fault_wifi_set_mode(WIFI_MODE_APSTA) == ESP_ERR_NO_MEM, "wifi_mode did not fail");
+    arm(FAULT_RECV, 0, 1, 1000, true);
+    arm(FAULT_SEND, 0, 1, 1000, true);
+    check(fault_recv(3, buf, sizeof(buf), 0) == sizeof(buf) / 2, "partial recv did not get half");
+    check(fault_send(3, buf, sizeof(buf), 0) == sizeof(buf) / 2, "partial send did not send half");
+    check(fault_send(3, buf, sizeof(buf), 0) == sizeof(buf), "send still partial after its count");
+}
+
+// Clear disarms every site
+static void clear(void) {
+    start();
+    arm(FAULT_NVS_COMMIT, 0, 0, 1000, false);
+    arm(FAULT_ACCEPT, 0, 0, 1000, false);
+    fault_inject_clear();
+    check(commit_calls(4) == 0, "nvs_commit failed after clear");
+    check(fault_accept(3, NULL, NULL) == 3, "accept failed after clear");
+}
+
+// A restart keeps the rule and its progress, clears the statistics
+static void restart(void) {
+    int armed;
+    uint32_t calls, injected;
+    long long last_ms;
+    start();
+    arm(FAULT_NVS_COMMIT, 1, 2, 1000, false);
+    check(commit_calls(2) == 1u << 1, "second call did not fail");
+    fault_inject_init();
+    check(dump_site("nvs_commit", &armed, &calls, &injected, &last_ms), "nvs_commit missing from the dump");
+    check(armed == 1 && calls == 0 && injected == 0 && last_ms == -1, "statistics kept over the restart");
+    check(commit_calls(2) == 1u << 0, "rule lost its last failure over the restart");
+}
+
+// Calls, failures and the time of the last one
+static void dump_counters(void) {
+    int armed;
+    uint32_t calls, injected;
+    long long last_ms;
+    start();
+    arm(FAULT_NVS_COMMIT, 2, 3, 1000, false);
+    now_us = 1500000;
+    commit_calls(4);
+    now_us = 2500000;
+    commit_calls(3);
+    check(dump_site("nvs_commit", &armed, &calls, &injected, &last_ms), "nvs_commit missing from the dump");
+    check(calls == 7 && injected == 3, "wrong calls or failures");
+    check(last_ms == 2500, "wrong time of the last failure");
+    check(armed == 0, "rule still armed");
+    check(dump_site("send", &armed, &calls, &injected, &last_ms), "send missing from the dump");
+    check(calls == 0 && injected == 0 && last_ms == -1, "untouched site has counters");
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "skip 2, count 1", scripted },
+    { "count used up disarms", count_disarms },
+    { "count 0, always", no_limit },
+    { "permille 50", probabilistic },
+    { "permille 0 disarms", permille_zero },
+    { "failure of each site, partial", failure_modes },
+    { "clear", clear },
+    { "rules kept over a restart", restart },
+    { "dump counters", dump_counters },
+};
+
+int main(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        failed_check = false;
+        scenarios[i].run();
+        printf("%-4s %s\n", failed_check ? "FAIL" : "ok", scenarios[i].name);
+        failed += failed_check;
+    }
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Fault recovery measurement (see main/fault_inject.h).
+
+Arms one failure at a time on a unit built with FAULT_INJECT_ENABLED, then
+measures how long the unit takes to serve a client again. Live faults are
+probed with list_networks, or with a full provisioning when --ssid is given.
+Boot faults are armed, then the unit is restarted and polled until its server
+answers. The clean runs at the top are the reference: a clean restart is what
+every fault that crashes the unit costs. Restarts are signed with the site
+key of the unit, see authorize_command() in main/main.c.
+
+    fault_run.py --host 192.168.4.1 --key <64 hex>
+    fault_run.py --host 192.168.0.42 --key <64 hex> --ssid Site --password Secret --only nvs
+"""
+import argparse
+import hashlib
+import hmac
+import json
+import socket
+import time
+
+PORT = 3333
+PROBE_TIMEOUT_S = 5                       # A scan for list_networks takes up to about 3 s
+POLL_INTERVAL_S = 0.1
+
+# Name, site, extra rule keys, how it is triggered
+SCENARIOS = [
+    ("list_networks, no fault", None, {}, "exchange"),
+    ("restart, no fault", None, {}, "boot"),
+    ("provisioning, no fault", None, {}, "provision"),
+    ("accept fails", "accept", {}, "exchange"),
+    ("recv resets", "recv", {}, "exchange"),
+    ("recv returns half", "recv", {"partial": "true"}, "exchange"),
+    ("send resets", "send", {}, "exchange"),
+    ("send sends half", "send", {"partial": "true"}, "exchange"),
+    ("nvs_set fails", "nvs_set", {}, "provision"),
+    ("nvs_commit fails", "nvs_commit", {}, "provision"),
+    ("nvs_get truncates at boot", "nvs_get", {}, "boot"),
+    ("nvs_open fails at boot", "nvs_open", {}, "boot"),
+    ("bind fails at boot", "bind", {}, "boot"),
+    ("listen fails at boot", "listen", {}, "boot"),
+    ("wifi_mode fails", "wifi_mode", {}, "provision"),
+    ("wifi_start fails at boot", "wifi_start", {}, "boot"),
+    ("wifi_start keeps failing", "wifi_start", {"count": "20"}, "boot"),
+]
+
+
+def read_reply(sock, dump=False):
+    data = b""
+    while True:
+        chunk = sock.recv(4096)
+        data += chunk
+        if not chunk or (data.endswith(b"# end\n") if dump else data.endswith(b"\n")):
+            return data.decode()
+
+
+def command(host, payload, dump=False):
+    """Sends a command on its own connection, returns the reply text."""
+    with socket.create_connection((host, PORT), timeout=PROBE_TIMEOUT_S) as sock:
+        sock.sendall(json.dumps(payload).encode())
+        return read_reply(sock, dump)
+
+
+def signed_command(host, key, name):
+    """Sends a command that needs the site key: asks for a challenge, answers it."""
+    with socket.create_connection((host, PORT), timeout=PROBE_TIMEOUT_S) as sock:
+        sock.sendall(json.dumps({"command": name}).encode())
+        reply = read_reply(sock)
+        if not reply.startswith("Challenge: "):
+            raise SystemExit(f"{name}: {reply.strip()}")
+        challenge = bytes.fromhex(reply.split()[1])
+        auth = hmac.new(key, challenge + name.encode(), hashlib.sha256).hexdigest()
+        sock.sendall(json.dumps({"command": name, "auth": auth}).encode())
+        return read_reply(sock)
+
+
+def fault_stats(host):
+    """Returns the uptime of the unit in ms and the statistics of each site."""
+    uptime, sites = 0, {}
+    for line in command(host, {"command": "fault_dump"}, dump=True).splitlines():
+        if line.startswith("# faults"):
+            uptime = int(line.split("now_ms=")[1])
+        elif line and not line.startswith("#"):
+            name, *fields = line.split()
+            sites[name] = {k: int(v) for k, v in (field.split("=") for field in fields)}
+    return uptime, sites
+
+
+def probe_exchange(args):
+    try:
+        with socket.create_connection((args.host, PORT), timeout=PROBE_TIMEOUT_S) as sock:
+            sock.sendall(b'{"command":"list_networks"}')
+            data = b""
+            while not data.endswith(b"]}\n"):
+                chunk = sock.recv(4096)
+                if not chunk:
+                    return False
+                data += chunk
+            return "networks" in json.loads(data)
+    except (OSError, ValueError):
+        return False
+
+
+def probe_provision(args):
+    try:
+        with socket.create_connection((args.host, PORT), timeout=args.connect_timeout) as sock:
+            for payload, expected in (({"wifi_name": args.ssid}, "SSID received"),
+                                      ({"wifi_password": args.password}, "information saved")):
+                sock.sendall(json.dumps(payload).encode())
+                if expected not in sock.recv(1024).decode():
+                    return False
+            return True
+    except OSError:
+        return False
+
+
+def run(args, site, extra, kind):
+    """Returns (result, latency in ms) of one scenario."""
+    if site:
+        rule = {"command": "fault", "site": site, **extra}
+        # The server reads the arming connection once more before it sees the close
+        if site == "recv":
+            rule["skip"] = "1"
+        reply = command(args.host, rule)
+        if not reply.startswith("Fault armed"):
+            return reply.strip(), None
+    start = time.monotonic()
+    deadline = start + args.timeout
+
+    if kind == "boot":
+        signed_command(args.host, args.key, "restart")
+        time.sleep(1)                     # The old server may still answer until the restart
+        probe = probe_exchange
+    else:
+        probe = probe_provision if kind == "provision" else probe_exchange
+    attempts = 0
+    while time.monotonic() < deadline:
+        attempts += 1
+        if probe(args):
+            break
+        time.sleep(POLL_INTERVAL_S)
+    else:
+        return "not recovered, reset the unit", None
+    latency = (time.monotonic() - start) * 1000
+
+    uptime, sites = fault_stats(args.host)
+    if kind != "boot" and uptime < latency:
+        result = "rebooted"
+    elif site and kind == "boot" and sites[site]["injected"] == 0:
+        result = "rebooted"               # An earlier boot took the failure and crashed
+    else:
+        result = f"recovered, {attempts} attempt{'s' if attempts > 1 else ''}"
+    if kind == "boot" and site:
+        # Back to a normal boot for the next scenario
+        signed_command(args.host, args.key, "restart")
+        time.sleep(1)
+        deadline = time.monotonic() + args.timeout
+        while not probe_exchange(args) and time.monotonic() < deadline:
+            time.sleep(POLL_INTERVAL_S)
+    return result, latency
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", required=True, help="unit to test")
+    parser.add_argument("--key", required=True, type=bytes.fromhex, help="site key of the unit, 64 hex digits")
+    parser.add_argument("--ssid", help="network for the provisioning scenarios, skipped without it")
+    parser.add_argument("--password", default="")
+    parser.add_argument("--only", help="run the scenarios whose name contains this")
+    parser.add_argument("--timeout", type=float, default=60, help="seconds to wait for recovery")
+    parser.add_argument("--connect-timeout", type=float, default=40,
+                        help="seconds to wait for a provisioning reply (connect_wifi() timeout)")
+    args = parser.parse_args()
+
+    command(args.host, {"command": "fault_clear"})
+    for name, site, extra, kind in SCENARIOS:
+        if args.only and args.only not in name:
+            continue
+        if kind == "provision" and not args.ssid:
+            continue
+        result, latency = run(args, site, extra, kind)
+        print(f"{name:28} {f'{latency:8.0f} ms' if latency is not None else '       -   '}  {result}", flush=True)
+        if result.startswith("not recovered"):
+            break
+    command(args.host, {"command": "fault_clear"})
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,220 @@
+/**
+ * @file flap_damping_test.c
+ * @brief Host test of the link flap damping against flap traces
+ * @details Feeds link traces through main/flap_damping.c the way
+ * wifi_event_handler() does: losing an established link records a flap, a
+ * new address is published at once unless the link is suppressed, and the
+ * reuse timer publishes it once the penalty has decayed, if the link is still
+ * up. Every publish stands for one NVS write and one WIFI_CONNECTED_BIT set.
+ *
+ * The built-in traces are the patterns seen on marginal links: bursts of
+ * disconnect/got-IP pairs seconds apart, a single drop, and slow periodic
+ * drops that must never be damped. Each one is checked for the number of
+ * publishes and for the link being published at the end; a wrong result is
+ * printed as FAIL. A trace file given with -f is replayed and reported
+ * without a check; one event per line, "<ms> down" or "<ms> up".
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o flap_damping_test tools/flap_damping_test.c main/flap_damping.c -lm
+ *   ./flap_damping_test [-v] [-f trace.txt]
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flap_damping.h"
+
+#define MAX_EVENTS      256
+#define SETTLE_MS       600000            // Time after the last event for the reuse timer
+
+typedef struct {
+    int64_t ms;
+    bool up;                              // Got an address, or lost the link
+} link_event_t;
+
+typedef struct {
+    const char *name;
+    link_event_t events[MAX_EVENTS];
+    int count;
+    int publishes;                        // Expected publishes, -1 to report only
+} trace_t;
+
+typedef struct {
+    int publishes;                        // NVS writes and connected bit sets
+    int suppressed_ups;                   // Addresses held back
+    int64_t last_publish_ms;
+    bool published_at_end;                // The final link state is published
+} result_t;
+
+static bool verbose;
+
+/**
+ * @brief Builds a burst of flaps: down at start + i * period, up again after up_ms
+ */
+static int add_burst(trace_t *trace, int64_t start, int flaps, int64_t period, int64_t up_ms) {
+    for (int i = 0; i < flaps && trace->count + 2 <= MAX_EVENTS; i++) {
+        trace->events[trace->count++] = (link_event_t){ start + i * period, false };
+        trace->events[trace->count++] = (link_event_t){ start + i * period + up_ms, true };
+    }
+    return trace->count;
+}
+
+/**
+ * @brief Replays a trace with the decisions of wifi_event_handler()
+ */
+static result_t replay(const trace_t *trace) {
+    flap_damping_config_t config = FLAP_DAMPING_DEFAULT_CONFIG();
+    flap_damping_t damping;
+    result_t result = { 0 };
+    bool link_up = false, published = false;
+    int64_t reuse_at = -1;                // Pending reuse timer
+
+    flap_damping_init(&damping, &config);
+
+    for (int i = 0; i <= trace->count; i++) {
+        int64_t now = i < trace->count ? trace->events[i].ms : trace->events[trace->count - 1].ms + SETTLE_MS;
+
+        // The reuse timer fires before the next event
+        while (reuse_at >= 0 && reuse_at <= now) {
+            uint32_t delay = flap_damping_reuse_delay_ms(&damping, reuse_at);
+            if (delay > 0) {
+                reuse_at += delay;
+                continue;
+            }
+            if (link_up && !published) {
+                result.publishes++;
+                result.last_publish_ms = reuse_at;
+                published = true;
+                if (verbose) printf("  %8lld ms  published by the reuse timer\n", (long long)reuse_at);
+            }
+            reuse_at = -1;
+        }
+        if (i == trace->count) break;
+
+        if (!trace->events[i].up) {
+            if (link_up) {
+                link_up = false;
+                published = false;
+                bool suppressed = flap_damping_record_flap(&damping, now);
+                if (verbose) {
+                    printf("  %8lld ms  down, penalty %u%s\n", (long long)now, (unsigned)damping.penalty,
+                           suppressed ? ", suppressed" : "");
+                }
+            }
+            continue;
+        }
+
+        link_up = true;
+        uint32_t delay = flap_damping_reuse_delay_ms(&damping, now);
+        if (delay > 0) {
+            result.suppressed_ups++;
+            reuse_at = now + delay;
+            if (verbose) printf("  %8lld ms  up, held back %u ms\n", (long long)now, (unsigned)delay);
+        } else {
+            result.publishes++;
+            result.last_publish_ms = now;
+            published = true;
+            if (verbose) printf("  %8lld ms  up, published\n", (long long)now);
+        }
+    }
+
+    result.published_at_end = link_up == published;
+    return result;
+}
+
+/**
+ * @brief Reads a trace file, one "<ms> down|up" per line
+ * @return true if successful
+ */
+static bool load_trace(const char *path, trace_t *trace) {
+    FILE *file = fopen(path, "r");
+    char line[64], state[8];
+    long long ms;
+
+    if (!file) return false;
+    trace->count = 0;
+    while (fgets(line, sizeof(line), file) && trace->count < MAX_EVENTS) {
+        if (line[0] == '#' || sscanf(line, "%lld %7s", &ms, state) != 2) continue;
+        trace->events[trace->count++] = (link_event_t){ ms, strcmp(state, "up") == 0 };
+    }
+    fclose(file);
+    return trace->count > 0;
+}
+
+/**
+ * @brief Replays and prints one trace
+ * @return true if it passed
+ */
+static bool run(const trace_t *trace) {
+    int flaps = 0;
+    for (int i = 1; i < trace->count; i++) flaps += !trace->events[i].up;
+
+    if (verbose) printf("%s\n", trace->name);
+    result_t result = replay(trace);
+    bool ok = result.published_at_end && (trace->publishes < 0 || result.publishes == trace->publishes);
+    printf("%-4s %-32s %3d flaps, %3d publishes, %3d held back, last publish at %.1f s\n",
+           trace->publishes < 0 ? "" : ok ? "ok" : "FAIL", trace->name, flaps, result.publishes,
+           result.suppressed_ups, result.last_publish_ms / 1000.0);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    static trace_t traces[5];
+    const char *path = NULL;
+    int opt, failed = 0;
+
+    while ((opt = getopt(argc, argv, "vf:")) != -1) {
+        switch (opt) {
+        case 'v': verbose = true; break;
+        case 'f': path = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-v] [-f trace.txt]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (path) {
+        static trace_t file_trace = { .name = "file", .publishes = -1 };
+        if (!load_trace(path, &file_trace)) {
+            fprintf(stderr, "Can not read %s\n", path);
+            return 2;
+        }
+        file_trace.name = path;
+        return run(&file_trace) ? 0 : 1;
+    }
+
+    // Connect, then 10 drops 3 s apart with the address back after 1 s
+    traces[0] = (trace_t){ .name = "burst, 3 s apart", .publishes = 4 };
+    traces[0].events[traces[0].count++] = (link_event_t){ 0, true };
+    add_burst(&traces[0], 10000, 10, 3000, 1000);
+
+    // A second burst before the first one is released: still one publish for both
+    traces[1] = (trace_t){ .name = "two bursts, 60 s apart", .publishes = 4 };
+    traces[1].events[traces[1].count++] = (link_event_t){ 0, true };
+    add_burst(&traces[1], 10000, 6, 2000, 500);
+    add_burst(&traces[1], 70000, 6, 2000, 500);
+
+    // A single drop, published again at once
+    traces[2] = (trace_t){ .name = "single drop", .publishes = 2 };
+    traces[2].events[traces[2].count++] = (link_event_t){ 0, true };
+    add_burst(&traces[2], 30000, 1, 0, 4000);
+
+    // Drops every 60 s never reach the suppress threshold
+    traces[3] = (trace_t){ .name = "slow drops, 60 s apart", .publishes = 11 };
+    traces[3].events[traces[3].count++] = (link_event_t){ 0, true };
+    add_burst(&traces[3], 60000, 10, 60000, 3000);
+
+    // A burst that ends with the link down: nothing is published at the end
+    traces[4] = (trace_t){ .name = "burst ending down", .publishes = 3 };
+    traces[4].events[traces[4].count++] = (link_event_t){ 0, true };
+    add_burst(&traces[4], 10000, 8, 3000, 1000);
+    traces[4].count--;
+
+    for (size_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) {
+        failed += !run(&traces[i]);
+    }
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
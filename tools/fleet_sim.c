@@ -0,0 +1,406 @@
+/**
+ * @file fleet_sim.c
+ * @brief Host simulation of a fleet connecting to shared access points
+ * @details Every device decides on each STA disconnect with the real
+ * conn_policy_on_disconnect() (main/conn_policy.c). The rest of the STA path
+ * of main/main.c is modelled, not run: the connect at boot with its
+ * wifi_timeout_ms, the immediate retry and the fallback to the provisioning
+ * AP. The virtual radio is a discrete-event model:
+ * - An attempt starts with the connect scan, then sends its auth frames on the
+ *   channel of its AP. A channel carries one exchange at a time, frames are
+ *   lost with the configured probability plus the airtime taken by the
+ *   beacons of provisioning APs on that channel.
+ * - An AP runs the handshakes one after the other, auth_ms each. A station
+ *   waiting longer than auth_timeout_ms, or losing its frames, is
+ *   disconnected after that timeout. An AP with capacity stations rejects the
+ *   next one.
+ * - A rebooting AP drops its stations, which notice after the beacon timeout.
+ * - A connect that takes longer than wifi_timeout_ms gives up, like
+ *   connect_wifi(); at boot the unit then falls back to its provisioning AP on
+ *   DEFAULT_AP_CHANNEL, which loads that channel.
+ *
+ * Scenarios:
+ * - boot: power comes back, every unit boots within a few seconds.
+ * - reboot: every unit is connected, then all APs reboot at once.
+ *
+ * Relay convergence is simulated separately by tools/relay_sim.c.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o fleet_sim tools/fleet_sim.c main/conn_policy.c && ./fleet_sim [options]
+ */
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "conn_policy.h"
+
+// Same values as main/device_config.h
+#define DEFAULT_AP_CHANNEL      1
+#define DEFAULT_WIFI_TIMEOUT_MS 30000
+
+#define AIRTIME_MS      2                 // Auth and association frames of one attempt
+#define BEACON_DUTY     0.008             // Airtime share of one provisioning AP's beacons
+#define DHCP_MS         300               // Association to GOT_IP
+#define MAX_CHANNELS    14
+
+typedef enum {
+    EV_CONNECT,                           // esp_wifi_connect() called
+    EV_SCAN_DONE,                         // Connect scan finished
+    EV_AUTH_DONE,                         // AP finished the handshake
+    EV_GOT_IP,                            // IP_EVENT_STA_GOT_IP
+    EV_DISCONNECT,                        // WIFI_EVENT_STA_DISCONNECTED
+    EV_TIMEOUT,                           // connect_wifi() stops waiting
+    EV_AP_DOWN,                           // AP reboots
+    EV_AP_UP,                             // AP beacons again
+} event_type_t;
+
+typedef struct {
+    int64_t t;
+    int id;                               // Device or AP index
+    uint32_t gen;                         // Generation of the device when scheduled
+    event_type_t type;
+} event_t;
+
+typedef enum {
+    DEV_CONNECTING,
+    DEV_CONNECTED,
+    DEV_GAVE_UP,                          // Attempts exhausted, link stays down
+    DEV_AP_MODE,                          // Boot connection failed, provisioning AP up
+} dev_state_t;
+
+typedef struct {
+    int ap;
+    dev_state_t state;
+    conn_policy_t policy;
+    uint32_t gen;                         // Bumped to cancel pending events
+    uint32_t ap_gen;                      // AP generation of the running attempt
+    int64_t connected_ms;                 // Time of the last GOT_IP, -1 if none
+    int attempts;
+} device_t;
+
+typedef struct {
+    int channel;
+    int up;
+    uint32_t gen;                         // Bumped on every reboot
+    int assoc;                            // Associated stations
+    int64_t busy_until;                   // End of the last queued handshake
+} ap_t;
+
+typedef struct {
+    int devices, aps, capacity;
+    double loss;
+    int auth_ms, auth_timeout_ms, scan_ms, beacon_timeout_ms, ap_down_ms, spread_ms;
+    int max_retry;
+    int reboot;                           // Scenario: 0 boot, 1 AP reboot
+    unsigned seed;
+} params_t;
+
+typedef struct {
+    int attempts, lost, timeouts, rejects, no_ap;
+} counters_t;
+
+static params_t p;
+static device_t *devs;
+static ap_t *aps;
+static int64_t channel_busy[MAX_CHANNELS + 1];
+static int fallback_aps[MAX_CHANNELS + 1];
+static counters_t counters;
+static event_t *heap;
+static int heap_len, heap_cap;
+static uint32_t rng_state;
+
+/**
+ * @brief xorshift32, uniform in [0, 1)
+ */
+static double rnd(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state >> 8) / 16777216.0;
+}
+
+/**
+ * @brief Queues an event, min-heap ordered by time
+ */
+static void schedule(int64_t t, int id, event_type_t type) {
+    if (heap_len == heap_cap) {
+        heap_cap = heap_cap ? heap_cap * 2 : 1024;
+        heap = realloc(heap, heap_cap * sizeof(event_t));
+    }
+    uint32_t gen = type == EV_AP_DOWN || type == EV_AP_UP ? 0 : devs[id].gen;
+    int i = heap_len++;
+    while (i > 0 && heap[(i - 1) / 2].t > t) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = (event_t){ t, id, gen, type };
+}
+
+/**
+ * @brief Takes the earliest event
+ */
+static event_t pop(void) {
+    event_t top = heap[0];
+    event_t last = heap[--heap_len];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= heap_len) break;
+        if (c + 1 < heap_len && heap[c + 1].t < heap[c].t) c++;
+        if (heap[c].t >= last.t) break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/**
+ * @brief Like esp_wifi_connect(): a scan, then the handshake
+ */
+static void start_attempt(int d, int64_t now) {
+    devs[d].attempts++;
+    counters.attempts++;
+    schedule(now + p.scan_ms * (0.8 + 0.4 * rnd()), d, EV_SCAN_DONE);
+}
+
+/**
+ * @brief Auth frames on the channel, then the queue of the AP
+ */
+static void on_scan_done(int d, int64_t now) {
+    device_t *dev = &devs[d];
+    ap_t *ap = &aps[dev->ap];
+    if (!ap->up) {
+        counters.no_ap++;
+        schedule(now, d, EV_DISCONNECT);
+        return;
+    }
+
+    // The channel carries one exchange at a time
+    int64_t start = channel_busy[ap->channel] > now ? channel_busy[ap->channel] : now;
+    channel_busy[ap->channel] = start + AIRTIME_MS;
+    int64_t arrival = start + AIRTIME_MS;
+    if (rnd() < p.loss + fallback_aps[ap->channel] * BEACON_DUTY) {
+        counters.lost++;
+        schedule(arrival + p.auth_timeout_ms, d, EV_DISCONNECT);
+        return;
+    }
+
+    // The AP runs one handshake at a time
+    int64_t begin = ap->busy_until > arrival ? ap->busy_until : arrival;
+    if (begin - arrival > p.auth_timeout_ms) {
+        counters.timeouts++;
+        schedule(arrival + p.auth_timeout_ms, d, EV_DISCONNECT);
+        return;
+    }
+    ap->busy_until = begin + p.auth_ms;
+    dev->ap_gen = ap->gen;
+    schedule(ap->busy_until, d, EV_AUTH_DONE);
+}
+
+/**
+ * @brief End of the handshake: associated unless the AP is full or rebooted
+ */
+static void on_auth_done(int d, int64_t now) {
+    device_t *dev = &devs[d];
+    ap_t *ap = &aps[dev->ap];
+    if (!ap->up || ap->gen != dev->ap_gen) {
+        schedule(now, d, EV_DISCONNECT);
+        return;
+    }
+    if (ap->assoc >= p.capacity) {
+        counters.rejects++;
+        schedule(now, d, EV_DISCONNECT);
+        return;
+    }
+    ap->assoc++;
+    schedule(now + DHCP_MS, d, EV_GOT_IP);
+}
+
+/**
+ * @brief An AP goes away: its stations notice after the beacon timeout
+ */
+static void on_ap_down(int a, int64_t now) {
+    aps[a].up = 0;
+    aps[a].gen++;
+    aps[a].assoc = 0;
+    for (int d = 0; d < p.devices; d++) {
+        if (devs[d].ap != a || devs[d].state != DEV_CONNECTED) continue;
+        devs[d].state = DEV_CONNECTING;
+        devs[d].gen++;
+        schedule(now + p.beacon_timeout_ms + (int64_t)(1000 * rnd()), d, EV_DISCONNECT);
+    }
+}
+
+/**
+ * @brief Processes one event
+ */
+static void dispatch(const event_t *ev) {
+    if (ev->type == EV_AP_DOWN) {
+        on_ap_down(ev->id, ev->t);
+        return;
+    }
+    if (ev->type == EV_AP_UP) {
+        aps[ev->id].up = 1;
+        aps[ev->id].busy_until = ev->t;
+        return;
+    }
+
+    device_t *dev = &devs[ev->id];
+    if (ev->gen != dev->gen) return;      // Cancelled
+    switch (ev->type) {
+    case EV_CONNECT:
+        start_attempt(ev->id, ev->t);
+        break;
+    case EV_SCAN_DONE:
+        on_scan_done(ev->id, ev->t);
+        break;
+    case EV_AUTH_DONE:
+        on_auth_done(ev->id, ev->t);
+        break;
+    case EV_GOT_IP:
+        // wifi_event_handler(): IP_EVENT_STA_GOT_IP
+        if (aps[dev->ap].gen != dev->ap_gen) {
+            schedule(ev->t, ev->id, EV_DISCONNECT);
+            break;
+        }
+        dev->state = DEV_CONNECTED;
+        dev->connected_ms = ev->t;
+        conn_policy_reset(&dev->policy);
+        break;
+    case EV_DISCONNECT:
+        // wifi_event_handler(): WIFI_EVENT_STA_DISCONNECTED
+        if (conn_policy_on_disconnect(&dev->policy) == CONN_RETRY) {
+            start_attempt(ev->id, ev->t);
+        } else {
+            dev->state = DEV_GAVE_UP;
+        }
+        break;
+    case EV_TIMEOUT:
+        // connect_wifi() timed out: WiFi stopped, app_main() starts the soft-AP
+        if (dev->state == DEV_CONNECTED) break;
+        dev->gen++;
+        dev->state = DEV_AP_MODE;
+        fallback_aps[DEFAULT_AP_CHANNEL]++;
+        break;
+    default:
+        break;
+    }
+}
+
+static int compare_ms(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-s boot|reboot] [-n devices] [-a aps] [-c capacity] [-l loss]\n"
+            "       [-u auth_ms] [-t auth_timeout_ms] [-S scan_ms] [-b beacon_timeout_ms]\n"
+            "       [-d ap_down_ms] [-p power_spread_ms] [-m max_retry] [-r seed]\n", name);
+}
+
+int main(int argc, char **argv) {
+    conn_policy_config_t policy_config = CONN_POLICY_DEFAULT_CONFIG();
+    p = (params_t){
+        .devices = 200, .aps = 4, .capacity = 64, .loss = 0.02,
+        .auth_ms = 30, .auth_timeout_ms = 1000, .scan_ms = 1500,
+        .beacon_timeout_ms = 6000, .ap_down_ms = 60000, .spread_ms = 2000,
+        .max_retry = policy_config.max_retry, .reboot = 0, .seed = 1,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:a:c:l:u:t:S:b:d:p:m:r:h")) != -1) {
+        switch (opt) {
+        case 's': p.reboot = strcmp(optarg, "reboot") == 0; break;
+        case 'n': p.devices = atoi(optarg); break;
+        case 'a': p.aps = atoi(optarg); break;
+        case 'c': p.capacity = atoi(optarg); break;
+        case 'l': p.loss = atof(optarg); break;
+        case 'u': p.auth_ms = atoi(optarg); break;
+        case 't': p.auth_timeout_ms = atoi(optarg); break;
+        case 'S': p.scan_ms = atoi(optarg); break;
+        case 'b': p.beacon_timeout_ms = atoi(optarg); break;
+        case 'd': p.ap_down_ms = atoi(optarg); break;
+        case 'p': p.spread_ms = atoi(optarg); break;
+        case 'm': p.max_retry = atoi(optarg); break;
+        case 'r': p.seed = strtoul(optarg, NULL, 0); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (p.devices <= 0 || p.aps <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    policy_config.max_retry = p.max_retry;
+    rng_state = p.seed ? p.seed : 1;
+
+    devs = calloc(p.devices, sizeof(device_t));
+    aps = calloc(p.aps, sizeof(ap_t));
+    static const int channels[] = { 1, 6, 11 };
+    for (int a = 0; a < p.aps; a++) {
+        aps[a].channel = channels[a % 3];
+        aps[a].up = 1;
+    }
+
+    for (int d = 0; d < p.devices; d++) {
+        device_t *dev = &devs[d];
+        dev->ap = d % p.aps;
+        dev->connected_ms = -1;
+        conn_policy_init(&dev->policy, &policy_config);
+        if (p.reboot) {
+            // Steady state: connected, then every AP reboots at t = 0
+            dev->state = DEV_CONNECTED;
+            aps[dev->ap].assoc++;
+        } else {
+            // Power restored: app_main() reaches connect_wifi() within the spread
+            int64_t boot = (int64_t)(p.spread_ms * rnd());
+            dev->state = DEV_CONNECTING;
+            conn_policy_reset(&dev->policy);
+            schedule(boot, d, EV_CONNECT);
+            schedule(boot + DEFAULT_WIFI_TIMEOUT_MS, d, EV_TIMEOUT);
+        }
+    }
+    if (p.reboot) {
+        for (int a = 0; a < p.aps; a++) {
+            schedule(0, a, EV_AP_DOWN);
+            schedule(p.ap_down_ms, a, EV_AP_UP);
+        }
+    }
+
+    while (heap_len > 0) {
+        event_t ev = pop();
+        dispatch(&ev);
+    }
+
+    // Time to connect, from power-up or from the AP reboot
+    int64_t *ttc = malloc(p.devices * sizeof(int64_t));
+    int connected = 0, gave_up = 0, ap_mode = 0, max_attempts = 0;
+    for (int d = 0; d < p.devices; d++) {
+        if (devs[d].state == DEV_CONNECTED) ttc[connected++] = devs[d].connected_ms;
+        if (devs[d].state == DEV_GAVE_UP) gave_up++;
+        if (devs[d].state == DEV_AP_MODE) ap_mode++;
+        if (devs[d].attempts > max_attempts) max_attempts = devs[d].attempts;
+    }
+    qsort(ttc, connected, sizeof(int64_t), compare_ms);
+
+    printf("%s: %d devices, %d APs (capacity %d, auth %d ms, timeout %d ms), loss %.0f %%, "
+           "max_retry %d\n", p.reboot ? "AP reboot" : "boot", p.devices, p.aps, p.capacity,
+           p.auth_ms, p.auth_timeout_ms, p.loss * 100, p.max_retry);
+    printf("  connected %d, gave up %d, provisioning AP %d\n", connected, gave_up, ap_mode);
+    if (connected > 0) {
+        printf("  time to connect: p50 %.1f s, p90 %.1f s, p99 %.1f s, max %.1f s\n",
+               ttc[connected / 2] / 1000.0, ttc[connected * 9 / 10] / 1000.0,
+               ttc[connected * 99 / 100] / 1000.0, ttc[connected - 1] / 1000.0);
+    }
+    printf("  attempts %d (max %d per device): %d lost, %d auth timeouts, %d rejected, "
+           "%d without AP\n", counters.attempts, max_attempts, counters.lost,
+           counters.timeouts, counters.rejects, counters.no_ap);
+
+    free(ttc);
+    free(heap);
+    free(aps);
+    free(devs);
+    return 0;
+}
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Steady-state allocation check (see main/alloc_trace.h).
+
+Drives a unit built with sdkconfig.alloc_trace through a full provisioning and
+reconnect cycle, fetches the allocations recorded meanwhile and symbolizes
+them against the ELF. The call site of an allocation is its innermost frame
+in main/. Sites missing from the baseline fail the check; allocations with
+no frame in main/ (driver, lwIP) are listed but only fail with --strict.
+Reconnects are signed with the site key of the unit, see authorize_command()
+in main/main.c.
+
+    heap_check.py build_trace/test3.elf --host 192.168.4.1 --key <64 hex> --ssid Site --password Secret
+    heap_check.py build_trace/test3.elf --host 192.168.4.1 --key <64 hex> --baseline sites.txt --update
+"""
+import argparse
+import collections
+import hashlib
+import hmac
+import socket
+import subprocess
+import sys
+import time
+
+PORT = 3333
+
+
+class Unit:
+    def __init__(self, host, timeout):
+        self.host = host
+        self.timeout = timeout
+        self.sock = None
+
+    def connect(self, wait):
+        """Opens a session, retrying while the unit is reconnecting."""
+        deadline = time.monotonic() + wait
+        while True:
+            try:
+                self.sock = socket.create_connection((self.host, PORT), timeout=self.timeout)
+                return
+            except OSError:
+                if time.monotonic() > deadline:
+                    raise
+                time.sleep(1)
+
+    def close(self):
+        self.sock.close()
+
+    def send(self, payload):
+        self.sock.sendall(payload.encode())
+
+    def ask(self, payload):
+        self.send(payload)
+        return self.sock.recv(512).decode().strip()
+
+    def ask_signed(self, key, name):
+        """Runs a command that needs the site key: asks for a challenge, answers it."""
+        reply = self.ask(f'{{"command":"{name}"}}')
+        if not reply.startswith("Challenge: "):
+            return reply
+        auth = hmac.new(key, bytes.fromhex(reply.split()[1]) + name.encode(), hashlib.sha256).hexdigest()
+        return self.ask(f'{{"command":"{name}","auth":"{auth}"}}')
+
+    def dump(self):
+        self.send('{"command":"alloc_dump"}')
+        data = b""
+        while not data.endswith(b"# end\n"):
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+        return data.decode()
+
+
+def parse(text):
+    header, records = {}, []
+    for line in text.splitlines():
+        if line.startswith("# alloc"):
+            header = {k: int(v) for k, v in (field.split("=") for field in line.split()[2:])}
+        elif line and not line.startswith("#"):
+            ptr, size, freed, task, *callers = line.split()
+            records.append((int(size), freed == "1", task, [int(c, 16) for c in callers]))
+    return header, records
+
+
+def symbolize(elf, addr2line, pcs):
+    """Maps every PC to (function, path:line) with one addr2line process."""
+    pcs = sorted(pcs)
+    out = subprocess.run([addr2line, "-f", "-C", "-e", elf], input="".join(f"{pc:#x}\n" for pc in pcs),
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    return {pc: (out[2 * i], out[2 * i + 1]) for i, pc in enumerate(pcs)}
+
+
+def call_site(callers, symbols):
+    """Innermost frame in the firmware's own code, None for driver allocations."""
+    for pc in callers:
+        function, location = symbols[pc]
+        if "/main/" in location:
+            # Function and file, line numbers would break the baseline on every edit
+            return f"{function} {location.split('/main/')[-1].split(':')[0]}"
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF of the running build")
+    parser.add_argument("--host", required=True, help="unit address, e.g. its provisioning AP")
+    parser.add_argument("--key", required=True, type=bytes.fromhex, help="site key of the unit, 64 hex digits")
+    parser.add_argument("--ssid", help="network to provision, skipped if missing")
+    parser.add_argument("--password", default="")
+    parser.add_argument("--reconnects", type=int, default=3, help="STA reconnect cycles")
+    parser.add_argument("--wait", type=float, default=60, help="time for the unit to come back in s")
+    parser.add_argument("--baseline", help="accepted call sites, one per line")
+    parser.add_argument("--update", action="store_true", help="write the sites seen to the baseline")
+    parser.add_argument("--strict", action="store_true", help="also fail on driver allocations")
+    parser.add_argument("--addr2line", default="riscv32-esp-elf-addr2line")
+    args = parser.parse_args()
+    if args.update and not args.baseline:
+        parser.error("--update needs --baseline")
+
+    unit = Unit(args.host, timeout=args.wait)
+    unit.connect(args.wait)
+    reply = unit.ask('{"command":"alloc_arm","steady":"true"}')
+    if reply.startswith("Unknown command"):
+        sys.exit("Firmware built without sdkconfig.alloc_trace")
+
+    if args.ssid:
+        print("provisioning:", unit.ask(f'{{"wifi_name":"{args.ssid}"}}'))
+        print("provisioning:", unit.ask(f'{{"wifi_password":"{args.password}"}}'))
+    for i in range(args.reconnects):
+        print(f"reconnect {i + 1}:", unit.ask_signed(args.key, "reconnect"))
+        unit.close()
+        time.sleep(5)
+        unit.connect(args.wait)
+
+    header, records = parse(unit.dump())
+    unit.close()
+    if not header:
+        sys.exit("No allocation trace in the dump")
+    print(f"{header['allocs']} allocations, {header['frees']} frees, {header['free_heap']} bytes free")
+    if header["allocs"] > len(records):
+        print(f"warning: only the last {len(records)} allocations were kept")
+
+    symbols = symbolize(args.elf, args.addr2line, {pc for _, _, _, callers in records for pc in callers})
+    sites = collections.defaultdict(lambda: [0, 0, 0, set()])   # count, bytes, live, tasks
+    driver = collections.Counter()
+    for size, freed, task, callers in records:
+        site = call_site(callers, symbols)
+        if site is None:
+            driver[symbols[callers[0]][0] if callers else "?", task] += 1
+            continue
+        entry = sites[site]
+        entry[0] += 1
+        entry[1] += size
+        entry[2] += not freed
+        entry[3].add(task)
+
+    baseline = set()
+    if args.baseline and not args.update:
+        try:
+            with open(args.baseline) as f:
+                baseline = {line.strip() for line in f if line.strip() and not line.startswith("#")}
+        except FileNotFoundError:
+            pass
+
+    new = [site for site in sites if site not in baseline]
+    for site, (count, total, live, tasks) in sorted(sites.items(), key=lambda item: -item[1][1]):
+        mark = "NEW" if site in new else "   "
+        print(f"{mark} {count:4}x {total:7} B {live:3} live  {site}  [{', '.join(sorted(tasks))}]")
+    for (function, task), count in driver.most_common():
+        print(f"drv {count:4}x  {function}  [{task}]")
+
+    if args.update:
+        with open(args.baseline, "w") as f:
+            f.write("# Accepted steady-state allocation sites, see tools/heap_check.py\n")
+            f.writelines(f"{site}\n" for site in sorted(sites))
+        print(f"{len(sites)} sites written to {args.baseline}")
+        return
+    failed = bool(new) or (args.strict and driver)
+    print("FAIL" if failed else "PASS", f"{len(new)} new sites" + (f", {sum(driver.values())} driver allocations"
+                                                                  if args.strict else ""))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
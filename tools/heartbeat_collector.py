@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Heartbeat collector for fleet monitoring (see main/heartbeat.h).
+
+One UDP socket receives the 48-byte heartbeats of the whole fleet and keeps
+the last state of every unit; a summary is printed periodically.
+
+    heartbeat_collector.py [--port 5001] [--interval 60] [--report 30]
+"""
+import argparse
+import collections
+import socket
+import struct
+import time
+
+MAGIC = 0x4842
+FORMAT = 1
+PACKET = struct.Struct(">HBB6sBbIIIIIII8s")
+STATES = {0: "down", 1: "connecting", 2: "ready"}
+
+
+class Unit:
+    __slots__ = ("addr", "last_seen", "seq", "uptime_s", "state", "rssi", "reconnects",
+                 "heap_free", "heap_min", "config_version", "fw", "flags", "lost", "reboots")
+
+    def __init__(self):
+        self.seq = None
+        self.lost = 0
+        self.reboots = 0
+
+    def update(self, fields, addr, now):
+        (_, _, state, _, flags, rssi, seq, uptime_s, _, reconnects,
+         heap_free, heap_min, config_version, fw) = fields
+        if self.seq is not None:
+            if seq <= self.seq or uptime_s < self.uptime_s:
+                self.reboots += 1          # Counter restarted with the firmware
+            else:
+                self.lost += seq - self.seq - 1
+        self.addr = addr[0]
+        self.last_seen = now
+        self.seq = seq
+        self.uptime_s = uptime_s
+        self.state = state
+        self.rssi = rssi
+        self.reconnects = reconnects
+        self.heap_free = heap_free
+        self.heap_min = heap_min
+        self.config_version = config_version
+        self.fw = fw.hex()
+        self.flags = flags
+
+
+def report(units, interval, now, bad):
+    silent = [mac for mac, u in units.items() if now - u.last_seen > 3 * interval]
+    received = sum(u.seq is not None for u in units.values())
+    lost = sum(u.lost for u in units.values())
+    print(time.strftime("%H:%M:%S"), f"{len(units)} units, {len(units) - len(silent)} alive, "
+          f"{len(silent)} silent, {lost} beats lost, {bad} bad packets")
+    if not units:
+        return
+    print("  states:", dict(collections.Counter(STATES.get(u.state, u.state) for u in units.values())))
+    print("  firmware:", dict(collections.Counter(u.fw for u in units.values())))
+    print("  config versions:", dict(collections.Counter(u.config_version for u in units.values())))
+    for mac, u in sorted(units.items(), key=lambda item: item[1].heap_min)[:5]:
+        print(f"  low heap {mac.hex(':')} {u.addr:15} min {u.heap_min} B, now {u.heap_free} B")
+    for mac in silent[:10]:
+        u = units[mac]
+        print(f"  silent {mac.hex(':')} {u.addr:15} for {now - u.last_seen:.0f} s")
+    flappy = sorted(units.items(), key=lambda item: item[1].reconnects, reverse=True)[:5]
+    for mac, u in flappy:
+        if u.reconnects:
+            print(f"  reconnects {mac.hex(':')} {u.reconnects}, rssi {u.rssi} dBm, reboots {u.reboots}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=5001)
+    parser.add_argument("--interval", type=int, default=60, help="heartbeat interval of the fleet in s")
+    parser.add_argument("--report", type=int, default=30, help="summary period in s")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    # Room for a burst of the whole fleet
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+    sock.bind(("", args.port))
+    sock.settimeout(1)
+
+    units = {}
+    bad = 0
+    next_report = time.monotonic() + args.report
+    while True:
+        try:
+            data, addr = sock.recvfrom(64)
+            fields = PACKET.unpack(data) if len(data) == PACKET.size else None
+            if not fields or fields[0] != MAGIC or fields[1] != FORMAT:
+                bad += 1
+            else:
+                units.setdefault(fields[3], Unit()).update(fields, addr, time.monotonic())
+        except socket.timeout:
+            pass
+        now = time.monotonic()
+        if now >= next_report:
+            report(units, args.interval, now, bad)
+            next_report = now + args.report
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,10 @@
+/**
+ * @file esp_attr.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details Placement attributes are empty: RTC memory is ordinary memory,
+ * zero at start instead of random.
+ */
+#pragma once
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
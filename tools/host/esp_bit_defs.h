@@ -0,0 +1,17 @@
+/**
+ * @file esp_bit_defs.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ */
+#pragma once
+
+#define BIT0  0x00000001
+#define BIT1  0x00000002
+#define BIT2  0x00000004
+#define BIT3  0x00000008
+#define BIT4  0x00000010
+#define BIT5  0x00000020
+#define BIT6  0x00000040
+#define BIT7  0x00000080
+#define BIT8  0x00000100
+#define BIT9  0x00000200
+#define BIT10 0x00000400
@@ -0,0 +1,22 @@
+/**
+ * @file esp_event.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t event_id, void *event_data);
+
+#define ESP_EVENT_ANY_ID                -1
+#define ESP_EVENT_DECLARE_BASE(id)      extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id)       esp_event_base_t const id = #id
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t event_id,
+                                     esp_event_handler_t handler, void *arg);
+esp_err_t esp_event_post(esp_event_base_t base, int32_t event_id, const void *data, size_t size,
+                         TickType_t ticks_to_wait);
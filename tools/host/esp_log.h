@@ -0,0 +1,30 @@
+/**
+ * @file esp_log.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details Logs go to stdout only with -DHOST_LOG, so test output stays short.
+ */
+#pragma once
+
+#include <stdio.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);  // Implemented by the test
+
+#ifdef HOST_LOG
+#define HOST_LOG_PRINT(letter, tag, fmt, ...) printf(letter " (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#else
+#define HOST_LOG_PRINT(letter, tag, fmt, ...) do { if (0) printf(fmt, ##__VA_ARGS__); (void)(tag); } while (0)
+#endif
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG_PRINT("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG_PRINT("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG_PRINT("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG_PRINT("D", tag, fmt, ##__VA_ARGS__)
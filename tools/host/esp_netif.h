@@ -0,0 +1,82 @@
+/**
+ * @file esp_netif.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+#define ESP_ERR_ESP_NETIF_BASE                  0x5000
+#define ESP_ERR_ESP_NETIF_DHCP_ALREADY_STARTED  (ESP_ERR_ESP_NETIF_BASE + 0x04)
+#define ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED  (ESP_ERR_ESP_NETIF_BASE + 0x05)
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+#define ESP_IP4TOADDR(a, b, c, d) \
+    (((uint32_t)(d) << 24) | ((uint32_t)(c) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(a))
+#define IP4_ADDR(ipaddr, a, b, c, d) ((ipaddr)->addr = ESP_IP4TOADDR(a, b, c, d))
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(ipaddr) (int)((ipaddr)->addr & 0xff), (int)(((ipaddr)->addr >> 8) & 0xff), \
+                       (int)(((ipaddr)->addr >> 16) & 0xff), (int)(((ipaddr)->addr >> 24) & 0xff)
+
+typedef struct esp_netif_obj esp_netif_t;  // Defined by the test
+
+typedef struct {
+    bool ap;                              // Stands for the default STA or AP configuration
+} esp_netif_config_t;
+
+#define ESP_NETIF_DEFAULT_WIFI_STA() { .ap = false }
+#define ESP_NETIF_DEFAULT_WIFI_AP()  { .ap = true }
+
+typedef enum {
+    ESP_NETIF_DHCP_INIT = 0,
+    ESP_NETIF_DHCP_STARTED,
+    ESP_NETIF_DHCP_STOPPED,
+} esp_netif_dhcp_status_t;
+
+typedef esp_err_t (*esp_netif_callback_fn)(void *ctx);
+typedef esp_err_t (*esp_netif_receive_t)(esp_netif_t *netif, void *buffer, size_t len, void *eb);
+
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+    IP_EVENT_AP_STAIPASSIGNED,
+} ip_event_t;
+
+typedef struct {
+    esp_netif_t *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+} ip_event_got_ip_t;
+
+esp_netif_t *esp_netif_new(const esp_netif_config_t *config);
+void esp_netif_destroy(esp_netif_t *netif);
+void *esp_netif_get_io_driver(esp_netif_t *netif);
+void *esp_netif_get_netif_impl(esp_netif_t *netif);
+esp_err_t esp_netif_set_mac(esp_netif_t *netif, uint8_t mac[]);
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_dhcpc_get_status(esp_netif_t *netif, esp_netif_dhcp_status_t *status);
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *netif);
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *netif);
+esp_err_t esp_netif_set_hostname(esp_netif_t *netif, const char *hostname);
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_tcpip_exec(esp_netif_callback_fn fn, void *ctx);
+esp_err_t esp_netif_receive(esp_netif_t *netif, void *buffer, size_t len, void *eb);
+void esp_netif_action_start(void *netif, esp_event_base_t base, int32_t event_id, void *data);
+void esp_netif_action_stop(void *netif, esp_event_base_t base, int32_t event_id, void *data);
+void esp_netif_action_connected(void *netif, esp_event_base_t base, int32_t event_id, void *data);
+void esp_netif_action_disconnected(void *netif, esp_event_base_t base, int32_t event_id, void *data);
@@ -0,0 +1,10 @@
+/**
+ * @file esp_random.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details The test implements esp_random().
+ */
+#pragma once
+
+#include <stdint.h>
+
+uint32_t esp_random(void);
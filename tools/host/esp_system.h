@@ -0,0 +1,9 @@
+/**
+ * @file esp_system.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ */
+#pragma once
+
+#include <stdint.h>
+
+uint32_t esp_get_free_heap_size(void);
@@ -0,0 +1,10 @@
+/**
+ * @file esp_timer.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details The test implements esp_timer_get_time().
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,7 @@
+/**
+ * @file esp_wifi_default.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ */
+#pragma once
+
+#include "esp_wifi.h"
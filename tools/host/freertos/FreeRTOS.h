@@ -0,0 +1,28 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+
+#define portTICK_PERIOD_MS  1
+#define portMAX_DELAY       0xffffffffu
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+// Critical sections are spinlocks, the host threads are not stopped
+typedef struct {
+    int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux) while (__atomic_exchange_n(&(mux)->locked, 1, __ATOMIC_ACQUIRE)) {}
+#define portEXIT_CRITICAL(mux)  __atomic_store_n(&(mux)->locked, 0, __ATOMIC_RELEASE)
@@ -0,0 +1,16 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details Tasks run as POSIX threads, implemented by the test.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *arg);
+typedef void *TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle);
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,10 @@
+/**
+ * @file dhcp.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ */
+#pragma once
+
+#include <stdint.h>
+#include "lwip/netif.h"
+
+uint8_t dhcp_supplied_address(const struct netif *netif);
@@ -0,0 +1,25 @@
+/**
+ * @file netif.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details Only the part of the lwIP netif and DHCP client the host tests model.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t addr;
+} ip4_addr_t;
+
+struct netif {
+    ip4_addr_t ip_addr;
+    bool link_up;
+    int dhcp_state;                       // Owned by the test
+};
+
+#define netif_ip4_addr(netif)       ((const ip4_addr_t *)&(netif)->ip_addr)
+#define ip4_addr_isany_val(ip4)     ((ip4).addr == 0)
+
+void netif_set_link_up(struct netif *netif);
+void netif_set_link_down(struct netif *netif);
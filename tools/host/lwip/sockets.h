@@ -0,0 +1,13 @@
+/**
+ * @file sockets.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details The lwIP socket API is the POSIX one on the host.
+ */
+#pragma once
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
@@ -0,0 +1,80 @@
+/**
+ * @file gcm.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details The mbedtls calls of main/ on top of OpenSSL, link with -lcrypto.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#define MBEDTLS_GCM_DECRYPT         0
+#define MBEDTLS_GCM_ENCRYPT         1
+#define MBEDTLS_ERR_GCM_AUTH_FAILED -0x0012
+#define MBEDTLS_ERR_GCM_BAD_INPUT   -0x0014
+
+typedef enum {
+    MBEDTLS_CIPHER_ID_NONE = 0,
+    MBEDTLS_CIPHER_ID_AES = 2,
+} mbedtls_cipher_id_t;
+
+typedef struct {
+    unsigned char key[32];
+    unsigned int keybits;
+} mbedtls_gcm_context;
+
+static inline void mbedtls_gcm_init(mbedtls_gcm_context *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static inline void mbedtls_gcm_free(mbedtls_gcm_context *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static inline int mbedtls_gcm_setkey(mbedtls_gcm_context *ctx, mbedtls_cipher_id_t cipher,
+                                     const unsigned char *key, unsigned int keybits) {
+    if (cipher != MBEDTLS_CIPHER_ID_AES || (keybits != 128 && keybits != 256)) return MBEDTLS_ERR_GCM_BAD_INPUT;
+    memcpy(ctx->key, key, keybits / 8);
+    ctx->keybits = keybits;
+    return 0;
+}
+
+/**
+ * @brief One GCM pass; on decryption the tag is checked
+ */
+static inline int host_gcm_run(mbedtls_gcm_context *ctx, int encrypt, size_t length, const unsigned char *iv,
+                               size_t iv_len, const unsigned char *add, size_t add_len, const unsigned char *input,
+                               unsigned char *output, size_t tag_len, unsigned char *tag) {
+    EVP_CIPHER_CTX *evp = EVP_CIPHER_CTX_new();
+    int len, ok = evp != NULL;
+
+    ok = ok && EVP_CipherInit_ex(evp, ctx->keybits == 256 ? EVP_aes_256_gcm() : EVP_aes_128_gcm(), NULL,
+                                 NULL, NULL, encrypt);
+    ok = ok && EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_SET_IVLEN, (int)iv_len, NULL);
+    ok = ok && EVP_CipherInit_ex(evp, NULL, NULL, ctx->key, iv, encrypt);
+    if (ok && add_len) ok = EVP_CipherUpdate(evp, NULL, &len, add, (int)add_len);
+    if (ok && length) ok = EVP_CipherUpdate(evp, output, &len, input, (int)length);
+    if (ok && !encrypt) ok = EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_SET_TAG, (int)tag_len, tag);
+    ok = ok && EVP_CipherFinal_ex(evp, output + length, &len);
+    if (ok && encrypt) ok = EVP_CIPHER_CTX_ctrl(evp, EVP_CTRL_GCM_GET_TAG, (int)tag_len, tag);
+    EVP_CIPHER_CTX_free(evp);
+    return ok ? 0 : MBEDTLS_ERR_GCM_AUTH_FAILED;
+}
+
+static inline int mbedtls_gcm_crypt_and_tag(mbedtls_gcm_context *ctx, int mode, size_t length,
+                                            const unsigned char *iv, size_t iv_len, const unsigned char *add,
+                                            size_t add_len, const unsigned char *input, unsigned char *output,
+                                            size_t tag_len, unsigned char *tag) {
+    if (mode != MBEDTLS_GCM_ENCRYPT) return MBEDTLS_ERR_GCM_BAD_INPUT;
+    return host_gcm_run(ctx, 1, length, iv, iv_len, add, add_len, input, output, tag_len, tag);
+}
+
+static inline int mbedtls_gcm_auth_decrypt(mbedtls_gcm_context *ctx, size_t length, const unsigned char *iv,
+                                           size_t iv_len, const unsigned char *add, size_t add_len,
+                                           const unsigned char *tag, size_t tag_len, const unsigned char *input,
+                                           unsigned char *output) {
+    int ret = host_gcm_run(ctx, 0, length, iv, iv_len, add, add_len, input, output, tag_len, (unsigned char *)tag);
+    if (ret != 0) memset(output, 0, length);
+    return ret;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file md.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details The mbedtls calls of main/ on top of OpenSSL, link with -lcrypto.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+typedef enum {
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 9,
+} mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t mbedtls_md_info_t;  // An EVP_MD on the host
+
+static inline const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t md_type) {
+    return md_type == MBEDTLS_MD_SHA256 ? (const mbedtls_md_info_t *)EVP_sha256() : NULL;
+}
+
+static inline int mbedtls_md_hmac(const mbedtls_md_info_t *md_info, const unsigned char *key, size_t keylen,
+                                  const unsigned char *input, size_t ilen, unsigned char *output) {
+    unsigned int len;
+    if (!md_info) return -1;
+    return HMAC((const EVP_MD *)md_info, key, (int)keylen, input, ilen, output, &len) ? 0 : -1;
+}
@@ -0,0 +1,11 @@
+/**
+ * @file nvs_flash.h
+ * @brief Host stand-in for the ESP-IDF header, for the host tests in tools/
+ * @details The test implements the functions.
+ */
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Builds and runs the host tests of the pure firmware modules.
+# Each test exits with 1 on a failure; this script stops at the first one.
+#
+#   tools/host_tests.sh [build_dir]
+set -e
+
+cd "$(dirname "$0")/.."
+out=${1:-./build_host}
+mkdir -p "$out"
+cc=${CC:-gcc}
+cflags="-O2 -Wall -Wextra -Wno-unused-parameter -Imain"
+
+run() {
+    name=$1
+    shift
+    echo "== $name"
+    $cc $cflags -o "$out/$name" "$@" -lm
+    "$out/$name"
+}
+
+run config_apply_test -Itools/host tools/config_apply_test.c main/config_apply.c main/config_ops.c
+run boot_guard_sim tools/boot_guard_sim.c main/boot_guard.c
+run wifi_netif_test -Itools/host tools/wifi_netif_test.c main/wifi_netif.c main/timer_wheel.c
+run ap_admission_test -Itools/host tools/ap_admission_test.c main/ap_admission.c
+run ap_lifecycle_test tools/ap_lifecycle_test.c main/ap_lifecycle.c
+run flap_damping_test tools/flap_damping_test.c main/flap_damping.c
+run csa_plan_test tools/csa_plan_test.c main/csa_plan.c
+run scan_sched_test tools/scan_sched_test.c main/scan_sched.c
+run fault_inject_test -DFAULT_INJECT_ENABLED=1 -Itools/host tools/fault_inject_test.c main/fault_inject.c
+run step_recovery_test -DFAULT_INJECT_ENABLED=1 -Itools/host tools/step_recovery_test.c main/conn_step.c main/conn_policy.c main/fault_inject.c
+run site_auth_test -Itools/host tools/site_auth_test.c main/site_auth.c main/relay.c -lcrypto
+run timer_wheel_bench tools/timer_wheel_bench.c main/timer_wheel.c
+run net_status_test -Itools/host tools/net_status_test.c main/net_status.c -lpthread
+run uplink_queue_bench -Itools/host tools/uplink_queue_bench.c main/uplink_queue.c -lpthread
+run event_loop_stress tools/event_loop_stress.c main/event_stats.c
+
+# The host bench writes a result file, checked against the committed baseline.
+# The parser time depends on the host CPU, so only a doubling counts.
+echo "== bench_host"
+$cc $cflags -Itools/host -o "$out/bench_host" tools/bench_host.c main/json_value.c main/wifi_store.c main/bench.c -lm
+"$out/bench_host" -o "$out/bench.json"
+python3 tools/bench_compare.py bench/baseline.json "$out/bench.json" --threshold parser.ps_per_byte=100
+echo "All host tests passed"
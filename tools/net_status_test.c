@@ -0,0 +1,219 @@
+/**
+ * @file net_status_test.c
+ * @brief Host test of the net_status seqlock with concurrent readers
+ * @details Runs main/net_status.c with one writer thread and several reader
+ * threads on the host cores. The writer goes through the transitions of the
+ * connection logic, ready with a new address, a RSSI update and back to
+ * connecting, as fast as it can. Every ready record it writes is consistent
+ * in a way a torn copy is not: generation n publishes the address n, a BSSID
+ * of six bytes n and a RSSI of -(n % 100), and is reconnect n - 1. A
+ * connecting record has no address, BSSID or RSSI.
+ *
+ * Each reader calls net_status_get() in a loop and checks every snapshot
+ * against these rules, and that the reconnect count never goes backwards. A
+ * snapshot that mixes two writes is counted as torn; any torn snapshot, or a
+ * reader that never saw a ready state, fails the test.
+ *
+ * At the end, net_status_set_down() must notify the subscribers once per
+ * state change, and not for a repeated state.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Itools/host -Imain -o net_status_test tools/net_status_test.c main/net_status.c -lpthread
+ *   ./net_status_test [-r readers] [-n writes]
+ */
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "net_status.h"
+
+#define MAX_READERS 16
+
+typedef struct {
+    pthread_t thread;
+    uint64_t reads;
+    uint64_t torn;                        // Snapshots that mix two writes
+    uint64_t ready;                       // Snapshots in NET_STATE_READY
+    uint64_t backwards;                   // Reconnect count lower than before
+} reader_t;
+
+static volatile bool writing;
+static uint32_t generation;               // Written by the writer only
+
+/* ---- Stand-ins ---- */
+
+struct host_event_group {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    EventGroupHandle_t group = calloc(1, sizeof(*group));
+    pthread_mutex_init(&group->mutex, NULL);
+    pthread_cond_init(&group->cond, NULL);
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&group->mutex);
+    group->bits |= bits;
+    EventBits_t now = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->mutex);
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&group->mutex);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->mutex);
+    return before;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks) {
+    pthread_mutex_lock(&group->mutex);
+    while ((group->bits & bits) == 0 && ticks > 0) pthread_cond_wait(&group->cond, &group->mutex);
+    EventBits_t now = group->bits;
+    pthread_mutex_unlock(&group->mutex);
+    return now;
+}
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief The AP of the current generation
+ */
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info) {
+    memset(ap_info->bssid, (uint8_t)generation, sizeof(ap_info->bssid));
+    ap_info->rssi = -(int8_t)(generation % 100);
+    return ESP_OK;
+}
+
+/* ---- Writer and readers ---- */
+
+static void *writer_thread(void *arg) {
+    uint32_t writes = *(uint32_t *)arg;
+    esp_netif_ip_info_t ip_info = { 0 };
+
+    for (generation = 1; generation <= writes; generation++) {
+        ip_info.ip.addr = generation;
+        net_status_set_ready(&ip_info);
+        net_status_update_rssi(-(int8_t)(generation % 100));
+        net_status_set_down(NET_STATE_CONNECTING);
+    }
+    writing = false;
+    return NULL;
+}
+
+/**
+ * @brief Checks one snapshot against the rules of the writer
+ * @return true if it is one of the records the writer wrote
+ */
+static bool consistent(const net_status_t *status) {
+    uint32_t n = status->ip.addr;
+    uint8_t bssid = status->state == NET_STATE_READY ? (uint8_t)n : 0;
+    for (int i = 0; i < 6; i++) {
+        if (status->bssid[i] != bssid) return false;
+    }
+    if (status->state != NET_STATE_READY) return n == 0 && status->rssi == 0 && status->link_uptime_ms == 0;
+    return n != 0 && status->reconnect_count == n - 1 && status->rssi == -(int8_t)(n % 100);
+}
+
+static void *reader_thread(void *arg) {
+    reader_t *reader = arg;
+    uint32_t last_count = 0;
+    net_status_t status;
+
+    while (writing) {
+        net_status_get(&status);
+        reader->reads++;
+        if (!consistent(&status)) reader->torn++;
+        if (status.state == NET_STATE_READY) reader->ready++;
+        if (status.reconnect_count < last_count) reader->backwards++;
+        last_count = status.reconnect_count;
+    }
+    return NULL;
+}
+
+static void count_notification(const net_status_t *status, void *arg) {
+    (*(int *)arg)++;
+}
+
+int main(int argc, char **argv) {
+    static reader_t readers[MAX_READERS];
+    uint32_t writes = 2000000;
+    int reader_count = 3, opt, failed = 0;
+    pthread_t writer;
+
+    while ((opt = getopt(argc, argv, "r:n:")) != -1) {
+        switch (opt) {
+        case 'r': reader_count = atoi(optarg); break;
+        case 'n': writes = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-r readers] [-n writes]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (reader_count < 1 || reader_count > MAX_READERS || writes == 0) {
+        fprintf(stderr, "1-%d readers, at least one write\n", MAX_READERS);
+        return 2;
+    }
+
+    net_status_init();
+    writing = true;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < reader_count; i++) pthread_create(&readers[i].thread, NULL, reader_thread, &readers[i]);
+    pthread_create(&writer, NULL, writer_thread, &writes);
+    pthread_join(writer, NULL);
+    for (int i = 0; i < reader_count; i++) pthread_join(readers[i].thread, NULL);
+    double seconds = (esp_timer_get_time() - start) / 1e6;
+
+    printf("%u writes of 3 transitions in %.2f s\n", writes, seconds);
+    for (int i = 0; i < reader_count; i++) {
+        reader_t *reader = &readers[i];
+        bool ok = reader->torn == 0 && reader->backwards == 0 && reader->ready > 0;
+        printf("%-4s reader %d %12llu reads %8.1f M/s, %llu ready, %llu torn, %llu backwards\n",
+               ok ? "ok" : "FAIL", i, (unsigned long long)reader->reads, reader->reads / seconds / 1e6,
+               (unsigned long long)reader->ready, (unsigned long long)reader->torn,
+               (unsigned long long)reader->backwards);
+        failed += !ok;
+    }
+
+    // The final state is the one the writer left
+    net_status_t status;
+    net_status_get(&status);
+    bool ok = status.state == NET_STATE_CONNECTING && status.reconnect_count == writes - 1 &&
+              !net_status_wait_ready(0);
+    printf("%-4s final state connecting, reconnect %u\n", ok ? "ok" : "FAIL", (unsigned)status.reconnect_count);
+    failed += !ok;
+
+    // A repeated state is not a change: no notification
+    int notifications = 0;
+    net_status_subscribe(count_notification, &notifications);
+    net_status_set_down(NET_STATE_CONNECTING);
+    int repeated = notifications;
+    net_status_set_down(NET_STATE_DOWN);
+    net_status_set_down(NET_STATE_DOWN);
+    ok = repeated == 0 && notifications == 1;
+    printf("%-4s notifications: %d for a repeated state, %d for a change\n", ok ? "ok" : "FAIL", repeated,
+           notifications - repeated);
+    failed += !ok;
+
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Symbolizes a profiler dump against the firmware ELF (see main/profiler.h).
+
+Fetches the PC histogram from a unit built with -DPROFILER_ENABLED=1, or reads
+a saved dump, and prints a flat profile and one profile per task.
+
+    profile_symbolize.py build/test3.elf --host 192.168.4.1 --start 1000 --seconds 30
+    profile_symbolize.py build/test3.elf --host 192.168.4.1 --save run.txt
+    profile_symbolize.py build/test3.elf --file run.txt --lines
+"""
+import argparse
+import collections
+import socket
+import subprocess
+import sys
+import time
+
+PORT = 3333
+
+
+def command(sock, name, **values):
+    fields = "".join(f',"{k}":"{v}"' for k, v in values.items())
+    sock.sendall(f'{{"command":"{name}"{fields}}}'.encode())
+
+
+def fetch(host, start, seconds):
+    with socket.create_connection((host, PORT), timeout=10) as sock:
+        if start:
+            command(sock, "profile_start", rate=start)
+            print(sock.recv(128).decode().strip(), file=sys.stderr)
+            time.sleep(seconds)
+        command(sock, "profile_dump")
+        data = b""
+        while not data.endswith(b"# end\n"):
+            chunk = sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+    return data.decode()
+
+
+def parse(text):
+    header, tasks, samples = {}, {}, []
+    for line in text.splitlines():
+        if line.startswith("# profile"):
+            header = dict(field.split("=") for field in line.split()[2:])
+        elif line.startswith("task "):
+            _, index, *name = line.split()
+            tasks[int(index)] = " ".join(name) or "?"
+        elif line and not line.startswith("#"):
+            pc, task, count = line.split()
+            samples.append((int(pc, 16), int(task), int(count)))
+    return header, tasks, samples
+
+
+def symbolize(elf, addr2line, pcs):
+    """Maps every PC to (function, file:line) with one addr2line process."""
+    pcs = sorted(pcs)
+    out = subprocess.run([addr2line, "-f", "-C", "-e", elf], input="".join(f"{pc:#x}\n" for pc in pcs),
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    return {pc: (out[2 * i], out[2 * i + 1].split("/")[-1]) for i, pc in enumerate(pcs)}
+
+
+def print_table(title, counts, total, limit):
+    print(f"\n{title}")
+    print(f"  {'samples':>8} {'%':>6}  location")
+    for key, count in counts.most_common(limit):
+        print(f"  {count:8} {100 * count / total:6.2f}  {key}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF of the running build")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--host", help="unit to fetch the dump from")
+    source.add_argument("--file", help="saved dump")
+    parser.add_argument("--start", type=int, metavar="HZ", help="restart sampling at this rate before the dump")
+    parser.add_argument("--seconds", type=float, default=30, help="sampling time with --start")
+    parser.add_argument("--save", help="also write the raw dump to this file")
+    parser.add_argument("--lines", action="store_true", help="profile by source line instead of function")
+    parser.add_argument("--limit", type=int, default=25, help="rows per table")
+    parser.add_argument("--cpu-mhz", type=int, default=160)
+    parser.add_argument("--addr2line", default="riscv32-esp-elf-addr2line")
+    args = parser.parse_args()
+
+    text = fetch(args.host, args.start, args.seconds) if args.host else open(args.file).read()
+    if args.save:
+        with open(args.save, "w") as f:
+            f.write(text)
+    header, tasks, samples = parse(text)
+    if not header:
+        sys.exit("No profile in the dump, is the firmware built with -DPROFILER_ENABLED=1?")
+    total = sum(count for _, _, count in samples)
+    if total == 0:
+        sys.exit("No samples yet")
+
+    rate = int(header["rate_hz"])
+    cost = int(header["avg_cycles"]) * rate / (args.cpu_mhz * 1e6)
+    print(f"{total} samples at {rate} Hz ({total / rate:.1f} s), {header['dropped']} dropped, "
+          f"handler cost {100 * cost:.2f} % of the CPU plus interrupt entry and exit")
+
+    symbols = symbolize(args.elf, args.addr2line, {pc for pc, _, _ in samples})
+    flat = collections.Counter()
+    per_task = collections.defaultdict(collections.Counter)
+    task_totals = collections.Counter()
+    for pc, task, count in samples:
+        function, line = symbols[pc]
+        key = f"{function} ({line})" if args.lines else function
+        flat[key] += count
+        per_task[task][key] += count
+        task_totals[task] += count
+
+    print_table("Flat profile", flat, total, args.limit)
+    print("\nTasks")
+    for task, count in task_totals.most_common():
+        print(f"  {count:8} {100 * count / total:6.2f}  {tasks.get(task, task)}")
+    for task, count in task_totals.most_common():
+        print_table(f"Task {tasks.get(task, task)}", per_task[task], count, args.limit)
+
+
+if __name__ == "__main__":
+    main()
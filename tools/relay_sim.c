@@ -0,0 +1,196 @@
+/**
+ * @file relay_sim.c
+ * @brief Host simulation of chain provisioning convergence
+ * @details Units sit on a square grid. A seed unit is provisioned by a
+ * technician, then every provisioned unit relays round by round like
+ * relay_task() in main/main.c, with the neighbour selection of main/relay.c:
+ * the scan finds the unprovisioned units in radio range, relay_plan_select()
+ * picks RELAY_FANOUT of them above RELAY_MIN_RSSI and relay_plan_mark_done()
+ * remembers them. A relayer stops after RELAY_MAX_ROUNDS rounds or when it
+ * has no candidate left. Two relayers picking the same neighbour in one round
+ * waste one push.
+ *
+ * The RSSI of a neighbour falls off with distance with a path loss exponent
+ * of 3, from the scan sensitivity at the radio range. With it a relayer only
+ * picks neighbours within about a third of the range.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Itools/host -Imain -o relay_sim tools/relay_sim.c main/relay.c -lm
+ *   ./relay_sim [units] [spacing_m] [range_m]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "relay.h"
+
+// Time of one relay round in seconds: scan, three pushes, back home, gap
+#define ROUND_S             (2 + RELAY_FANOUT * 5 + 4 + 10)
+// Technician time per unit through the phone app
+#define MANUAL_S            60
+// Radio model: RSSI at the edge of the radio range and path loss exponent
+#define SCAN_SENSITIVITY_DBM -90
+#define PATH_LOSS_EXPONENT  3.0
+
+typedef struct {
+    double x, y;
+    int provisioned_round;                // -1 while unprovisioned
+    int rounds_left;                      // Relay rounds left
+    relay_plan_t plan;                    // Neighbours handled by this unit
+} unit_t;
+
+/* ---- Stand-ins, the simulation sends no messages ---- */
+
+esp_err_t site_auth_seal(const uint8_t nonce[SITE_NONCE_SIZE], const void *aad, size_t aad_len,
+                         void *data, size_t len, uint8_t tag[SITE_TAG_SIZE]) {
+    return ESP_ERR_INVALID_STATE;
+}
+
+bool site_auth_open(const uint8_t nonce[SITE_NONCE_SIZE], const void *aad, size_t aad_len,
+                    void *data, size_t len, const uint8_t tag[SITE_TAG_SIZE]) {
+    return false;
+}
+
+/* ---- Simulation ---- */
+
+/**
+ * @brief Distance between two units in meters
+ */
+static double distance(const unit_t *a, const unit_t *b) {
+    return hypot(a->x - b->x, a->y - b->y);
+}
+
+/**
+ * @brief Soft-AP BSSID of a unit
+ */
+static void bssid_of(int id, uint8_t bssid[6]) {
+    static const uint8_t base[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    memcpy(bssid, base, 6);
+    bssid[4] = (uint8_t)(id >> 8);
+    bssid[5] = (uint8_t)id;
+}
+
+/**
+ * @brief Unit of a BSSID
+ */
+static int id_of(const uint8_t bssid[6]) {
+    return bssid[4] << 8 | bssid[5];
+}
+
+/**
+ * @brief RSSI of a unit seen from another one
+ */
+static int8_t rssi_at(double d, double range) {
+    if (d < 1) d = 1;
+    double rssi = SCAN_SENSITIVITY_DBM + 10 * PATH_LOSS_EXPONENT * log10(range / d);
+    return rssi > 0 ? 0 : (int8_t)lround(rssi);
+}
+
+/**
+ * @brief Runs the simulation from a seed unit
+ * @return Rounds until every unit is provisioned, -1 if the site never converges
+ */
+static int simulate(unit_t *units, int n, int seed, double range, int *pushes) {
+    for (int i = 0; i < n; i++) {
+        units[i].provisioned_round = -1;
+        units[i].rounds_left = RELAY_MAX_ROUNDS;
+        relay_plan_init(&units[i].plan);
+    }
+    units[seed].provisioned_round = 0;
+    int provisioned = 1;
+    *pushes = 0;
+
+    int *claimed = calloc(n, sizeof(int));
+    relay_target_t *found = calloc(n, sizeof(relay_target_t));
+    int result = 0;
+    for (int round = 1; provisioned < n; round++) {
+        int active = 0;
+        memset(claimed, 0, n * sizeof(int));
+
+        for (int r = 0; r < n; r++) {
+            unit_t *relayer = &units[r];
+            if (relayer->provisioned_round < 0 || relayer->provisioned_round >= round) continue;
+            if (relayer->rounds_left == 0) continue;
+
+            // The scan finds the provisioning APs in radio range
+            int found_count = 0;
+            for (int t = 0; t < n; t++) {
+                if (units[t].provisioned_round >= 0 && units[t].provisioned_round < round) continue;
+                double d = distance(relayer, &units[t]);
+                if (d > range) continue;
+                bssid_of(t, found[found_count].bssid);
+                found[found_count].rssi = rssi_at(d, range);
+                found[found_count].channel = 1;
+                found_count++;
+            }
+
+            relay_target_t targets[RELAY_FANOUT];
+            int count = relay_plan_select(&relayer->plan, found, found_count, targets, RELAY_FANOUT,
+                                          (uint32_t)rand());
+            if (count == 0) {
+                relayer->rounds_left = 0;
+                continue;
+            }
+
+            active++;
+            relayer->rounds_left--;
+            for (int i = 0; i < count; i++) {
+                int t = id_of(targets[i].bssid);
+                (*pushes)++;
+                relay_plan_mark_done(&relayer->plan, targets[i].bssid);
+                if (claimed[t]) continue;  // Another relayer got there first
+                claimed[t] = 1;
+                units[t].provisioned_round = round;
+                provisioned++;
+            }
+        }
+
+        if (active == 0) {
+            result = -1;
+            break;
+        }
+        if (provisioned == n) {
+            result = round;
+            break;
+        }
+    }
+    free(found);
+    free(claimed);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 500;
+    double spacing = argc > 2 ? atof(argv[2]) : 10.0;
+    double range = argc > 3 ? atof(argv[3]) : 40.0;
+
+    unit_t *units = calloc(n, sizeof(unit_t));
+    int side = (int)ceil(sqrt(n));
+    for (int i = 0; i < n; i++) {
+        units[i].x = (i % side) * spacing;
+        units[i].y = (i / side) * spacing;
+    }
+
+    if (n < 2 || n > 0xffff || spacing <= 0 || range <= 0) {
+        fprintf(stderr, "2-65535 units, positive spacing and range\n");
+        return 2;
+    }
+    printf("%d units, %.0f m apart, %.0f m range, fanout %d, above %d dBm\n", n, spacing, range,
+           RELAY_FANOUT, RELAY_MIN_RSSI);
+    const char *names[] = { "corner", "center" };
+    int seeds[] = { 0, (side / 2) * side + side / 2 < n ? (side / 2) * side + side / 2 : 0 };
+    for (int s = 0; s < 2; s++) {
+        int pushes;
+        int rounds = simulate(units, n, seeds[s], range, &pushes);
+        if (rounds < 0) {
+            printf("  seed %s: does not converge\n", names[s]);
+        } else {
+            printf("  seed %s: %d rounds, ~%d min, %d pushes (%d wasted)\n", names[s], rounds,
+                   (rounds * ROUND_S + 59) / 60, pushes, pushes - (n - 1));
+        }
+    }
+    printf("  manual: ~%d min\n", (n * MANUAL_S + 59) / 60);
+
+    free(units);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file scan_sched_test.c
+ * @brief Host test of the scan budget in main/scan_sched.c
+ * @details Checks the slicing of the channel range, the choice between the
+ * driver's home channel dwell and slices run one by one, and the latency model
+ * against the budgets of the README table, for client packets every 10 ms
+ * during a 13-channel scan. The expected values are worked out by hand from
+ * the budget: a run of n slices takes n * dwell + (n - 1) * home, and a packet
+ * sent off channel waits for the end of its slice. A wrong result is printed
+ * as FAIL.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o scan_sched_test tools/scan_sched_test.c main/scan_sched.c
+ *   ./scan_sched_test
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "scan_sched.h"
+
+#define PACKET_INTERVAL_MS 10
+
+static bool failed_check;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("     %s\n", what);
+        failed_check = true;
+    }
+}
+
+static scan_sched_budget_t budget_of(uint16_t dwell_ms, uint16_t home_ms, uint8_t slice_channels) {
+    scan_sched_budget_t budget = SCAN_SCHED_DEFAULT_BUDGET();
+    budget.dwell_ms = dwell_ms;
+    budget.home_ms = home_ms;
+    budget.slice_channels = slice_channels;
+    return budget;
+}
+
+/**
+ * @brief Simulates a budget and compares the statistics with the expected ones
+ */
+static void check_stats(const scan_sched_budget_t *budget, uint32_t scan_ms, uint32_t off_ms,
+                        uint32_t max_ms, uint32_t mean_ms) {
+    scan_sched_stats_t stats;
+    scan_sched_simulate(budget, PACKET_INTERVAL_MS, &stats);
+    check(stats.scan_ms == scan_ms, "wrong scan time");
+    check(stats.off_channel_ms == off_ms, "wrong off channel time");
+    check(stats.max_latency_ms == max_ms, "wrong max latency");
+    check(stats.mean_latency_ms == mean_ms, "wrong mean latency");
+}
+
+// Single-channel slices cover 1-13 one by one, 0 is the same as 1
+static void slices_single(void) {
+    scan_sched_budget_t budget = budget_of(40, 100, 1);
+    uint8_t first, last;
+    check(scan_sched_slices(&budget) == 13, "not 13 slices");
+    scan_sched_slice(&budget, 12, &first, &last);
+    check(first == 13 && last == 13, "last slice is not channel 13");
+    budget.slice_channels = 0;
+    check(scan_sched_slices(&budget) == 13, "slice_channels 0 is not one channel");
+}
+
+// Slices of 4 channels: 1-4, 5-8, 9-12, 13
+static void slices_grouped(void) {
+    scan_sched_budget_t budget = budget_of(40, 100, 4);
+    uint8_t first, last;
+    check(scan_sched_slices(&budget) == 4, "not 4 slices");
+    scan_sched_slice(&budget, 1, &first, &last);
+    check(first == 5 && last == 8, "second slice is not 5-8");
+    scan_sched_slice(&budget, 3, &first, &last);
+    check(first == 13 && last == 13, "short last slice not cut at 13");
+    budget.last_channel = 0;
+    check(scan_sched_slices(&budget) == 0, "empty range has slices");
+}
+
+// The driver runs single-channel budgets with a home time in its range
+static void driver_home(void) {
+    scan_sched_budget_t budget = budget_of(40, 100, 1);
+    check(scan_sched_driver_home(&budget), "default budget not run by the driver");
+    budget.home_ms = SCAN_SCHED_DRIVER_HOME_MIN_MS;
+    check(scan_sched_driver_home(&budget), "minimum home time not run by the driver");
+    budget.home_ms = SCAN_SCHED_DRIVER_HOME_MAX_MS;
+    check(scan_sched_driver_home(&budget), "maximum home time not run by the driver");
+    budget.home_ms = SCAN_SCHED_DRIVER_HOME_MIN_MS - 1;
+    check(!scan_sched_driver_home(&budget), "home time below the driver range");
+    budget.home_ms = 200;
+    check(!scan_sched_driver_home(&budget), "home time above the driver range");
+    budget = budget_of(40, 100, 4);
+    check(!scan_sched_driver_home(&budget), "slices of 4 channels run by the driver");
+}
+
+// 13 * 120 ms in one go: a packet waits up to the whole scan, (1560 + 10) / 2 on average
+static void budget_all_at_once(void) {
+    scan_sched_budget_t budget = budget_of(120, 0, 13);
+    check_stats(&budget, 1560, 1560, 1560, 785);
+}
+
+// 13 * 120 + 12 * 30 ms, a packet waits up to one slice
+static void budget_120_30(void) {
+    scan_sched_budget_t budget = budget_of(120, 30, 1);
+    check_stats(&budget, 1920, 1560, 120, 52);
+}
+
+// Default: 13 * 40 + 12 * 100 ms, 100 ms of latency per slice over 172 packets
+static void budget_default(void) {
+    scan_sched_budget_t budget = SCAN_SCHED_DEFAULT_BUDGET();
+    check_stats(&budget, 1720, 520, 40, 7);
+}
+
+// 13 * 20 + 12 * 200 ms
+static void budget_20_200(void) {
+    scan_sched_budget_t budget = budget_of(20, 200, 1);
+    check_stats(&budget, 2660, 260, 20, 1);
+}
+
+// Longer home time: longer scan, less time off channel per second
+static void budget_tradeoff(void) {
+    scan_sched_budget_t short_home = budget_of(40, 30, 1);
+    scan_sched_budget_t long_home = budget_of(40, 150, 1);
+    scan_sched_stats_t a, b;
+    scan_sched_simulate(&short_home, PACKET_INTERVAL_MS, &a);
+    scan_sched_simulate(&long_home, PACKET_INTERVAL_MS, &b);
+    check(a.scan_ms < b.scan_ms, "longer home time did not lengthen the scan");
+    check(a.off_channel_ms == b.off_channel_ms, "home time changed the off channel time");
+    check(a.mean_latency_ms > b.mean_latency_ms, "longer home time did not lower the mean latency");
+    check(a.max_latency_ms == 40 && b.max_latency_ms == 40, "max latency is not one channel");
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "single-channel slices", slices_single },
+    { "slices of 4 channels", slices_grouped },
+    { "driver home channel dwell", driver_home },
+    { "all channels at once, 120 ms", budget_all_at_once },
+    { "120 ms slices, 30 ms home", budget_120_30 },
+    { "default 40 ms slices, 100 ms home", budget_default },
+    { "20 ms slices, 200 ms home", budget_20_200 },
+    { "dwell and home tradeoff", budget_tradeoff },
+};
+
+int main(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        failed_check = false;
+        scenarios[i].run();
+        printf("%-4s %s\n", failed_check ? "FAIL" : "ok", scenarios[i].name);
+        failed += failed_check;
+    }
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
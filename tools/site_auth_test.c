@@ -0,0 +1,379 @@
+/**
+ * @file site_auth_test.c
+ * @brief Host test and timing of the site key crypto in main/site_auth.c
+ * @details Builds main/site_auth.c and main/relay.c against the mbedtls
+ * stand-ins of tools/host, which call OpenSSL, and an NVS kept in memory. A
+ * reset is a new site_auth_init() on the same NVS.
+ *
+ * The scenarios check the HMAC against a tag computed with Python's hmac, the
+ * AES-GCM seal and open, a configuration push built by tools/config_push.py,
+ * the message counter across resets, the replay check of peer counters and
+ * the binding of relay messages to their target. A wrong result is printed as
+ * FAIL.
+ *
+ * Then it times the checks a unit runs on every received message: the HMAC of
+ * a push-sized message, opening a valid push and rejecting a forged one. The
+ * times are those of OpenSSL on the host; on the unit, config_push.c logs the
+ * check time at debug level.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Itools/host -Imain -o site_auth_test tools/site_auth_test.c main/site_auth.c main/relay.c -lcrypto
+ *   ./site_auth_test [-n iterations]
+ */
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "nvs.h"
+#include "site_auth.h"
+#include "relay.h"
+#include "config_push.h"
+
+#define NVS_ENTRIES 16
+
+typedef struct {
+    char name[32];                        // "namespace/key"
+    uint8_t value[256];
+    size_t length;
+} nvs_entry_t;
+
+static nvs_entry_t nvs[NVS_ENTRIES];
+static char nvs_namespaces[4][16];        // Indexed by handle
+static int nvs_writes;                    // Commits since the start
+static bool nvs_broken;                   // Writes fail while set
+static bool failed_check;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("     %s\n", what);
+        failed_check = true;
+    }
+}
+
+/* ---- Stand-ins ---- */
+
+void bench_add(const char *metric, int64_t delta) {}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *handle) {
+    for (nvs_handle_t i = 0; i < 4; i++) {
+        if (nvs_namespaces[i][0] == '\0' || strcmp(nvs_namespaces[i], name) == 0) {
+            snprintf(nvs_namespaces[i], sizeof(nvs_namespaces[i]), "%s", name);
+            *handle = i;
+            return ESP_OK;
+        }
+    }
+    return ESP_FAIL;
+}
+
+void nvs_close(nvs_handle_t handle) {}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    nvs_writes++;
+    return ESP_OK;
+}
+
+static nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key, bool create) {
+    char name[32];
+    snprintf(name, sizeof(name), "%s/%s", nvs_namespaces[handle], key);
+    for (int i = 0; i < NVS_ENTRIES; i++) {
+        if (strcmp(nvs[i].name, name) == 0) return &nvs[i];
+    }
+    if (!create) return NULL;
+    for (int i = 0; i < NVS_ENTRIES; i++) {
+        if (nvs[i].name[0] == '\0') {
+            snprintf(nvs[i].name, sizeof(nvs[i].name), "%s", name);
+            return &nvs[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    if (nvs_broken) return ESP_FAIL;
+    nvs_entry_t *entry = nvs_find(handle, key, true);
+    if (!entry || length > sizeof(entry->value)) return ESP_ERR_NO_MEM;
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length) {
+    nvs_entry_t *entry = nvs_find(handle, key, false);
+    if (!entry) return ESP_ERR_NVS_NOT_FOUND;
+    if (entry->length > *length) return ESP_ERR_INVALID_SIZE;
+    memcpy(value, entry->value, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value) {
+    size_t length = sizeof(*value);
+    return nvs_get_blob(handle, key, value, &length);
+}
+
+/* ---- Scenarios ---- */
+
+static const uint8_t site_key[SITE_KEY_SIZE] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+};
+
+// config_push.py build(bytes(range(32)), 7, "Site", "NewSecret", None, None, nonce=bytes(range(100, 112)))
+static const char push_hex[] =
+    "4350020000000007000300000000006465666768696a6b6c6d6e6f638bc7a495f3fd116db38f24bc8ae79da6d5dd"
+    "aedca93be6d89e034c182f61b73f13f992f8672e87e4a86df015634d49cb2fdb0a28ad7b9413fba0c36d04c4ce56"
+    "c388c3f3d719ebc32f96a75d310494b050fdd5c04ede468661e7a600de034c7fe6d2ae95b86173e88ee870d58fdc68";
+
+static void unhex(const char *hex, uint8_t *out, size_t size) {
+    for (size_t i = 0; i < size; i++) sscanf(hex + 2 * i, "%2hhx", &out[i]);
+}
+
+static void mac_of(int id, uint8_t mac[6]) {
+    static const uint8_t base[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    memcpy(mac, base, 6);
+    mac[5] = (uint8_t)id;
+}
+
+// Runs first: without a key nothing is signed, sealed or opened
+static void no_key(void) {
+    uint8_t mac[SITE_MAC_SIZE], nonce[SITE_NONCE_SIZE] = { 0 }, tag[SITE_TAG_SIZE] = { 0 };
+    char data[8] = "secret";
+    check(site_auth_init() == ESP_OK, "init failed on an empty NVS");
+    check(!site_auth_has_key(), "key without NVS");
+    check(site_auth_sign("x", 1, mac) == ESP_ERR_INVALID_STATE, "signed without a key");
+    check(site_auth_seal(nonce, NULL, 0, data, sizeof(data), tag) == ESP_ERR_INVALID_STATE, "sealed without a key");
+    check(!site_auth_open(nonce, NULL, 0, data, sizeof(data), tag), "opened without a key");
+}
+
+// The tag Python's hmac computes, the key can only be set once
+static void hmac_vector(void) {
+    static const char expected_hex[] = "ef1aa7c463636cf040276f300e39544f6fa85d9c404d345bdd37137c395192f5";
+    static const char msg[] = "site_auth host test";
+    uint8_t expected[SITE_MAC_SIZE], mac[SITE_MAC_SIZE];
+    unhex(expected_hex, expected, sizeof(expected));
+
+    check(site_auth_set_key(site_key) == ESP_OK && site_auth_has_key(), "key not installed");
+    check(site_auth_sign(msg, strlen(msg), mac) == ESP_OK && memcmp(mac, expected, sizeof(mac)) == 0,
+          "tag differs from Python's hmac");
+    check(site_auth_verify(msg, strlen(msg), mac), "valid tag rejected");
+    mac[31] ^= 1;
+    check(!site_auth_verify(msg, strlen(msg), mac), "wrong tag accepted");
+    check(site_auth_set_key(site_key) == ESP_ERR_INVALID_STATE, "key replaced");
+}
+
+// Round trip, and every changed byte is caught
+static void seal_open(void) {
+    static const char aad[] = "header";
+    uint8_t nonce[SITE_NONCE_SIZE] = { 1 }, tag[SITE_TAG_SIZE];
+    char data[16] = "secret", sealed[16];
+
+    check(site_auth_seal(nonce, aad, sizeof(aad), data, sizeof(data), tag) == ESP_OK, "seal failed");
+    check(strcmp(data, "secret") != 0, "data not encrypted");
+    memcpy(sealed, data, sizeof(data));
+    check(site_auth_open(nonce, aad, sizeof(aad), data, sizeof(data), tag) && strcmp(data, "secret") == 0,
+          "round trip failed");
+
+    memcpy(data, sealed, sizeof(data));
+    check(!site_auth_open(nonce, "Header", sizeof(aad), data, sizeof(data), tag), "changed header accepted");
+    memcpy(data, sealed, sizeof(data));
+    data[0] ^= 1;
+    check(!site_auth_open(nonce, aad, sizeof(aad), data, sizeof(data), tag), "changed data accepted");
+    check(data[0] == 0 && data[15] == 0, "data of a rejected message not wiped");
+    memcpy(data, sealed, sizeof(data));
+    nonce[0] = 2;
+    check(!site_auth_open(nonce, aad, sizeof(aad), data, sizeof(data), tag), "other nonce accepted");
+}
+
+// A push built by tools/config_push.py opens the way handle_message() does it
+static void push_from_tool(void) {
+    config_push_msg_t msg;
+    check(sizeof(msg) == (sizeof(push_hex) - 1) / 2, "config_push_msg_t size differs from the tool");
+    unhex(push_hex, (uint8_t *)&msg, sizeof(msg));
+
+    check(site_auth_open(msg.nonce, &msg, offsetof(config_push_msg_t, ssid), msg.ssid,
+                         sizeof(msg.ssid) + sizeof(msg.password), msg.tag), "push rejected");
+    check(ntohl(msg.version) == 7 && msg.format == CONFIG_PUSH_FORMAT, "wrong header");
+    check(strcmp(msg.ssid, "Site") == 0 && strcmp(msg.password, "NewSecret") == 0, "wrong credentials");
+
+    unhex(push_hex, (uint8_t *)&msg, sizeof(msg));
+    msg.version = htonl(8);
+    check(!site_auth_open(msg.nonce, &msg, offsetof(config_push_msg_t, ssid), msg.ssid,
+                          sizeof(msg.ssid) + sizeof(msg.password), msg.tag), "changed version accepted");
+}
+
+// Increases across resets, one NVS write per 16 values
+static void counter_resets(void) {
+    uint32_t counter, last = 0;
+    int writes = nvs_writes;
+    bool increasing = true;
+
+    for (int i = 0; i < 20; i++) {
+        check(site_auth_next_counter(&counter) == ESP_OK, "counter failed");
+        increasing &= counter > last;
+        last = counter;
+    }
+    check(increasing && last == 20, "counter not 1..20");
+    check(nvs_writes - writes == 2, "not one NVS write per 16 values");
+
+    site_auth_init();
+    check(site_auth_next_counter(&counter) == ESP_OK && counter > last, "counter went back after a reset");
+    check(counter == 33, "reset did not skip the rest of the block");
+
+    nvs_broken = true;
+    for (int i = 0; i < 15; i++) site_auth_next_counter(&counter);
+    check(site_auth_next_counter(&counter) != ESP_OK, "counter given out without an NVS reservation");
+    nvs_broken = false;
+}
+
+// Only a higher counter per peer, remembered across resets
+static void replayed_counter(void) {
+    uint8_t a[6], b[6];
+    mac_of(1, a);
+    mac_of(2, b);
+
+    check(site_auth_accept_counter(a, 5) == ESP_OK, "first counter rejected");
+    check(site_auth_accept_counter(a, 5) == ESP_ERR_INVALID_STATE, "same counter accepted");
+    check(site_auth_accept_counter(a, 4) == ESP_ERR_INVALID_STATE, "lower counter accepted");
+    check(site_auth_accept_counter(b, 1) == ESP_OK, "other peer rejected");
+    check(site_auth_accept_counter(a, 6) == ESP_OK, "higher counter rejected");
+
+    site_auth_init();
+    check(site_auth_accept_counter(a, 6) == ESP_ERR_INVALID_STATE, "counter accepted again after a reset");
+    check(site_auth_accept_counter(b, 1) == ESP_ERR_INVALID_STATE, "other peer forgotten after a reset");
+
+    nvs_broken = true;
+    check(site_auth_accept_counter(a, 7) != ESP_OK, "accepted without saving");
+    nvs_broken = false;
+    check(site_auth_accept_counter(a, 7) == ESP_OK, "failed save counted as accepted");
+}
+
+// SITE_PEERS peers are remembered, the least recent one goes
+static void peer_table_full(void) {
+    uint8_t mac[6];
+    for (int i = 10; i < 10 + SITE_PEERS; i++) {
+        mac_of(i, mac);
+        site_auth_accept_counter(mac, 100);
+    }
+    mac_of(10 + SITE_PEERS - 1, mac);
+    check(site_auth_accept_counter(mac, 100) == ESP_ERR_INVALID_STATE, "most recent peer forgotten");
+
+    // Peer 1 was pushed out by SITE_PEERS newer ones: the documented limit
+    mac_of(1, mac);
+    check(site_auth_accept_counter(mac, 7) == ESP_OK, "peer pushed out of the table still remembered");
+    mac_of(10, mac);
+    check(site_auth_accept_counter(mac, 100) == ESP_OK, "least recent peer kept over a new one");
+}
+
+// A relay message opens at its target only, and not once changed
+static void relay_target(void) {
+    uint8_t sender[6], target[6], other[6];
+    relay_msg_t msg, sent;
+    mac_of(1, sender);
+    mac_of(2, target);
+    mac_of(3, other);
+
+    check(relay_msg_build(&sent, "Site", "Secret", RELAY_FLAG_RELAY, sender, target, 42) == ESP_OK, "build failed");
+    check(memmem(&sent, sizeof(sent), "Secret", 6) == NULL, "password in clear");
+    msg = sent;
+    check(relay_msg_open(&msg, target) && strcmp(msg.password, "Secret") == 0, "target rejected the message");
+    msg = sent;
+    check(!relay_msg_open(&msg, other), "other unit accepted the message");
+    msg = sent;
+    memcpy(msg.target, other, 6);
+    check(!relay_msg_open(&msg, other), "retargeted message accepted");
+    msg = sent;
+    msg.counter++;
+    check(!relay_msg_open(&msg, target), "changed counter accepted");
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "no key", no_key },
+    { "HMAC-SHA256 vector, key set once", hmac_vector },
+    { "AES-GCM seal and open", seal_open },
+    { "push from config_push.py", push_from_tool },
+    { "counter across resets", counter_resets },
+    { "replayed counter", replayed_counter },
+    { "peer table full", peer_table_full },
+    { "relay message bound to its target", relay_target },
+};
+
+/* ---- Timing ---- */
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Times the checks run on every received push
+ */
+static void timing(int iterations) {
+    config_push_msg_t valid, msg;
+    uint8_t mac[SITE_MAC_SIZE];
+    int accepted = 0;
+    unhex(push_hex, (uint8_t *)&valid, sizeof(valid));
+
+    double start = now_us();
+    for (int i = 0; i < iterations; i++) site_auth_sign(&valid, sizeof(valid), mac);
+    printf("     HMAC-SHA256 of %zu bytes: %.2f us\n", sizeof(valid), (now_us() - start) / iterations);
+
+    start = now_us();
+    for (int i = 0; i < iterations; i++) {
+        msg = valid;
+        accepted += site_auth_open(msg.nonce, &msg, offsetof(config_push_msg_t, ssid), msg.ssid,
+                                   sizeof(msg.ssid) + sizeof(msg.password), msg.tag);
+    }
+    printf("     open a valid push: %.2f us\n", (now_us() - start) / iterations);
+
+    start = now_us();
+    for (int i = 0; i < iterations; i++) {
+        msg = valid;
+        msg.tag[0] ^= 1;
+        accepted += site_auth_open(msg.nonce, &msg, offsetof(config_push_msg_t, ssid), msg.ssid,
+                                   sizeof(msg.ssid) + sizeof(msg.password), msg.tag);
+    }
+    printf("     reject a forged push: %.2f us\n", (now_us() - start) / iterations);
+    printf("     %d iterations on the host (OpenSSL), %d opened\n", iterations, accepted);
+}
+
+int main(int argc, char **argv) {
+    int iterations = 100000, opt, failed = 0;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iterations < 1) {
+        fprintf(stderr, "at least one iteration\n");
+        return 2;
+    }
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        failed_check = false;
+        scenarios[i].run();
+        printf("%-4s %s\n", failed_check ? "FAIL" : "ok", scenarios[i].name);
+        failed += failed_check;
+    }
+    timing(iterations);
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file step_recovery_test.c
+ * @brief Host test of the recovery time of the setup steps after injected failures
+ * @details Runs the retry loop of main.c: a setup step, then
+ * conn_step_backoff() of main/conn_step.c with main/conn_policy.c until the
+ * step succeeds or the policy gives up. The steps call the wrappers of
+ * main/fault_inject.c as main.c does, so every failure comes from a fault
+ * rule:
+ *   STA setup     esp_wifi_start() fails
+ *   AP setup      esp_wifi_set_mode() fails
+ *   Server setup  bind() fails, or listen()
+ *   NVS open      nvs_open() fails
+ *
+ * vTaskDelay() advances a virtual clock and the driver calls take no time,
+ * so the recovery time is the backoff alone: from the first failure to the
+ * call that succeeds. Each class runs 1 to 4 failures and a failure that
+ * stays, 1000 times each with a different jitter. Recovery and giving up
+ * must both come within RECOVERY_BOUND_MS, or the row is printed as FAIL.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -DFAULT_INJECT_ENABLED=1 -Itools/host -Imain -o step_recovery_test tools/step_recovery_test.c main/conn_step.c main/conn_policy.c main/fault_inject.c
+ *   ./step_recovery_test
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "conn_policy.h"
+#include "conn_step.h"
+#include "fault_inject.h"
+
+#define RUNS              1000            // Jitter draws per row
+#define MAX_FAILURES      4               // Failures the default policy recovers from
+#define RECOVERY_BOUND_MS 1500            // Longest backoff of the default policy, see conn_policy.h
+
+static int64_t now_us;
+static uint32_t random_state;
+
+/* ---- Stand-ins ---- */
+
+int64_t esp_timer_get_time(void) {
+    return now_us;
+}
+
+uint32_t esp_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    now_us += (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *handle) {
+    *handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value, size_t *length) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+    return ESP_OK;
+}
+
+int bind(int s, const struct sockaddr *name, socklen_t namelen) {
+    return 0;
+}
+
+int listen(int s, int backlog) {
+    return 0;
+}
+
+int accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
+    return 3;
+}
+
+ssize_t recv(int s, void *mem, size_t len, int flags) {
+    return len;
+}
+
+ssize_t send(int s, const void *data, size_t size, int flags) {
+    return size;
+}
+
+/* ---- Setup steps, as in main.c ---- */
+
+static bool sta_setup(void) {
+    return fault_wifi_set_mode(WIFI_MODE_STA) == ESP_OK && fault_wifi_start() == ESP_OK;
+}
+
+static bool ap_setup(void) {
+    return fault_wifi_set_mode(WIFI_MODE_AP) == ESP_OK && fault_wifi_start() == ESP_OK;
+}
+
+static bool server_setup(void) {
+    return fault_bind(3, NULL, 0) == 0 && fault_listen(3, 4) == 0;
+}
+
+static bool nvs_setup(void) {
+    nvs_handle_t handle;
+    return fault_nvs_open("net", NVS_READWRITE, &handle) == ESP_OK;
+}
+
+typedef struct {
+    const char *name;
+    conn_step_t step;
+    fault_site_t site;                    // Call that fails
+    bool (*run)(void);
+} failure_class_t;
+
+static const failure_class_t classes[] = {
+    { "STA setup",    CONN_STEP_STA,    FAULT_WIFI_START, sta_setup },
+    { "AP setup",     CONN_STEP_AP,     FAULT_WIFI_MODE,  ap_setup },
+    { "Server, bind", CONN_STEP_SERVER, FAULT_BIND,       server_setup },
+    { "Server, listen", CONN_STEP_SERVER, FAULT_LISTEN,   server_setup },
+    { "NVS open",     CONN_STEP_NVS,    FAULT_NVS_OPEN,   nvs_setup },
+};
+
+/**
+ * @brief Runs the retry loop of main.c once
+ * @param failures Failures injected, 0 for a failure that stays
+ * @param elapsed_ms Set to the time from the first failure to the success or to giving up
+ * @return true if the step succeeded
+ */
+static bool run_once(const failure_class_t *cls, uint32_t failures, int64_t *elapsed_ms) {
+    const conn_policy_config_t config = CONN_POLICY_DEFAULT_CONFIG();
+    conn_policy_t policy;
+    conn_policy_init(&policy, &config);
+    fault_inject_clear();
+    fault_rule_t rule = { .skip = 0, .count = failures, .permille = 1000 };
+    fault_inject_set(cls->site, &rule);
+    now_us = 0;
+
+    bool ok;
+    while (!(ok = cls->run())) {
+        if (!conn_step_backoff(&policy, cls->step)) break;
+    }
+    if (ok) conn_policy_on_step_ok(&policy, cls->step);
+    *elapsed_ms = now_us / 1000;
+    return ok;
+}
+
+/**
+ * @brief Runs one row and prints it
+ * @return true if it passed
+ */
+static bool run_row(const failure_class_t *cls, uint32_t failures) {
+    int64_t worst_ms = 0, sum_ms = 0;
+    int recovered = 0;
+
+    for (int i = 0; i < RUNS; i++) {
+        int64_t elapsed_ms;
+        random_state = 0x2545f491 + i * 0x9e3779b9u;
+        recovered += run_once(cls, failures, &elapsed_ms);
+        if (elapsed_ms > worst_ms) worst_ms = elapsed_ms;
+        sum_ms += elapsed_ms;
+    }
+
+    // Transient failures recover every time, a failure that stays gives up every time
+    bool expected = failures ? recovered == RUNS : recovered == 0;
+    bool ok = expected && worst_ms <= RECOVERY_BOUND_MS;
+    char count[8] = "always";
+    if (failures) snprintf(count, sizeof(count), "%u", (unsigned)failures);
+    printf("%-4s %-15s %-7s %-9s %6.2f s %6.2f s\n", ok ? "ok" : "FAIL", cls->name, count,
+           failures ? "recovered" : "gave up", worst_ms / 1000.0, (double)sum_ms / RUNS / 1000.0);
+    return ok;
+}
+
+int main(void) {
+    int failed = 0;
+
+    fault_inject_init();
+    printf("     class           fails   result     worst     mean\n");
+    for (size_t c = 0; c < sizeof(classes) / sizeof(classes[0]); c++) {
+        for (uint32_t failures = 1; failures <= MAX_FAILURES; failures++) {
+            failed += !run_row(&classes[c], failures);
+        }
+        failed += !run_row(&classes[c], 0);
+    }
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}
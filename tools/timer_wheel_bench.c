@@ -0,0 +1,252 @@
+/**
+ * @file timer_wheel_bench.c
+ * @brief Host benchmark and check of the timer wheel with 10k timers
+ * @details Runs main/timer_wheel.c the way conn_timer.c does, in 10 ms ticks.
+ *
+ * The check arms, moves and cancels timers at random while the clock moves
+ * in random steps. It verifies that every one-shot timer is handed out in
+ * the step that reaches its tick, and that nothing due is left behind.
+ *
+ * The benchmark times insert, cancel and expiry of N timers against a sorted
+ * list, which is how esp_timer keeps its alarms (insert O(n)). It then counts
+ * the wakeups of the driving esp_timer for N timers spread over a minute,
+ * against one alarm per timer.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Imain -o timer_wheel_bench tools/timer_wheel_bench.c main/timer_wheel.c
+ *   ./timer_wheel_bench [-n timers] [-r seed]
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "timer_wheel.h"
+
+#define TICK_MS        10                 // Same value as CONN_TIMER_TICK_MS
+#define CHECK_STEPS    200000
+
+typedef struct list_timer {
+    struct list_timer *next, *prev;
+    uint64_t expires;
+} list_timer_t;
+
+static uint32_t rng_state;
+
+/**
+ * @brief xorshift32
+ */
+static uint32_t rnd(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Random delay in ticks: mostly short, some up to hours, a few past the wheel's reach
+ */
+static uint64_t random_delay(void) {
+    switch (rnd() % 8) {
+    case 0: return rnd() % 64;
+    case 1: case 2: case 3: return rnd() % 6000;                  // Up to a minute
+    case 4: case 5: return rnd() % 360000;                        // Up to an hour
+    case 6: return rnd() % (TIMER_WHEEL_MAX_DELAY + 1);
+    default: return TIMER_WHEEL_MAX_DELAY + rnd() % 1000000;      // Past the last level
+    }
+}
+
+/**
+ * @brief Randomized check against the expected expiry of every timer
+ * @return Number of errors
+ */
+static int check(int n) {
+    timer_wheel_t wheel;
+    timer_wheel_timer_t *timers = calloc(n, sizeof(*timers));
+    uint64_t now = 1000, fired = 0;
+    int errors = 0;
+
+    timer_wheel_init(&wheel, now);
+    for (int i = 0; i < n; i++) timer_wheel_timer_init(&timers[i], NULL, (void *)(intptr_t)i);
+
+    for (int step = 0; step < CHECK_STEPS && errors < 10; step++) {
+        // Some timers are armed, moved or cancelled
+        for (int k = 0; k < 8; k++) {
+            int i = rnd() % n;
+            if (rnd() % 4 == 0) {
+                timer_wheel_cancel(&wheel, &timers[i]);
+            } else {
+                timer_wheel_add(&wheel, &timers[i], now + random_delay(), rnd() % 16 == 0 ? 500 + rnd() % 5000 : 0);
+            }
+        }
+
+        // The clock moves: mostly one tick, sometimes a long sleep
+        uint64_t prev = now;
+        now += rnd() % 16 == 0 ? rnd() % 20000 : 1 + rnd() % 3;
+        timer_wheel_timer_t *timer;
+        while ((timer = timer_wheel_expire(&wheel, now))) {
+            int i = (int)(intptr_t)timer->arg;
+            // A one-shot timer is due within this step, at prev only if armed with no delay
+            if (!timer->period && (timer->expires > now || timer->expires < prev)) {
+                printf("  timer %d due %llu handed out at %llu (previous step %llu)\n", i,
+                       (unsigned long long)timer->expires, (unsigned long long)now, (unsigned long long)prev);
+                errors++;
+            }
+            if (timer_wheel_pending(timer) != (timer->period != 0)) {
+                printf("  timer %d handed out, pending %d\n", i, timer_wheel_pending(timer));
+                errors++;
+            }
+            fired++;
+        }
+
+        // From time to time, nothing due may be left
+        if (step % 1000 == 0) {
+            for (int i = 0; i < n; i++) {
+                if (timer_wheel_pending(&timers[i]) && timers[i].expires <= now) {
+                    printf("  timer %d due %llu still pending at %llu\n", i,
+                           (unsigned long long)timers[i].expires, (unsigned long long)now);
+                    errors++;
+                }
+            }
+        }
+    }
+
+    uint32_t pending = 0;
+    for (int i = 0; i < n; i++) pending += timer_wheel_pending(&timers[i]);
+    if (pending != wheel.count) {
+        printf("  %u timers pending, the wheel counts %u\n", pending, wheel.count);
+        errors++;
+    }
+    printf("check: %d steps, %llu expiries, %u pending at the end, %d errors\n", CHECK_STEPS,
+           (unsigned long long)fired, pending, errors);
+    free(timers);
+    return errors;
+}
+
+/**
+ * @brief Inserts into a list sorted by expiry, scanning from the head like esp_timer
+ */
+static void list_insert(list_timer_t *head, list_timer_t *timer) {
+    list_timer_t *pos = head->next;
+    while (pos != head && pos->expires <= timer->expires) pos = pos->next;
+    timer->next = pos;
+    timer->prev = pos->prev;
+    pos->prev->next = timer;
+    pos->prev = timer;
+}
+
+static void list_remove(list_timer_t *timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+}
+
+/**
+ * @brief Times insert, cancel and expiry of n timers, wheel against sorted list
+ */
+static void bench(int n) {
+    timer_wheel_t wheel;
+    timer_wheel_timer_t *timers = calloc(n, sizeof(*timers));
+    list_timer_t *items = calloc(n, sizeof(*items));
+    list_timer_t head = { &head, &head, 0 };
+    uint64_t *delays = calloc(n, sizeof(*delays));
+    double t0, wheel_add, wheel_cancel, wheel_expire, list_add, list_cancel;
+
+    for (int i = 0; i < n; i++) delays[i] = 1 + rnd() % 360000;
+    timer_wheel_init(&wheel, 0);
+    for (int i = 0; i < n; i++) timer_wheel_timer_init(&timers[i], NULL, NULL);
+
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) timer_wheel_add(&wheel, &timers[i], delays[i], 0);
+    wheel_add = (now_ns() - t0) / n;
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) timer_wheel_cancel(&wheel, &timers[i]);
+    wheel_cancel = (now_ns() - t0) / n;
+
+    // Expiry: every timer once, the clock following the next wakeup
+    for (int i = 0; i < n; i++) timer_wheel_add(&wheel, &timers[i], delays[i], 0);
+    uint64_t tick;
+    int expired = 0;
+    t0 = now_ns();
+    while (timer_wheel_next(&wheel, &tick)) {
+        while (timer_wheel_expire(&wheel, tick)) expired++;
+    }
+    wheel_expire = (now_ns() - t0) / n;
+
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        items[i].expires = delays[i];
+        list_insert(&head, &items[i]);
+    }
+    list_add = (now_ns() - t0) / n;
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) list_remove(&items[i]);
+    list_cancel = (now_ns() - t0) / n;
+
+    printf("\n%d timers, delays up to 1 h      insert      cancel      expiry\n", n);
+    printf("  timer wheel              %8.1f ns %8.1f ns %8.1f ns  (%d handed out)\n",
+           wheel_add, wheel_cancel, wheel_expire, expired);
+    printf("  sorted list (esp_timer)  %8.1f ns %8.1f ns\n", list_add, list_cancel);
+    free(timers);
+    free(items);
+    free(delays);
+}
+
+/**
+ * @brief Counts the wakeups of the driving esp_timer for n timers within a minute
+ */
+static void wakeups(int n) {
+    timer_wheel_t wheel;
+    timer_wheel_timer_t *timers = calloc(n, sizeof(*timers));
+    uint8_t *alarm_ms = calloc(60000, 1);
+    uint32_t wheel_wakeups = 0, distinct_ms = 0;
+
+    timer_wheel_init(&wheel, 0);
+    for (int i = 0; i < n; i++) {
+        uint32_t ms = 1 + rnd() % 59999;
+        // conn_timer.c rounds up to the next tick
+        timer_wheel_timer_init(&timers[i], NULL, NULL);
+        timer_wheel_add(&wheel, &timers[i], (ms + TICK_MS - 1) / TICK_MS, 0);
+        if (!alarm_ms[ms]) distinct_ms++;
+        alarm_ms[ms] = 1;
+    }
+
+    uint64_t tick;
+    while (timer_wheel_next(&wheel, &tick)) {
+        wheel_wakeups++;
+        while (timer_wheel_expire(&wheel, tick)) {}
+    }
+    printf("\n%d timers within a minute: %u wakeups of the wheel timer, %d with one esp_timer each"
+           " (%u distinct ms)\n", n, wheel_wakeups, n, distinct_ms);
+    free(timers);
+    free(alarm_ms);
+}
+
+int main(int argc, char **argv) {
+    int n = 10000;
+    uint32_t seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+        case 'n': n = atoi(optarg); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n timers] [-r seed]\n", argv[0]);
+            return 2;
+        }
+    }
+    rng_state = seed ? seed : 1;
+
+    int errors = check(n);
+    bench(n);
+    wakeups(n);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,662 @@
+/**
+ * @file wifi_netif_test.c
+ * @brief Host test of the STA short-outage handling and the soft-AP lease cache in main/wifi_netif.c
+ * @details Runs wifi_netif.c on a virtual clock against stand-ins for the
+ * default event loop, the conn_timer wheel (main/timer_wheel.c), the lwIP
+ * netif and its DHCP client, and a DHCP server that answers after
+ * DHCP_RTT_MS. The DHCP client follows lwIP: link up in BOUND starts an
+ * INIT-REBOOT, a NAK drops the address and starts over, and esp_netif
+ * reports a lease only when the address changes.
+ *
+ * Each STA scenario connects, loses the beacon for a while and checks what
+ * the application saw: every IP_EVENT_STA_GOT_IP with its time and address,
+ * and when the address was dropped.
+ *
+ * The soft-AP scenarios model the ESP-IDF DHCP server, whose per-MAC lease
+ * list lives as long as the AP interface is started, and a phone's DHCP
+ * client: a phone that had a lease asks for it again with an INIT-REBOOT, a
+ * NAK sends it through DISCOVER and REQUEST. Each scenario restarts the AP
+ * between two visits of the phone and counts the DHCP exchanges of the second
+ * visit. A wrong result is printed as FAIL.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Itools/host -Imain -o wifi_netif_test tools/wifi_netif_test.c main/wifi_netif.c main/timer_wheel.c
+ *   ./wifi_netif_test [-v]
+ */
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_wifi.h"
+#include "lwip/dhcp.h"
+#include "conn_timer.h"
+#include "wifi_netif.h"
+
+#define GRACE_MS        5000              // Outage grace period under test
+#define DHCP_RTT_MS     300               // Server answer time
+#define QUEUE_SIZE      16                // Default loop queue
+#define MAX_HANDLERS    4
+#define MAX_GOT_IP      8
+#define EVENT_DATA_SIZE 64
+#define MAX_LEASES      8                 // Soft-AP DHCP server lease list
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+typedef enum {
+    DHCP_OFF,
+    DHCP_SELECTING,                       // Discover, a new address follows
+    DHCP_REBOOTING,                       // INIT-REBOOT of the address it has
+    DHCP_BOUND,
+} dhcp_state_t;
+
+struct esp_netif_obj {
+    struct netif lwip;
+    bool ap;
+    uint32_t reported_ip;                 // Address esp_netif posted, 0 after a drop
+    uint32_t old_ip;                      // Last address posted, for ip_changed
+};
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    uint8_t data[EVENT_DATA_SIZE];
+} queued_event_t;
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+} handler_t;
+
+typedef struct {
+    int64_t ms;
+    uint32_t ip;
+    bool changed;
+} got_ip_t;
+
+// Virtual time and the stand-ins
+static int64_t now_ms;
+static timer_wheel_t wheel;
+static queued_event_t queue[QUEUE_SIZE];
+static int queue_head, queue_count;
+static int64_t queue_full_until = -1;     // Posts fail before this time
+static handler_t handlers[MAX_HANDLERS];
+static int handler_count;
+static struct esp_netif_obj sta;
+static struct esp_netif_obj ap;
+
+// DHCP server
+static uint32_t server_ip;                // Address it hands out
+static bool server_nak;                   // NAKs an INIT-REBOOT
+static bool static_ip;                    // DHCP client stopped
+static int64_t reply_at = -1;             // Answer to the pending request
+
+// Soft-AP DHCP server, its lease list lives while the AP netif is started
+static bool ap_server_running;
+static uint8_t ap_leases[MAX_LEASES][6];
+static int ap_lease_count;
+static int ap_exchanges;                  // DHCP exchanges of the returning phone
+
+static const uint8_t PHONE[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+// What the application saw
+static got_ip_t got_ip[MAX_GOT_IP];
+static int got_ip_count;
+static int64_t ip_dropped_at;
+static bool verbose;
+
+static const uint8_t SITE[32] = "Site";
+static const uint8_t OTHER[32] = "Other";
+
+/* ---- Stand-ins: event loop, timers, system ---- */
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t event_id,
+                                     esp_event_handler_t handler, void *arg) {
+    if (handler_count == MAX_HANDLERS) return ESP_ERR_NO_MEM;
+    handlers[handler_count++] = (handler_t){ base, event_id, handler };
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t event_id, const void *data, size_t size,
+                         TickType_t ticks_to_wait) {
+    // Nothing drains the queue while a host caller waits, so a full queue fails at once
+    if (queue_count == QUEUE_SIZE || now_ms < queue_full_until) return ESP_ERR_TIMEOUT;
+    queued_event_t *event = &queue[(queue_head + queue_count++) % QUEUE_SIZE];
+    event->base = base;
+    event->id = event_id;
+    memset(event->data, 0, sizeof(event->data));
+    if (data) memcpy(event->data, data, size);
+    return ESP_OK;
+}
+
+static void dispatch(void) {
+    while (queue_count > 0) {
+        queued_event_t event = queue[queue_head];
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_count--;
+        for (int i = 0; i < handler_count; i++) {
+            if (handlers[i].base == event.base &&
+                (handlers[i].id == ESP_EVENT_ANY_ID || handlers[i].id == event.id)) {
+                handlers[i].handler(NULL, event.base, event.id, event.data);
+            }
+        }
+    }
+}
+
+void conn_timer_setup(conn_timer_t *timer, timer_wheel_cb_t callback, void *arg) {
+    timer_wheel_timer_init(timer, callback, arg);
+}
+
+void conn_timer_start_once(conn_timer_t *timer, uint32_t timeout_ms) {
+    timer_wheel_add(&wheel, timer, (now_ms + timeout_ms + CONN_TIMER_TICK_MS - 1) / CONN_TIMER_TICK_MS, 0);
+}
+
+void conn_timer_start_periodic(conn_timer_t *timer, uint32_t period_ms) {
+    uint32_t period = (period_ms + CONN_TIMER_TICK_MS - 1) / CONN_TIMER_TICK_MS;
+    timer_wheel_add(&wheel, timer, (now_ms + period_ms + CONN_TIMER_TICK_MS - 1) / CONN_TIMER_TICK_MS,
+                    period ? period : 1);
+}
+
+void conn_timer_stop(conn_timer_t *timer) {
+    timer_wheel_cancel(&wheel, timer);
+}
+
+bool conn_timer_is_active(conn_timer_t *timer) {
+    return timer_wheel_pending(timer);
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return 200000;
+}
+
+/* ---- Stand-ins: WiFi driver and esp_netif ---- */
+
+/**
+ * @brief Stopping the soft-AP DHCP server frees its lease list
+ */
+static void ap_server_stop(void) {
+    ap_server_running = false;
+    ap_lease_count = 0;
+}
+
+
+esp_err_t esp_wifi_get_if_mac(wifi_netif_driver_t driver, uint8_t mac[6]) {
+    memset(mac, 0x02, 6);
+    return ESP_OK;
+}
+
+bool esp_wifi_is_if_ready_when_started(wifi_netif_driver_t driver) { return true; }
+esp_err_t esp_wifi_register_if_rxcb(wifi_netif_driver_t driver, esp_netif_receive_t fn, void *arg) { return ESP_OK; }
+esp_err_t esp_wifi_internal_set_sta_ip(void) { return ESP_OK; }
+esp_err_t esp_netif_attach_wifi_station(esp_netif_t *netif) { return ESP_OK; }
+esp_err_t esp_netif_attach_wifi_ap(esp_netif_t *netif) { return ESP_OK; }
+void esp_netif_destroy_default_wifi(void *netif) {
+    if (netif == &ap) ap_server_stop();
+}
+
+void esp_netif_destroy(esp_netif_t *netif) {
+    if (netif == &ap) ap_server_stop();
+}
+esp_err_t esp_netif_receive(esp_netif_t *netif, void *buffer, size_t len, void *eb) { return ESP_OK; }
+esp_err_t esp_netif_set_mac(esp_netif_t *netif, uint8_t mac[]) { return ESP_OK; }
+void *esp_netif_get_io_driver(esp_netif_t *netif) { return netif; }
+void *esp_netif_get_netif_impl(esp_netif_t *netif) { return &netif->lwip; }
+esp_err_t esp_netif_tcpip_exec(esp_netif_callback_fn fn, void *ctx) { return fn(ctx); }
+
+esp_netif_t *esp_netif_new(const esp_netif_config_t *config) {
+    if (!config->ap) return &sta;
+    memset(&ap, 0, sizeof(ap));
+    ap.ap = true;
+    return &ap;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info) {
+    memset(ip_info, 0, sizeof(*ip_info));
+    ip_info->ip.addr = netif->lwip.ip_addr.addr;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_get_status(esp_netif_t *netif, esp_netif_dhcp_status_t *status) {
+    *status = static_ip ? ESP_NETIF_DHCP_STOPPED : ESP_NETIF_DHCP_STARTED;
+    return ESP_OK;
+}
+
+/**
+ * @brief esp_netif posts a lease only when the address changed
+ */
+static void report_ip(void) {
+    struct esp_netif_obj *netif = &sta;
+    if (netif->lwip.ip_addr.addr == netif->reported_ip) return;
+
+    ip_event_got_ip_t event = { .esp_netif = netif, .ip_changed = netif->lwip.ip_addr.addr != netif->old_ip };
+    event.ip_info.ip.addr = netif->lwip.ip_addr.addr;
+    netif->reported_ip = netif->old_ip = netif->lwip.ip_addr.addr;
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &event, sizeof(event), 0);
+}
+
+/**
+ * @brief Takes the address away, as esp_netif_down() does
+ */
+static void drop_ip(struct esp_netif_obj *netif) {
+    if (netif->lwip.ip_addr.addr != 0 && ip_dropped_at < 0) ip_dropped_at = now_ms;
+    netif->reported_ip = 0;
+    netif->lwip.ip_addr.addr = 0;
+    netif->lwip.link_up = false;
+    netif->lwip.dhcp_state = DHCP_OFF;
+    reply_at = -1;
+}
+
+void esp_netif_action_start(void *netif, esp_event_base_t base, int32_t event_id, void *data) {
+    if (netif != &ap) return;
+    ap.lwip.link_up = true;
+    ap_server_running = true;
+}
+
+void esp_netif_action_stop(void *netif, esp_event_base_t base, int32_t event_id, void *data) {
+    if (netif == &ap) {
+        ap.lwip.link_up = false;
+        ap_server_stop();
+        return;
+    }
+    drop_ip(netif);
+}
+
+void esp_netif_action_connected(void *esp_netif, esp_event_base_t base, int32_t event_id, void *data) {
+    struct esp_netif_obj *netif = esp_netif;
+    netif->lwip.link_up = true;
+    if (static_ip) {
+        netif->lwip.ip_addr.addr = server_ip;
+        report_ip();
+        return;
+    }
+    netif->lwip.dhcp_state = DHCP_SELECTING;
+    reply_at = now_ms + DHCP_RTT_MS;
+}
+
+void esp_netif_action_disconnected(void *netif, esp_event_base_t base, int32_t event_id, void *data) {
+    drop_ip(netif);
+}
+
+/* ---- Stand-ins: lwIP netif and DHCP client ---- */
+
+void netif_set_link_down(struct netif *netif) {
+    netif->link_up = false;
+}
+
+void netif_set_link_up(struct netif *netif) {
+    netif->link_up = true;
+    // dhcp_network_changed(): a bound or rebooting client revalidates its address
+    if (netif->dhcp_state == DHCP_BOUND || netif->dhcp_state == DHCP_REBOOTING) {
+        netif->dhcp_state = DHCP_REBOOTING;
+        reply_at = now_ms + DHCP_RTT_MS;
+    }
+}
+
+uint8_t dhcp_supplied_address(const struct netif *netif) {
+    return netif->dhcp_state == DHCP_BOUND;
+}
+
+/**
+ * @brief The server answers the pending request, if the link is up to carry it
+ */
+static void dhcp_reply(void) {
+    struct netif *netif = &sta.lwip;
+
+    reply_at = -1;
+    if (!netif->link_up) return;
+    if (netif->dhcp_state == DHCP_REBOOTING && server_nak) {
+        if (ip_dropped_at < 0) ip_dropped_at = now_ms;
+        netif->ip_addr.addr = 0;
+        sta.reported_ip = 0;
+        netif->dhcp_state = DHCP_SELECTING;
+        reply_at = now_ms + DHCP_RTT_MS;
+        return;
+    }
+    if (netif->dhcp_state == DHCP_SELECTING) netif->ip_addr.addr = server_ip;
+    netif->dhcp_state = DHCP_BOUND;
+    report_ip();
+}
+
+/* ---- Application and test driver ---- */
+
+static void app_handler(void *arg, esp_event_base_t base, int32_t event_id, void *data) {
+    ip_event_got_ip_t *event = (ip_event_got_ip_t *)data;
+    if (got_ip_count < MAX_GOT_IP) {
+        got_ip[got_ip_count++] = (got_ip_t){ now_ms, event->ip_info.ip.addr, event->ip_changed };
+    }
+    if (verbose) {
+        printf("  %6lld ms  GOT_IP " IPSTR "%s\n", (long long)now_ms, IP2STR(&event->ip_info.ip),
+               event->ip_changed ? " (changed)" : "");
+    }
+}
+
+/**
+ * @brief Runs the timers, the DHCP server and the event loop up to a time
+ */
+static void run_until(int64_t end_ms) {
+    for (; now_ms <= end_ms; now_ms++) {
+        if (now_ms % CONN_TIMER_TICK_MS == 0) {
+            timer_wheel_timer_t *timer;
+            while ((timer = timer_wheel_expire(&wheel, now_ms / CONN_TIMER_TICK_MS))) {
+                timer->callback(timer->arg);
+            }
+        }
+        if (reply_at >= 0 && now_ms >= reply_at) dhcp_reply();
+        dispatch();
+    }
+    now_ms = end_ms;
+}
+
+static void post_connected(const uint8_t *ssid) {
+    wifi_event_sta_connected_t event = { 0 };
+    memcpy(event.ssid, ssid, sizeof(event.ssid));
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &event, sizeof(event), 0);
+    if (verbose) printf("  %6lld ms  connected to %s\n", (long long)now_ms, (const char *)ssid);
+}
+
+static void post_disconnected(const uint8_t *ssid) {
+    wifi_event_sta_disconnected_t event = { .reason = 200 };     // Beacon timeout
+    memcpy(event.ssid, ssid, sizeof(event.ssid));
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event, sizeof(event), 0);
+    if (verbose) printf("  %6lld ms  beacon lost\n", (long long)now_ms);
+}
+
+/**
+ * @brief Resets the stand-ins, connects and waits for the first lease
+ */
+static void start(uint32_t grace_ms) {
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_STOP, NULL, 0, 0);
+    dispatch();
+
+    now_ms = 0;
+    timer_wheel_init(&wheel, 0);
+    queue_full_until = -1;
+    memset(&sta.lwip, 0, sizeof(sta.lwip));
+    sta.reported_ip = sta.old_ip = 0;
+    IP4_ADDR((esp_ip4_addr_t *)&server_ip, 192, 168, 0, 23);
+    server_nak = false;
+    static_ip = false;
+    reply_at = -1;
+    wifi_netif_set_outage_grace(grace_ms);
+
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, 0);
+    post_connected(SITE);
+    run_until(1000);
+    got_ip_count = 0;
+    ip_dropped_at = -1;
+}
+
+static bool failed_check;
+
+static void check(bool ok, const char *fmt, ...) {
+    va_list args;
+    if (ok) return;
+    failed_check = true;
+    printf("     ");
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+}
+
+/* ---- Scenarios, each returns with the results in got_ip and ip_dropped_at ---- */
+
+static uint32_t kept_ip;
+
+// 2 s without beacons, then the same AP and an ACK for the kept address
+static void beacon_loss(void) {
+    start(GRACE_MS);
+    kept_ip = sta.lwip.ip_addr.addr;
+    post_disconnected(SITE);
+    run_until(3000);
+    post_connected(SITE);
+    run_until(10000);
+    check(ip_dropped_at < 0, "address dropped at %lld ms", (long long)ip_dropped_at);
+    check(got_ip_count == 1, "%d GOT_IP instead of 1", got_ip_count);
+    check(got_ip_count < 1 || got_ip[0].ms >= 3000 + DHCP_RTT_MS,
+          "GOT_IP at %lld ms, before the ACK", (long long)got_ip[0].ms);
+    check(got_ip_count < 1 || got_ip[0].ms <= 3000 + DHCP_RTT_MS + 60,
+          "GOT_IP at %lld ms, late after the ACK", (long long)got_ip[0].ms);
+    check(got_ip_count < 1 || (got_ip[0].ip == kept_ip && !got_ip[0].changed), "wrong GOT_IP");
+}
+
+// 2 s without beacons, the server NAKs the kept address and hands out another
+static void beacon_loss_nak(void) {
+    start(GRACE_MS);
+    kept_ip = sta.lwip.ip_addr.addr;
+    server_nak = true;
+    IP4_ADDR((esp_ip4_addr_t *)&server_ip, 192, 168, 0, 77);
+    post_disconnected(SITE);
+    run_until(3000);
+    post_connected(SITE);
+    run_until(10000);
+    check(ip_dropped_at == 3000 + DHCP_RTT_MS, "address dropped at %lld ms", (long long)ip_dropped_at);
+    check(got_ip_count == 1, "%d GOT_IP instead of 1", got_ip_count);
+    check(got_ip_count < 1 || (got_ip[0].ip == server_ip && got_ip[0].changed), "old address reported");
+}
+
+// The link drops again while the kept address is being revalidated
+static void beacon_loss_twice(void) {
+    start(GRACE_MS);
+    post_disconnected(SITE);
+    run_until(3000);
+    post_connected(SITE);
+    run_until(3100);
+    post_disconnected(SITE);
+    run_until(5000);
+    post_connected(SITE);
+    run_until(12000);
+    check(ip_dropped_at < 0, "address dropped at %lld ms", (long long)ip_dropped_at);
+    check(got_ip_count == 1, "%d GOT_IP instead of 1", got_ip_count);
+    check(got_ip_count < 1 || got_ip[0].ms >= 5000 + DHCP_RTT_MS,
+          "GOT_IP at %lld ms, before the ACK", (long long)got_ip[0].ms);
+}
+
+// Back after the grace period: the address went at its end
+static void long_outage(void) {
+    start(GRACE_MS);
+    post_disconnected(SITE);
+    run_until(8000);
+    post_connected(SITE);
+    run_until(12000);
+    check(ip_dropped_at >= 1000 + GRACE_MS && ip_dropped_at <= 1000 + GRACE_MS + CONN_TIMER_TICK_MS,
+          "address dropped at %lld ms", (long long)ip_dropped_at);
+    check(got_ip_count == 1 && got_ip[0].ms == 8000 + DHCP_RTT_MS, "no new lease after the outage");
+}
+
+// The grace period ends while the event queue is full
+static void expiry_queue_full(void) {
+    start(GRACE_MS);
+    post_disconnected(SITE);
+    queue_full_until = 1000 + GRACE_MS + 250;
+    run_until(20000);
+    check(ip_dropped_at > 1000 + GRACE_MS && ip_dropped_at <= queue_full_until + 100 + CONN_TIMER_TICK_MS,
+          "address dropped at %lld ms", (long long)ip_dropped_at);
+}
+
+// Reassociation to another network ends the outage at once
+static void other_network(void) {
+    start(GRACE_MS);
+    post_disconnected(SITE);
+    run_until(3000);
+    post_connected(OTHER);
+    run_until(6000);
+    check(ip_dropped_at == 3000, "address dropped at %lld ms", (long long)ip_dropped_at);
+    check(got_ip_count == 1 && got_ip[0].ms == 3000 + DHCP_RTT_MS, "no new lease on the other network");
+}
+
+// A static address has no lease to revalidate
+static void static_address(void) {
+    start(GRACE_MS);
+    static_ip = true;
+    post_disconnected(SITE);
+    run_until(3000);
+    post_connected(SITE);
+    run_until(6000);
+    check(ip_dropped_at < 0, "address dropped at %lld ms", (long long)ip_dropped_at);
+    check(got_ip_count == 1 && got_ip[0].ms == 3000, "GOT_IP not at the reassociation");
+}
+
+// Without a grace period the address goes with the link
+static void no_grace(void) {
+    start(0);
+    post_disconnected(SITE);
+    run_until(3000);
+    post_connected(SITE);
+    run_until(6000);
+    check(ip_dropped_at == 1000, "address dropped at %lld ms", (long long)ip_dropped_at);
+    check(got_ip_count == 1 && got_ip[0].ms == 3000 + DHCP_RTT_MS, "no new lease");
+}
+
+/* ---- Soft-AP lease cache ---- */
+
+/**
+ * @brief A phone joins the soft-AP and runs its DHCP client
+ * @param had_lease The phone holds a lease of this AP and asks for it with an INIT-REBOOT
+ * @return DHCP exchanges until the phone has an address, -1 if the server is not reachable
+ */
+static int phone_join(bool had_lease) {
+    int exchanges = 0;
+    bool known = false;
+
+    if (!ap_server_running || !ap.lwip.link_up) return -1;
+    for (int i = 0; i < ap_lease_count; i++) known |= memcmp(ap_leases[i], PHONE, 6) == 0;
+
+    if (had_lease) {
+        exchanges++;                      // REQUEST, then ACK or NAK
+        if (known) return exchanges;
+    }
+    exchanges += 2;                       // DISCOVER/OFFER, REQUEST/ACK
+    if (!known && ap_lease_count < MAX_LEASES) memcpy(ap_leases[ap_lease_count++], PHONE, 6);
+    return exchanges;
+}
+
+static void ap_event(int32_t event_id) {
+    esp_event_post(WIFI_EVENT, event_id, NULL, 0, 0);
+    dispatch();
+}
+
+/**
+ * @brief Destroys the AP interface of the previous scenario, a first visit of the phone follows
+ */
+static void ap_begin(bool keep_leases) {
+    if (wifi_netif_ap()) {
+        wifi_netif_ap_release();
+        ap_event(WIFI_EVENT_AP_STOP);
+    }
+    ap_server_stop();
+    wifi_netif_set_ap_keep_leases(keep_leases);
+    check(wifi_netif_ap_create() == ESP_OK, "AP interface not created");
+    ap_event(WIFI_EVENT_AP_START);
+    check(phone_join(false) == 2, "first visit not a full exchange");
+}
+
+// The AP stops and starts again, the phone comes back
+static void ap_restart(void) {
+    ap_begin(true);
+    ap_event(WIFI_EVENT_AP_STOP);
+    check(phone_join(true) < 0, "server reachable while the AP is stopped");
+    check(wifi_netif_ap_create() == ESP_OK, "AP interface not created");
+    ap_event(WIFI_EVENT_AP_START);
+    ap_exchanges = phone_join(true);
+    check(ap_exchanges == 1, "%d exchanges instead of an ACK at once", ap_exchanges);
+}
+
+// The same with the lease cache off: the server forgot the phone
+static void ap_restart_no_cache(void) {
+    ap_begin(false);
+    ap_event(WIFI_EVENT_AP_STOP);
+    wifi_netif_ap_create();
+    ap_event(WIFI_EVENT_AP_START);
+    ap_exchanges = phone_join(true);
+    check(ap_exchanges == 3, "%d exchanges instead of NAK and DISCOVER", ap_exchanges);
+}
+
+// The STA connected and the AP is closed: the interface and its leases go
+static void ap_released(void) {
+    ap_begin(true);
+    wifi_netif_ap_release();
+    ap_event(WIFI_EVENT_AP_STOP);
+    check(wifi_netif_ap() == NULL, "AP interface kept after the release");
+    wifi_netif_ap_create();
+    ap_event(WIFI_EVENT_AP_START);
+    ap_exchanges = phone_join(true);
+    check(ap_exchanges == 3, "%d exchanges instead of NAK and DISCOVER", ap_exchanges);
+}
+
+// A new window opens before the released AP stopped: the interface stays
+static void ap_release_cancelled(void) {
+    ap_begin(true);
+    wifi_netif_ap_release();
+    wifi_netif_ap_create();
+    ap_event(WIFI_EVENT_AP_STOP);
+    check(wifi_netif_ap() != NULL, "AP interface destroyed");
+    ap_event(WIFI_EVENT_AP_START);
+    ap_exchanges = phone_join(true);
+    check(ap_exchanges == 1, "%d exchanges instead of an ACK at once", ap_exchanges);
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} scenario_t;
+
+static const scenario_t ap_scenarios[] = {
+    { "AP restart, leases kept", ap_restart },
+    { "AP restart, no lease cache", ap_restart_no_cache },
+    { "AP released", ap_released },
+    { "AP release cancelled", ap_release_cancelled },
+};
+
+static const scenario_t scenarios[] = {
+    { "2 s beacon loss, lease ACKed", beacon_loss },
+    { "2 s beacon loss, lease NAKed", beacon_loss_nak },
+    { "drop while revalidating", beacon_loss_twice },
+    { "outage beyond grace", long_outage },
+    { "grace expiry, queue full", expiry_queue_full },
+    { "other network", other_network },
+    { "static address", static_address },
+    { "no grace period", no_grace },
+};
+
+int main(int argc, char **argv) {
+    int opt, failed = 0;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        if (opt != 'v') {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+        verbose = true;
+    }
+
+    timer_wheel_init(&wheel, 0);
+    if (wifi_netif_init() != ESP_OK ||
+        esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, app_handler, NULL) != ESP_OK) {
+        printf("FAIL wifi_netif_init()\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        if (verbose) printf("%s\n", scenarios[i].name);
+        failed_check = false;
+        scenarios[i].run();
+        printf("%-4s %-30s %d GOT_IP, first at %lld ms, address %s\n", failed_check ? "FAIL" : "ok",
+               scenarios[i].name, got_ip_count, got_ip_count ? (long long)got_ip[0].ms : -1LL,
+               ip_dropped_at < 0 ? "kept" : "dropped");
+        failed += failed_check;
+    }
+    for (size_t i = 0; i < sizeof(ap_scenarios) / sizeof(ap_scenarios[0]); i++) {
+        failed_check = false;
+        ap_exchanges = -1;
+        ap_scenarios[i].run();
+        printf("%-4s %-30s %d DHCP exchanges for the returning phone\n", failed_check ? "FAIL" : "ok",
+               ap_scenarios[i].name, ap_exchanges);
+        failed += failed_check;
+    }
+    printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}